@@ -9,17 +9,19 @@ static char rcsid[] = "$Id: access.c 170327 2015-07-22 17:50:11Z twu $";
 
 #include <stdio.h>
 #include <stddef.h>
-#include <stdlib.h>
+#include <stdlib.h>		/* For getenv */
 #include <string.h>		/* For strerror */
 #include <errno.h>
 
 /* <unistd.h> and <sys/types.h> included in access.h */
 #include <sys/mman.h>		/* For mmap */
 
-#define PROJECT_ID 42
-#include <sys/ipc.h>
-#include <sys/shm.h>		/* For shmat and shmdt */
-#include <sys/sem.h>		/* For semaphores */
+#include <sys/file.h>		/* For flock */
+#include <sys/statvfs.h>	/* For fstatvfs */
+
+#ifdef HAVE_PTHREAD
+#include <pthread.h>		/* For warm-up thread */
+#endif
 
 #ifdef USE_MPI
 #include <mpi.h>
@@ -189,6 +191,375 @@ Access_fileio_rw (char *filename) {
 }
 
 
+/************************************************************************
+ *   Index images.  gmapindex -I packs the mapped files of a genome
+ *   into <genomedir>/<genome>.image: a table of contents followed by
+ *   each file's bytes, unchanged, at an IMAGE_ALIGNMENT boundary.
+ *   The image is mapped once, when the first file in its directory is
+ *   accessed, and Access_mmap and Access_mmap_and_preload hand out a
+ *   file's region of that mapping, while Access_allocate copies from
+ *   it.  A genome thus loads from one file that can be copied,
+ *   cached, or preloaded as a unit.  Callers munmap what they get, so
+ *   a region given out a second time is mapped on its own.  The
+ *   separate files are still needed, for index discovery and for
+ *   FILEIO access.
+ *
+ *   Validation is done once, when the image is opened: the table of
+ *   contents must match its checksum, and an entry whose file no
+ *   longer has the recorded size and modification time is dropped.
+ *   The data itself is not checksummed, since checking it would
+ *   touch every page of every file at each startup.
+ ************************************************************************/
+
+#define IMAGE_MAGIC 0x474D4150494D4732ULL /* "GMAPIMG2" */
+#define IMAGE_ALIGNMENT 65536	/* A multiple of any page size, so regions can be mapped directly */
+#define IMAGE_NAMELENGTH 96
+#define IMAGE_SUFFIX ".image"
+
+struct Image_header_T {
+  UINT8 magic;
+  UINT8 nentries;
+  UINT8 toc_checksum;		/* Over the entries */
+};
+
+typedef struct Image_entry_T *Image_entry_T;
+struct Image_entry_T {
+  char name[IMAGE_NAMELENGTH];
+  UINT8 offset;
+  UINT8 length;
+  UINT8 mtime;
+};
+
+typedef struct Image_T *Image_T;
+struct Image_T {
+  char *dir;
+  int fd;			/* -1 if the directory has no usable image */
+  char *base;			/* The whole image, or NULL if not mapped */
+  size_t len;
+  int nentries;
+  struct Image_entry_T *entries; /* Stale entries have an empty name */
+  bool *handedp;		/* Whether an entry's region of base was given out */
+};
+
+static List_T images = NULL;
+
+
+#define FNV_OFFSET_BASIS 0xCBF29CE484222325ULL
+#define FNV_PRIME 0x100000001B3ULL
+
+static UINT8
+fnv_checksum (UINT8 hash, unsigned char *bytes, size_t n) {
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    hash ^= bytes[i];
+    hash *= FNV_PRIME;
+  }
+  return hash;
+}
+
+
+/* Drops entries whose files have changed since the image was written */
+static int
+image_validate (Image_T image) {
+  char *filename;
+  int nvalid = 0, i;
+#ifdef HAVE_STRUCT_STAT64
+  struct stat64 sb;
+#else
+  struct stat sb;
+#endif
+
+  for (i = 0; i < image->nentries; i++) {
+    image->entries[i].name[IMAGE_NAMELENGTH-1] = '\0';
+    filename = (char *) CALLOC(strlen(image->dir)+strlen("/")+strlen(image->entries[i].name)+1,sizeof(char));
+    sprintf(filename,"%s/%s",image->dir,image->entries[i].name);
+#ifdef HAVE_STAT64
+    if (stat64(filename,&sb) != 0 ||
+#else
+    if (stat(filename,&sb) != 0 ||
+#endif
+	(UINT8) sb.st_size != image->entries[i].length || (UINT8) sb.st_mtime != image->entries[i].mtime ||
+	image->entries[i].offset + image->entries[i].length > (UINT8) image->len) {
+      fprintf(stderr,"Ignoring index image entry for %s, which has changed\n",filename);
+      image->entries[i].name[0] = '\0';
+    } else {
+      nvalid++;
+    }
+    FREE(filename);
+  }
+
+  return nvalid;
+}
+
+
+static Image_T
+image_read (char *dir) {
+  Image_T image;
+  struct Image_header_T header;
+  char *imagefile, *dirbase;
+  struct stat sb;
+
+  image = (Image_T) MALLOC(sizeof(*image));
+  image->dir = (char *) CALLOC(strlen(dir)+1,sizeof(char));
+  strcpy(image->dir,dir);
+  image->fd = -1;
+  image->base = (char *) NULL;
+  image->len = 0;
+  image->nentries = 0;
+  image->entries = (struct Image_entry_T *) NULL;
+  image->handedp = (bool *) NULL;
+
+  if ((dirbase = strrchr(dir,'/')) == NULL) {
+    dirbase = dir;
+  } else {
+    dirbase++;
+  }
+  imagefile = (char *) CALLOC(strlen(dir)+strlen("/")+strlen(dirbase)+strlen(IMAGE_SUFFIX)+1,sizeof(char));
+  sprintf(imagefile,"%s/%s%s",dir,dirbase,IMAGE_SUFFIX);
+
+  if ((image->fd = open(imagefile,O_RDONLY,0764)) < 0) {
+    /* No image */
+  } else if (fstat(image->fd,&sb) != 0 ||
+	     pread(image->fd,&header,sizeof(header),0) != (ssize_t) sizeof(header) ||
+	     header.magic != IMAGE_MAGIC) {
+    fprintf(stderr,"Ignoring index image %s, which is not valid for this machine\n",imagefile);
+    close(image->fd);
+    image->fd = -1;
+  } else {
+    image->nentries = (int) header.nentries;
+    image->entries = (struct Image_entry_T *) MALLOC(image->nentries*sizeof(struct Image_entry_T));
+    if (pread(image->fd,image->entries,image->nentries*sizeof(struct Image_entry_T),sizeof(header)) !=
+	(ssize_t) (image->nentries*sizeof(struct Image_entry_T)) ||
+	fnv_checksum(FNV_OFFSET_BASIS,(unsigned char *) image->entries,
+		     image->nentries*sizeof(struct Image_entry_T)) != header.toc_checksum) {
+      fprintf(stderr,"Ignoring index image %s, whose table of contents is corrupt\n",imagefile);
+      FREE(image->entries);
+      image->nentries = 0;
+      close(image->fd);
+      image->fd = -1;
+    } else {
+      image->len = (size_t) sb.st_size;
+      image->handedp = (bool *) CALLOC(image->nentries,sizeof(bool));
+      fprintf(stderr,"Using index image %s with %d files\n",imagefile,image_validate(image));
+#ifdef HAVE_MMAP
+      if ((image->base = (char *) mmap(NULL,image->len,PROT_READ,MAP_SHARED,image->fd,0)) == MAP_FAILED) {
+	image->base = (char *) NULL;
+      }
+#endif
+    }
+  }
+
+  FREE(imagefile);
+  return image;
+}
+
+
+static void
+image_free (Image_T *old) {
+#ifdef HAVE_MMAP
+  if ((*old)->base != NULL) {
+    munmap((void *) (*old)->base,(*old)->len);
+  }
+#endif
+  if ((*old)->fd >= 0) {
+    close((*old)->fd);
+  }
+  if ((*old)->entries != NULL) {
+    FREE((*old)->handedp);
+    FREE((*old)->entries);
+  }
+  FREE((*old)->dir);
+  FREE(*old);
+  return;
+}
+
+
+/* Returns the image entry for filename, if any, and its image */
+static Image_entry_T
+image_lookup (Image_T *found, char *filename) {
+  Image_T image = NULL;
+  List_T p;
+  char *dir, *basename;
+  int dirlength, i;
+
+  if ((basename = strrchr(filename,'/')) == NULL) {
+    return (Image_entry_T) NULL;
+  }
+  dirlength = basename - filename;
+  basename++;
+
+  for (p = images; p != NULL && image == NULL; p = List_next(p)) {
+    image = (Image_T) List_head(p);
+    if ((int) strlen(image->dir) != dirlength || strncmp(image->dir,filename,dirlength)) {
+      image = NULL;
+    }
+  }
+  if (image == NULL) {
+    dir = (char *) CALLOC(dirlength+1,sizeof(char));
+    strncpy(dir,filename,dirlength);
+    image = image_read(dir);
+    images = List_push(images,(void *) image);
+    FREE(dir);
+  }
+
+  for (i = 0; i < image->nentries; i++) {
+    if (!strcmp(image->entries[i].name,basename)) {
+      *found = image;
+      return &(image->entries[i]);
+    }
+  }
+
+  return (Image_entry_T) NULL;
+}
+
+
+/* Returns filename's region of the image mapping, unless it has no
+   entry or the region was given out already.  With handoutp, the
+   region is given out, and *fd gets a descriptor for the caller to
+   close. */
+static char *
+image_region (int *fd, char *filename, bool handoutp) {
+  Image_T image;
+  Image_entry_T entry;
+  int i;
+
+  if ((entry = image_lookup(&image,filename)) == NULL || image->base == NULL) {
+    return (char *) NULL;
+  } else if (image->handedp[i = entry - image->entries] == true) {
+    return (char *) NULL;
+  } else {
+    if (handoutp == true) {
+      image->handedp[i] = true;
+      *fd = dup(image->fd);
+    }
+    return &(image->base[entry->offset]);
+  }
+}
+
+
+/* Opens filename, or the image holding it, and gives the offset of
+   its contents */
+static int
+image_open (off_t *offset, Image_entry_T *entry, char *filename) {
+  Image_T image;
+
+  if ((*entry = image_lookup(&image,filename)) != NULL) {
+    *offset = (off_t) (*entry)->offset;
+    return dup(image->fd);
+  } else {
+    *offset = 0;
+    return open(filename,O_RDONLY,0764);
+  }
+}
+
+/* Callers that get no mapping fall back to FILEIO on the returned fd,
+   reading at offsets from the start of the file, so they need the
+   file itself rather than the image */
+static int
+image_unmapped_fd (int fd, Image_entry_T entry, char *filename) {
+  if (entry != NULL) {
+    close(fd);
+    if ((fd = open(filename,O_RDONLY,0764)) < 0) {
+      fprintf(stderr,"Error: can't open file %s with open for reading\n",filename);
+      exit(9);
+    }
+  }
+  return fd;
+}
+
+
+void
+Access_image_write (char *imagefile, char *dir, char **basenames, int nfiles) {
+  struct Image_header_T header;
+  struct Image_entry_T *entries;
+  FILE *fp, *input;
+  char *filename, *padding;
+  unsigned char *buffer;
+  size_t nread;
+  UINT8 offset;
+  int i;
+#ifdef HAVE_STRUCT_STAT64
+  struct stat64 sb;
+#else
+  struct stat sb;
+#endif
+
+  entries = (struct Image_entry_T *) CALLOC(nfiles,sizeof(struct Image_entry_T));
+  offset = sizeof(struct Image_header_T) + nfiles*sizeof(struct Image_entry_T);
+  for (i = 0; i < nfiles; i++) {
+    if (strlen(basenames[i]) >= IMAGE_NAMELENGTH) {
+      fprintf(stderr,"File name %s is too long for an index image\n",basenames[i]);
+      exit(9);
+    }
+    filename = (char *) CALLOC(strlen(dir)+strlen("/")+strlen(basenames[i])+1,sizeof(char));
+    sprintf(filename,"%s/%s",dir,basenames[i]);
+#ifdef HAVE_STAT64
+    if (stat64(filename,&sb) != 0) {
+#else
+    if (stat(filename,&sb) != 0) {
+#endif
+      fprintf(stderr,"Cannot find file %s\n",filename);
+      exit(9);
+    }
+    FREE(filename);
+
+    strcpy(entries[i].name,basenames[i]);
+    offset = (offset + IMAGE_ALIGNMENT - 1)/IMAGE_ALIGNMENT * IMAGE_ALIGNMENT;
+    entries[i].offset = offset;
+    entries[i].length = (UINT8) sb.st_size;
+    entries[i].mtime = (UINT8) sb.st_mtime;
+    offset += entries[i].length;
+  }
+
+  if ((fp = FOPEN_WRITE_BINARY(imagefile)) == NULL) {
+    fprintf(stderr,"Can't open file %s for writing\n",imagefile);
+    exit(9);
+  }
+
+  /* Table of contents is written again below, with its checksum */
+  memset(&header,0,sizeof(header));
+  fwrite(&header,sizeof(header),1,fp);
+  fwrite(entries,sizeof(struct Image_entry_T),nfiles,fp);
+
+  buffer = (unsigned char *) MALLOC(IMAGE_ALIGNMENT*sizeof(unsigned char));
+  padding = (char *) CALLOC(IMAGE_ALIGNMENT,sizeof(char));
+  offset = sizeof(struct Image_header_T) + nfiles*sizeof(struct Image_entry_T);
+  for (i = 0; i < nfiles; i++) {
+    fwrite(padding,sizeof(char),entries[i].offset - offset,fp);
+
+    filename = (char *) CALLOC(strlen(dir)+strlen("/")+strlen(basenames[i])+1,sizeof(char));
+    sprintf(filename,"%s/%s",dir,basenames[i]);
+    if ((input = FOPEN_READ_BINARY(filename)) == NULL) {
+      fprintf(stderr,"Cannot open file %s\n",filename);
+      exit(9);
+    }
+    while ((nread = fread(buffer,sizeof(unsigned char),IMAGE_ALIGNMENT,input)) > 0) {
+      fwrite(buffer,sizeof(unsigned char),nread,fp);
+    }
+    fclose(input);
+    FREE(filename);
+
+    fprintf(stderr,"Packed %s (%llu bytes) at offset %llu\n",
+	    basenames[i],(unsigned long long) entries[i].length,(unsigned long long) entries[i].offset);
+    offset = entries[i].offset + entries[i].length;
+  }
+  FREE(padding);
+  FREE(buffer);
+
+  header.magic = IMAGE_MAGIC;
+  header.nentries = (UINT8) nfiles;
+  header.toc_checksum = fnv_checksum(FNV_OFFSET_BASIS,(unsigned char *) entries,nfiles*sizeof(struct Image_entry_T));
+  fseeko(fp,0,SEEK_SET);
+  fwrite(&header,sizeof(header),1,fp);
+  fwrite(entries,sizeof(struct Image_entry_T),nfiles,fp);
+  fclose(fp);
+
+  FREE(entries);
+  return;
+}
+
+
 #ifndef WORDS_BIGENDIAN
 /* Needed as a test on Macintosh machines */
 static unsigned char
@@ -276,206 +647,218 @@ first_nonzero_uint8 (size_t *i, char *filename) {
 
 
 /************************************************************************
- *   Functions for shared memory and semaphores
+ *   Functions for shared memory
+ *
+ *   Shared copies of index files are kept as files in a memory-backed
+ *   directory (/dev/shm by default, or a hugetlbfs mount given by the
+ *   GMAP_SHMEM_DIR environment variable).  Each image is named by a
+ *   hash of the source file's device, inode, size, and modification
+ *   time, so a rebuilt index never attaches a stale image.  Every
+ *   attached process holds a shared flock on its image.  Processes
+ *   take turns attaching through an exclusive flock on a companion
+ *   .lock file, and the one that finds the image missing builds it
+ *   while holding that lock.  No flock is ever converted between
+ *   shared and exclusive, since the kernel does not do that
+ *   atomically, so two starters cannot wait on each other or both
+ *   build the image.  Since the kernel drops flocks when a process
+ *   exits, a crash neither blocks other processes nor leaves a
+ *   half-built image marked as ready.  The file is sized to a multiple of the
+ *   directory's block size, since hugetlbfs accepts only whole huge
+ *   pages.
  ************************************************************************/
 
-static List_T shmem_memory = NULL;
-static Intlist_T shmem_ids = NULL;
-static Intlist_T semaphore_ids = NULL;
+#define SHMEM_DEFAULT_DIR "/dev/shm"
+#define SHMEM_MAGIC 0x474D415053484D31ULL /* "GMAPSHM1" */
+#define SHMEM_HEADER_SIZE 4096	/* Keeps the data page-aligned */
 
+typedef struct Shmem_header_T *Shmem_header_T;
+struct Shmem_header_T {
+  UINT8 magic;
+  UINT8 len;			/* Bytes of data following the header */
+  UINT4 readyp;
+};
 
-#define SEMAPHORE_NA 0	/* For commands, like removal, where semnum
-			   argument is ignored */
-#define SEMAPHORE_CREATION 0	/* -1 to lock, +1 to unlock */
+typedef struct Shmem_T *Shmem_T;
+struct Shmem_T {
+  int id;
+  int fd;
+  void *base;
+  size_t mapped_len;
+  char *path;
+  char *lockpath;
+};
 
-/* See if item is already in shared memory */
-static bool
-shmem_exists_p (int *shmid, key_t key) {
-  if ((*shmid = shmget(key,0,0)) == -1) {
-    return false;
-  } else {
-    return true;
-  }
-}
+static List_T shmem_registry = NULL;
+static int shmem_next_id = 1;
 
 
-static short
-shmem_nattached (int shmid) {
-  struct shmid_ds buf;
+static char *
+shmem_path (char *filename) {
+  char *path, *dir, *basename;
+#ifdef HAVE_STRUCT_STAT64
+  struct stat64 sb;
+#else
+  struct stat sb;
+#endif
+  UINT8 key[4], hash = 0xCBF29CE484222325ULL; /* FNV-1a */
+  unsigned char *p;
+  int i;
 
-  if (shmctl(shmid,IPC_STAT,&buf) == -1) {
-#if 0
-    fprintf(stderr,"Error in shmem_nattached with shmctl.  Error %d: %s\n",
-	    errno,strerror(errno));
+#ifdef HAVE_STAT64
+  if (stat64(filename,&sb) != 0) {
+#else
+  if (stat(filename,&sb) != 0) {
 #endif
-    return -1;
-  } else {
-    return buf.shm_nattch;
+    return (char *) NULL;
   }
-}
-
-
-void
-Access_shmem_remove (char *filename) {
-  key_t key;
-  int shmid, semid;
-  struct shmid_ds *buf = NULL;
-
-  key = ftok(filename,PROJECT_ID);
-  if (shmem_exists_p(&shmid,key) == false) {
-    /* Nothing to do */
-  } else if (shmctl(shmid,IPC_RMID,buf) == -1) {
-    fprintf(stderr,"Error with shmctl.  Error %d: %s\n",errno,strerror(errno));
-  } else {
-    fprintf(stderr,"Successfully removed existing memory\n");
+  key[0] = (UINT8) sb.st_dev;
+  key[1] = (UINT8) sb.st_ino;
+  key[2] = (UINT8) sb.st_size;
+  key[3] = (UINT8) sb.st_mtime;
+  for (p = (unsigned char *) key, i = 0; i < (int) sizeof(key); i++) {
+    hash ^= p[i];
+    hash *= 0x100000001B3ULL;
   }
 
-  if ((semid = semget(key,/*nsems*/0,0)) == -1) {
-    /* Nothing to do */
+  if ((dir = getenv("GMAP_SHMEM_DIR")) == NULL) {
+    dir = SHMEM_DEFAULT_DIR;
+  }
+  if ((basename = strrchr(filename,'/')) == NULL) {
+    basename = filename;
   } else {
-    fprintf(stderr,"Removing semaphore set %d\n",semid);
-    semctl(semid,SEMAPHORE_NA,IPC_RMID,NULL);
+    basename++;
   }
 
-  return;
+  path = (char *) CALLOC(strlen(dir)+strlen("/gmap-")+strlen(basename)+strlen("-")+16+1,sizeof(char));
+  sprintf(path,"%s/gmap-%s-%016llX",dir,basename,(unsigned long long) hash);
+  return path;
 }
 
-static void
-semaphore_init (int semid, int sem_i, int value) {
-  union semun {
-    int val;
-    struct semid_ds *buf;
-    ushort *array;
-  } argument;
-
-  argument.val = value;
-  semctl(semid,sem_i,SETVAL,argument);
-  return;
-}
 
-#if 0
-static int
-semaphore_value (int semid, int sem_i) {
-  return semctl(semid,sem_i,GETVAL,NULL);
-}
-#endif
+static char *
+shmem_lockpath (char *path) {
+  char *lockpath;
 
-#if 0
-static int
-semaphore_nwaiting (int semid, int sem_i) {
-  printf("nwaiting = %d\n",semctl(semid,sem_i,GETNCNT,NULL));
-  return semctl(semid,sem_i,GETNCNT,NULL);
+  lockpath = (char *) CALLOC(strlen(path)+strlen(".lock")+1,sizeof(char));
+  sprintf(lockpath,"%s.lock",path);
+  return lockpath;
 }
-#endif
 
-#if 0
-/* If already locked, then puts process to sleep */
-static void
-semaphore_lock (int semid) {
-  struct sembuf op;
 
-  /* printf("Process %d locking semaphore %d\n",getpid(),semid); */
-  op.sem_num = SEMAPHORE_CREATION;
-  op.sem_op = -1;
-  op.sem_flg = SEM_UNDO;
-  semop(semid,&op,1);
+/* Rounds the image up to whole blocks of the file system holding it,
+   which for hugetlbfs is the huge page size */
+static size_t
+shmem_mapped_len (int fd, size_t len) {
+  struct statvfs sfs;
+  size_t blocksize;
 
-  return;
+  len += SHMEM_HEADER_SIZE;
+  if (fstatvfs(fd,&sfs) == 0 && (blocksize = (size_t) sfs.f_bsize) > 0) {
+    len = (len + blocksize - 1)/blocksize*blocksize;
+  }
+  return len;
 }
-#endif
 
-#if 0
-static int
-semaphore_unlock (int semid) {
-  struct sembuf op;
-
-  /* printf("Process %d unlocking semaphore %d\n",getpid(),semid); */
-  op.sem_num = SEMAPHORE_CREATION;
-  op.sem_op = +1;
-  op.sem_flg = SEM_UNDO;
-  semop(semid,&op,1);
 
-  /* printf("%d processes still waiting\n",semctl(semid,SEMAPHORE_CREATION,GETNCNT,NULL)); */
+static bool
+shmem_ready_p (int fd, size_t len) {
+  struct Shmem_header_T header;
+  struct stat sb;
 
-  return semctl(semid,SEMAPHORE_CREATION,GETNCNT,NULL);
+  if (fstat(fd,&sb) != 0 || (size_t) sb.st_size < SHMEM_HEADER_SIZE + len) {
+    return false;
+  } else if (pread(fd,&header,sizeof(header),0) != (ssize_t) sizeof(header)) {
+    return false;
+  } else if (header.magic != SHMEM_MAGIC || header.len != (UINT8) len || header.readyp == 0) {
+    return false;
+  } else {
+    return true;
+  }
 }
-#endif
 
 
-/* Same as semaphore_lock */
-static void
-semaphore_wait (int semid) {
-  struct sembuf op;
+void
+Access_shmem_remove (char *filename) {
+  char *path, *lockpath;
 
-  /* printf("Process %d locking semaphore %d\n",getpid(),semid); */
-  op.sem_num = SEMAPHORE_CREATION;
-  op.sem_op = -1;
-  op.sem_flg = SEM_UNDO;
-  semop(semid,&op,1);
+  if ((path = shmem_path(filename)) == NULL) {
+    /* Nothing to do */
+  } else {
+    if (unlink(path) == 0) {
+      fprintf(stderr,"Successfully removed existing memory %s\n",path);
+    }
+    lockpath = shmem_lockpath(path);
+    unlink(lockpath);
+    FREE(lockpath);
+    FREE(path);
+  }
 
   return;
 }
 
 
-void
-Access_controlled_cleanup () {
-  List_free(&shmem_memory);
-  Intlist_free(&shmem_ids);
-  Intlist_free(&semaphore_ids);
+/* Drops the shared lock, and removes the image if no other process
+   still holds one.  A process busy attaching holds the .lock file, so
+   the image is left in place for it.  Neither lock is waited for,
+   since this also runs from Access_emergency_cleanup. */
+static void
+shmem_detach (Shmem_T shmem, bool verbosep) {
+  int lockfd;
+
+  munmap(shmem->base,shmem->mapped_len);
+  flock(shmem->fd,LOCK_UN);
+  if ((lockfd = open(shmem->lockpath,O_RDWR)) >= 0 && flock(lockfd,LOCK_EX | LOCK_NB) != 0) {
+    if (verbosep == true) {
+      fprintf(stderr,"Other processes attaching to %s\n",shmem->path);
+    }
+  } else if (flock(shmem->fd,LOCK_EX | LOCK_NB) != 0) {
+    if (verbosep == true) {
+      fprintf(stderr,"Other processes still attached to %s\n",shmem->path);
+    }
+  } else {
+    unlink(shmem->path);
+    unlink(shmem->lockpath);
+    if (verbosep == true) {
+      fprintf(stderr,"Removed existing memory %s\n",shmem->path);
+    }
+  }
+  if (lockfd >= 0) {
+    close(lockfd);
+  }
+  close(shmem->fd);
+  FREE(shmem->lockpath);
+  FREE(shmem->path);
+  FREE(shmem);
   return;
 }
 
 
 void
-Access_emergency_cleanup () {
+Access_controlled_cleanup () {
   List_T p;
-  Intlist_T q;
-  void *memory;
-  int shmid, semid;
-  int nattached;
-  struct shmid_ds *buf = NULL;
-  
-  fprintf(stderr,"Calling Access_emergency_cleanup\n");
-  for (p = shmem_memory, q = shmem_ids; p != NULL; p = List_next(p), q = Intlist_next(q)) {
-    memory = List_head(p);
-    shmid = Intlist_head(q);
+  Image_T image;
 
-    if (shmdt(memory) == -1) {
-#if 0
-      /* Somehow, shmdt forks and prints the error message and continues with the rest of the code */
-      fprintf(stderr,"Error in Access_emergency_cleanup with shmdt on memory %p, shmid %d.  Error %d: %s\n",
-	      memory,shmid,errno,strerror(errno));
-#endif
-    }
+  List_free(&shmem_registry);
 
-    if ((nattached = shmem_nattached(shmid)) > 0) {
-      fprintf(stderr,"For shmid %d, %d other processes still attached\n",shmid,(int) nattached);
-
-    } else if (shmctl(shmid,IPC_RMID,buf) == -1) {
-#if 0
-      fprintf(stderr,"Error in Access_emergency_cleanup with shmctl.  Error %d: %s\n",
-	      errno,strerror(errno));
-#endif
-    } else {
-      fprintf(stderr,"Removed existing memory for shmid %d\n",shmid);
-    }
+  for (p = images; p != NULL; p = List_next(p)) {
+    image = (Image_T) List_head(p);
+    image_free(&image);
   }
+  List_free(&images);
+
+  return;
+}
 
-  for (q = semaphore_ids; q != NULL; q = Intlist_next(q)) {
-    /* Many of these removals will be for semaphores that don't exist */
-    semid = Intlist_head(q);
-    semctl(semid,/*semnum*/0,IPC_RMID,NULL);
-  }
-  Intlist_free(&semaphore_ids);
 
-  if (shmem_memory != NULL) {
-    fprintf(stderr,"\n");
-    fprintf(stderr,"You may want to run 'ipcs -m' to see if any shared memory segments are still in use\n");
-    fprintf(stderr,"You can remove a shared memory segment manually by doing 'ipcrm -m <shmid>'\n");
-    fprintf(stderr,"\n");
-    List_free(&shmem_memory);
-    Intlist_free(&shmem_ids);
+void
+Access_emergency_cleanup () {
+  List_T p;
+
+  fprintf(stderr,"Calling Access_emergency_cleanup\n");
+  for (p = shmem_registry; p != NULL; p = List_next(p)) {
+    shmem_detach((Shmem_T) List_head(p),/*verbosep*/true);
   }
+  List_free(&shmem_registry);
 
   return;
 }
@@ -483,29 +866,25 @@ Access_emergency_cleanup () {
 
 void
 Access_deallocate (void *memory, int shmid) {
-  struct shmid_ds *buf = NULL;
-  short nattached;
-
-  if (shmdt(memory) == -1) {
-#if 0      
-      /* Somehow, shmdt forks and prints the error message and continues with the rest of the code */
-      fprintf(stderr,"Error in Access_emergency_cleanup with shmdt on memory %p, shmid %d.  Error %d: %s\n",
-	      memory,shmid,errno,strerror(errno));
-#endif
-  }
-
-  if ((nattached = shmem_nattached(shmid)) > 0) {
-    fprintf(stderr,"For shmid %d, %d processes still attached\n",shmid,(int) nattached);
-  } else if (shmctl(shmid,IPC_RMID,buf) == -1) {
-#if 0
-    /* Somehow, shmctl forks and prints the error message and continues with the rest of the code */
-    fprintf(stderr,"Error in Access_deallocate with shmctl.  Error %d: %s\n",
-	    errno,strerror(errno));
-#endif
-  } else {
-    fprintf(stderr,"Removed existing memory for shmid %d\n",shmid);
+  List_T p, prev = NULL;
+  Shmem_T shmem;
+
+  for (p = shmem_registry; p != NULL; prev = p, p = List_next(p)) {
+    shmem = (Shmem_T) List_head(p);
+    if (shmem->id == shmid) {
+      if (prev == NULL) {
+	shmem_registry = List_next(p);
+      } else {
+	List_tail_set(prev,List_next(p));
+      }
+      List_tail_set(p,NULL);
+      List_free(&p);
+      shmem_detach(shmem,/*verbosep*/true);
+      return;
+    }
   }
 
+  fprintf(stderr,"Access_deallocate called on memory %p with unknown shmid %d\n",memory,shmid);
   return;
 }
 
@@ -517,11 +896,22 @@ static void
 copy_memory_from_file (void *memory, char *filename, size_t filesize, size_t eltsize) {
   FILE *fp;
   void *p;
+  char *region;
   size_t i;
+  int fd;
+  off_t offset;
+  Image_entry_T entry;
 
-  if ((fp = FOPEN_READ_BINARY(filename)) == NULL) {
+  if ((region = image_region(/*fd*/NULL,filename,/*handoutp*/false)) != NULL) {
+    memcpy(memory,(void *) region,filesize);
+    return;
+  }
+
+  if ((fd = image_open(&offset,&entry,filename)) < 0 || (fp = fdopen(fd,"rb")) == NULL) {
     fprintf(stderr,"Error: can't open file %s with fopen\n",filename);
     exit(9);
+  } else if (offset > 0) {
+    fseeko(fp,offset,SEEK_SET);
   }
   
   if (eltsize == 1) {
@@ -567,68 +957,114 @@ copy_memory_from_file (void *memory, char *filename, size_t filesize, size_t elt
 }
 
 
-static void *
-shmem_attach (int *shmid, char *filename, off_t filesize, size_t eltsize) {
-  void *memory = NULL;
-  key_t key;
-  int semid;
-
-  key = ftok(filename,PROJECT_ID);
-  if ((semid = semget(key,/*nsems*/1,IPC_CREAT | IPC_EXCL | 0666)) != -1) {
-    /* Usually, we would set the value to be 1.  However, we can set
-       the value to 0, because this process won't perform semaphore_wait */
-    semaphore_init(semid,SEMAPHORE_CREATION,/*value*/0);
-
-    /* Store semid in case we abort in the middle of this procedure */
-    semaphore_ids = Intlist_push(semaphore_ids,semid);
-  } else if ((semid = semget(key,0,0)) == -1) {
-    fprintf(stderr,"Error in getting semaphore\n");
-    abort();
-  } else {
-    semaphore_wait(semid);
+/* Takes the exclusive lock on lockpath, retrying if shmem_detach
+   removed the file while we waited, so that every starter locks the
+   same file */
+static int
+shmem_lock (char *lockpath) {
+  int lockfd;
+  struct stat sb_fd, sb_path;
+
+  while (1) {
+    if ((lockfd = open(lockpath,O_RDWR | O_CREAT,0666)) < 0) {
+      fprintf(stderr,"Cannot open lock file %s.  Error %d: %s\n",lockpath,errno,strerror(errno));
+      return -1;
+    }
+    flock(lockfd,LOCK_EX);
+    if (fstat(lockfd,&sb_fd) == 0 && stat(lockpath,&sb_path) == 0 &&
+	sb_fd.st_dev == sb_path.st_dev && sb_fd.st_ino == sb_path.st_ino) {
+      return lockfd;
+    }
+    close(lockfd);
   }
+}
 
-  /* The process tha created the semaphore will proceed, while the
-     others wait.  They will be woken up when the semaphore is
-     removed. */
 
-  if ((*shmid = shmget(key,filesize,IPC_CREAT | IPC_EXCL |
-#ifdef HAVE_SHM_NORESERVE
-		       SHM_NORESERVE | 
-#endif
-		       0666)) != -1) {
-    /* Created new shared memory */
-    if ((memory = shmat(*shmid,NULL,0)) == (void *) -1) {
-      fprintf(stderr,"Error with shmat.  Error %d: %s\n",errno,strerror(errno));
-    } else {
-      shmem_memory = List_push(shmem_memory,memory);
-      shmem_ids = Intlist_push(shmem_ids,*shmid);
-      copy_memory_from_file(memory,filename,filesize,eltsize);
-      fprintf(stderr,"Attached new memory for %s...",filename);
+static void *
+shmem_attach (int *shmid, char *filename, off_t filesize, size_t eltsize) {
+  Shmem_T shmem;
+  Shmem_header_T header;
+  char *path, *lockpath;
+  int fd, lockfd;
+  size_t mapped_len;
+  void *base;
+  bool builtp = false;
+
+  if ((path = shmem_path(filename)) == NULL) {
+    return (void *) NULL;
+  }
+  lockpath = shmem_lockpath(path);
+  if ((lockfd = shmem_lock(lockpath)) < 0) {
+    FREE(lockpath);
+    FREE(path);
+    return (void *) NULL;
+  } else if ((fd = open(path,O_RDWR | O_CREAT,0666)) < 0) {
+    fprintf(stderr,"Cannot open shared memory file %s.  Error %d: %s\n",path,errno,strerror(errno));
+    close(lockfd);
+    FREE(lockpath);
+    FREE(path);
+    return (void *) NULL;
+  }
+  mapped_len = shmem_mapped_len(fd,(size_t) filesize);
+
+  /* Holding the .lock file, we are the only process attaching, so an
+     image that is not ready was never finished and no one is using it */
+  if (shmem_ready_p(fd,(size_t) filesize) == false) {
+    if (ftruncate(fd,0) != 0 || ftruncate(fd,(off_t) mapped_len) != 0) {
+      fprintf(stderr,"Cannot size shared memory file %s.  Error %d: %s\n",path,errno,strerror(errno));
+      close(fd);
+      unlink(path);
+      close(lockfd);
+      FREE(lockpath);
+      FREE(path);
+      return (void *) NULL;
     }
-
-  } else if ((*shmid = shmget(key,0,0)) != -1) {
-    /* Found existing shared memory */
-    if ((memory = shmat(*shmid,NULL,0)) == (void *) -1) {
-      fprintf(stderr,"Error with shmat.  Error %d: %s\n",errno,strerror(errno));
-    } else {
-      shmem_memory = List_push(shmem_memory,memory);
-      shmem_ids = Intlist_push(shmem_ids,*shmid);
-      fprintf(stderr,"Attached existing memory for %s...",filename);
+    base = mmap(NULL,mapped_len,PROT_READ | PROT_WRITE,MAP_SHARED,fd,0);
+    if (base == MAP_FAILED) {
+      fprintf(stderr,"Cannot map shared memory file %s.  Error %d: %s\n",path,errno,strerror(errno));
+      close(fd);
+      unlink(path);
+      close(lockfd);
+      FREE(lockpath);
+      FREE(path);
+      return (void *) NULL;
     }
-    
-  } else {
-    fprintf(stderr,"Using malloc instead of shmget for file %s\n",filename);
-    memory = (void *) NULL;
+    copy_memory_from_file((void *) &(((unsigned char *) base)[SHMEM_HEADER_SIZE]),filename,filesize,eltsize);
+    header = (Shmem_header_T) base;
+    header->magic = SHMEM_MAGIC;
+    header->len = (UINT8) filesize;
+    header->readyp = 1;
+    munmap(base,mapped_len);
+    builtp = true;
+  }
+  flock(fd,LOCK_SH);
+  close(lockfd);		/* Releases the .lock file */
+
+  if ((base = mmap(NULL,mapped_len,PROT_READ,MAP_SHARED,fd,0)) == MAP_FAILED) {
+    fprintf(stderr,"Cannot map shared memory file %s.  Error %d: %s\n",path,errno,strerror(errno));
+    flock(fd,LOCK_UN);
+    close(fd);
+    FREE(lockpath);
+    FREE(path);
+    return (void *) NULL;
   }
 
-  /* The process that proceeded removes the semaphore here, allowing
-     the other processes to continue after their waits.  The other
-     processes will try to remove the semaphore too, yielding an
-     error, which we simply ignore. */
-  semctl(semid,SEMAPHORE_NA,IPC_RMID,NULL);
+  shmem = (Shmem_T) MALLOC(sizeof(*shmem));
+  shmem->id = *shmid = shmem_next_id++;
+  shmem->fd = fd;
+  shmem->base = base;
+  shmem->mapped_len = mapped_len;
+  shmem->path = path;
+  shmem->lockpath = lockpath;
+  shmem_registry = List_push(shmem_registry,(void *) shmem);
+
+  if (builtp == true) {
+    fprintf(stderr,"Attached new memory for %s...",filename);
+  } else {
+    fprintf(stderr,"Attached existing memory for %s...",filename);
+  }
 
-  return memory;
+  return (void *) &(((unsigned char *) base)[SHMEM_HEADER_SIZE]);
 }
 
 
@@ -744,6 +1180,234 @@ get_pagesize () {
 }
 
 
+/************************************************************************
+ *   Background warm-up
+ ************************************************************************/
+
+/* Regions memory-mapped with Access_mmap between Access_warmup_init
+   and Access_warmup_start are faulted in, and optionally locked, by a
+   background thread while the aligner is already running.  Regions
+   are visited smallest first, since the small tables (offsets,
+   suffix array indices) are consulted for every read, and visiting
+   stops once available RAM would be exhausted, because pages touched
+   beyond that point would only evict earlier ones. */
+
+#define WARMUP_CHUNKSIZE 1048576 /* Bytes handled between checks for a stop request */
+#define WARMUP_NREPORTS 10
+#define WARMUP_RESERVE_FRACTION 16 /* Leave 1/16 of physical RAM untouched */
+
+typedef struct Warmup_region_T *Warmup_region_T;
+struct Warmup_region_T {
+  char *memory;
+  size_t len;
+};
+
+static Access_warmup_T warmup_mode = WARMUP_NONE;
+static List_T warmup_regions = NULL;
+static bool warmup_started_p = false;
+static volatile bool warmup_stop_p = false;
+#ifdef HAVE_PTHREAD
+static pthread_t warmup_thread_id;
+#endif
+
+
+void
+Access_warmup_init (Access_warmup_T mode) {
+  warmup_mode = mode;
+  warmup_started_p = false;
+  return;
+}
+
+static void
+warmup_record (void *memory, size_t len) {
+  Warmup_region_T region;
+
+  if (warmup_mode != WARMUP_NONE && warmup_started_p == false && memory != NULL && len > 0) {
+    region = (Warmup_region_T) MALLOC(sizeof(*region));
+    region->memory = (char *) memory;
+    region->len = len;
+    warmup_regions = List_push(warmup_regions,(void *) region);
+  }
+  return;
+}
+
+static int
+warmup_region_cmp (const void *a, const void *b) {
+  Warmup_region_T x = * (Warmup_region_T *) a;
+  Warmup_region_T y = * (Warmup_region_T *) b;
+
+  if (x->len < y->len) {
+    return -1;
+  } else if (y->len < x->len) {
+    return +1;
+  } else {
+    return 0;
+  }
+}
+
+
+/* Bytes of RAM that can be filled without evicting anything else.
+   Uses MemAvailable where the kernel provides it, since free pages
+   alone undercount memory held by a reclaimable page cache.  Returns
+   0 if unknown. */
+static size_t
+available_memory () {
+  size_t avail = 0, total = 0, reserve;
+  FILE *fp;
+  char line[128];
+  unsigned long kb;
+  long npages;
+
+  if ((fp = fopen("/proc/meminfo","r")) != NULL) {
+    while (fgets(line,sizeof(line),fp) != NULL) {
+      if (sscanf(line,"MemAvailable: %lu kB",&kb) == 1) {
+	avail = (size_t) kb * 1024;
+      } else if (sscanf(line,"MemTotal: %lu kB",&kb) == 1) {
+	total = (size_t) kb * 1024;
+      }
+    }
+    fclose(fp);
+  }
+
+#if defined(_SC_AVPHYS_PAGES) && defined(_SC_PHYS_PAGES)
+  if (avail == 0 && (npages = sysconf(_SC_AVPHYS_PAGES)) > 0) {
+    avail = (size_t) npages * get_pagesize();
+  }
+  if (total == 0 && (npages = sysconf(_SC_PHYS_PAGES)) > 0) {
+    total = (size_t) npages * get_pagesize();
+  }
+#endif
+
+  reserve = total/WARMUP_RESERVE_FRACTION;
+  if (avail <= reserve) {
+    return 0;
+  } else {
+    return avail - reserve;
+  }
+}
+
+
+static void *
+warmup_thread (void *data) {
+  Warmup_region_T *regions = (Warmup_region_T *) data, region;
+  size_t total = 0, done = 0, budget, pos, chunk, i;
+  volatile char sum = 0;
+  bool lockp = (warmup_mode == WARMUP_MLOCK) ? true : false;
+  int nregions, k, pagesize, nreported = 0;
+  double seconds;
+  Stopwatch_T stopwatch;
+
+  pagesize = get_pagesize();
+  for (nregions = 0; regions[nregions] != NULL; nregions++) {
+    total += regions[nregions]->len;
+  }
+  if ((budget = available_memory()) == 0 || budget > total) {
+    budget = total;
+  } else {
+    fprintf(stderr,"Warm-up: only %zu of %zu MB of index fits in available memory\n",
+	    budget/1048576,total/1048576);
+  }
+
+  Stopwatch_start(stopwatch = Stopwatch_new());
+  for (k = 0; k < nregions && done < budget && warmup_stop_p == false; k++) {
+    region = regions[k];
+#if defined(HAVE_MADVISE) && defined(HAVE_MADVISE_MADV_WILLNEED)
+    madvise(region->memory,region->len,MADV_WILLNEED);
+#endif
+    for (pos = 0; pos < region->len && done < budget && warmup_stop_p == false; pos += chunk) {
+      if ((chunk = region->len - pos) > WARMUP_CHUNKSIZE) {
+	chunk = WARMUP_CHUNKSIZE;
+      }
+
+      if (lockp == true && mlock(region->memory + pos,chunk) != 0) {
+	fprintf(stderr,"Warm-up: mlock failed (%s), so pages will be touched but not locked.  Check ulimit -l\n",
+		strerror(errno));
+	lockp = false;
+      }
+      if (lockp == false) {
+	for (i = pos; i < pos + chunk; i += pagesize) {
+	  sum += region->memory[i];
+	}
+      }
+
+      done += chunk;
+      while (nreported < WARMUP_NREPORTS && done >= total/WARMUP_NREPORTS*(nreported + 1)) {
+	nreported++;
+	fprintf(stderr,"Warm-up: %d%% of %zu MB of index\n",nreported*100/WARMUP_NREPORTS,total/1048576);
+      }
+    }
+  }
+
+  seconds = Stopwatch_stop(stopwatch);
+  Stopwatch_free(&stopwatch);
+  if (warmup_stop_p == false) {
+    fprintf(stderr,"Warm-up: %s %zu MB of index in %.1f seconds\n",
+	    lockp == true ? "locked" : "touched",done/1048576,seconds);
+  }
+
+  return (void *) NULL;
+}
+
+
+static Warmup_region_T *warmup_array = NULL;
+
+void
+Access_warmup_start () {
+  if (warmup_mode == WARMUP_NONE || warmup_started_p == true || warmup_regions == NULL) {
+    return;
+  }
+  warmup_started_p = true;
+  warmup_stop_p = false;
+
+  warmup_array = (Warmup_region_T *) List_to_array(warmup_regions,/*end*/NULL);
+  qsort(warmup_array,List_length(warmup_regions),sizeof(Warmup_region_T),warmup_region_cmp);
+
+#ifdef HAVE_PTHREAD
+  if (pthread_create(&warmup_thread_id,NULL,warmup_thread,(void *) warmup_array) != 0) {
+    fprintf(stderr,"Unable to create warm-up thread, so warming up in the foreground\n");
+    warmup_thread((void *) warmup_array);
+    warmup_started_p = false;	/* Nothing to join */
+  }
+#else
+  warmup_thread((void *) warmup_array);
+  warmup_started_p = false;
+#endif
+
+  return;
+}
+
+/* Must be called before any of the recorded regions are unmapped */
+void
+Access_warmup_finish () {
+  List_T p;
+  Warmup_region_T region;
+
+  if (warmup_mode == WARMUP_NONE) {
+    return;
+  }
+
+#ifdef HAVE_PTHREAD
+  if (warmup_started_p == true) {
+    warmup_stop_p = true;
+    pthread_join(warmup_thread_id,NULL);
+    warmup_started_p = false;
+  }
+#endif
+
+  for (p = warmup_regions; p != NULL; p = List_next(p)) {
+    region = (Warmup_region_T) List_head(p);
+    FREE(region);
+  }
+  List_free(&warmup_regions);
+  if (warmup_array != NULL) {
+    FREE(warmup_array);
+  }
+  warmup_mode = WARMUP_NONE;
+
+  return;
+}
+
+
 #ifdef HAVE_MMAP
 /* Returns NULL if mmap fails.  Bigendian conversion required */
 #ifdef HAVE_CADDR_T
@@ -752,7 +1416,8 @@ caddr_t
 void *
 #endif
 Access_mmap (int *fd, size_t *len, char *filename, size_t eltsize, bool randomp) {
-  off_t length;
+  off_t length, offset;
+  Image_entry_T entry = NULL;
 #ifdef HAVE_CADDR_T
   caddr_t memory;
 #else
@@ -764,7 +1429,17 @@ Access_mmap (int *fd, size_t *len, char *filename, size_t eltsize, bool randomp)
     *fd = open(filename,O_RDONLY,0764); /* Still need to initialize value */
     memory = (void *) NULL;
 
-  } else if ((*fd = open(filename,O_RDONLY,0764)) < 0) {
+  } else if ((memory = image_region(&(*fd),filename,/*handoutp*/true)) != NULL) {
+    debug(printf("Got region of index image for %s\n",filename));
+#ifdef HAVE_MADVISE
+#ifdef HAVE_MADVISE_MADV_RANDOM
+    if (randomp == true) {
+      madvise(memory,*len,MADV_RANDOM);
+    }
+#endif
+#endif
+
+  } else if ((*fd = image_open(&offset,&entry,filename)) < 0) {
     fprintf(stderr,"Error: can't open file %s with open for reading\n",filename);
     exit(9);
 
@@ -786,7 +1461,7 @@ Access_mmap (int *fd, size_t *len, char *filename, size_t eltsize, bool randomp)
 		  |MAP_VARIABLE
 #endif
 		  /*|MAP_NORESERVE*/
-		  ,*fd,0);
+		  ,*fd,offset);
 
     if (memory == MAP_FAILED) {
       fprintf(stderr,"Error in access.c (1): Got mmap failure on len %jd from length %jd.  Error %d: %s\n",
@@ -812,6 +1487,11 @@ Access_mmap (int *fd, size_t *len, char *filename, size_t eltsize, bool randomp)
     }
   }
 
+  if (memory == NULL) {
+    *fd = image_unmapped_fd(*fd,entry,filename);
+  }
+
+  warmup_record((void *) memory,*len);
   return memory;
 }
 #endif
@@ -1034,7 +1714,9 @@ caddr_t
 void *
 #endif
 Access_mmap_and_preload (int *fd, size_t *len, int *npages, double *seconds, char *filename, size_t eltsize) {
-  off_t length;
+  off_t length, offset;
+  Image_entry_T entry = NULL;
+  char *region = NULL;
 #ifdef HAVE_CADDR_T
   caddr_t memory;
 #else
@@ -1051,7 +1733,8 @@ Access_mmap_and_preload (int *fd, size_t *len, int *npages, double *seconds, cha
     *fd = open(filename,O_RDONLY,0764); /* Still need to initialize value */
     memory = (void *) NULL;
 
-  } else if ((*fd = open(filename,O_RDONLY,0764)) < 0) {
+  } else if ((region = image_region(&(*fd),filename,/*handoutp*/true)) == NULL &&
+	     (*fd = image_open(&offset,&entry,filename)) < 0) {
     fprintf(stderr,"Error: can't open file %s with open for reading\n",filename);
     exit(9);
 
@@ -1069,18 +1752,22 @@ Access_mmap_and_preload (int *fd, size_t *len, int *npages, double *seconds, cha
     
     Stopwatch_start(stopwatch = Stopwatch_new());
 
-    memory = mmap(NULL,length,PROT_READ,0
+    if (region != NULL) {
+      memory = (void *) region;
+    } else {
+      memory = mmap(NULL,length,PROT_READ,0
 #ifdef HAVE_MMAP_MAP_SHARED
-		  |MAP_SHARED
+		    |MAP_SHARED
 #endif
 #ifdef HAVE_MMAP_MAP_FILE
-		  |MAP_FILE
+		    |MAP_FILE
 #endif
 #ifdef HAVE_MMAP_MAP_VARIABLE
-		  |MAP_VARIABLE
+		    |MAP_VARIABLE
 #endif
-		  /*|MAP_NORESERVE*/
-		  ,*fd,0);
+		    /*|MAP_NORESERVE*/
+		    ,*fd,offset);
+    }
 
     if (memory == MAP_FAILED) {
       fprintf(stderr,"Error in access.c (5): Got mmap failure on len %jd from length %jd.  Error %d: %s\n",
@@ -1118,8 +1805,13 @@ Access_mmap_and_preload (int *fd, size_t *len, int *npages, double *seconds, cha
     }
   }
 
+  if (memory == NULL) {
+    *fd = image_unmapped_fd(*fd,entry,filename);
+  }
+
   return memory;
 }
 #endif
 
 
+
@@ -12,13 +12,12 @@
 #include <sys/types.h>		/* For size_t, and for mmap and off_t */
 #endif
 
-#include <sys/ipc.h>		/* For key_t */
-
 #include "bool.h"
 
 /* ALLOCATED implies bigendian conversion already done */
 typedef enum {USE_ALLOCATE, USE_MMAP_ONLY, USE_MMAP_PRELOAD, USE_FILEIO} Access_mode_T;
 typedef enum {ALLOCATED_PRIVATE, ALLOCATED_SHARED, MMAPPED, FILEIO} Access_T;
+typedef enum {WARMUP_NONE, WARMUP_TOUCH, WARMUP_MLOCK} Access_warmup_T;
 #define MAX32BIT 4294967295U	/* 2^32 - 1 */
 
 extern bool
@@ -39,6 +38,9 @@ Access_fileio (char *filename);
 extern int
 Access_fileio_rw (char *filename);
 
+extern void
+Access_image_write (char *imagefile, char *dir, char **basenames, int nfiles);
+
 extern void
 Access_controlled_cleanup ();
 
@@ -90,4 +92,13 @@ extern void *
 Access_mmap_and_preload (int *fd, size_t *len, int *npages, double *seconds,
 			 char *filename, size_t eltsize);
 
+extern void
+Access_warmup_init (Access_warmup_T mode);
+
+extern void
+Access_warmup_start ();
+
+extern void
+Access_warmup_finish ();
+
 #endif
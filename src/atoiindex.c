@@ -63,6 +63,7 @@ static char rcsid[] = "$Id: atoiindex.c 167263 2015-06-10 23:59:15Z twu $";
 #include "bytecoding.h"
 #include "sarray-write.h"
 #include "bitpack64-write.h"
+#include "indexdb-sort.h"
 #include "datadir.h"
 #include "getopt.h"
 
@@ -89,6 +90,7 @@ static int index1interval;
 static int required_interval = 0;
 
 static bool build_suffix_array_p = true;
+static int nthreads = 1;
 static char *snps_root = NULL;
 
 
@@ -101,6 +103,7 @@ static struct option long_options[] = {
   {"db", required_argument, 0, 'd'}, /* dbroot */
   {"usesnps", required_argument, 0, 'v'}, /* snps_root */
   {"build-sarray", required_argument, 0, 0}, /* build_suffix_array_p */
+  {"nthreads", required_argument, 0, 't'}, /* nthreads */
 
   /* Help options */
   {"version", no_argument, 0, 0}, /* print_program_version */
@@ -291,24 +294,6 @@ compute_offsets_tc (Positionsptr_T *oldoffsets, Oligospace_T oligospace, Storedo
 }
 
 
-static void
-sort_8mers (unsigned char *positions8_high, UINT4 *positions8_low, Positionsptr_T npositions) {
-  UINT8 *positions8;
-  Positionsptr_T i;
-
-  positions8 = (UINT8 *) MALLOC(npositions*sizeof(UINT8));
-  for (i = 0; i < npositions; i++) {
-    positions8[i] = ((UINT8) positions8_high[i] << 32) + positions8_low[i];
-  }
-  qsort(positions8,npositions,sizeof(UINT8),UINT8_compare);
-  for (i = 0; i < npositions; i++) {
-    positions8_high[i] = positions8[i] >> POSITIONS8_HIGH_SHIFT;
-    positions8_low[i] = positions8[i] & POSITIONS8_LOW_MASK;
-  }
-  return;
-}
-
-
 /*                                       G  C  G  T */
 static unsigned char ag_conversion[4] = {2, 1, 2, 3};
 static char AG_CHARTABLE[4] = {'G','C','G','T'};
@@ -430,8 +415,13 @@ compute_ag (char *pointers_filename, char *offsets_filename,
 
   fprintf(stderr,"Sorting AG positions...");
   offsets = compute_offsets_ag(oldoffsets,oligospace,mask);
+  if (coord_values_8p == true) {
+    Indexdb_sort_positions8(positions8_high,positions8_low,offsets,oligospace,nthreads);
+  } else {
+    Indexdb_sort_positions4(positions4,offsets,oligospace,nthreads);
+  }
 
-  /* Sort positions in each block */
+  /* Write sorted positions in each block */
   if (snps_root) {
     oligok = 0;
     snpoffsets = (Positionsptr_T *) CALLOC(oligospace+1,sizeof(Positionsptr_T));
@@ -446,8 +436,6 @@ compute_ag (char *pointers_filename, char *offsets_filename,
       block_start = offsets[oligoi];
       block_end = offsets[oligoi+1];
       if ((npositions = block_end - block_start) > 0) {
-	/* qsort(&(positions8[block_start]),npositions,sizeof(UINT8),UINT8_compare); */
-	sort_8mers(&(positions8_high[block_start]),&(positions8_low[block_start]),npositions);
 	if (snps_root == NULL) {
 	  /* FWRITE_UINT8S(&(positions8[block_start]),npositions,positions_fp); */
 	  FWRITE_CHARS(&(positions8_high[block_start]),npositions,positions_high_fp);
@@ -481,7 +469,6 @@ compute_ag (char *pointers_filename, char *offsets_filename,
       block_start = offsets[oligoi];
       block_end = offsets[oligoi+1];
       if ((npositions = block_end - block_start) > 0) {
-	qsort(&(positions4[block_start]),npositions,sizeof(UINT4),UINT4_compare);
 	if (snps_root == NULL) {
 	  FWRITE_UINTS(&(positions4[block_start]),npositions,positions_low_fp);
 	} else {
@@ -651,8 +638,13 @@ compute_tc (char *pointers_filename, char *offsets_filename,
 
   fprintf(stderr,"Sorting TC positions...");
   offsets = compute_offsets_tc(oldoffsets,oligospace,mask);
+  if (coord_values_8p == true) {
+    Indexdb_sort_positions8(positions8_high,positions8_low,offsets,oligospace,nthreads);
+  } else {
+    Indexdb_sort_positions4(positions4,offsets,oligospace,nthreads);
+  }
 
-  /* Sort positions in each block */
+  /* Write sorted positions in each block */
   if (snps_root) {
     oligok = 0;
     snpoffsets = (Positionsptr_T *) CALLOC(oligospace+1,sizeof(Positionsptr_T));
@@ -667,8 +659,6 @@ compute_tc (char *pointers_filename, char *offsets_filename,
       block_start = offsets[oligoi];
       block_end = offsets[oligoi+1];
       if ((npositions = block_end - block_start) > 0) {
-	/* qsort(&(positions8[block_start]),npositions,sizeof(UINT8),UINT8_compare); */
-	sort_8mers(&(positions8_high[block_start]),&(positions8_low[block_start]),npositions);
 	if (snps_root == NULL) {
 	  /* FWRITE_UINT8S(&(positions8[block_start]),npositions,positions_fp); */
 	  FWRITE_CHARS(&(positions8_high[block_start]),npositions,positions_high_fp);
@@ -702,7 +692,6 @@ compute_tc (char *pointers_filename, char *offsets_filename,
       block_start = offsets[oligoi];
       block_end = offsets[oligoi+1];
       if ((npositions = block_end - block_start) > 0) {
-	qsort(&(positions4[block_start]),npositions,sizeof(UINT4),UINT4_compare);
 	if (snps_root == NULL) {
 	  FWRITE_UINTS(&(positions4[block_start]),npositions,positions_low_fp);
 	} else {
@@ -806,7 +795,7 @@ main (int argc, char *argv[]) {
   int long_option_index = 0;
   const char *long_name;
 
-  while ((opt = getopt_long(argc,argv,"F:D:d:k:q:v:",
+  while ((opt = getopt_long(argc,argv,"F:D:d:k:q:v:t:",
 			    long_options,&long_option_index)) != -1) {
     switch (opt) {
     case 0: 
@@ -841,6 +830,7 @@ main (int argc, char *argv[]) {
     case 'k': required_index1part = atoi(optarg); break;
     case 'q': required_interval = atoi(optarg); break;
     case 'v': snps_root = optarg; break;
+    case 't': nthreads = atoi(optarg); break;
     default: fprintf(stderr,"Do not recognize flag %c\n",opt); exit(9);
     }
   }
@@ -1285,6 +1275,18 @@ Usage: atoiindex [OPTIONS...] -d <genome>\n\
                                    within selected basesize and k-mer size\n\
   -v, --use-snps=STRING          Use database containing known SNPs (in <STRING>.iit, built\n\
                                    previously using snpindex) for tolerance to SNPs\n\
+");
+#ifdef HAVE_PTHREAD
+  fprintf(stdout,"\
+  -t, --nthreads=INT             Number of threads for sorting positions (default 1)\n\
+");
+#else
+  fprintf(stdout,"\
+  -t, --nthreads=INT             Number of threads for sorting positions.  Flag is ignored in\n\
+                                   this version, which has pthreads disabled\n\
+");
+#endif
+  fprintf(stdout,"\
 \n\
   --version                      Show version\n\
   --help                         Show this help message\n\
@@ -0,0 +1,522 @@
+static char rcsid[] = "$Id: bgzf.c $";
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "bgzf.h"
+
+#ifdef HAVE_ZLIB
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>		/* For memchr, memcpy, strcpy */
+#include <zlib.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "mem.h"
+#include "fopen.h"
+
+
+/* Reads gzipped input for Shortread and Inbuffer, which take lines
+   with bgzfgets and characters with bgzfgetc straight out of the
+   inflated buffers, finding line ends with memchr.
+
+   A BGZF file (as written by bgzip) is a series of gzip members of at
+   most 64 KB each, whose headers give their compressed size, so
+   members can be read without inflating them first.  With background
+   threads, each thread in turn reads the next member into a ring of
+   slots and then inflates it, and the caller takes the inflated slots
+   in order.  Any other gzip file, including a multi-member one, is
+   inflated into the slots by a single read-ahead thread using gzread.
+   Without background threads, the caller inflates with gzread into a
+   buffer of its own. */
+
+#define BGZF_MAX_BLOCK 65536
+#define BGZF_HEADER_LENGTH 18	/* Fixed part of header, through BSIZE */
+#define SLOTS_PER_THREAD 4
+#define BUFFER_SIZE 131072
+
+#ifdef DEBUG
+#define debug(x) x
+#else
+#define debug(x)
+#endif
+
+
+static int nthreads = 0;
+
+void
+Bgzf_setup (int nthreads_in) {
+  nthreads = nthreads_in;
+  return;
+}
+
+
+typedef enum {SLOT_EMPTY, SLOT_FULL, SLOT_DONE} Slotstate_T;
+
+typedef struct Slot_T *Slot_T;
+struct Slot_T {
+  Slotstate_T state;
+  unsigned char *block;		/* Compressed member, including header and footer */
+  int blocklength;
+  unsigned char *inflated;
+  int inflatedlength;
+};
+
+#define T Bgzf_T
+struct T {
+  char *filename;		/* For error messages */
+  FILE *fp;			/* BGZF input */
+  gzFile gzipped;		/* Other gzip input */
+
+  unsigned char *buffer;	/* Inflated text for the caller */
+  int navail;
+  int bufferi;
+  unsigned char *ownbuffer;	/* For gzread without background threads */
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t lock;
+  pthread_cond_t empty_p;	/* Signals that the caller has finished a slot */
+  pthread_cond_t done_p;	/* Signals that a slot has been inflated */
+#endif
+  struct Slot_T *slots;		/* NULL without background threads */
+  int nslots;
+  Slot_T slot;			/* Slot being read by the caller */
+  unsigned long long nread;	/* Slots filled by background threads */
+  unsigned long long nconsumed;	/* Slots finished by the caller */
+  bool inputdonep;		/* Background threads have reached the end */
+  bool closedp;			/* Caller has called Bgzf_free */
+  int nactive;			/* Threads still using this, including the caller */
+};
+
+
+static T
+Bgzf_new (char *filename) {
+  T new = (T) MALLOC_KEEP(sizeof(*new));
+
+  new->filename = (char *) MALLOC_KEEP((strlen(filename)+1)*sizeof(char));
+  strcpy(new->filename,filename);
+  new->fp = (FILE *) NULL;
+  new->gzipped = (gzFile) NULL;
+
+  new->buffer = (unsigned char *) NULL;
+  new->navail = 0;
+  new->bufferi = 0;
+  new->ownbuffer = (unsigned char *) NULL;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_init(&new->lock,NULL);
+  pthread_cond_init(&new->empty_p,NULL);
+  pthread_cond_init(&new->done_p,NULL);
+#endif
+  new->slots = (struct Slot_T *) NULL;
+  new->nslots = 0;
+  new->slot = (Slot_T) NULL;
+  new->nread = new->nconsumed = 0;
+  new->inputdonep = false;
+  new->closedp = false;
+  new->nactive = 1;
+
+  return new;
+}
+
+static void
+destroy (T *old) {
+  int i;
+
+  for (i = 0; i < (*old)->nslots; i++) {
+    FREE_KEEP((*old)->slots[i].block);
+    FREE_KEEP((*old)->slots[i].inflated);
+  }
+  if ((*old)->slots != NULL) {
+    FREE_KEEP((*old)->slots);
+  }
+  if ((*old)->ownbuffer != NULL) {
+    FREE_KEEP((*old)->ownbuffer);
+  }
+  if ((*old)->fp != NULL) {
+    fclose((*old)->fp);
+  }
+  if ((*old)->gzipped != NULL) {
+    gzclose((*old)->gzipped);
+  }
+#ifdef HAVE_PTHREAD
+  pthread_cond_destroy(&(*old)->done_p);
+  pthread_cond_destroy(&(*old)->empty_p);
+  pthread_mutex_destroy(&(*old)->lock);
+#endif
+  FREE_KEEP((*old)->filename);
+  FREE_KEEP(*old);
+  return;
+}
+
+
+#ifdef HAVE_PTHREAD
+
+/* The last thread to finish, which may be the caller, frees this */
+static void
+release (T this) {
+  bool lastp;
+
+  pthread_mutex_lock(&this->lock);
+  lastp = (--this->nactive == 0);
+  pthread_mutex_unlock(&this->lock);
+
+  if (lastp == true) {
+    destroy(&this);
+  }
+  return;
+}
+
+
+/* Returns the total member size given by the BC subfield of a BGZF
+   header, or 0 if header is not a BGZF header */
+static int
+bgzf_blocklength (unsigned char *header) {
+  if (header[0] != 31 || header[1] != 139 || header[2] != 8 || (header[3] & 4) == 0) {
+    return 0;
+  } else if ((header[10] | (header[11] << 8)) != 6) {
+    /* XLEN */
+    return 0;
+  } else if (header[12] != 'B' || header[13] != 'C' || (header[14] | (header[15] << 8)) != 2) {
+    return 0;
+  } else {
+    /* BSIZE is the total member size minus 1 */
+    return (header[16] | (header[17] << 8)) + 1;
+  }
+}
+
+/* Returns false at end of file */
+static bool
+read_block (Slot_T slot, T this) {
+  size_t n;
+
+  if ((n = fread(slot->block,sizeof(unsigned char),BGZF_HEADER_LENGTH,this->fp)) == 0) {
+    return false;
+  } else if (n < BGZF_HEADER_LENGTH) {
+    fprintf(stderr,"Truncated BGZF header in %s\n",this->filename);
+    exit(9);
+  } else if ((slot->blocklength = bgzf_blocklength(slot->block)) < BGZF_HEADER_LENGTH + 8) {
+    fprintf(stderr,"BGZF file %s has a member without a BGZF header, so cannot be read in parallel.  Try without --gunzip-threads\n",
+	    this->filename);
+    exit(9);
+  } else if (fread(&(slot->block[BGZF_HEADER_LENGTH]),sizeof(unsigned char),slot->blocklength - BGZF_HEADER_LENGTH,this->fp) !=
+	     (size_t) (slot->blocklength - BGZF_HEADER_LENGTH)) {
+    fprintf(stderr,"Truncated BGZF member in %s\n",this->filename);
+    exit(9);
+  } else {
+    return true;
+  }
+}
+
+static void
+inflate_block (Slot_T slot, z_stream *zstream, char *filename) {
+  unsigned char *footer;
+  unsigned long crc, isize;
+
+  footer = &(slot->block[slot->blocklength - 8]);
+  crc = (unsigned long) footer[0] | ((unsigned long) footer[1] << 8) |
+    ((unsigned long) footer[2] << 16) | ((unsigned long) footer[3] << 24);
+  isize = (unsigned long) footer[4] | ((unsigned long) footer[5] << 8) |
+    ((unsigned long) footer[6] << 16) | ((unsigned long) footer[7] << 24);
+
+  inflateReset(zstream);
+  zstream->next_in = &(slot->block[BGZF_HEADER_LENGTH]);
+  zstream->avail_in = slot->blocklength - BGZF_HEADER_LENGTH - 8;
+  zstream->next_out = slot->inflated;
+  zstream->avail_out = BGZF_MAX_BLOCK;
+
+  if (inflate(zstream,Z_FINISH) != Z_STREAM_END) {
+    fprintf(stderr,"Error inflating BGZF member in %s\n",filename);
+    exit(9);
+  }
+  slot->inflatedlength = BGZF_MAX_BLOCK - zstream->avail_out;
+
+  if ((unsigned long) slot->inflatedlength != isize ||
+      crc32(crc32(0L,Z_NULL,0),slot->inflated,slot->inflatedlength) != crc) {
+    fprintf(stderr,"BGZF member in %s fails its CRC check\n",filename);
+    exit(9);
+  }
+
+  return;
+}
+
+
+static void *
+inflater_thread (void *data) {
+  T this = (T) data;
+  Slot_T slot;
+  z_stream zstream;
+  int n;
+
+  if (this->fp != NULL) {
+    zstream.zalloc = Z_NULL;
+    zstream.zfree = Z_NULL;
+    zstream.opaque = Z_NULL;
+    zstream.next_in = Z_NULL;
+    zstream.avail_in = 0;
+    if (inflateInit2(&zstream,/*raw deflate*/-15) != Z_OK) {
+      fprintf(stderr,"Unable to initialize zlib for %s\n",this->filename);
+      exit(9);
+    }
+  }
+
+  pthread_mutex_lock(&this->lock);
+  while (this->inputdonep == false && this->closedp == false) {
+    slot = &(this->slots[this->nread % this->nslots]);
+    if (slot->state != SLOT_EMPTY) {
+      pthread_cond_wait(&this->empty_p,&this->lock);
+
+    } else if (this->fp != NULL) {
+      /* Members are read in turn under the lock, and inflated outside it */
+      if (read_block(slot,this) == false) {
+	this->inputdonep = true;
+      } else {
+	slot->state = SLOT_FULL;
+	this->nread += 1;
+	pthread_mutex_unlock(&this->lock);
+
+	inflate_block(slot,&zstream,this->filename);
+
+	pthread_mutex_lock(&this->lock);
+	slot->state = SLOT_DONE;
+      }
+      pthread_cond_broadcast(&this->done_p);
+
+    } else {
+      /* A single thread reads other gzip input */
+      slot->state = SLOT_FULL;
+      pthread_mutex_unlock(&this->lock);
+
+      if ((n = gzread(this->gzipped,slot->inflated,BGZF_MAX_BLOCK)) < 0) {
+	fprintf(stderr,"Error inflating %s\n",this->filename);
+	exit(9);
+      }
+
+      pthread_mutex_lock(&this->lock);
+      if (n == 0) {
+	slot->state = SLOT_EMPTY;
+	this->inputdonep = true;
+      } else {
+	slot->inflatedlength = n;
+	slot->state = SLOT_DONE;
+	this->nread += 1;
+      }
+      pthread_cond_broadcast(&this->done_p);
+    }
+  }
+  pthread_mutex_unlock(&this->lock);
+
+  if (this->fp != NULL) {
+    inflateEnd(&zstream);
+  }
+  release(this);
+  return (void *) NULL;
+}
+
+
+static void
+start_thread (void *(*function)(void *), T this) {
+  pthread_t thread_id;
+  pthread_attr_t thread_attr;
+
+  pthread_attr_init(&thread_attr);
+  pthread_attr_setdetachstate(&thread_attr,PTHREAD_CREATE_DETACHED);
+  if (pthread_create(&thread_id,&thread_attr,function,(void *) this) != 0) {
+    fprintf(stderr,"Unable to create inflater thread for %s\n",this->filename);
+    exit(9);
+  }
+  pthread_attr_destroy(&thread_attr);
+  return;
+}
+
+#endif /* HAVE_PTHREAD */
+
+
+/* Opens filename, which may be gzipped or not.  Returns NULL if it
+   cannot be opened. */
+T
+Bgzf_open (char *filename) {
+  T this;
+#ifdef HAVE_PTHREAD
+  FILE *fp;
+  unsigned char header[BGZF_HEADER_LENGTH];
+  size_t n;
+  int nstarted, i;
+
+  if (nthreads > 0) {
+    if ((fp = FOPEN_READ_BINARY(filename)) == NULL) {
+      return (T) NULL;
+
+    } else if ((n = fread(header,sizeof(unsigned char),BGZF_HEADER_LENGTH,fp)) == BGZF_HEADER_LENGTH &&
+	       bgzf_blocklength(header) > 0) {
+      debug(fprintf(stderr,"Inflating BGZF file %s with %d threads\n",filename,nthreads));
+      rewind(fp);
+      this = Bgzf_new(filename);
+      this->fp = fp;
+      nstarted = nthreads;
+
+    } else if (n >= 2 && header[0] == 31 && header[1] == 139) {
+      debug(fprintf(stderr,"Inflating gzip file %s on a read-ahead thread\n",filename));
+      fclose(fp);
+      this = Bgzf_new(filename);
+      if ((this->gzipped = gzopen(filename,"rb")) == NULL) {
+	destroy(&this);
+	return (T) NULL;
+      }
+      nstarted = 1;
+
+    } else {
+      /* Not gzipped, so read it as is on the caller's thread */
+      fclose(fp);
+      nstarted = 0;
+    }
+
+    if (nstarted > 0) {
+      this->nslots = SLOTS_PER_THREAD * nstarted;
+      this->slots = (struct Slot_T *) MALLOC_KEEP(this->nslots*sizeof(struct Slot_T));
+      for (i = 0; i < this->nslots; i++) {
+	this->slots[i].state = SLOT_EMPTY;
+	this->slots[i].block = (unsigned char *) MALLOC_KEEP(BGZF_MAX_BLOCK*sizeof(unsigned char));
+	this->slots[i].inflated = (unsigned char *) MALLOC_KEEP(BGZF_MAX_BLOCK*sizeof(unsigned char));
+      }
+
+      this->nactive = nstarted + 1;
+      for (i = 0; i < nstarted; i++) {
+	start_thread(inflater_thread,this);
+      }
+      return this;
+    }
+  }
+#endif
+
+  this = Bgzf_new(filename);
+  if ((this->gzipped = gzopen(filename,"rb")) == NULL) {
+    destroy(&this);
+    return (T) NULL;
+  }
+  this->ownbuffer = (unsigned char *) MALLOC_KEEP(BUFFER_SIZE*sizeof(unsigned char));
+  return this;
+}
+
+
+void
+Bgzf_free (T *old) {
+#ifdef HAVE_PTHREAD
+  if ((*old)->slots != NULL) {
+    /* Background threads stop at their next slot */
+    pthread_mutex_lock(&(*old)->lock);
+    (*old)->closedp = true;
+    pthread_cond_broadcast(&(*old)->empty_p);
+    pthread_mutex_unlock(&(*old)->lock);
+    release(*old);
+    *old = (T) NULL;
+    return;
+  }
+#endif
+
+  destroy(&(*old));
+  return;
+}
+
+
+/* Makes more inflated text available, possibly none.  Returns false
+   at the end of the input. */
+static bool
+fill_buffer (T this) {
+  int n;
+#ifdef HAVE_PTHREAD
+  Slot_T slot;
+
+  if (this->slots != NULL) {
+    pthread_mutex_lock(&this->lock);
+    if (this->slot != NULL) {
+      this->slot->state = SLOT_EMPTY;
+      this->slot = (Slot_T) NULL;
+      this->nconsumed += 1;
+      pthread_cond_broadcast(&this->empty_p);
+    }
+
+    slot = &(this->slots[this->nconsumed % this->nslots]);
+    while (slot->state != SLOT_DONE) {
+      if (this->inputdonep == true && this->nconsumed == this->nread) {
+	pthread_mutex_unlock(&this->lock);
+	return false;
+      }
+      pthread_cond_wait(&this->done_p,&this->lock);
+    }
+    pthread_mutex_unlock(&this->lock);
+
+    this->slot = slot;
+    this->buffer = slot->inflated;
+    this->navail = slot->inflatedlength;
+    this->bufferi = 0;
+    return true;
+  }
+#endif
+
+  if ((n = gzread(this->gzipped,this->ownbuffer,BUFFER_SIZE)) < 0) {
+    fprintf(stderr,"Error inflating %s\n",this->filename);
+    exit(9);
+  } else if (n == 0) {
+    return false;
+  } else {
+    this->buffer = this->ownbuffer;
+    this->navail = n;
+    this->bufferi = 0;
+    return true;
+  }
+}
+
+
+int
+bgzfgetc (T this) {
+  while (this->navail == 0) {
+    if (fill_buffer(this) == false) {
+      return EOF;
+    }
+  }
+  this->navail -= 1;
+  return (int) this->buffer[this->bufferi++];
+}
+
+
+/* As gzgets: copies through the next newline, or up to maxlength - 1
+   characters, and returns NULL if there are none left */
+char *
+bgzfgets (T this, char *buffer, int maxlength) {
+  unsigned char *start, *newline;
+  int n = 0, ncopy;
+
+  while (n < maxlength - 1) {
+    if (this->navail == 0) {
+      if (fill_buffer(this) == false) {
+	break;
+      }
+    } else {
+      start = &(this->buffer[this->bufferi]);
+      if ((ncopy = this->navail) > maxlength - 1 - n) {
+	ncopy = maxlength - 1 - n;
+      }
+      if ((newline = (unsigned char *) memchr(start,'\n',ncopy)) != NULL) {
+	ncopy = newline + 1 - start;
+      }
+      memcpy(&(buffer[n]),start,ncopy);
+      n += ncopy;
+      this->bufferi += ncopy;
+      this->navail -= ncopy;
+      if (newline != NULL) {
+	break;
+      }
+    }
+  }
+
+  if (n == 0) {
+    return (char *) NULL;
+  } else {
+    buffer[n] = '\0';
+    return buffer;
+  }
+}
+
+#endif /* HAVE_ZLIB */
@@ -0,0 +1,33 @@
+/* $Id: bgzf.h $ */
+#ifndef BGZF_INCLUDED
+#define BGZF_INCLUDED
+#ifdef HAVE_CONFIG_H
+#include <config.h>		/* For HAVE_ZLIB */
+#endif
+
+#ifdef HAVE_ZLIB
+#include "bool.h"
+
+#define T Bgzf_T
+typedef struct T *T;
+
+extern void
+Bgzf_setup (int nthreads_in);
+
+extern T
+Bgzf_open (char *filename);
+
+extern void
+Bgzf_free (T *old);
+
+extern int
+bgzfgetc (T this);
+
+extern char *
+bgzfgets (T this, char *buffer, int maxlength);
+
+#undef T
+#endif
+
+#endif
+
@@ -616,6 +616,7 @@ Directions32_print (Direction32_T **directions_nogap, Direction32_T **directions
 
 #define QUERY_MAXLENGTH 500
 #define GENOMIC_MAXLENGTH 2000
+#define INITIAL_BANDWIDTH 128	/* Cells per column initially reserved for SIMD matrices */
 
 
 static void
@@ -671,35 +672,45 @@ Dynprog_new (int maxlookback, int extraquerygap, int maxpeelback,
 #endif
 #if defined(HAVE_SSE4_1) || defined(HAVE_SSE2)
   /* Use SIMD_NCHARS > SIMD_NSHORTS and sizeof(Score16_T) > sizeof(Score8_T) */
+  /* Matrices are stored by band (see dynprog_simd.c), so the spaces
+     start small and are grown by Dynprog_reserve_* for wide bands */
   if (doublep == true) {
+    new->aligned.two.upper_space_nbytes = (max_glength+1)*INITIAL_BANDWIDTH*sizeof(Score16_T);
     new->aligned.two.upper_matrix_ptrs = (void **) CALLOC(max_glength+1,sizeof(void *));
-    new->aligned.two.upper_matrix_space = (void *) _mm_malloc((max_glength+1)*(max_rlength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.two.upper_matrix_space = (void *) _mm_malloc(new->aligned.two.upper_space_nbytes,16);
     new->aligned.two.upper_directions_ptrs_0 = (void **) CALLOC(max_glength+1,sizeof(void *));
-    new->aligned.two.upper_directions_space_0 = (void *) _mm_malloc((max_glength+1)*(max_rlength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.two.upper_directions_space_0 = (void *) _mm_malloc(new->aligned.two.upper_space_nbytes,16);
     new->aligned.two.upper_directions_ptrs_1 = (void **) CALLOC(max_glength+1,sizeof(void *));
-    new->aligned.two.upper_directions_space_1 = (void *) _mm_malloc((max_glength+1)*(max_rlength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.two.upper_directions_space_1 = (void *) _mm_malloc(new->aligned.two.upper_space_nbytes,16);
 
+    new->aligned.two.lower_space_nbytes = (max_rlength+1)*INITIAL_BANDWIDTH*sizeof(Score16_T);
     new->aligned.two.lower_matrix_ptrs = (void **) CALLOC(max_rlength+1,sizeof(void *));
-    new->aligned.two.lower_matrix_space = (void *) _mm_malloc((max_rlength+1)*(max_glength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.two.lower_matrix_space = (void *) _mm_malloc(new->aligned.two.lower_space_nbytes,16);
     new->aligned.two.lower_directions_ptrs_0 = (void **) CALLOC(max_rlength+1,sizeof(void *));
-    new->aligned.two.lower_directions_space_0 = (void *) _mm_malloc((max_rlength+1)*(max_glength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.two.lower_directions_space_0 = (void *) _mm_malloc(new->aligned.two.lower_space_nbytes,16);
     new->aligned.two.lower_directions_ptrs_1 = (void **) CALLOC(max_rlength+1,sizeof(void *));
-    new->aligned.two.lower_directions_space_1 = (void *) _mm_malloc((max_rlength+1)*(max_glength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.two.lower_directions_space_1 = (void *) _mm_malloc(new->aligned.two.lower_space_nbytes,16);
 
     new->nspaces = 2;
 
   } else {
+    new->aligned.one.space_nbytes = (max_glength+1)*INITIAL_BANDWIDTH*sizeof(Score16_T);
     new->aligned.one.matrix_ptrs = (void **) CALLOC(max_glength+1,sizeof(void *));
-    new->aligned.one.matrix_space = (void *) _mm_malloc((max_glength+1)*(max_rlength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.one.matrix_space = (void *) _mm_malloc(new->aligned.one.space_nbytes,16);
     new->aligned.one.directions_ptrs_0 = (void **) CALLOC(max_glength+1,sizeof(void *));
-    new->aligned.one.directions_space_0 = (void *) _mm_malloc((max_glength+1)*(max_rlength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.one.directions_space_0 = (void *) _mm_malloc(new->aligned.one.space_nbytes,16);
     new->aligned.one.directions_ptrs_1 = (void **) CALLOC(max_glength+1,sizeof(void *));
-    new->aligned.one.directions_space_1 = (void *) _mm_malloc((max_glength+1)*(max_rlength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.one.directions_space_1 = (void *) _mm_malloc(new->aligned.one.space_nbytes,16);
     new->aligned.one.directions_ptrs_2 = (void **) CALLOC(max_glength+1,sizeof(void *));
-    new->aligned.one.directions_space_2 = (void *) _mm_malloc((max_glength+1)*(max_rlength+SIMD_NCHARS+SIMD_NCHARS)*sizeof(Score16_T),16);
+    new->aligned.one.directions_space_2 = (void *) _mm_malloc(new->aligned.one.space_nbytes,16);
 
     new->nspaces = 1;
   }
+
+  /* Profiles are rebuilt by every call, so one space is reused rather
+     than allocating five or six vectors for each small problem */
+  new->profile_nbytes = 6*(max_glength+1+SIMD_NCHARS)*sizeof(Score16_T);
+  new->profile_space = (void *) _mm_malloc(new->profile_nbytes,16);
 #endif
   return new;
 }
@@ -747,6 +758,7 @@ Dynprog_free (T *old) {
       FREE((*old)->aligned.two.lower_directions_ptrs_0);
       _mm_free((*old)->aligned.two.lower_directions_space_0);
     }
+    _mm_free((*old)->profile_space);
 #endif
 
     FREE(*old);
@@ -755,6 +767,80 @@ Dynprog_free (T *old) {
   return;
 }
 
+#if defined(HAVE_SSE4_1) || defined(HAVE_SSE2)
+/* Grows geometrically, so a few wide bands early on settle the size */
+static size_t
+grow_nbytes (size_t old_nbytes, size_t nbytes) {
+  if (nbytes < 2*old_nbytes) {
+    nbytes = 2*old_nbytes;
+  }
+  return nbytes;
+}
+
+/* Contents are not preserved */
+void
+Dynprog_reserve_single (T this, size_t nbytes) {
+  if (nbytes > this->aligned.one.space_nbytes) {
+    nbytes = grow_nbytes(this->aligned.one.space_nbytes,nbytes);
+    debug(printf("Growing single spaces from %lu to %lu bytes\n",
+		 (unsigned long) this->aligned.one.space_nbytes,(unsigned long) nbytes));
+    _mm_free(this->aligned.one.matrix_space);
+    _mm_free(this->aligned.one.directions_space_0);
+    _mm_free(this->aligned.one.directions_space_1);
+    _mm_free(this->aligned.one.directions_space_2);
+    this->aligned.one.matrix_space = (void *) _mm_malloc(nbytes,16);
+    this->aligned.one.directions_space_0 = (void *) _mm_malloc(nbytes,16);
+    this->aligned.one.directions_space_1 = (void *) _mm_malloc(nbytes,16);
+    this->aligned.one.directions_space_2 = (void *) _mm_malloc(nbytes,16);
+    this->aligned.one.space_nbytes = nbytes;
+  }
+  return;
+}
+
+void
+Dynprog_reserve_upper (T this, size_t nbytes) {
+  if (nbytes > this->aligned.two.upper_space_nbytes) {
+    nbytes = grow_nbytes(this->aligned.two.upper_space_nbytes,nbytes);
+    _mm_free(this->aligned.two.upper_matrix_space);
+    _mm_free(this->aligned.two.upper_directions_space_0);
+    _mm_free(this->aligned.two.upper_directions_space_1);
+    this->aligned.two.upper_matrix_space = (void *) _mm_malloc(nbytes,16);
+    this->aligned.two.upper_directions_space_0 = (void *) _mm_malloc(nbytes,16);
+    this->aligned.two.upper_directions_space_1 = (void *) _mm_malloc(nbytes,16);
+    this->aligned.two.upper_space_nbytes = nbytes;
+  }
+  return;
+}
+
+void
+Dynprog_reserve_lower (T this, size_t nbytes) {
+  if (nbytes > this->aligned.two.lower_space_nbytes) {
+    nbytes = grow_nbytes(this->aligned.two.lower_space_nbytes,nbytes);
+    _mm_free(this->aligned.two.lower_matrix_space);
+    _mm_free(this->aligned.two.lower_directions_space_0);
+    _mm_free(this->aligned.two.lower_directions_space_1);
+    this->aligned.two.lower_matrix_space = (void *) _mm_malloc(nbytes,16);
+    this->aligned.two.lower_directions_space_0 = (void *) _mm_malloc(nbytes,16);
+    this->aligned.two.lower_directions_space_1 = (void *) _mm_malloc(nbytes,16);
+    this->aligned.two.lower_space_nbytes = nbytes;
+  }
+  return;
+}
+
+/* Contents are not preserved */
+void *
+Dynprog_reserve_profile (T this, size_t nbytes) {
+  if (nbytes > this->profile_nbytes) {
+    nbytes = grow_nbytes(this->profile_nbytes,nbytes);
+    _mm_free(this->profile_space);
+    this->profile_space = (void *) _mm_malloc(nbytes,16);
+    this->profile_nbytes = nbytes;
+  }
+  return this->profile_space;
+}
+#endif
+
+
 /************************************************************************/
 
 #ifdef PMAP
@@ -11,6 +11,7 @@
 typedef enum {QUERYEND_GAP, QUERYEND_INDELS, QUERYEND_NOGAPS, BEST_LOCAL} Endalign_T;
 typedef struct Dynprog_T *Dynprog_T; /* Needed before header files below */
 
+#include <stddef.h>		/* For size_t */
 #include "bool.h"
 #include "list.h"
 #include "pairpool.h"
@@ -113,6 +114,7 @@ struct Space_single_T {
   void **directions_ptrs_0, *directions_space_0;
   void **directions_ptrs_1, *directions_space_1;
   void **directions_ptrs_2, *directions_space_2;
+  size_t space_nbytes;		/* Capacity of each space, grown as needed by the band */
 };
 
 struct Space_double_T {
@@ -122,6 +124,8 @@ struct Space_double_T {
   void **lower_matrix_ptrs, *lower_matrix_space;
   void **lower_directions_ptrs_0, *lower_directions_space_0;
   void **lower_directions_ptrs_1, *lower_directions_space_1;
+  size_t upper_space_nbytes;
+  size_t lower_space_nbytes;
 };
 
 
@@ -145,6 +149,8 @@ struct T {
     struct Space_single_T one;
     struct Space_double_T two;
   } aligned;
+  void *profile_space;		/* Query or genome profiles (pairscores) */
+  size_t profile_nbytes;
 #endif
   int nspaces;
 };
@@ -164,6 +170,17 @@ Dynprog_new (int maxlookback, int extraquerygap, int maxpeelback,
 extern void
 Dynprog_free (T *old);
 
+#if defined(HAVE_SSE4_1) || defined(HAVE_SSE2)
+extern void
+Dynprog_reserve_single (T this, size_t nbytes);
+extern void
+Dynprog_reserve_upper (T this, size_t nbytes);
+extern void
+Dynprog_reserve_lower (T this, size_t nbytes);
+extern void *
+Dynprog_reserve_profile (T this, size_t nbytes);
+#endif
+
 extern bool
 Dynprog_consistent_p (int c, int g, int g_alt);
 
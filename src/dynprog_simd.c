@@ -1269,22 +1269,69 @@ banded_directions16_compare_Fgap (Direction16_T **directions1, Direction32_T **d
 
 
 #if defined(HAVE_SSE4_1) || defined(HAVE_SSE2)
+/* Matrices are stored by band.  Column c keeps only the rows that
+   can lie within [c - uband, c + lband], rounded out to whole blocks
+   with one block of margin on each side for the read of the previous
+   block and for traceback.  Each column pointer is offset by its
+   first stored row, so matrix[c][r] indexing is unchanged.  The
+   lower triangle is stored by rows and passes its lengths transposed. */
+#define BAND_BLOCKSIZE 16	/* Multiple of SIMD_NCHARS and SIMD_NSHORTS */
+
+static int
+band_window (int *lo, int c, int rlength, int rlength_ceil, int uband, int lband) {
+  int hi;
+
+  if (uband >= c) {
+    *lo = 0;
+  } else if ((*lo = ((c - uband)/BAND_BLOCKSIZE - 1) * BAND_BLOCKSIZE) < 0) {
+    *lo = 0;
+  }
+
+  if (lband >= rlength - c) {
+    hi = rlength;
+  } else {
+    hi = c + lband;
+  }
+  if ((hi = (hi/BAND_BLOCKSIZE + 2) * BAND_BLOCKSIZE) > rlength_ceil) {
+    hi = rlength_ceil;
+  }
+
+  if (*lo > hi) {
+    /* Column lies entirely outside the band */
+    *lo = hi;
+  }
+  return hi - *lo;
+}
+
+/* Number of cells needed for a banded matrix */
+static size_t
+band_ncells (int rlength, int rlength_ceil, int glength, int uband, int lband) {
+  size_t ncells = 0;
+  int lo, c;
+
+  for (c = 0; c <= glength; c++) {
+    ncells += band_window(&lo,c,rlength,rlength_ceil,uband,lband);
+  }
+  return ncells;
+}
+
 /* Makes a matrix of dimensions 0..rlength x 0..glength inclusive */
 static Score8_T **
-aligned_score8_alloc (int rlength, int glength, void **ptrs, void *space) {
+aligned_score8_alloc (int rlength, int rlength_ceil, int glength, int uband, int lband,
+                      void **ptrs, void *space) {
   Score8_T **matrix, *ptr;
-  int c;
+  int lo, width, c;
 
   matrix = (Score8_T **) ptrs;
 
   ptr = (Score8_T *) space;
-  matrix[0] = ptr;	   /* Want aligned row to be r = 0, 16, ... */
-  for (c = 1; c <= glength; c++) {
-    ptr += rlength;
-    matrix[c] = ptr;	   /* Want aligned row to be r = 0, 16, ... */
+  for (c = 0; c <= glength; c++) {
+    width = band_window(&lo,c,rlength,rlength_ceil,uband,lband);
+    matrix[c] = ptr - lo;	/* Want aligned row to be r = 0, 16, ... */
+    ptr += width;
   }
 #if defined(DEBUG2) && defined(DEBUG14)
-  memset((void *) matrix[0],0,(glength+1)*rlength*sizeof(Score8_T));
+  memset(space,0,(ptr - (Score8_T *) space)*sizeof(Score8_T));
 #endif
 
   return matrix;
@@ -1292,20 +1339,21 @@ aligned_score8_alloc (int rlength, int glength, void **ptrs, void *space) {
 
 /* No initialization to DIAG (0), for directions_Egap and directions_nogap */
 static Score8_T **
-aligned_directions8_alloc (int rlength, int glength, void **ptrs, void *space) {
+aligned_directions8_alloc (int rlength, int rlength_ceil, int glength, int uband, int lband,
+                           void **ptrs, void *space) {
   Score8_T **matrix, *ptr;
-  int c;
+  int lo, width, c;
 
   matrix = (Score8_T **) ptrs;
 
   ptr = (Score8_T *) space;
-  matrix[0] = ptr;	   /* Want aligned row to be r = 0, 16, ... */
-  for (c = 1; c <= glength; c++) {
-    ptr += rlength;
-    matrix[c] = ptr;	   /* Want aligned row to be r = 0, 16, ... */
+  for (c = 0; c <= glength; c++) {
+    width = band_window(&lo,c,rlength,rlength_ceil,uband,lband);
+    matrix[c] = ptr - lo;	/* Want aligned row to be r = 0, 16, ... */
+    ptr += width;
   }
 #if defined(DEBUG2) && defined(DEBUG14)
-  memset((void *) matrix[0],/*DIAG*/0,(glength+1)*rlength*sizeof(Score8_T));
+  memset(space,/*DIAG*/0,(ptr - (Score8_T *) space)*sizeof(Score8_T));
 #endif
 
   return matrix;
@@ -1313,41 +1361,42 @@ aligned_directions8_alloc (int rlength, int glength, void **ptrs, void *space) {
 
 /* Initialization to DIAG (0), for directions_Fgap */
 static Score8_T **
-aligned_directions8_calloc (int rlength, int glength, void **ptrs, void *space) {
+aligned_directions8_calloc (int rlength, int rlength_ceil, int glength, int uband, int lband,
+                            void **ptrs, void *space) {
   Score8_T **matrix, *ptr;
-  int c;
+  int lo, width, c;
 
   matrix = (Score8_T **) ptrs;
 
   ptr = (Score8_T *) space;
-  matrix[0] = ptr;	/* Want aligned row to be r = 0, 16, ... */
-  for (c = 1; c <= glength; c++) {
-    ptr += rlength;
-    matrix[c] = ptr;	/* Want aligned row to be r = 0, 16, ... */
+  for (c = 0; c <= glength; c++) {
+    width = band_window(&lo,c,rlength,rlength_ceil,uband,lband);
+    matrix[c] = ptr - lo;	/* Want aligned row to be r = 0, 16, ... */
+    ptr += width;
   }
-  memset((void *) matrix[0],/*DIAG*/0,(glength+1)*rlength*sizeof(Score8_T));
+  memset(space,/*DIAG*/0,(ptr - (Score8_T *) space)*sizeof(Score8_T));
 
   return matrix;
 }
 
 
-
 /* Makes a matrix of dimensions 0..rlength x 0..glength inclusive */
 static Score16_T **
-aligned_score16_alloc (int rlength, int glength, void **ptrs, void *space) {
+aligned_score16_alloc (int rlength, int rlength_ceil, int glength, int uband, int lband,
+                       void **ptrs, void *space) {
   Score16_T **matrix, *ptr;
-  int c;
+  int lo, width, c;
 
   matrix = (Score16_T **) ptrs;
 
   ptr = (Score16_T *) space;
-  matrix[0] = ptr;	/* Want aligned row to be r = 0, 8, 16, ... */
-  for (c = 1; c <= glength; c++) {
-    ptr += rlength;
-    matrix[c] = ptr;	/* Want aligned row to be r = 0, 8, 16, ... */
+  for (c = 0; c <= glength; c++) {
+    width = band_window(&lo,c,rlength,rlength_ceil,uband,lband);
+    matrix[c] = ptr - lo;	/* Want aligned row to be r = 0, 8, 16, ... */
+    ptr += width;
   }
 #ifdef DEBUG2
-  memset((void *) matrix[0],0,(glength+1)*rlength*sizeof(Score16_T));
+  memset(space,0,(ptr - (Score16_T *) space)*sizeof(Score16_T));
 #endif
 
   return matrix;
@@ -1355,20 +1404,21 @@ aligned_score16_alloc (int rlength, int glength, void **ptrs, void *space) {
 
 /* No initialization to DIAG (0), for directions_Egap and directions_nogap */
 static Score16_T **
-aligned_directions16_alloc (int rlength, int glength, void **ptrs, void *space) {
+aligned_directions16_alloc (int rlength, int rlength_ceil, int glength, int uband, int lband,
+                            void **ptrs, void *space) {
   Score16_T **matrix, *ptr;
-  int c;
+  int lo, width, c;
 
   matrix = (Score16_T **) ptrs;
 
   ptr = (Score16_T *) space;
-  matrix[0] = ptr;	/* Want aligned row to be r = 0, 8, 16, ... */
-  for (c = 1; c <= glength; c++) {
-    ptr += rlength;
-    matrix[c] = ptr;	/* Want aligned row to be r = 0, 8, 16, ... */
+  for (c = 0; c <= glength; c++) {
+    width = band_window(&lo,c,rlength,rlength_ceil,uband,lband);
+    matrix[c] = ptr - lo;	/* Want aligned row to be r = 0, 8, 16, ... */
+    ptr += width;
   }
 #ifdef DEBUG2
-  memset((void *) matrix[0],/*DIAG*/0,(glength+1)*rlength*sizeof(Score16_T));
+  memset(space,/*DIAG*/0,(ptr - (Score16_T *) space)*sizeof(Score16_T));
 #endif
 
   return matrix;
@@ -1376,19 +1426,20 @@ aligned_directions16_alloc (int rlength, int glength, void **ptrs, void *space)
 
 /* Initialization to DIAG (0), for directions_Fgap */
 static Score16_T **
-aligned_directions16_calloc (int rlength, int glength, void **ptrs, void *space) {
+aligned_directions16_calloc (int rlength, int rlength_ceil, int glength, int uband, int lband,
+                             void **ptrs, void *space) {
   Score16_T **matrix, *ptr;
-  int c;
+  int lo, width, c;
 
   matrix = (Score16_T **) ptrs;
 
   ptr = (Score16_T *) space;
-  matrix[0] = ptr;	/* Want aligned row to be r = 0, 8, 16, ... */
-  for (c = 1; c <= glength; c++) {
-    ptr += rlength;
-    matrix[c] = ptr;	/* Want aligned row to be r = 0, 8, 16, ... */
+  for (c = 0; c <= glength; c++) {
+    width = band_window(&lo,c,rlength,rlength_ceil,uband,lband);
+    matrix[c] = ptr - lo;	/* Want aligned row to be r = 0, 8, 16, ... */
+    ptr += width;
   }
-  memset((void *) matrix[0],/*DIAG*/0,(glength+1)*rlength*sizeof(Score16_T));
+  memset(space,/*DIAG*/0,(ptr - (Score16_T *) space)*sizeof(Score16_T));
 
   return matrix;
 }
@@ -1449,14 +1500,15 @@ Dynprog_simd_8 (Direction8_T ***directions_nogap, Direction8_T ***directions_Ega
   debug(printf("Lengths are %d and %d, so band is %d on right\n",rlength,glength,uband));
   debug(printf("Query length rounded up to %d\n",rlength_ceil));
 
-  matrix = aligned_score8_alloc(rlength_ceil,glength,
+  Dynprog_reserve_single(this,band_ncells(rlength,rlength_ceil,glength,uband,lband)*sizeof(Score8_T));
+  matrix = aligned_score8_alloc(rlength,rlength_ceil,glength,uband,lband,
 				this->aligned.one.matrix_ptrs,this->aligned.one.matrix_space);
-  *directions_nogap = aligned_directions8_alloc(rlength_ceil,glength,
+  *directions_nogap = aligned_directions8_alloc(rlength,rlength_ceil,glength,uband,lband,
 						this->aligned.one.directions_ptrs_0,this->aligned.one.directions_space_0);
-  *directions_Egap = aligned_directions8_alloc(rlength_ceil,glength,
+  *directions_Egap = aligned_directions8_alloc(rlength,rlength_ceil,glength,uband,lband,
 					       this->aligned.one.directions_ptrs_1,this->aligned.one.directions_space_1);
   /* Need to calloc to save time in F loop */
-  *directions_Fgap = aligned_directions8_calloc(rlength_ceil,glength,
+  *directions_Fgap = aligned_directions8_calloc(rlength,rlength_ceil,glength,uband,lband,
 						this->aligned.one.directions_ptrs_2,this->aligned.one.directions_space_2);
 
 #if 0
@@ -1485,14 +1537,13 @@ Dynprog_simd_8 (Direction8_T ***directions_nogap, Direction8_T ***directions_Ega
 
 
   /* Load pairscores.  Store match - mismatch */
-  pairscores[0] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-  pairscores[1] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-  pairscores[2] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-  pairscores[3] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-  pairscores[4] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-
   lband_ceil = (int) ((lband + SIMD_NCHARS)/SIMD_NCHARS) * SIMD_NCHARS;
-  pairscores_col0 = (Score8_T *) _mm_malloc(lband_ceil * sizeof(Score8_T),16);
+  pairscores[0] = (Score8_T *) Dynprog_reserve_profile(this,(5*rlength_ceil + lband_ceil)*sizeof(Score8_T));
+  pairscores[1] = &(pairscores[0][rlength_ceil]);
+  pairscores[2] = &(pairscores[1][rlength_ceil]);
+  pairscores[3] = &(pairscores[2][rlength_ceil]);
+  pairscores[4] = &(pairscores[3][rlength_ceil]);
+  pairscores_col0 = &(pairscores[4][rlength_ceil]);
 
 
 #if 0
@@ -2017,12 +2068,6 @@ Dynprog_simd_8 (Direction8_T ***directions_nogap, Direction8_T ***directions_Ega
 #endif
 
   FREEA(FF);
-  _mm_free(pairscores_col0);
-  _mm_free(pairscores[4]);
-  _mm_free(pairscores[3]);
-  _mm_free(pairscores[2]);
-  _mm_free(pairscores[1]);
-  _mm_free(pairscores[0]);
 
   return matrix;
 }
@@ -2105,11 +2150,12 @@ Dynprog_simd_8_upper (Direction8_T ***directions_nogap, Direction8_T ***directio
   debug(printf("Lengths are %d and %d, so band is %d on right\n",rlength,glength,uband));
   debug(printf("Query length rounded up to %d\n",rlength_ceil));
 
-  matrix = aligned_score8_alloc(rlength_ceil,glength,
+  Dynprog_reserve_upper(this,band_ncells(rlength,rlength_ceil,glength,uband,/*lband*/0)*sizeof(Score8_T));
+  matrix = aligned_score8_alloc(rlength,rlength_ceil,glength,uband,/*lband*/0,
 				this->aligned.two.upper_matrix_ptrs,this->aligned.two.upper_matrix_space);
-  *directions_nogap = aligned_directions8_alloc(rlength_ceil,glength,
+  *directions_nogap = aligned_directions8_alloc(rlength,rlength_ceil,glength,uband,/*lband*/0,
 						this->aligned.two.upper_directions_ptrs_0,this->aligned.two.upper_directions_space_0);
-  *directions_Egap = aligned_directions8_alloc(rlength_ceil,glength,
+  *directions_Egap = aligned_directions8_alloc(rlength,rlength_ceil,glength,uband,/*lband*/0,
 					       this->aligned.two.upper_directions_ptrs_1,this->aligned.two.upper_directions_space_1);
 
 #if 0
@@ -2137,11 +2183,11 @@ Dynprog_simd_8_upper (Direction8_T ***directions_nogap, Direction8_T ***directio
 
 
   /* Load pairscores.  Store match - mismatch */
-  pairscores[0] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-  pairscores[1] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-  pairscores[2] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-  pairscores[3] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
-  pairscores[4] = (Score8_T *) _mm_malloc(rlength_ceil * sizeof(Score8_T),16);
+  pairscores[0] = (Score8_T *) Dynprog_reserve_profile(this,5*rlength_ceil*sizeof(Score8_T));
+  pairscores[1] = &(pairscores[0][rlength_ceil]);
+  pairscores[2] = &(pairscores[1][rlength_ceil]);
+  pairscores[3] = &(pairscores[2][rlength_ceil]);
+  pairscores[4] = &(pairscores[3][rlength_ceil]);
 
 #if 0
   /* Should not be necessary */
@@ -2502,12 +2548,6 @@ Dynprog_simd_8_upper (Direction8_T ***directions_nogap, Direction8_T ***directio
   banded_directions8_compare_Egap(matrix,*directions_Egap,directions_Egap_std,rlength,glength,lband,uband);
 #endif
 
-  _mm_free(pairscores[4]);
-  _mm_free(pairscores[3]);
-  _mm_free(pairscores[2]);
-  _mm_free(pairscores[1]);
-  _mm_free(pairscores[0]);
-
   return matrix;
 }
 #endif
@@ -2565,11 +2605,12 @@ Dynprog_simd_8_lower (Direction8_T ***directions_nogap, Direction8_T ***directio
   debug(printf("Lengths are %d and %d, so band is %d on left\n",rlength,glength,lband));
   debug(printf("Genome length rounded up to %d\n",glength_ceil));
 
-  matrix = aligned_score8_alloc(glength_ceil,rlength,
+  Dynprog_reserve_lower(this,band_ncells(glength,glength_ceil,rlength,lband,/*uband*/0)*sizeof(Score8_T));
+  matrix = aligned_score8_alloc(glength,glength_ceil,rlength,lband,/*uband*/0,
 				this->aligned.two.lower_matrix_ptrs,this->aligned.two.lower_matrix_space);
-  *directions_nogap = aligned_directions8_alloc(glength_ceil,rlength,
+  *directions_nogap = aligned_directions8_alloc(glength,glength_ceil,rlength,lband,/*uband*/0,
 						this->aligned.two.lower_directions_ptrs_0,this->aligned.two.lower_directions_space_0);
-  *directions_Egap = aligned_directions8_alloc(glength_ceil,rlength,
+  *directions_Egap = aligned_directions8_alloc(glength,glength_ceil,rlength,lband,/*uband*/0,
 					       this->aligned.two.lower_directions_ptrs_1,this->aligned.two.lower_directions_space_1);
 
 #if 0
@@ -2597,11 +2638,11 @@ Dynprog_simd_8_lower (Direction8_T ***directions_nogap, Direction8_T ***directio
 
 
   /* Load pairscores.  Store match - mismatch */
-  pairscores[0] = (Score8_T *) _mm_malloc(glength_ceil * sizeof(Score8_T),16);
-  pairscores[1] = (Score8_T *) _mm_malloc(glength_ceil * sizeof(Score8_T),16);
-  pairscores[2] = (Score8_T *) _mm_malloc(glength_ceil * sizeof(Score8_T),16);
-  pairscores[3] = (Score8_T *) _mm_malloc(glength_ceil * sizeof(Score8_T),16);
-  pairscores[4] = (Score8_T *) _mm_malloc(glength_ceil * sizeof(Score8_T),16);
+  pairscores[0] = (Score8_T *) Dynprog_reserve_profile(this,5*glength_ceil*sizeof(Score8_T));
+  pairscores[1] = &(pairscores[0][glength_ceil]);
+  pairscores[2] = &(pairscores[1][glength_ceil]);
+  pairscores[3] = &(pairscores[2][glength_ceil]);
+  pairscores[4] = &(pairscores[3][glength_ceil]);
 
 #if 0
   /* Should not be necessary */
@@ -2992,12 +3033,6 @@ Dynprog_simd_8_lower (Direction8_T ***directions_nogap, Direction8_T ***directio
   banded_directions8_compare_Egap(matrix,*directions_Egap,directions_Egap_std,rlength,glength,lband,uband);
 #endif
 
-  _mm_free(pairscores[4]);
-  _mm_free(pairscores[3]);
-  _mm_free(pairscores[2]);
-  _mm_free(pairscores[1]);
-  _mm_free(pairscores[0]);
-
   return matrix;
 }
 #endif
@@ -3044,14 +3079,15 @@ Dynprog_simd_16 (Direction16_T ***directions_nogap, Direction16_T ***directions_
   debug(printf("Lengths are %d and %d, so band is %d on right\n",rlength,glength,uband));
   debug(printf("Query length rounded up to %d\n",rlength_ceil));
 
-  matrix = aligned_score16_alloc(rlength_ceil,glength,
+  Dynprog_reserve_single(this,band_ncells(rlength,rlength_ceil,glength,uband,lband)*sizeof(Score16_T));
+  matrix = aligned_score16_alloc(rlength,rlength_ceil,glength,uband,lband,
 				 this->aligned.one.matrix_ptrs,this->aligned.one.matrix_space);
-  *directions_nogap = aligned_directions16_alloc(rlength_ceil,glength,
+  *directions_nogap = aligned_directions16_alloc(rlength,rlength_ceil,glength,uband,lband,
 						 this->aligned.one.directions_ptrs_0,this->aligned.one.directions_space_0);
-  *directions_Egap = aligned_directions16_alloc(rlength_ceil,glength,
+  *directions_Egap = aligned_directions16_alloc(rlength,rlength_ceil,glength,uband,lband,
 						this->aligned.one.directions_ptrs_1,this->aligned.one.directions_space_1);
   /* Need to calloc to save time in F loop */
-  *directions_Fgap = aligned_directions16_calloc(rlength_ceil,glength,
+  *directions_Fgap = aligned_directions16_calloc(rlength,rlength_ceil,glength,uband,lband,
 						 this->aligned.one.directions_ptrs_2,this->aligned.one.directions_space_2);
 
 #if 0
@@ -3079,14 +3115,13 @@ Dynprog_simd_16 (Direction16_T ***directions_nogap, Direction16_T ***directions_
 
 
   /* Load pairscores.  Store match - mismatch */
-  pairscores[0] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-  pairscores[1] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-  pairscores[2] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-  pairscores[3] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-  pairscores[4] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-
   lband_ceil = (int) ((lband + SIMD_NSHORTS)/SIMD_NSHORTS) * SIMD_NSHORTS;
-  pairscores_col0 = (Score16_T *) _mm_malloc(lband_ceil * sizeof(Score16_T),16);
+  pairscores[0] = (Score16_T *) Dynprog_reserve_profile(this,(5*rlength_ceil + lband_ceil)*sizeof(Score16_T));
+  pairscores[1] = &(pairscores[0][rlength_ceil]);
+  pairscores[2] = &(pairscores[1][rlength_ceil]);
+  pairscores[3] = &(pairscores[2][rlength_ceil]);
+  pairscores[4] = &(pairscores[3][rlength_ceil]);
+  pairscores_col0 = &(pairscores[4][rlength_ceil]);
 
 #if 0
   /* Should not be necessary */
@@ -3552,12 +3587,6 @@ Dynprog_simd_16 (Direction16_T ***directions_nogap, Direction16_T ***directions_
 #endif
 
   FREEA(FF);
-  _mm_free(pairscores_col0);
-  _mm_free(pairscores[4]);
-  _mm_free(pairscores[3]);
-  _mm_free(pairscores[2]);
-  _mm_free(pairscores[1]);
-  _mm_free(pairscores[0]);
 
   return matrix;
   }
@@ -3605,11 +3634,12 @@ Dynprog_simd_16_upper (Direction16_T ***directions_nogap, Direction16_T ***direc
   debug(printf("Lengths are %d and %d, so band is %d on right\n",rlength,glength,uband));
   debug(printf("Query length rounded up to %d\n",rlength_ceil));
 
-  matrix = aligned_score16_alloc(rlength_ceil,glength,
+  Dynprog_reserve_upper(this,band_ncells(rlength,rlength_ceil,glength,uband,/*lband*/0)*sizeof(Score16_T));
+  matrix = aligned_score16_alloc(rlength,rlength_ceil,glength,uband,/*lband*/0,
 				 this->aligned.two.upper_matrix_ptrs,this->aligned.two.upper_matrix_space);
-  *directions_nogap = aligned_directions16_alloc(rlength_ceil,glength,
+  *directions_nogap = aligned_directions16_alloc(rlength,rlength_ceil,glength,uband,/*lband*/0,
 						 this->aligned.two.upper_directions_ptrs_0,this->aligned.two.upper_directions_space_0);
-  *directions_Egap = aligned_directions16_alloc(rlength_ceil,glength,
+  *directions_Egap = aligned_directions16_alloc(rlength,rlength_ceil,glength,uband,/*lband*/0,
 						this->aligned.two.upper_directions_ptrs_1,this->aligned.two.upper_directions_space_1);
 
 #if 0
@@ -3637,11 +3667,11 @@ Dynprog_simd_16_upper (Direction16_T ***directions_nogap, Direction16_T ***direc
 
 
   /* Load pairscores.  Store match - mismatch */
-  pairscores[0] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-  pairscores[1] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-  pairscores[2] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-  pairscores[3] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
-  pairscores[4] = (Score16_T *) _mm_malloc(rlength_ceil * sizeof(Score16_T),16);
+  pairscores[0] = (Score16_T *) Dynprog_reserve_profile(this,5*rlength_ceil*sizeof(Score16_T));
+  pairscores[1] = &(pairscores[0][rlength_ceil]);
+  pairscores[2] = &(pairscores[1][rlength_ceil]);
+  pairscores[3] = &(pairscores[2][rlength_ceil]);
+  pairscores[4] = &(pairscores[3][rlength_ceil]);
 
 #if 0
   /* Should not be necessary */
@@ -3938,12 +3968,6 @@ Dynprog_simd_16_upper (Direction16_T ***directions_nogap, Direction16_T ***direc
   banded_directions16_compare_Egap(*directions_Egap,directions_Egap_std,rlength,glength,lband,uband);
 #endif
 
-  _mm_free(pairscores[4]);
-  _mm_free(pairscores[3]);
-  _mm_free(pairscores[2]);
-  _mm_free(pairscores[1]);
-  _mm_free(pairscores[0]);
-
   return matrix;
 }
 #endif
@@ -3991,11 +4015,12 @@ Dynprog_simd_16_lower (Direction16_T ***directions_nogap, Direction16_T ***direc
   debug(printf("Lengths are %d and %d, so band is %d on left\n",rlength,glength,lband));
   debug(printf("Genome length rounded up to %d\n",glength_ceil));
 
-  matrix = aligned_score16_alloc(glength_ceil,rlength,
+  Dynprog_reserve_lower(this,band_ncells(glength,glength_ceil,rlength,lband,/*uband*/0)*sizeof(Score16_T));
+  matrix = aligned_score16_alloc(glength,glength_ceil,rlength,lband,/*uband*/0,
 				 this->aligned.two.lower_matrix_ptrs,this->aligned.two.lower_matrix_space);
-  *directions_nogap = aligned_directions16_alloc(glength_ceil,rlength,
+  *directions_nogap = aligned_directions16_alloc(glength,glength_ceil,rlength,lband,/*uband*/0,
 						 this->aligned.two.lower_directions_ptrs_0,this->aligned.two.lower_directions_space_0);
-  *directions_Egap = aligned_directions16_alloc(glength_ceil,rlength,
+  *directions_Egap = aligned_directions16_alloc(glength,glength_ceil,rlength,lband,/*uband*/0,
 						this->aligned.two.lower_directions_ptrs_1,this->aligned.two.lower_directions_space_1);
 
 #if 0
@@ -4023,11 +4048,11 @@ Dynprog_simd_16_lower (Direction16_T ***directions_nogap, Direction16_T ***direc
 
 
   /* Load pairscores.  Store match - mismatch */
-  pairscores[0] = (Score16_T *) _mm_malloc(glength_ceil * sizeof(Score16_T),16);
-  pairscores[1] = (Score16_T *) _mm_malloc(glength_ceil * sizeof(Score16_T),16);
-  pairscores[2] = (Score16_T *) _mm_malloc(glength_ceil * sizeof(Score16_T),16);
-  pairscores[3] = (Score16_T *) _mm_malloc(glength_ceil * sizeof(Score16_T),16);
-  pairscores[4] = (Score16_T *) _mm_malloc(glength_ceil * sizeof(Score16_T),16);
+  pairscores[0] = (Score16_T *) Dynprog_reserve_profile(this,5*glength_ceil*sizeof(Score16_T));
+  pairscores[1] = &(pairscores[0][glength_ceil]);
+  pairscores[2] = &(pairscores[1][glength_ceil]);
+  pairscores[3] = &(pairscores[2][glength_ceil]);
+  pairscores[4] = &(pairscores[3][glength_ceil]);
 
 #if 0
   /* Should not be necessary */
@@ -4349,12 +4374,6 @@ Dynprog_simd_16_lower (Direction16_T ***directions_nogap, Direction16_T ***direc
   banded_directions16_compare_Egap(*directions_Egap,directions_Egap_std,rlength,glength,lband,uband);
 #endif
 
-  _mm_free(pairscores[4]);
-  _mm_free(pairscores[3]);
-  _mm_free(pairscores[2]);
-  _mm_free(pairscores[1]);
-  _mm_free(pairscores[0]);
-
   return matrix;
 }
 #endif
@@ -5,9 +5,11 @@ static char rcsid[] = "$Id: filestring.c 162093 2015-03-26 18:54:22Z twu $";
 
 #include "filestring.h"
 #include <stdlib.h>
+#include <string.h>		/* For memcpy, strlen */
 #include <stdarg.h>
 #include <ctype.h>		/* For isdigit() */
 #include "assert.h"
+#include "bool.h"
 #include "mem.h"
 #include "list.h"
 
@@ -33,6 +35,7 @@ static char rcsid[] = "$Id: filestring.c 162093 2015-03-26 18:54:22Z twu $";
 struct T {
   int id;
   SAM_split_output_type split_output;
+  int sampleid;			/* Selects per-sample outputs under --manifest */
 
   List_T blocks;
   int nleft;
@@ -59,6 +62,17 @@ Filestring_split_output (T this) {
   return this->split_output;
 }
 
+void
+Filestring_set_sampleid (T this, int sampleid) {
+  this->sampleid = sampleid;
+  return;
+}
+
+int
+Filestring_sampleid (T this) {
+  return this->sampleid;
+}
+
 
 T
 Filestring_new (int id) {
@@ -66,6 +80,7 @@ Filestring_new (int id) {
 
   new->id = id;
   new->split_output = OUTPUT_NONE;
+  new->sampleid = 0;
   new->blocks = (List_T) NULL;
   new->nleft = 0;
   new->ptr = (char *) NULL;
@@ -244,6 +259,61 @@ transfer_string (T this, char *string, int bufferlen) {
 
 
 
+/* Integers are formatted two digits at a time from this table, rather
+   than through sprintf, since SAM output is mostly numbers */
+static const char digit_pairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+#define DIGITS_BUFFERLEN 24	/* Enough for a 64-bit value and sign */
+
+static void
+transfer_digits (T this, unsigned long long x, bool negativep) {
+  char buffer[DIGITS_BUFFERLEN], *q;
+  int i;
+
+  q = &(buffer[DIGITS_BUFFERLEN]);
+  while (x >= 100) {
+    i = (int) (x % 100) * 2;
+    x /= 100;
+    *--q = digit_pairs[i+1];
+    *--q = digit_pairs[i];
+  }
+  if (x >= 10) {
+    i = (int) x * 2;
+    *--q = digit_pairs[i+1];
+    *--q = digit_pairs[i];
+  } else {
+    *--q = (char) ('0' + x);
+  }
+  if (negativep == true) {
+    *--q = '-';
+  }
+
+  Filestring_puts(this,q,&(buffer[DIGITS_BUFFERLEN]) - q);
+  return;
+}
+
+static void
+transfer_signed (T this, long long x) {
+  if (x >= 0) {
+    transfer_digits(this,(unsigned long long) x,/*negativep*/false);
+  } else {
+    /* Avoids overflow on the most negative value */
+    transfer_digits(this,(unsigned long long) (-(x + 1)) + 1,/*negativep*/true);
+  }
+  return;
+}
+
+
 #define BUFFERLEN 1024
 
 void
@@ -254,7 +324,7 @@ Filestring_put (T this, const char *format, ...) {
   char *block;
   const char *p;
   char *q, c;
-  int precision;
+  int precision, i;
 
   va_start(values,format);
 
@@ -281,9 +351,8 @@ Filestring_put (T this, const char *format, ...) {
 	break;
 
       case 's': 		/* string */
-	for (q = va_arg(values, char *); *q != '\0'; q++) {
-	  transfer_char(this,*q);
-	}
+	q = va_arg(values, char *);
+	Filestring_puts(this,q,strlen(q));
 	break;
 
       case '.':			/* float or double */
@@ -311,8 +380,10 @@ Filestring_put (T this, const char *format, ...) {
 	  break;
 	  
 	case 's':
-	  sprintf(BUFFER,"%.*s",precision,va_arg(values, char *));
-	  transfer_string(this,BUFFER,BUFFERLEN);
+	  /* Copied directly, since reads can exceed BUFFERLEN */
+	  q = va_arg(values, char *);
+	  for (i = 0; i < precision && q[i] != '\0'; i++) ;
+	  Filestring_puts(this,q,i);
 	  break;
 
 	default: fprintf(stderr,"Cannot parse %%.%d%c\n",precision,*p); abort();
@@ -340,8 +411,7 @@ Filestring_put (T this, const char *format, ...) {
 	break;
 
       case 'd':			/* int */
-	sprintf(BUFFER,"%d",va_arg(values, int));
-	transfer_string(this,BUFFER,BUFFERLEN);
+	transfer_signed(this,(long long) va_arg(values, int));
 	break;
 
       case 'f':			/* float */
@@ -350,31 +420,27 @@ Filestring_put (T this, const char *format, ...) {
 	break;
 
       case 'u':			/* unsigned int */
-	sprintf(BUFFER,"%u",va_arg(values, unsigned int));
-	transfer_string(this,BUFFER,BUFFERLEN);
+	transfer_digits(this,(unsigned long long) va_arg(values, unsigned int),/*negativep*/false);
 	break;
       
       case 'l':
 	switch (*++p) {
 	case 'd':			/* long int */
-	  sprintf(BUFFER,"%ld",va_arg(values, long int));
-	  transfer_string(this,BUFFER,BUFFERLEN);
+	  transfer_signed(this,(long long) va_arg(values, long int));
 	  break;
 
 	case 'u':			/* unsigned long */
-	  sprintf(BUFFER,"%lu",va_arg(values, unsigned long));
-	  transfer_string(this,BUFFER,BUFFERLEN);
+	  transfer_digits(this,(unsigned long long) va_arg(values, unsigned long),/*negativep*/false);
 	  break;
 
 	case 'l':
 	  switch (*++p) {
 	  case 'd':			/* long long int */
-	    sprintf(BUFFER,"%lld",va_arg(values, long long int));
-	    transfer_string(this,BUFFER,BUFFERLEN);
+	    transfer_signed(this,va_arg(values, long long int));
 	    break;
 
 	  case 'u':			/* unsigned long long */
-	    sprintf(BUFFER,"%llu",va_arg(values, unsigned long long));
+	    transfer_digits(this,va_arg(values, unsigned long long),/*negativep*/false);
 	    break;
 
 	  default: fprintf(stderr,"Cannot parse %%ll%c\n",*p); abort();
@@ -423,25 +489,58 @@ Filestring_putc (char c, T this) {
 }
 
 
-/* Modified from transfer_string */
+/* Modified from transfer_string.  Copies as much as fits in each block. */
 void
 Filestring_puts (T this, char *string, int strlength) {
-  char *block, *q;
+  char *block;
+  int n;
 
-  for (q = string; --strlength >= 0; q++) {
+  while (strlength > 0) {
     if (this->nleft == 0) {
       block = (char *) MALLOC_OUT(BLOCKSIZE * sizeof(char));
       this->blocks = List_push_out(this->blocks,(void *) block);
       this->nleft = BLOCKSIZE;
       this->ptr = &(block[0]);
     }
-    *this->ptr++ = *q;
-    this->nleft -= 1;
+    n = (strlength < this->nleft) ? strlength : this->nleft;
+    memcpy(this->ptr,string,n*sizeof(char));
+    this->ptr += n;
+    this->nleft -= n;
+    string += n;
+    strlength -= n;
   }
 
   return;
 }
 
+/* Equivalent to FPRINTF(this,"%d",x), without parsing a format */
+void
+Filestring_put_int (T this, int x) {
+  transfer_signed(this,(long long) x);
+  return;
+}
+
+/* Equivalent to FPRINTF(this,"%u",x), without parsing a format */
+void
+Filestring_put_uint (T this, unsigned int x) {
+  transfer_digits(this,(unsigned long long) x,/*negativep*/false);
+  return;
+}
+
+
+
+/* Stringifies the contents, which remain owned by this */
+char *
+Filestring_get (int *strlength, T this) {
+  Filestring_stringify(this);
+  if (this->strlength <= 0) {
+    *strlength = 0;
+    return (char *) NULL;
+  } else {
+    *strlength = this->strlength;
+    return this->string;
+  }
+}
 
 
 #ifdef USE_MPI
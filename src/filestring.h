@@ -23,6 +23,10 @@ extern void
 Filestring_set_split_output (T this, int split_output);
 extern SAM_split_output_type
 Filestring_split_output (T this);
+extern void
+Filestring_set_sampleid (T this, int sampleid);
+extern int
+Filestring_sampleid (T this);
 extern T
 Filestring_new (int id);
 extern void
@@ -45,6 +49,10 @@ extern void
 Filestring_putc (char c, T this);
 extern void
 Filestring_puts (T this, char *string, int strlength);
+extern void
+Filestring_put_int (T this, int x);
+extern void
+Filestring_put_uint (T this, unsigned int x);
 
 #ifdef USE_MPI
 extern char *
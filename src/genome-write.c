@@ -871,3 +871,86 @@ Genome_write_comp32 (char *genomesubdir, char *fileroot, FILE *input,
 }
 
 
+
+
+#define MERGE_CHUNK 1048576
+
+static int
+copy_region_memory (int nbadchars, Genomecomp_T *genomecomp, char *gbuffer, Genome_T genome,
+		    Univcoord_T oldstart, Univcoord_T oldend, Univcoord_T newstart) {
+  Chrpos_T length;
+
+  while (oldstart < oldend) {
+    if (oldend - oldstart > MERGE_CHUNK) {
+      length = MERGE_CHUNK;
+    } else {
+      length = (Chrpos_T) (oldend - oldstart);
+    }
+    Genome_fill_buffer_simple(genome,oldstart,length,gbuffer);
+    nbadchars = Compress_update_memory(nbadchars,genomecomp,gbuffer,newstart,newstart + length);
+    oldstart += length;
+    newstart += length;
+  }
+
+  return nbadchars;
+}
+
+/* Writes the genome for gmapindex -M.  Each base chromosome (with its
+   circular alias, if any) that is kept is copied from
+   [base_chrlows[i],base_chrhighs[i]) to base_newoffsets[i], and the
+   entire delta genome is copied to delta_shift. */
+void
+Genome_write_merged (char *genomesubdir, char *fileroot, Genome_T base_genome,
+		     Univcoord_T *base_chrlows, Univcoord_T *base_chrhighs,
+		     Univcoord_T *base_newoffsets, bool *base_keepp, int base_nchromosomes,
+		     Genome_T delta_genome, Univcoord_T delta_genomelength, Univcoord_T delta_shift,
+		     Univcoord_T genomelength) {
+  size_t nuint4;
+  FILE *refgenome_fp;
+  char *filename, *gbuffer;
+  Genomecomp_T *genomecomp;
+  int nbadchars = 0;
+  int i;
+
+  fprintf(stderr,"Merged genome length is %llu nt\n",(unsigned long long) genomelength);
+  nuint4 = ((genomelength + 31)/32U)*3;
+  fprintf(stderr,"Trying to allocate %llu*%d bytes of memory...",
+	  (unsigned long long) nuint4,(int) sizeof(Genomecomp_T));
+  if ((genomecomp = (Genomecomp_T *) CALLOC_NO_EXCEPTION(nuint4,sizeof(Genomecomp_T))) == NULL) {
+    fprintf(stderr,"failed.  Need a computer with sufficient memory.\n");
+    exit(9);
+  } else {
+    fprintf(stderr,"succeeded.  Building genome in memory.\n");
+  }
+  /* Creates X's at end */
+  genomecomp[nuint4-3] = 0xFFFFFFFF;
+  genomecomp[nuint4-2] = 0xFFFFFFFF;
+  genomecomp[nuint4-1] = 0xFFFFFFFF;
+
+  gbuffer = (char *) CALLOC(MERGE_CHUNK+1,sizeof(char));
+  for (i = 0; i < base_nchromosomes; i++) {
+    if (base_keepp[i] == true) {
+      nbadchars = copy_region_memory(nbadchars,genomecomp,gbuffer,base_genome,
+				     base_chrlows[i],base_chrhighs[i],base_newoffsets[i]);
+    }
+  }
+  nbadchars = copy_region_memory(nbadchars,genomecomp,gbuffer,delta_genome,
+				 /*oldstart*/0,/*oldend*/delta_genomelength,/*newstart*/delta_shift);
+  FREE(gbuffer);
+
+  filename = (char *) CALLOC(strlen(genomesubdir)+strlen("/")+
+			     strlen(fileroot)+strlen(".genomecomp")+1,sizeof(char));
+  sprintf(filename,"%s/%s.genomecomp",genomesubdir,fileroot);
+  if ((refgenome_fp = FOPEN_WRITE_BINARY(filename)) == NULL) {
+    fprintf(stderr,"Can't open file %s for write\n",filename);
+    exit(9);
+  }
+  FWRITE_UINTS(genomecomp,nuint4,refgenome_fp);
+  fclose(refgenome_fp);
+  FREE(filename);
+  FREE(genomecomp);
+
+  fprintf(stderr,"A total of %d non-ACGTNX characters were seen in the genome.\n",nbadchars);
+
+  return;
+}
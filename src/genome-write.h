@@ -7,6 +7,7 @@
 #include "iit-read-univ.h"
 #include "iit-read.h"
 #include "types.h"
+#include "genome.h"
 
 extern void
 Genome_write_comp32 (char *genomesubdir, char *fileroot, FILE *input, 
@@ -14,4 +15,11 @@ Genome_write_comp32 (char *genomesubdir, char *fileroot, FILE *input,
 		     bool uncompressedp, bool rawp, bool writefilep,
 		     Univcoord_T genomelength, int index1part, int nmessages);
 
+extern void
+Genome_write_merged (char *genomesubdir, char *fileroot, Genome_T base_genome,
+		     Univcoord_T *base_chrlows, Univcoord_T *base_chrhighs,
+		     Univcoord_T *base_newoffsets, bool *base_keepp, int base_nchromosomes,
+		     Genome_T delta_genome, Univcoord_T delta_genomelength, Univcoord_T delta_shift,
+		     Univcoord_T genomelength);
+
 #endif
@@ -43,6 +43,10 @@ static char rcsid[] = "$Id: genome.c 172736 2015-08-27 16:36:31Z twu $";
 #include "littleendian.h"
 #endif
 
+#if !defined(UTILITYP) && !defined(WORDS_BIGENDIAN) && defined(HAVE_SSSE3)
+#include <tmmintrin.h>
+#endif
+
 
 /* Uses 'A' instead of 'N' just as Oligoindex_hr_tally would do */
 /* #define EXTRACT_GENOMICSEG 1 */
@@ -76,6 +80,7 @@ static char rcsid[] = "$Id: genome.c 172736 2015-08-27 16:36:31Z twu $";
 #endif
 
 
+
 #define T Genome_T
 struct T {
   Access_T access;
@@ -88,6 +93,7 @@ struct T {
   char *chars;
   Genomecomp_T *blocks;
   bool compressedp;
+  bool bits128p;		/* blocks are in the GENOME_BITS layout */
 
   char *ptr;
   unsigned int left;
@@ -217,6 +223,7 @@ Genome_new (char *genomesubdir, char *fileroot, char *snps_root, Genometype_T ge
   double seconds;
 
   new->compressedp = compressedp;
+  new->bits128p = (compressedp == true && genometype == GENOME_BITS) ? true : false;
 
   if (compressedp == true) {
     if (genometype == GENOME_OLIGOS) {
@@ -8934,11 +8941,11 @@ uncompress_mmap_bitbybit (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T star
   if (endblock == startblock) {
     /* Special case */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
     for (i = 0; i < 16; i++) {
@@ -8957,11 +8964,11 @@ uncompress_mmap_bitbybit (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T star
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
     for (i = 0; i < 16; i++) {
@@ -8981,11 +8988,11 @@ uncompress_mmap_bitbybit (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T star
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
       for (i = 0; i < 16; i++) {
@@ -9003,11 +9010,11 @@ uncompress_mmap_bitbybit (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T star
 
     if (enddiscard > 0) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
       for (i = 0; i < 16; i++) {
@@ -9050,11 +9057,11 @@ Genome_uncompress_mmap (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T startp
   if (endblock == startblock) {
     /* Special case */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
     memcpy(Buffer,nucleotides[low & 0x0000FFFF],8);
@@ -9073,11 +9080,11 @@ Genome_uncompress_mmap (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T startp
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
     memcpy(Buffer,nucleotides[low & 0x0000FFFF],8);
@@ -9097,11 +9104,11 @@ Genome_uncompress_mmap (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T startp
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
       memcpy(&(gbuffer1[k]),nucleotides[low & 0x0000FFFF],8); k += 8;
@@ -9121,11 +9128,11 @@ Genome_uncompress_mmap (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T startp
 
     if (enddiscard > 0) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
       memcpy(Buffer,nucleotides[low & 0x0000FFFF],8);
@@ -9169,11 +9176,11 @@ Genome_uncompress_memory (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T star
   if (endblock == startblock) {
     /* Special case */
 #if 0
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
     memcpy(Buffer,nucleotides[low & 0x0000FFFF],8);
@@ -9192,11 +9199,11 @@ Genome_uncompress_memory (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T star
 
   } else {
 #if 0
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
     memcpy(Buffer,nucleotides[low & 0x0000FFFF],8);
@@ -9216,11 +9223,11 @@ Genome_uncompress_memory (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T star
       
     while (ptr < endblock) {
 #if 0
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
       memcpy(&(gbuffer1[k]),nucleotides[low & 0x0000FFFF],8); k += 8;
@@ -9240,11 +9247,11 @@ Genome_uncompress_memory (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T star
 
     if (enddiscard > 0) {
 #if 0
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
       memcpy(Buffer,nucleotides[low & 0x0000FFFF],8);
@@ -9289,11 +9296,11 @@ uncompress_mmap_snps_subst (char *gbuffer1, Genomecomp_T *refblocks, Genomecomp_
   if (endblock == startblock) {
     /* Special case */
 #ifdef WORDS_BIGENDIAN
-    althigh = Bigendian_convert_uint(altblocks[ptr]);
-    altlow = Bigendian_convert_uint(altblocks[ptr+1]);
-    refflags = Bigendian_convert_uint(refblocks[ptr+2]);
+    althigh = Bigendian_convert_uint(BLOCK_HIGH(altblocks,ptr));
+    altlow = Bigendian_convert_uint(BLOCK_LOW(altblocks,ptr));
+    refflags = Bigendian_convert_uint(BLOCK_FLAGS(refblocks,ptr));
 #else
-    althigh = altblocks[ptr]; altlow = altblocks[ptr+1]; refflags = refblocks[ptr+2];
+    althigh = BLOCK_HIGH(altblocks,ptr); altlow = BLOCK_LOW(altblocks,ptr); refflags = BLOCK_FLAGS(refblocks,ptr);
 #endif
 
     memcpy(Buffer,nucleotides[altlow & 0x0000FFFF],8);
@@ -9321,11 +9328,11 @@ uncompress_mmap_snps_subst (char *gbuffer1, Genomecomp_T *refblocks, Genomecomp_
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    althigh = Bigendian_convert_uint(altblocks[ptr]);
-    altlow = Bigendian_convert_uint(altblocks[ptr+1]);
-    refflags = Bigendian_convert_uint(refblocks[ptr+2]);
+    althigh = Bigendian_convert_uint(BLOCK_HIGH(altblocks,ptr));
+    altlow = Bigendian_convert_uint(BLOCK_LOW(altblocks,ptr));
+    refflags = Bigendian_convert_uint(BLOCK_FLAGS(refblocks,ptr));
 #else
-    althigh = altblocks[ptr]; altlow = altblocks[ptr+1]; refflags = refblocks[ptr+2];
+    althigh = BLOCK_HIGH(altblocks,ptr); altlow = BLOCK_LOW(altblocks,ptr); refflags = BLOCK_FLAGS(refblocks,ptr);
 #endif
 
     memcpy(Buffer,nucleotides[altlow & 0x0000FFFF],8);
@@ -9354,11 +9361,11 @@ uncompress_mmap_snps_subst (char *gbuffer1, Genomecomp_T *refblocks, Genomecomp_
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      althigh = Bigendian_convert_uint(altblocks[ptr]);
-      altlow = Bigendian_convert_uint(altblocks[ptr+1]);
-      refflags = Bigendian_convert_uint(refblocks[ptr+2]);
+      althigh = Bigendian_convert_uint(BLOCK_HIGH(altblocks,ptr));
+      altlow = Bigendian_convert_uint(BLOCK_LOW(altblocks,ptr));
+      refflags = Bigendian_convert_uint(BLOCK_FLAGS(refblocks,ptr));
 #else
-      althigh = altblocks[ptr]; altlow = altblocks[ptr+1]; refflags = refblocks[ptr+2];
+      althigh = BLOCK_HIGH(altblocks,ptr); altlow = BLOCK_LOW(altblocks,ptr); refflags = BLOCK_FLAGS(refblocks,ptr);
 #endif
 
       memcpy(&(gbuffer1[k]),nucleotides[altlow & 0x0000FFFF],8); k += 8;
@@ -9388,11 +9395,11 @@ uncompress_mmap_snps_subst (char *gbuffer1, Genomecomp_T *refblocks, Genomecomp_
 
     if (enddiscard > 0) {
 #ifdef WORDS_BIGENDIAN
-      althigh = Bigendian_convert_uint(altblocks[ptr]);
-      altlow = Bigendian_convert_uint(altblocks[ptr+1]);
-      refflags = Bigendian_convert_uint(refblocks[ptr+2]);
+      althigh = Bigendian_convert_uint(BLOCK_HIGH(altblocks,ptr));
+      altlow = Bigendian_convert_uint(BLOCK_LOW(altblocks,ptr));
+      refflags = Bigendian_convert_uint(BLOCK_FLAGS(refblocks,ptr));
 #else
-      althigh = altblocks[ptr]; altlow = altblocks[ptr+1]; refflags = refblocks[ptr+2];
+      althigh = BLOCK_HIGH(altblocks,ptr); altlow = BLOCK_LOW(altblocks,ptr); refflags = BLOCK_FLAGS(refblocks,ptr);
 #endif
 
       memcpy(Buffer,nucleotides[altlow & 0x0000FFFF],8);
@@ -9450,11 +9457,11 @@ uncompress_mmap_snps_only (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T sta
   if (endblock == startblock) {
     /* Special case */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
     memcpy(Buffer,EMPTY_32,32);
@@ -9478,11 +9485,11 @@ uncompress_mmap_snps_only (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T sta
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
     memcpy(Buffer,EMPTY_32,32);
@@ -9507,11 +9514,11 @@ uncompress_mmap_snps_only (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T sta
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
       memcpy(&(gbuffer1[k]),EMPTY_32,32);
@@ -9538,11 +9545,11 @@ uncompress_mmap_snps_only (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T sta
 
     if (enddiscard > 0) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
       memcpy(Buffer,EMPTY_32,32);
@@ -9585,9 +9592,9 @@ uncompress_one_char (Genomecomp_T *blocks, Univcoord_T pos, char flagchar, char
   bit = pos % 32;
   
 #ifdef WORDS_BIGENDIAN
-  flags = Bigendian_convert_uint(blocks[ptr+2]);
+  flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-  flags = blocks[ptr+2];
+  flags = BLOCK_FLAGS(blocks,ptr);
 #endif
 
   if (flags & (1 << bit)) {
@@ -9595,18 +9602,18 @@ uncompress_one_char (Genomecomp_T *blocks, Univcoord_T pos, char flagchar, char
 
   } else if (bit < 16) {
 #ifdef WORDS_BIGENDIAN
-    low = Bigendian_convert_uint(blocks[ptr+1]);
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-    low = blocks[ptr+1];
+    low = BLOCK_LOW(blocks,ptr);
 #endif
     c = (low >> (bit+bit)) & LOW_TWO_BITS;
     return chartable[c];
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
 #else
-    high = blocks[ptr];
+    high = BLOCK_HIGH(blocks,ptr);
 #endif
     c = (high >> (bit+bit-32)) & LOW_TWO_BITS;
     return chartable[c];
@@ -9629,18 +9636,18 @@ uncompress_one_char_ignore_flags (Genomecomp_T *blocks, Univcoord_T pos) {
   
   if (bit < 16) {
 #ifdef WORDS_BIGENDIAN
-    low = Bigendian_convert_uint(blocks[ptr+1]);
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-    low = blocks[ptr+1];
+    low = BLOCK_LOW(blocks,ptr);
 #endif
     c = (low >> (bit+bit)) & LOW_TWO_BITS;
     return CHARTABLE[c];
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
 #else
-    high = blocks[ptr];
+    high = BLOCK_HIGH(blocks,ptr);
 #endif
     c = (high >> (bit+bit-32)) & LOW_TWO_BITS;
     return CHARTABLE[c];
@@ -9670,11 +9677,11 @@ Genome_ntcounts_mmap (Univcoord_T *na, Univcoord_T *nc, Univcoord_T *ng, Univcoo
   if (endblock == startblock) {
     /* Special case */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     for (i = 0; i < 16; i++) {
       Buffer[i] = (char) ((flags & 1U) ? flagchars[low & 3U] : defaultchars[low & 3U]);
@@ -9696,11 +9703,11 @@ Genome_ntcounts_mmap (Univcoord_T *na, Univcoord_T *nc, Univcoord_T *ng, Univcoo
     }
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     for (i = 0; i < 16; i++) {
       Buffer[i] = (char) ((flags & 1U) ? flagchars[low & 3U] : defaultchars[low & 3U]);
@@ -9724,11 +9731,11 @@ Genome_ntcounts_mmap (Univcoord_T *na, Univcoord_T *nc, Univcoord_T *ng, Univcoo
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
       for (i = 0; i < 16; i++) {
 	c = (char) ((flags & 1U) ? flagchars[low & 3U] : defaultchars[low & 3U]);
@@ -9757,11 +9764,11 @@ Genome_ntcounts_mmap (Univcoord_T *na, Univcoord_T *nc, Univcoord_T *ng, Univcoo
 
     if (enddiscard > 0) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
       for (i = 0; i < 16; i++) {
 	Buffer[i] = (char) ((flags & 1U) ? flagchars[low & 3U] : defaultchars[low & 3U]);
@@ -9829,11 +9836,11 @@ uncompress_mmap_nucleotides_wstatus (unsigned char *gbuffer, Genomecomp_T *block
   if (endblock == startblock) {
     /* Special case */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     flags >>= startdiscard;
     if (startdiscard < 16) {
@@ -9878,11 +9885,11 @@ uncompress_mmap_nucleotides_wstatus (unsigned char *gbuffer, Genomecomp_T *block
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     flags >>= startdiscard;
     if (startdiscard < 16) {
@@ -9924,11 +9931,11 @@ uncompress_mmap_nucleotides_wstatus (unsigned char *gbuffer, Genomecomp_T *block
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
       if (flags) {
 	/* return false; */
@@ -9959,11 +9966,11 @@ uncompress_mmap_nucleotides_wstatus (unsigned char *gbuffer, Genomecomp_T *block
 
     if (enddiscard > 0) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
       i = 0;
       while (i < enddiscard && i < 16) {
@@ -10022,9 +10029,9 @@ uncompress_mmap_nucleotides (unsigned char *gbuffer, Genomecomp_T *blocks, Univc
     /* Special case */
     if (startdiscard < 16) {
 #ifdef WORDS_BIGENDIAN
-      low = Bigendian_convert_uint(blocks[ptr+1]);
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-      low = blocks[ptr+1];
+      low = BLOCK_LOW(blocks,ptr);
 #endif
       low >>= (startdiscard+startdiscard);
       while (startdiscard < enddiscard && startdiscard < 16) {
@@ -10037,9 +10044,9 @@ uncompress_mmap_nucleotides (unsigned char *gbuffer, Genomecomp_T *blocks, Univc
       startdiscard -= 16;
       enddiscard -= 16;
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
 #else
-      high = blocks[ptr];
+      high = BLOCK_HIGH(blocks,ptr);
 #endif
       high >>= (startdiscard+startdiscard);
       while (startdiscard < enddiscard) {
@@ -10051,10 +10058,10 @@ uncompress_mmap_nucleotides (unsigned char *gbuffer, Genomecomp_T *blocks, Univc
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr);
 #endif
     if (startdiscard < 16) {
       low >>= (startdiscard+startdiscard);
@@ -10076,10 +10083,10 @@ uncompress_mmap_nucleotides (unsigned char *gbuffer, Genomecomp_T *blocks, Univc
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr);
 #endif
       for (i = 0; i < 16; i++) {
 	*gbuffer++ = (unsigned char) (low & 0x03);
@@ -10095,10 +10102,10 @@ uncompress_mmap_nucleotides (unsigned char *gbuffer, Genomecomp_T *blocks, Univc
     }
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr);
 #endif
     i = 0;
     while (i < enddiscard && i < 16) {
@@ -10148,17 +10155,17 @@ uncompress_mmap_int_string (unsigned char *gbuffer, Genomecomp_T *blocks, Univco
   if (endblock == startblock) {
     /* Special case */
 #ifdef WORDS_BIGENDIAN
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    flags = blocks[ptr+2];
+    flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     flags >>= startdiscard;
 
     if (startdiscard < 16) {
 #ifdef WORDS_BIGENDIAN
-      low = Bigendian_convert_uint(blocks[ptr+1]);
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-      low = blocks[ptr+1];
+      low = BLOCK_LOW(blocks,ptr);
 #endif
       low >>= (startdiscard+startdiscard);
       while (startdiscard < enddiscard && startdiscard < 16) {
@@ -10176,9 +10183,9 @@ uncompress_mmap_int_string (unsigned char *gbuffer, Genomecomp_T *blocks, Univco
       startdiscard -= 16;
       enddiscard -= 16;
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
 #else
-      high = blocks[ptr];
+      high = BLOCK_HIGH(blocks,ptr);
 #endif
       high >>= (startdiscard+startdiscard);
       while (startdiscard < enddiscard) {
@@ -10195,11 +10202,11 @@ uncompress_mmap_int_string (unsigned char *gbuffer, Genomecomp_T *blocks, Univco
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     flags >>= startdiscard;
     if (startdiscard < 16) {
@@ -10232,11 +10239,11 @@ uncompress_mmap_int_string (unsigned char *gbuffer, Genomecomp_T *blocks, Univco
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
       for (i = 0; i < 16; i++) {
 	if (flags & 0x01) {
@@ -10262,11 +10269,11 @@ uncompress_mmap_int_string (unsigned char *gbuffer, Genomecomp_T *blocks, Univco
     }
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     i = 0;
     while (i < enddiscard && i < 16) {
@@ -10325,17 +10332,17 @@ uncompress_mmap_int_string_convert (unsigned char *gbuffer, Genomecomp_T *blocks
   if (endblock == startblock) {
     /* Special case */
 #ifdef WORDS_BIGENDIAN
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    flags = blocks[ptr+2];
+    flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     flags >>= startdiscard;
 
     if (startdiscard < 16) {
 #ifdef WORDS_BIGENDIAN
-      low = Bigendian_convert_uint(blocks[ptr+1]);
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-      low = blocks[ptr+1];
+      low = BLOCK_LOW(blocks,ptr);
 #endif
       low >>= (startdiscard+startdiscard);
       while (startdiscard < enddiscard && startdiscard < 16) {
@@ -10353,9 +10360,9 @@ uncompress_mmap_int_string_convert (unsigned char *gbuffer, Genomecomp_T *blocks
       startdiscard -= 16;
       enddiscard -= 16;
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
 #else
-      high = blocks[ptr];
+      high = BLOCK_HIGH(blocks,ptr);
 #endif
       high >>= (startdiscard+startdiscard);
       while (startdiscard < enddiscard) {
@@ -10372,11 +10379,11 @@ uncompress_mmap_int_string_convert (unsigned char *gbuffer, Genomecomp_T *blocks
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     flags >>= startdiscard;
     if (startdiscard < 16) {
@@ -10409,11 +10416,11 @@ uncompress_mmap_int_string_convert (unsigned char *gbuffer, Genomecomp_T *blocks
       
     while (ptr < endblock) {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(blocks[ptr]);
-      low = Bigendian_convert_uint(blocks[ptr+1]);
-      flags = Bigendian_convert_uint(blocks[ptr+2]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+      flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-      high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+      high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
       for (i = 0; i < 16; i++) {
 	if (flags & 0x01) {
@@ -10439,11 +10446,11 @@ uncompress_mmap_int_string_convert (unsigned char *gbuffer, Genomecomp_T *blocks
     }
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     i = 0;
     while (i < enddiscard && i < 16) {
@@ -10492,6 +10499,7 @@ uncompress_mmap_int_string_convert (unsigned char *gbuffer, Genomecomp_T *blocks
 
 static T genome;
 static Genomecomp_T *genome_blocks;
+static size_t genome_nwords;	/* Words in genome_blocks, or 0 if not known */
 
 static T genomealt;
 static Genomecomp_T *genomealt_blocks;	/* Can be equal to genome_blocks, but not NULL */
@@ -10499,6 +10507,12 @@ static Genomecomp_T *genomealt_blocks;	/* Can be equal to genome_blocks, but not
 static Mode_T mode;
 static int circular_typeint = -1;
 
+#ifndef UTILITYP
+/* Incremented whenever the genome blocks are replaced.  Cached windows
+   from an older generation are ignored. */
+static unsigned int window_generation = 1;
+#endif
+
 static char *fwd_conversion;
 static char *rev_conversion;
 
@@ -10507,6 +10521,13 @@ void
 Genome_setup (T genome_in, T genomealt_in, Mode_T mode_in, int circular_typeint_in) {
   genome = genome_in;
   genome_blocks = genome->blocks;
+  genome_nwords = genome->len/sizeof(Genomecomp_T);
+#ifdef GSNAP
+  if (genome->compressedp == true && genome->bits128p == false) {
+    fprintf(stderr,"GSNAP expects its compressed genome in the genomebits128 layout\n");
+    abort();
+  }
+#endif
   if (genomealt_in == NULL) {
     genomealt = genome_in;
     genomealt_blocks = genome->blocks;
@@ -10529,6 +10550,9 @@ Genome_setup (T genome_in, T genomealt_in, Mode_T mode_in, int circular_typeint_
     rev_conversion = "GCGT";
   }
   circular_typeint = circular_typeint_in;
+#ifndef UTILITYP
+  window_generation++;
+#endif
   return;
 }
 
@@ -10536,12 +10560,338 @@ void
 Genome_user_setup (Genomecomp_T *genome_blocks_in) {
   genome = (T) NULL;
   genome_blocks = genome_blocks_in;
+  genome_nwords = 0;
   genomealt = (T) NULL;
   genomealt_blocks = genome_blocks_in;
   mode = STANDARD;
+#ifndef UTILITYP
+  window_generation++;
+#endif
+  return;
+}
+
+
+
+/************************************************************************
+ *   Window cache.  Stage 3, dynamic programming, and the GMAP fallback
+ *   decode the same neighborhood many times for one read or read
+ *   pair.  Each thread keeps a small direct-mapped cache of decoded
+ *   windows of the genome, keyed by aligned window, and serves
+ *   overlapping fills by memcpy.
+ ************************************************************************/
+
+#ifdef UTILITYP
+#define uncompress_mmap_cached(gbuffer1,blocks,nwords,startpos,endpos) Genome_uncompress_mmap(gbuffer1,blocks,startpos,endpos)
+
+#else
+#define WINDOW_BLOCKS 16	/* 512 nt per window */
+#define WINDOW_LENGTH (WINDOW_BLOCKS*32)
+#define NWINDOWS 64
+#define WINDOW_MAXFILL (4*WINDOW_LENGTH) /* Longer fills would only evict other windows */
+
+typedef struct Window_cache_T *Window_cache_T;
+struct Window_cache_T {
+  Genomecomp_T *blocks[NWINDOWS];
+  Univcoord_T windowi[NWINDOWS];
+  unsigned int generation[NWINDOWS];
+  char chars[NWINDOWS][WINDOW_LENGTH];
+
+  unsigned long long nhits;
+  unsigned long long nmisses;
+};
+
+static unsigned long long window_total_hits = 0;
+static unsigned long long window_total_misses = 0;
+
+#ifdef HAVE_PTHREAD
+static pthread_once_t window_cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t window_cache_key;
+static pthread_mutex_t window_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Adds the counts of an exiting thread to the totals */
+static void
+window_cache_free (void *data) {
+  Window_cache_T cache = (Window_cache_T) data;
+
+  pthread_mutex_lock(&window_stats_mutex);
+  window_total_hits += cache->nhits;
+  window_total_misses += cache->nmisses;
+  pthread_mutex_unlock(&window_stats_mutex);
+
+  FREE_KEEP(cache);
+  return;
+}
+
+static void
+window_cache_key_create (void) {
+  pthread_key_create(&window_cache_key,window_cache_free);
+  return;
+}
+#else
+static Window_cache_T window_cache = NULL;
+#endif
+
+
+static Window_cache_T
+window_cache_get (bool createp) {
+  Window_cache_T cache;
+
+#ifdef HAVE_PTHREAD
+  pthread_once(&window_cache_once,window_cache_key_create);
+  if ((cache = (Window_cache_T) pthread_getspecific(window_cache_key)) == NULL && createp == true) {
+    cache = (Window_cache_T) MALLOC_KEEP(sizeof(*cache));
+    memset((void *) cache->generation,0,NWINDOWS*sizeof(unsigned int));
+    cache->nhits = cache->nmisses = 0;
+    pthread_setspecific(window_cache_key,(void *) cache);
+  }
+#else
+  if ((cache = window_cache) == NULL && createp == true) {
+    cache = window_cache = (Window_cache_T) MALLOC_KEEP(sizeof(*cache));
+    memset((void *) cache->generation,0,NWINDOWS*sizeof(unsigned int));
+    cache->nhits = cache->nmisses = 0;
+  }
+#endif
+
+  return cache;
+}
+
+
+#if !defined(WORDS_BIGENDIAN) && defined(HAVE_SSSE3)
+#ifndef GSNAP
+/* Decodes whole blocks, 16 nucleotides per 32-bit word.  The four
+   2-bit fields of each byte are separated by shifts and interleaved
+   back into order, then translated to ASCII by a byte shuffle. */
+static void
+decode_blocks (char *chars, Genomecomp_T *blocks, int nblocks) {
+  __m128i packed, y0, y1, y2, y3, a, b, nts, flagbytes, isflag;
+  __m128i mask3 = _mm_set1_epi8(0x03);
+  __m128i acgt = _mm_setr_epi8('A','C','G','T',0,0,0,0,0,0,0,0,0,0,0,0);
+  __m128i nchar = _mm_set1_epi8('N');
+  __m128i bits = _mm_setr_epi8(1,2,4,8,16,32,64,-128,1,2,4,8,16,32,64,-128);
+  __m128i select_low = _mm_setr_epi8(0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1);
+  __m128i select_high = _mm_setr_epi8(2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3);
+  Genomecomp_T flags;
+  int i;
+
+  for (i = 0; i < nblocks; i++, blocks += 3, chars += 32) {
+    /* Nucleotides 0..15 are in the low word at blocks[1], 16..31 in the high word at blocks[0] */
+    packed = _mm_set_epi32(0,0,blocks[0],blocks[1]);
+    y0 = _mm_and_si128(packed,mask3);
+    y1 = _mm_and_si128(_mm_srli_epi16(packed,2),mask3);
+    y2 = _mm_and_si128(_mm_srli_epi16(packed,4),mask3);
+    y3 = _mm_and_si128(_mm_srli_epi16(packed,6),mask3);
+    a = _mm_unpacklo_epi8(y0,y1);
+    b = _mm_unpacklo_epi8(y2,y3);
+
+    flags = blocks[2];
+    flagbytes = _mm_cvtsi32_si128((int) flags);
+
+    nts = _mm_shuffle_epi8(acgt,_mm_unpacklo_epi16(a,b));
+    if (flags) {
+      isflag = _mm_shuffle_epi8(flagbytes,select_low);
+      isflag = _mm_cmpeq_epi8(_mm_and_si128(isflag,bits),bits);
+      nts = _mm_or_si128(_mm_andnot_si128(isflag,nts),_mm_and_si128(isflag,nchar));
+    }
+    _mm_storeu_si128((__m128i *) chars,nts);
+
+    nts = _mm_shuffle_epi8(acgt,_mm_unpackhi_epi16(a,b));
+    if (flags) {
+      isflag = _mm_shuffle_epi8(flagbytes,select_high);
+      isflag = _mm_cmpeq_epi8(_mm_and_si128(isflag,bits),bits);
+      nts = _mm_or_si128(_mm_andnot_si128(isflag,nts),_mm_and_si128(isflag,nchar));
+    }
+    _mm_storeu_si128((__m128i *) &(chars[16]),nts);
+  }
+
+  return;
+}
+#else
+/* Same for the GENOME_BITS layout that GSNAP reads.  Each nucleotide
+   is one bit in the highbits word and one in the lowbits word, so the
+   bits of each word are spread over bytes the same way as the flags,
+   and combined into a 2-bit code for the byte shuffle.  nblocks must
+   be a multiple of 4. */
+static void
+decode_bits128 (char *chars, Genomecomp_T *blocks, int nblocks) {
+  __m128i highbytes, lowbytes, flagbytes, code, nts, isflag;
+  __m128i acgt = _mm_setr_epi8('A','C','G','T',0,0,0,0,0,0,0,0,0,0,0,0);
+  __m128i nchar = _mm_set1_epi8('N');
+  __m128i one = _mm_set1_epi8(1);
+  __m128i two = _mm_set1_epi8(2);
+  __m128i bits = _mm_setr_epi8(1,2,4,8,16,32,64,-128,1,2,4,8,16,32,64,-128);
+  __m128i select[2];
+  Genomecomp_T flags;
+  int i, col, half;
+
+  select[0] = _mm_setr_epi8(0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1);
+  select[1] = _mm_setr_epi8(2,2,2,2,2,2,2,2,3,3,3,3,3,3,3,3);
+
+  for (i = 0; i < nblocks; i += 4, blocks += 12) {
+    for (col = 0; col < 4; col++, chars += 32) {
+      highbytes = _mm_cvtsi32_si128((int) blocks[col]);
+      lowbytes = _mm_cvtsi32_si128((int) blocks[col+4]);
+      flags = blocks[col+8];
+      flagbytes = _mm_cvtsi32_si128((int) flags);
+
+      for (half = 0; half < 2; half++) {
+	code = _mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(highbytes,select[half]),bits),bits),two);
+	code = _mm_or_si128(code,_mm_and_si128(_mm_cmpeq_epi8(_mm_and_si128(_mm_shuffle_epi8(lowbytes,select[half]),bits),bits),one));
+	nts = _mm_shuffle_epi8(acgt,code);
+	if (flags) {
+	  isflag = _mm_shuffle_epi8(flagbytes,select[half]);
+	  isflag = _mm_cmpeq_epi8(_mm_and_si128(isflag,bits),bits);
+	  nts = _mm_or_si128(_mm_andnot_si128(isflag,nts),_mm_and_si128(isflag,nchar));
+	}
+	_mm_storeu_si128((__m128i *) &(chars[16*half]),nts);
+      }
+    }
+  }
+
+  return;
+}
+#endif
+
+#else
+#ifndef GSNAP
+static void
+decode_blocks (char *chars, Genomecomp_T *blocks, int nblocks) {
+  Genomecomp_T high, low, flags;
+  int i, k;
+
+  for (i = 0; i < nblocks; i++, blocks += 3, chars += 32) {
+#ifdef WORDS_BIGENDIAN
+    high = Bigendian_convert_uint(blocks[0]);
+    low = Bigendian_convert_uint(blocks[1]);
+    flags = Bigendian_convert_uint(blocks[2]);
+#else
+    high = blocks[0]; low = blocks[1]; flags = blocks[2];
+#endif
+
+    memcpy(chars,nucleotides[low & 0x0000FFFF],8);
+    memcpy(&(chars[8]),nucleotides[low >> 16],8);
+    memcpy(&(chars[16]),nucleotides[high & 0x0000FFFF],8);
+    memcpy(&(chars[24]),nucleotides[high >> 16],8);
+    for (k = 0; flags != 0; k++, flags >>= 1) {
+      if (flags & 1U) {
+	chars[k] = 'N';
+      }
+    }
+  }
+
   return;
 }
+#else
+/* nblocks must be a multiple of 4 */
+static void
+decode_bits128 (char *chars, Genomecomp_T *blocks, int nblocks) {
+  Genomecomp_T highbits, lowbits, flags;
+  int i, col, k;
 
+  for (i = 0; i < nblocks; i += 4, blocks += 12) {
+    for (col = 0; col < 4; col++, chars += 32) {
+#ifdef WORDS_BIGENDIAN
+      highbits = Bigendian_convert_uint(blocks[col]);
+      lowbits = Bigendian_convert_uint(blocks[col+4]);
+      flags = Bigendian_convert_uint(blocks[col+8]);
+#else
+      highbits = blocks[col]; lowbits = blocks[col+4]; flags = blocks[col+8];
+#endif
+
+      for (k = 0; k < 32; k++) {
+	chars[k] = "ACGT"[(((highbits >> k) & 1U) << 1) | ((lowbits >> k) & 1U)];
+      }
+      for (k = 0; flags != 0; k++, flags >>= 1) {
+	if (flags & 1U) {
+	  chars[k] = 'N';
+	}
+      }
+    }
+  }
+
+  return;
+}
+#endif
+#endif
+
+
+/* Same output as Genome_uncompress_mmap.  nwords is the number of
+   words available in blocks, so that windows past the end of the
+   genome are never decoded. */
+static void
+uncompress_mmap_cached (char *gbuffer1, Genomecomp_T *blocks, size_t nwords,
+			Univcoord_T startpos, Univcoord_T endpos) {
+  Window_cache_T cache;
+  Univcoord_T windowi, windowstart, windowend;
+  int slot;
+
+  if (endpos <= startpos || endpos - startpos > WINDOW_MAXFILL ||
+      ((endpos - 1)/WINDOW_LENGTH + 1) * (WINDOW_BLOCKS*3) > nwords) {
+    Genome_uncompress_mmap(gbuffer1,blocks,startpos,endpos);
+    return;
+  }
+
+  cache = window_cache_get(/*createp*/true);
+  windowi = startpos/WINDOW_LENGTH;
+  while (startpos < endpos) {
+    slot = windowi % NWINDOWS;
+    if (cache->generation[slot] == window_generation && cache->windowi[slot] == windowi &&
+	cache->blocks[slot] == blocks) {
+      cache->nhits += 1;
+    } else {
+      /* WINDOW_BLOCKS is a multiple of 4, so a window starts at the same word in either layout */
+#ifdef GSNAP
+      decode_bits128(cache->chars[slot],&(blocks[windowi*(WINDOW_BLOCKS*3)]),WINDOW_BLOCKS);
+#else
+      decode_blocks(cache->chars[slot],&(blocks[windowi*(WINDOW_BLOCKS*3)]),WINDOW_BLOCKS);
+#endif
+      cache->blocks[slot] = blocks;
+      cache->windowi[slot] = windowi;
+      cache->generation[slot] = window_generation;
+      cache->nmisses += 1;
+    }
+
+    windowstart = windowi*WINDOW_LENGTH;
+    if ((windowend = windowstart + WINDOW_LENGTH) > endpos) {
+      windowend = endpos;
+    }
+    memcpy(gbuffer1,&(cache->chars[slot][startpos - windowstart]),windowend - startpos);
+    gbuffer1 += windowend - startpos;
+    startpos = windowend;
+    windowi++;
+  }
+
+  return;
+}
+
+
+void
+Genome_window_cache_report (void) {
+  Window_cache_T cache;
+  unsigned long long nhits, nmisses;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&window_stats_mutex);
+#endif
+  nhits = window_total_hits;
+  nmisses = window_total_misses;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&window_stats_mutex);
+#endif
+
+  /* Include the calling thread, which may have done the alignments itself */
+  if ((cache = window_cache_get(/*createp*/false)) != NULL) {
+    nhits += cache->nhits;
+    nmisses += cache->nmisses;
+  }
+
+  if (nhits + nmisses > 0) {
+    fprintf(stderr,"Genome window cache: %llu hits, %llu misses (%.1f%% hit rate)\n",
+	    nhits,nmisses,100.0*(double) nhits/(double) (nhits + nmisses));
+  }
+  return;
+}
+
+#endif
 
 
 static const Except_T gbufferlen_error = { "Insufficient allocation" };
@@ -10732,7 +11082,7 @@ Genome_fill_buffer_simple (T this, Univcoord_T left, Chrpos_T length, char *gbuf
 #ifdef EXTRACT_GENOMICSEG
       uncompress_mmap_bitbybit(gbuffer1,this->blocks,left,left+length,DEFAULT_FLAGS,A_FLAGS);
 #else
-      Genome_uncompress_mmap(gbuffer1,this->blocks,left,left+length);
+      uncompress_mmap_cached(gbuffer1,this->blocks,this->len/sizeof(Genomecomp_T),left,left+length);
 #endif
     }
   }
@@ -10775,7 +11125,7 @@ Genome_fill_buffer_blocks (Univcoord_T left, Chrpos_T length, char *gbuffer1) {
 #ifdef EXTRACT_GENOMICSEG
     uncompress_mmap_bitbybit(gbuffer1,genome_blocks,left,left+length,DEFAULT_CHARS,A_FLAGS);
 #else
-    Genome_uncompress_mmap(gbuffer1,genome_blocks,left,left+length);
+    uncompress_mmap_cached(gbuffer1,genome_blocks,genome_nwords,left,left+length);
 #endif
   }
   gbuffer1[length] = '\0';
@@ -10787,7 +11137,7 @@ Genome_fill_buffer_blocks_noterm (Univcoord_T left, Chrpos_T length, char *gbuff
   
   if (length > 0) {
     assert(left + length >= left);
-    Genome_uncompress_mmap(gbuffer1,genome_blocks,left,left+length);
+    uncompress_mmap_cached(gbuffer1,genome_blocks,genome_nwords,left,left+length);
     uncompress_mmap_snps_subst(gbuffer2,genome_blocks,genomealt_blocks,left,left+length);
   }
   /* gbuffer1[length] = '\0'; */
@@ -11105,7 +11455,7 @@ Genome_get_segment_blocks_right (char *segment, char *segmentalt, Univcoord_T le
   }
 
   /* printf("Genome_get_segment_blocks called with left = %u, revcomp %d\n",left,revcomp); */
-  Genome_uncompress_mmap(segment,genome_blocks,left,left+length-out_of_bounds);
+  uncompress_mmap_cached(segment,genome_blocks,genome_nwords,left,left+length-out_of_bounds);
   segment[length] = '\0';
   if (revcomp == true) {
     make_complement_inplace(segment,length);
@@ -11151,7 +11501,7 @@ Genome_get_segment_blocks_left (char *segment, char *segmentalt, Univcoord_T rig
   }
 
   /* printf("Genome_get_segment_blocks called with left = %u, revcomp %d\n",right-length,revcomp); */
-  Genome_uncompress_mmap(&(segment[out_of_bounds]),genome_blocks,right-length+out_of_bounds,right);
+  uncompress_mmap_cached(&(segment[out_of_bounds]),genome_blocks,genome_nwords,right-length+out_of_bounds,right);
   segment[length] = '\0';
   if (revcomp == true) {
     make_complement_inplace(segment,length);
@@ -1,6 +1,9 @@
 /* $Id: genome.h 168395 2015-06-26 17:13:13Z twu $ */
 #ifndef GENOME_INCLUDED
 #define GENOME_INCLUDED
+#ifdef HAVE_CONFIG_H
+#include <config.h>		/* For WORDS_BIGENDIAN */
+#endif
 
 #include "bool.h"
 #include "access.h"
@@ -10,11 +13,87 @@
 #include "iit-read-univ.h"
 #include "chrnum.h"
 #include "mode.h"
+#ifdef WORDS_BIGENDIAN
+#include "bigendian.h"
+#endif
 
 #define OUTOFBOUNDS '*'
 
 typedef enum {GENOME_OLIGOS, GENOME_BITS} Genometype_T;
 
+
+/* A GENOME_OLIGOS genome stores each 32-nt block as three words:
+   high (nt 16..31, two bits each), low (nt 0..15), and flags.  A
+   GENOME_BITS genome stores each group of four blocks as four
+   highbits words, four lowbits words, and four flags words, with one
+   bit per nucleotide.  The accessors below take a GENOME_OLIGOS
+   offset ptr = 3*(pos/32) and return the word that a GENOME_OLIGOS
+   genome would hold there, so that decoders can read either layout
+   while keeping their own block arithmetic. */
+
+static inline Univcoord_T
+Genome_bits128_offset (Univcoord_T ptr) {
+  Univcoord_T blocki = ptr/3;
+
+  return (blocki/4)*12 + (blocki & 3);
+}
+
+/* Inverse of nt_unshuffle in compress-write.c: interleaves the high
+   bits in the upper half of x with the low bits in the lower half */
+static inline UINT4
+Genome_bits128_shuffle (UINT4 x) {
+  UINT4 t;
+
+  t = (x ^ (x >> 8)) & 0x0000FF00;  x = x ^ t ^ (t << 8);
+  t = (x ^ (x >> 4)) & 0x00F000F0;  x = x ^ t ^ (t << 4);
+  t = (x ^ (x >> 2)) & 0x0C0C0C0C;  x = x ^ t ^ (t << 2);
+  t = (x ^ (x >> 1)) & 0x22222222;  x = x ^ t ^ (t << 1);
+  return x;
+}
+
+static inline Genomecomp_T
+Genome_bits128_high (Genomecomp_T *blocks, Univcoord_T ptr) {
+  Univcoord_T w = Genome_bits128_offset(ptr);
+
+#ifdef WORDS_BIGENDIAN
+  return Bigendian_convert_uint(Genome_bits128_shuffle((Bigendian_convert_uint(blocks[w]) & 0xFFFF0000) |
+						       (Bigendian_convert_uint(blocks[w+4]) >> 16)));
+#else
+  return Genome_bits128_shuffle((blocks[w] & 0xFFFF0000) | (blocks[w+4] >> 16));
+#endif
+}
+
+static inline Genomecomp_T
+Genome_bits128_low (Genomecomp_T *blocks, Univcoord_T ptr) {
+  Univcoord_T w = Genome_bits128_offset(ptr);
+
+#ifdef WORDS_BIGENDIAN
+  return Bigendian_convert_uint(Genome_bits128_shuffle((Bigendian_convert_uint(blocks[w]) << 16) |
+						       (Bigendian_convert_uint(blocks[w+4]) & 0x0000FFFF)));
+#else
+  return Genome_bits128_shuffle((blocks[w] << 16) | (blocks[w+4] & 0x0000FFFF));
+#endif
+}
+
+static inline Genomecomp_T
+Genome_bits128_flags (Genomecomp_T *blocks, Univcoord_T ptr) {
+  return blocks[Genome_bits128_offset(ptr) + 8];
+}
+
+/* Decoders read blocks through these.  GSNAP gives every module its
+   GENOME_BITS genome in place of the GENOME_OLIGOS one, so the layout
+   is fixed when the program is compiled, and no read has to test it */
+#ifdef GSNAP
+#define BLOCK_HIGH(blocks,ptr) Genome_bits128_high(blocks,ptr)
+#define BLOCK_LOW(blocks,ptr) Genome_bits128_low(blocks,ptr)
+#define BLOCK_FLAGS(blocks,ptr) Genome_bits128_flags(blocks,ptr)
+#else
+#define BLOCK_HIGH(blocks,ptr) (blocks)[ptr]
+#define BLOCK_LOW(blocks,ptr) (blocks)[(ptr)+1]
+#define BLOCK_FLAGS(blocks,ptr) (blocks)[(ptr)+2]
+#endif
+
+
 #define T Genome_T
 typedef struct T *T;
 
@@ -36,6 +115,9 @@ Genome_setup (T genome_in, T genomealt_in, Mode_T mode_in, int circular_typeint_
 extern void
 Genome_user_setup (Genomecomp_T *genome_blocks_in);
 
+extern void
+Genome_window_cache_report (void);
+
 extern void
 Genome_uncompress_mmap (char *gbuffer1, Genomecomp_T *blocks, Univcoord_T startpos, 
 			Univcoord_T endpos);
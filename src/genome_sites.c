@@ -23,6 +23,7 @@ static char rcsid[] = "$Id: genome_sites.c 153955 2014-11-24 17:54:45Z twu $";
 #include "atoi.h"
 #include "maxent_hr.h"
 #include "popcount.h"
+#include "genome.h"		/* For BLOCK_HIGH */
 
 
 #ifdef WORDS_BIGENDIAN
@@ -69,7 +70,6 @@ static char rcsid[] = "$Id: genome_sites.c 153955 2014-11-24 17:54:45Z twu $";
 
 
 
-
 static const Genomecomp_T donor_gt_bits[] =
 {0x000,0x000,0x000,0x001,0x000,0x000,0x000,0x001,0x000,0x000,0x000,0x001,0x000,0x000,0x002,0x001,
  0x000,0x000,0x000,0x001,0x000,0x000,0x000,0x001,0x000,0x000,0x000,0x001,0x000,0x000,0x002,0x001,
@@ -24734,11 +24734,11 @@ Genome_print_blocks (Genomecomp_T *blocks, Univcoord_T startpos, Univcoord_T end
 
   for (ptr = startblock ; ptr <= endblock; ptr += 3) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     printf("high: %08X  low: %08X  flags: %08X\t",high,low,flags);
     printf("%llu\t",(unsigned long long) ptr/3*32U);
@@ -24805,9 +24805,9 @@ block_find (Genomecomp_T *high_halfsite, Genomecomp_T *low_halfsite, Genomecomp_
   /* High */
   debug2(printf("Evaluating high %08X and low %08X\n",*ptr,ptr[1]));
 #ifdef WORDS_BIGENDIAN
-  compare = Bigendian_convert_uint(*ptr++);
+  compare = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr - ref_blocks));
 #else
-  compare = *ptr++;
+  compare = BLOCK_HIGH(ref_blocks,ptr - ref_blocks);
 #endif
   /* Get high_halfsite bit */
   found = splicesite_bits[compare >> 16];
@@ -24821,9 +24821,9 @@ block_find (Genomecomp_T *high_halfsite, Genomecomp_T *low_halfsite, Genomecomp_
 
   /* Low */
 #ifdef WORDS_BIGENDIAN
-  compare = Bigendian_convert_uint(*ptr++);
+  compare = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr - ref_blocks));
 #else
-  compare = *ptr++;
+  compare = BLOCK_LOW(ref_blocks,ptr - ref_blocks);
 #endif
   found &= (splicesite_bits[compare >> 16] << 8) | 0xFFFE00FF;
   debug2(printf("  splicesite_bits_1: %08X\n",splicesite_bits[compare >> 16] << 8));
@@ -24836,9 +24836,9 @@ block_find (Genomecomp_T *high_halfsite, Genomecomp_T *low_halfsite, Genomecomp_
   /* Flags: N is considered a mismatch */
   debug2(printf("Marking flags: genome %08X ",*ptr));
 #ifdef WORDS_BIGENDIAN
-  flags = Bigendian_convert_uint(*ptr);
+  flags = Bigendian_convert_uint(BLOCK_FLAGS(ref_blocks,ptr - ref_blocks));
 #else
-  flags = (*ptr);
+  flags = BLOCK_FLAGS(ref_blocks,ptr - ref_blocks);
 #endif
 
   found &= ~flags;
@@ -24867,11 +24867,11 @@ block_find_snp (Genomecomp_T *high_halfsite, Genomecomp_T *low_halfsite, Genomec
   debug2(printf("Evaluating ref high %08X and low %08X, and alt high %08X and low %08X\n",
 		*ref_ptr,ref_ptr[1],*alt_ptr,alt_ptr[1]));
 #ifdef WORDS_BIGENDIAN
-  ref = Bigendian_convert_uint(*ref_ptr++);
-  alt = Bigendian_convert_uint(*alt_ptr++);
+  ref = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ref_ptr - ref_blocks));
+  alt = Bigendian_convert_uint(BLOCK_HIGH(snp_blocks,alt_ptr - snp_blocks));
 #else
-  ref = *ref_ptr++;
-  alt = *alt_ptr++;
+  ref = BLOCK_HIGH(ref_blocks,ref_ptr - ref_blocks);
+  alt = BLOCK_HIGH(snp_blocks,alt_ptr - snp_blocks);
 #endif
   /* Get high_halfsite bit */
   found = splicesite_bits[ref >> 16] | splicesite_bits[alt >> 16];
@@ -24887,11 +24887,11 @@ block_find_snp (Genomecomp_T *high_halfsite, Genomecomp_T *low_halfsite, Genomec
 
   /* Low */
 #ifdef WORDS_BIGENDIAN
-  ref = Bigendian_convert_uint(*ref_ptr++);
-  alt = Bigendian_convert_uint(*alt_ptr++);
+  ref = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ref_ptr - ref_blocks));
+  alt = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,alt_ptr - snp_blocks));
 #else
-  ref = *ref_ptr++;
-  alt = *alt_ptr++;
+  ref = BLOCK_LOW(ref_blocks,ref_ptr - ref_blocks);
+  alt = BLOCK_LOW(snp_blocks,alt_ptr - snp_blocks);
 #endif
   found &= ((splicesite_bits[ref >> 16] | splicesite_bits[alt >> 16]) << 8) | 0xFFFE00FF;
   debug2(printf("  splicesite_bits_1: %08X | %08X\n",
@@ -24906,9 +24906,9 @@ block_find_snp (Genomecomp_T *high_halfsite, Genomecomp_T *low_halfsite, Genomec
   /* Reference flags: N is considered a mismatch */
   debug2(printf("Marking flags: genome %08X ",*ref_ptr));
 #ifdef WORDS_BIGENDIAN
-  flags = Bigendian_convert_uint(*ref_ptr);
+  flags = Bigendian_convert_uint(BLOCK_FLAGS(ref_blocks,ref_ptr - ref_blocks));
 #else
-  flags = (*ref_ptr);
+  flags = BLOCK_FLAGS(ref_blocks,ref_ptr - ref_blocks);
 #endif
 
   found &= ~flags;
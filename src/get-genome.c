@@ -8,6 +8,9 @@ static char rcsid[] = "$Id: get-genome.c 170023 2015-07-17 16:47:21Z twu $";
 #include <string.h>
 #include <strings.h>		/* For rindex */
 #include <ctype.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include "bool.h"
 #include "mem.h"
@@ -25,6 +28,10 @@ static char rcsid[] = "$Id: get-genome.c 170023 2015-07-17 16:47:21Z twu $";
 
 
 #define INFINITY -1
+#define BUFFERLEN 1024
+
+#define BATCH_NQUERIES 1024
+#define BATCH_MAXLENGTH 16777216 /* Total genomic length prefetched per block */
 
 
 #ifdef DEBUG
@@ -70,6 +77,9 @@ static bool signedp = false;
 
 static bool vareffect_p = false;
 
+static bool batchp = false;
+static int nthreads = 1;
+
 /* Dump options */
 static bool dumpallp = false;
 static bool stream_chars_p = false;
@@ -104,6 +114,8 @@ static struct option long_options[] = {
   {"exact", no_argument, 0, 0},		/* exactp */
   {"signed", no_argument, 0, 's'},	   /* signedp */
   {"aslabel", no_argument, 0, 0},	   /* force_label_p */
+  {"batch", no_argument, 0, 0},	   /* batchp */
+  {"nthreads", required_argument, 0, 0}, /* nthreads */
 
   /* Dump options */
   {"dump", no_argument, 0, 'A'},	/* dumpallp */
@@ -176,6 +188,10 @@ External map file options\n\
                             are also requested, show only flanking hits downstream in direction of\n\
                             query.\n\
   --aslabel               Consider all queries to be labels, even if numeric\n\
+  --batch                 For queries from stdin, read them in blocks and retrieve the\n\
+                            sequences of each block in genomic order before printing\n\
+                            them in input order\n\
+  --nthreads=INT          Number of threads for --batch (default 1)\n\
 \n\
 Dump options\n\
   -A, --dump              Dump entire genome in FASTA format\n\
@@ -389,6 +405,258 @@ index_compare (const void *a, const void *b) {
 }
 
 
+/* Batch mode.  Queries from stdin are read and parsed a block at a
+   time, and the genomic segments for the block are retrieved in order
+   of genomic position, divided among threads, before the queries are
+   printed in input order. */
+
+typedef struct Batch_T *Batch_T;
+struct Batch_T {
+  char *line;
+  bool parsedp;
+  bool revcomp;
+  Univcoord_T genomicstart;
+  Chrpos_T genomiclength;
+  Chrpos_T chrstart;
+  Chrpos_T chrend;
+  Univcoord_T chroffset;
+  Chrpos_T chrlength;
+  Sequence_T genomicseg;
+};
+
+static Batch_T *batch = NULL;
+static Batch_T *batch_sorted;
+static int batch_nqueries = 0;
+static int batch_k = 0;
+static Batch_T batch_current = NULL;
+
+static Genome_T batch_genome;
+static Univ_IIT_T batch_chromosome_iit;
+
+static Sequence_T prefetched_segment = NULL;
+
+
+static void
+batch_fetch (Batch_T this) {
+  this->genomicseg = Genome_get_segment(batch_genome,this->genomicstart,this->genomiclength,
+					batch_chromosome_iit,this->revcomp);
+  return;
+}
+
+#ifdef HAVE_PTHREAD
+typedef struct Batch_range_T *Batch_range_T;
+struct Batch_range_T {
+  int start;
+  int end;
+};
+
+static void *
+batch_thread (void *data) {
+  Batch_range_T range = (Batch_range_T) data;
+  int k;
+
+  for (k = range->start; k < range->end; k++) {
+    batch_fetch(batch_sorted[k]);
+  }
+  return (void *) NULL;
+}
+#endif
+
+
+static int
+batch_cmp (const void *x, const void *y) {
+  Batch_T a = * (Batch_T *) x;
+  Batch_T b = * (Batch_T *) y;
+
+  if (a->genomicstart < b->genomicstart) {
+    return -1;
+  } else if (b->genomicstart < a->genomicstart) {
+    return +1;
+  } else if (a->genomiclength < b->genomiclength) {
+    return -1;
+  } else if (b->genomiclength < a->genomiclength) {
+    return +1;
+  } else {
+    return 0;
+  }
+}
+
+
+static void
+prefetch_batch () {
+  int nsorted = 0, k;
+#ifdef HAVE_PTHREAD
+  pthread_t *threads;
+  struct Batch_range_T *ranges;
+  int nworkers, t;
+#endif
+
+  batch_sorted = (Batch_T *) MALLOC(batch_nqueries*sizeof(Batch_T));
+  for (k = 0; k < batch_nqueries; k++) {
+    if (batch[k]->parsedp == true) {
+      batch_sorted[nsorted++] = batch[k];
+    }
+  }
+  qsort(batch_sorted,nsorted,sizeof(Batch_T),batch_cmp);
+
+#ifdef HAVE_PTHREAD
+  if ((nworkers = nthreads) > nsorted) {
+    nworkers = nsorted;
+  }
+  if (nworkers > 1) {
+    threads = (pthread_t *) MALLOC(nworkers*sizeof(pthread_t));
+    ranges = (struct Batch_range_T *) MALLOC(nworkers*sizeof(struct Batch_range_T));
+    for (t = 0; t < nworkers; t++) {
+      ranges[t].start = (int) ((long int) nsorted * t / nworkers);
+      ranges[t].end = (int) ((long int) nsorted * (t + 1) / nworkers);
+      pthread_create(&(threads[t]),NULL,batch_thread,(void *) &(ranges[t]));
+    }
+    for (t = 0; t < nworkers; t++) {
+      pthread_join(threads[t],NULL);
+    }
+    FREE(ranges);
+    FREE(threads);
+    FREE(batch_sorted);
+    return;
+  }
+#endif
+
+  for (k = 0; k < nsorted; k++) {
+    batch_fetch(batch_sorted[k]);
+  }
+  FREE(batch_sorted);
+  return;
+}
+
+
+/* Reads and parses the next block of queries.  The parse works on its
+   own copy of each query, split in the same way as the main loop
+   would have split it, so that lines without coordinates see the
+   same leftover query. */
+static void
+fill_batch (Univ_IIT_T chromosome_iit, Univ_IIT_T contig_iit, Genome_T genome, bool prefetchp) {
+  static char coords[BUFFERLEN], typestring[BUFFERLEN];
+  char Buffer[BUFFERLEN], *p, *segment;
+  Batch_T this;
+  size_t totallength = 0;
+  int k;
+
+  if (batch == NULL) {
+    batch = (Batch_T *) MALLOC(BATCH_NQUERIES*sizeof(Batch_T));
+  } else {
+    for (k = 0; k < batch_nqueries; k++) {
+      FREE(batch[k]->line);
+      FREE(batch[k]);
+    }
+  }
+
+  batch_nqueries = batch_k = 0;
+  while (batch_nqueries < BATCH_NQUERIES && totallength < BATCH_MAXLENGTH &&
+	 fgets(Buffer,BUFFERLEN,stdin) != NULL) {
+    this = batch[batch_nqueries++] = (Batch_T) MALLOC(sizeof(*this));
+    this->line = (char *) MALLOC((strlen(Buffer)+1)*sizeof(char));
+    strcpy(this->line,Buffer);
+    this->parsedp = false;
+    this->genomicseg = (Sequence_T) NULL;
+
+    if ((p = rindex(Buffer,'\n')) != NULL) {
+      *p = '\0';
+    }
+    sscanf(Buffer,"%s %s",coords,typestring);
+    if (force_label_p == false &&
+	Parserange_universal_iit(&segment,&this->revcomp,&this->genomicstart,&this->genomiclength,
+				 &this->chrstart,&this->chrend,&this->chroffset,&this->chrlength,
+				 coords,chromosome_iit,contig_iit) == true) {
+      this->parsedp = true;
+      totallength += this->genomiclength;
+    }
+  }
+
+  if (prefetchp == true) {
+    batch_genome = genome;
+    batch_chromosome_iit = chromosome_iit;
+    prefetch_batch();
+  }
+
+  return;
+}
+
+
+static char *
+read_query (char *Buffer, Univ_IIT_T chromosome_iit, Univ_IIT_T contig_iit, Genome_T genome,
+	    bool prefetchp) {
+
+  if (batchp == false) {
+    return fgets(Buffer,BUFFERLEN,stdin);
+
+  } else {
+    if (batch_k >= batch_nqueries) {
+      fill_batch(chromosome_iit,contig_iit,genome,prefetchp);
+      if (batch_nqueries == 0) {
+	FREE(batch);
+	return (char *) NULL;
+      }
+    }
+
+    batch_current = batch[batch_k++];
+    strcpy(Buffer,batch_current->line);
+    prefetched_segment = batch_current->genomicseg;
+    return Buffer;
+  }
+}
+
+
+static bool
+parse_universal (char **div, bool *revcomp, Univcoord_T *genomicstart, Chrpos_T *genomiclength,
+		 Chrpos_T *chrstart, Chrpos_T *chrend, Univcoord_T *chroffset, Chrpos_T *chrlength,
+		 char *query, Univ_IIT_T chromosome_iit, Univ_IIT_T contig_iit) {
+
+  if (batchp == false) {
+    return Parserange_universal_iit(&(*div),&(*revcomp),&(*genomicstart),&(*genomiclength),
+				    &(*chrstart),&(*chrend),&(*chroffset),&(*chrlength),
+				    query,chromosome_iit,contig_iit);
+
+  } else {
+    /* Parsed already by fill_batch, but split query as the parser does */
+    if (index(query,':')) {
+      *div = strtok(query,":");
+      strtok(NULL,":");
+    }
+    *revcomp = batch_current->revcomp;
+    *genomicstart = batch_current->genomicstart;
+    *genomiclength = batch_current->genomiclength;
+    *chrstart = batch_current->chrstart;
+    *chrend = batch_current->chrend;
+    *chroffset = batch_current->chroffset;
+    *chrlength = batch_current->chrlength;
+    return batch_current->parsedp;
+  }
+}
+
+
+static Sequence_T
+get_segment (Genome_T genome, Univcoord_T genomicstart, Chrpos_T genomiclength,
+	     Univ_IIT_T chromosome_iit) {
+  Sequence_T genomicseg;
+
+  if (prefetched_segment != NULL) {
+    genomicseg = prefetched_segment;
+    prefetched_segment = (Sequence_T) NULL;
+    return genomicseg;
+  } else {
+    return Genome_get_segment(genome,genomicstart,genomiclength,chromosome_iit,revcomp);
+  }
+}
+
+static void
+free_prefetched_segment () {
+  if (prefetched_segment != NULL) {
+    Sequence_free(&prefetched_segment);
+  }
+  return;
+}
+
+
 static void
 print_sequence (Genome_T genome, Genome_T genomealt, Univcoord_T genomicstart, Chrpos_T genomiclength,
 		Univ_IIT_T chromosome_iit, bool whole_chromosome_p) {
@@ -445,7 +713,7 @@ print_sequence (Genome_T genome, Genome_T genomealt, Univcoord_T genomicstart, C
 
   if (vareffect_p == true) {
     chromosome1 = Univ_IIT_string_from_position(&chrpos,genomicstart,chromosome_iit);
-    genomicseg = Genome_get_segment(genome,genomicstart,genomiclength,chromosome_iit,revcomp);
+    genomicseg = get_segment(genome,genomicstart,genomiclength,chromosome_iit);
     ptr = Sequence_fullpointer(genomicseg);
     while ((c = *ptr++) != '\0') {
       chrpos++;			/* Converts to a 1-based coordinate */
@@ -482,17 +750,17 @@ print_sequence (Genome_T genome, Genome_T genomealt, Univcoord_T genomicstart, C
     FREE(chromosome1);
 
   } else if (stream_chars_p == true) {
-    genomicseg = Genome_get_segment(genome,genomicstart,genomiclength,chromosome_iit,revcomp);
+    genomicseg = get_segment(genome,genomicstart,genomiclength,chromosome_iit);
     Sequence_stdout_stream_chars(genomicseg);
     Sequence_free(&genomicseg);
 
   } else if (stream_ints_p == true) {
-    genomicseg = Genome_get_segment(genome,genomicstart,genomiclength,chromosome_iit,revcomp);
+    genomicseg = get_segment(genome,genomicstart,genomiclength,chromosome_iit);
     Sequence_stdout_stream_ints(genomicseg);
     Sequence_free(&genomicseg);
 
   } else if (snps_root == NULL || print_snps_mode == 0 || print_snps_mode == 2) {
-    genomicseg = Genome_get_segment(genome,genomicstart,genomiclength,chromosome_iit,revcomp);
+    genomicseg = get_segment(genome,genomicstart,genomiclength,chromosome_iit);
     if (user_typestring == NULL) {
       if (rawp == true) {
 	Sequence_stdout_raw(genomicseg);
@@ -504,7 +772,7 @@ print_sequence (Genome_T genome, Genome_T genomealt, Univcoord_T genomicstart, C
 
   } else if (print_snps_mode == 1) {
     /* Handle both reference and alternate versions */
-    genomicseg = Genome_get_segment(genome,genomicstart,genomiclength,chromosome_iit,revcomp);
+    genomicseg = get_segment(genome,genomicstart,genomiclength,chromosome_iit);
     genomicseg_alt = Genome_get_segment_alt(genomealt,genomicstart,genomiclength,chromosome_iit,revcomp);
     genomicseg_snp = Genome_get_segment_snp(genomealt,genomicstart,genomiclength,chromosome_iit,revcomp);
     if (user_typestring == NULL) {
@@ -520,7 +788,7 @@ print_sequence (Genome_T genome, Genome_T genomealt, Univcoord_T genomicstart, C
 
   } else {
     /* Handle both reference and alternate versions */
-    genomicseg = Genome_get_segment(genome,genomicstart,genomiclength,chromosome_iit,revcomp);
+    genomicseg = get_segment(genome,genomicstart,genomiclength,chromosome_iit);
     genomicseg_snp = Genome_get_segment_snp(genomealt,genomicstart,genomiclength,chromosome_iit,revcomp);
     if (user_typestring == NULL) {
       if (rawp == true) {
@@ -1056,7 +1324,6 @@ print_interval (char *divstring, int index, IIT_T iit, int ndivs, Univ_IIT_T chr
 }
 
 
-#define BUFFERLEN 1024
 
 
 int
@@ -1110,6 +1377,15 @@ main (int argc, char *argv[]) {
       } else if (!strcmp(long_name,"aslabel")) {
 	force_label_p = true;
 
+      } else if (!strcmp(long_name,"batch")) {
+	batchp = true;
+
+      } else if (!strcmp(long_name,"nthreads")) {
+	if ((nthreads = atoi(optarg)) < 1) {
+	  fprintf(stderr,"--nthreads must be at least 1\n");
+	  exit(9);
+	}
+
       } else if (!strcmp(long_name,"forsam")) {
 	dumpchrp = true;
 	dumpchr_forsam_p = true;
@@ -1544,7 +1820,8 @@ main (int argc, char *argv[]) {
     contig_iit = Univ_IIT_read(iitfile,/*readonlyp*/true,/*add_iit_p*/false);
     FREE(iitfile);
 
-    while (fgets(Buffer,BUFFERLEN,stdin) != NULL) {
+    while (read_query(Buffer,chromosome_iit,contig_iit,genome,
+		      /*prefetchp*/map_iit == NULL && coordp == false) != NULL) {
       if ((p = rindex(Buffer,'\n')) != NULL) {
 	*p = '\0';
       }
@@ -1556,8 +1833,8 @@ main (int argc, char *argv[]) {
       
       fprintf(stdout,"# Query: %s\n",coords);
       if (force_label_p == false &&
-	  Parserange_universal_iit(&segment,&revcomp,&genomicstart,&genomiclength,&chrstart,&chrend,
-				   &chroffset,&chrlength,coords,chromosome_iit,contig_iit) == true) {
+	  parse_universal(&segment,&revcomp,&genomicstart,&genomiclength,&chrstart,&chrend,
+			  &chroffset,&chrlength,coords,chromosome_iit,contig_iit) == true) {
 	debug(printf("Query %s parsed as: genomicstart = %llu, genomiclength = %u, revcomp = %d\n",
 		     coords,(unsigned long long) genomicstart,genomiclength,revcomp));
 	divstring = Univ_IIT_string_from_position(&chrstart,genomicstart,chromosome_iit);
@@ -1633,6 +1910,7 @@ main (int argc, char *argv[]) {
       }
 
       fprintf(stdout,"# End\n");
+      free_prefetched_segment();
     }
 
     Univ_IIT_free(&contig_iit);
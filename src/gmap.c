@@ -5754,6 +5754,7 @@ main (int argc, char *argv[]) {
   double runtime;
 
   Splicestringpool_T splicestringpool;
+  int ntriecontents_obs, ntriecontents_max;
 
 #ifdef HAVE_PTHREAD
   int ret, i;
@@ -6370,7 +6371,7 @@ main (int argc, char *argv[]) {
 	  Splicetrie_npartners(&nsplicepartners_skip,&nsplicepartners_obs,&nsplicepartners_max,splicesites,splicetypes,splicedists,
 			       splicestrings,nsplicesites,chromosome_iit,shortsplicedist,distances_observed_p);
 	  Splicetrie_build_via_splicesites(&triecontents_obs,&trieoffsets_obs,&triecontents_max,&trieoffsets_max,
-					   nsplicepartners_skip,nsplicepartners_obs,nsplicepartners_max,splicetypes,
+					   &ntriecontents_obs,&ntriecontents_max,nsplicepartners_skip,nsplicepartners_obs,nsplicepartners_max,splicetypes,
 					   splicestrings,nsplicesites);
 	  FREE(nsplicepartners_max);
 	  FREE(nsplicepartners_obs);
@@ -6397,7 +6398,7 @@ main (int argc, char *argv[]) {
 	  IIT_dump_divstrings(stderr,splicing_iit);
 	  exit(9);
 	} else {
-	  Splicetrie_build_via_introns(&triecontents_obs,&trieoffsets_obs,splicesites,splicetypes,
+	  Splicetrie_build_via_introns(&triecontents_obs,&trieoffsets_obs,&ntriecontents_obs,splicesites,splicetypes,
 				       splicestrings,nsplicesites,chromosome_iit,splicing_iit,splicing_divint_crosstable);
 	  triecontents_max = (Triecontent_T *) NULL;
 	  trieoffsets_max =  (Trieoffset_T *) NULL;
@@ -6637,6 +6638,7 @@ main (int argc, char *argv[]) {
   /* nbeyond = Outbuffer_nbeyond(outbuffer); */
   fprintf(stderr,"Processed %u queries in %.2f seconds (%.2f queries/sec)\n",
 	  nread,runtime,(double) nread/runtime);
+  Genome_window_cache_report();
 
   Outbuffer_free(&outbuffer);
   Inbuffer_free(&inbuffer);	/* Also closes inputs */
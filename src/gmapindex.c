@@ -38,6 +38,7 @@ typedef Tableuint_T Table_chrpos_T;
 #include "genome.h"
 #include "genome128_hr.h"
 #include "genome-write.h"
+#include "maxent_hr.h"
 #include "indexdb-write.h"
 #include "compress-write.h"
 #include "intlist.h"
@@ -46,6 +47,7 @@ typedef Tableuint_T Table_chrpos_T;
 #include "sarray-write.h"
 #include "bytecoding.h"
 #include "bitpack64-write.h"
+#include "access.h"
 
 #ifdef HAVE_SSE2
 #include <emmintrin.h>
@@ -81,7 +83,7 @@ typedef Tableuint_T Table_chrpos_T;
 
 /* Program variables */
 typedef enum {NONE, AUXFILES, GENOME, UNSHUFFLE, COUNT, OFFSETS, POSITIONS, SUFFIX_ARRAY, LCP_CHILD,
-	      COMPRESSED_SUFFIX_ARRAY, ARRAY_UNCOMPRESS, CHILD_UNCOMPRESS} Action_T;
+	      COMPRESSED_SUFFIX_ARRAY, ARRAY_UNCOMPRESS, CHILD_UNCOMPRESS, MERGE, SPLICE_SCORES, KMER_CLASSES, INDEX_IMAGE} Action_T;
 static Action_T action = NONE;
 static char *sourcedir = ".";
 static char *destdir = ".";
@@ -1010,6 +1012,296 @@ remove_slashes (char *buffer) {
 #endif
 
 
+/************************************************************************
+ *   Merging a delta genome into an existing genome
+ ************************************************************************/
+
+static Univ_IIT_T
+read_chromosome_iit (char *genomesubdir, char *fileroot) {
+  Univ_IIT_T chromosome_iit;
+  char *chromosomefile;
+
+  chromosomefile = (char *) CALLOC(strlen(genomesubdir)+strlen("/")+
+				   strlen(fileroot)+strlen(".chromosome.iit")+1,sizeof(char));
+  sprintf(chromosomefile,"%s/%s.chromosome.iit",genomesubdir,fileroot);
+  if ((chromosome_iit = Univ_IIT_read(chromosomefile,/*readonlyp*/true,/*add_iit_p*/false)) == NULL) {
+    fprintf(stderr,"IIT file %s is not valid\n",chromosomefile);
+    exit(9);
+  }
+  FREE(chromosomefile);
+
+  return chromosome_iit;
+}
+
+static void
+merge_store_contigs (Table_T accsegmentpos_table, char *genomesubdir, char *fileroot,
+		     Univ_IIT_T chromosome_iit, bool *keepp) {
+  Univ_IIT_T contig_iit;
+  char *iitfile, *label, *accession, *chr_string;
+  Univcoord_T contig_low, chroffset;
+  Chrpos_T chrpos1, seglength;
+  Chrom_T chrom;
+  int circular_typeint, index, chrindex;
+  bool allocp, chr_allocp;
+
+  iitfile = (char *) CALLOC(strlen(genomesubdir)+strlen("/")+
+			    strlen(fileroot)+strlen(".contig.iit")+1,sizeof(char));
+  sprintf(iitfile,"%s/%s.contig.iit",genomesubdir,fileroot);
+  if ((contig_iit = Univ_IIT_read(iitfile,/*readonlyp*/true,/*add_iit_p*/false)) == NULL) {
+    fprintf(stderr,"IIT file %s is not valid\n",iitfile);
+    exit(9);
+  }
+  FREE(iitfile);
+
+  circular_typeint = Univ_IIT_typeint(chromosome_iit,"circular");
+  for (index = 1; index <= Univ_IIT_total_nintervals(contig_iit); index++) {
+    contig_low = Univ_IIT_interval_low(contig_iit,index);
+    seglength = (Chrpos_T) Univ_IIT_interval_length(contig_iit,index);
+    chrindex = Univ_IIT_get_one(chromosome_iit,contig_low,contig_low);
+    if (keepp == NULL || keepp[chrindex-1] == true) {
+      label = Univ_IIT_label(contig_iit,index,&allocp);
+      if (Table_get(accsegmentpos_table,(void *) label) != NULL) {
+	fprintf(stderr,"Contig %s appears in both genomes.  Keeping the first one.\n",label);
+      } else {
+	accession = (char *) CALLOC(strlen(label)+1,sizeof(char));
+	strcpy(accession,label);
+
+	chroffset = Univ_IIT_interval_low(chromosome_iit,chrindex);
+	chrpos1 = (Chrpos_T) (contig_low - chroffset);
+	chr_string = Univ_IIT_label(chromosome_iit,chrindex,&chr_allocp);
+	chrom = Chrom_from_string(chr_string,mitochondrial_string,/*order*/0,
+				  Univ_IIT_interval_type(chromosome_iit,chrindex) == circular_typeint);
+	if (chr_allocp == true) {
+	  FREE(chr_string);
+	}
+
+	/* Strand of contigs is not recoverable from the contig IIT */
+	Table_put(accsegmentpos_table,(void *) accession,
+		  (void *) Segmentpos_new(chrom,chrpos1,chrpos1+seglength,/*revcompp*/false,seglength,/*type*/0));
+      }
+      if (allocp == true) {
+	FREE(label);
+      }
+    }
+  }
+
+  Univ_IIT_free(&contig_iit);
+  return;
+}
+
+static List_T
+merge_store_chromosomes (Table_chrpos_T chrlength_table, List_T chroms, Univ_IIT_T chromosome_iit,
+			 bool *keepp) {
+  char *chr_string;
+  Chrom_T chrom;
+  int circular_typeint, index;
+  bool allocp;
+
+  circular_typeint = Univ_IIT_typeint(chromosome_iit,"circular");
+  for (index = 1; index <= Univ_IIT_total_nintervals(chromosome_iit); index++) {
+    if (keepp == NULL || keepp[index-1] == true) {
+      chr_string = Univ_IIT_label(chromosome_iit,index,&allocp);
+      chrom = Chrom_from_string(chr_string,mitochondrial_string,/*order*/Tableuint8_length(chrlength_table)+1,
+				Univ_IIT_interval_type(chromosome_iit,index) == circular_typeint);
+#ifdef HAVE_64_BIT
+      Tableuint8_put(chrlength_table,(void *) chrom,(UINT8) Univ_IIT_interval_length(chromosome_iit,index));
+#else
+      Tableuint_put(chrlength_table,(void *) chrom,(unsigned int) Univ_IIT_interval_length(chromosome_iit,index));
+#endif
+      chroms = List_push(chroms,(void *) chrom);
+      if (allocp == true) {
+	FREE(chr_string);
+      }
+    }
+  }
+
+  return chroms;
+}
+
+
+/* Builds <destdir>/<fileroot> from the genome <sourcedir>/<base_fileroot>
+   plus the separately built genome <delta_sourcedir>/<delta_fileroot>.
+   Delta chromosomes are placed after all base chromosomes.  A base
+   chromosome with the same name as a delta chromosome is replaced.
+   The suffix array is not merged, and needs to be rebuilt by the
+   caller if desired. */
+static void
+merge_genomes (char *base_fileroot, char *delta_sourcedir, char *delta_fileroot) {
+  Univ_IIT_T base_chromosome_iit, delta_chromosome_iit;
+  Genome_T base_genome, delta_genome;
+  Filenames_T base_filenames, delta_filenames;
+  Table_T accsegmentpos_table;
+  Table_chrpos_T chrlength_table;
+  List_T chroms = NULL, contigtypelist, p;
+  Chrom_T chrom;
+  Univcoord_T *base_chrlows, *base_chrhighs, *base_newoffsets, *delta_chrlows, *delta_chrhighs;
+  Chrpos_T *base_chrlengths, *delta_chrlengths;
+  Univcoord_T delta_shift, delta_genomelength, genomelength;
+  char *pointersfile, *offsetsfile, *positionsfile_high, *positionsfile_low;
+  char *label, *typestring;
+  int base_nchromosomes, delta_nchromosomes, index, base_index;
+  int base_compression_type, delta_compression_type;
+  Width_T base_index1part, base_index1interval, delta_index1part, delta_index1interval;
+  bool *base_keepp, coord_values_8p, allocp;
+
+  base_chromosome_iit = read_chromosome_iit(sourcedir,base_fileroot);
+  delta_chromosome_iit = read_chromosome_iit(delta_sourcedir,delta_fileroot);
+
+  base_nchromosomes = Univ_IIT_total_nintervals(base_chromosome_iit);
+  delta_nchromosomes = Univ_IIT_total_nintervals(delta_chromosome_iit);
+  Univ_IIT_intervals_setup(&base_chrlows,&base_chrhighs,&base_chrlengths,base_chromosome_iit,base_nchromosomes,
+			   Univ_IIT_typeint(base_chromosome_iit,"circular"));
+  Univ_IIT_intervals_setup(&delta_chrlows,&delta_chrhighs,&delta_chrlengths,delta_chromosome_iit,delta_nchromosomes,
+			   Univ_IIT_typeint(delta_chromosome_iit,"circular"));
+
+  /* Determine which base chromosomes are replaced */
+  base_keepp = (bool *) MALLOC(base_nchromosomes*sizeof(bool));
+  for (index = 0; index < base_nchromosomes; index++) {
+    base_keepp[index] = true;
+  }
+  for (index = 1; index <= delta_nchromosomes; index++) {
+    label = Univ_IIT_label(delta_chromosome_iit,index,&allocp);
+    if ((base_index = Univ_IIT_find_one(base_chromosome_iit,label)) > 0) {
+      fprintf(stderr,"Replacing chromosome %s\n",label);
+      base_keepp[base_index-1] = false;
+    } else {
+      fprintf(stderr,"Adding chromosome %s\n",label);
+    }
+    if (allocp == true) {
+      FREE(label);
+    }
+  }
+
+  /* Compute new layout, which must match the order used by write_chromosome_file */
+  base_newoffsets = (Univcoord_T *) MALLOC(base_nchromosomes*sizeof(Univcoord_T));
+  delta_shift = 0;
+  for (index = 0; index < base_nchromosomes; index++) {
+    base_newoffsets[index] = delta_shift;
+    if (base_keepp[index] == true) {
+      delta_shift += base_chrhighs[index] - base_chrlows[index];
+    }
+  }
+  delta_genomelength = Univ_IIT_genomelength(delta_chromosome_iit,/*with_circular_alias_p*/true);
+  genomelength = delta_shift + delta_genomelength;
+  fprintf(stderr,"Base chromosomes occupy %llu nt.  Delta genome of %llu nt starts there.\n",
+	  (unsigned long long) delta_shift,(unsigned long long) delta_genomelength);
+
+#ifdef HAVE_64_BIT
+  if (genomelength > 4294967295) {
+    coord_values_8p = true;
+  } else {
+    coord_values_8p = false;
+  }
+#else
+  coord_values_8p = false;
+#endif
+
+  /* Chromosome and contig files.  Keep base order, followed by delta order. */
+  divsort = NO_SORT;
+#ifdef HAVE_64_BIT
+  chrlength_table = Tableuint8_new(65522,Chrom_compare_table,Chrom_hash_table);
+#else
+  chrlength_table = Tableuint_new(65522,Chrom_compare_table,Chrom_hash_table);
+#endif
+  chroms = merge_store_chromosomes(chrlength_table,chroms,base_chromosome_iit,base_keepp);
+  chroms = merge_store_chromosomes(chrlength_table,chroms,delta_chromosome_iit,/*keepp*/NULL);
+  write_chromosome_file(destdir,fileroot,chrlength_table,coord_values_8p);
+
+  accsegmentpos_table = Table_new(65522,Table_string_compare,Table_string_hash);
+  merge_store_contigs(accsegmentpos_table,sourcedir,base_fileroot,base_chromosome_iit,base_keepp);
+  merge_store_contigs(accsegmentpos_table,delta_sourcedir,delta_fileroot,delta_chromosome_iit,/*keepp*/NULL);
+  typestring = (char *) CALLOC(1,sizeof(char));
+  typestring[0] = '\0';
+  contigtypelist = List_push(NULL,typestring);
+  write_contig_file(destdir,fileroot,accsegmentpos_table,chrlength_table,contigtypelist,coord_values_8p);
+  FREE(typestring);
+  List_free(&contigtypelist);
+  accsegmentpos_table_gc(&accsegmentpos_table);
+  chrlength_table_gc(&chrlength_table);
+  for (p = chroms; p != NULL; p = List_next(p)) {
+    chrom = (Chrom_T) List_head(p);
+    Chrom_free(&chrom);
+  }
+  List_free(&chroms);
+
+  /* Genome */
+  base_genome = Genome_new(sourcedir,base_fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
+			   /*uncompressedp*/false,/*access*/USE_MMAP_ONLY,/*sharedp*/false);
+  delta_genome = Genome_new(delta_sourcedir,delta_fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
+			    /*uncompressedp*/false,/*access*/USE_MMAP_ONLY,/*sharedp*/false);
+  Genome_write_merged(destdir,fileroot,base_genome,base_chrlows,base_chrhighs,base_newoffsets,
+		      base_keepp,base_nchromosomes,delta_genome,delta_genomelength,delta_shift,genomelength);
+  Genome_free(&delta_genome);
+  Genome_free(&base_genome);
+
+  /* Offsets and positions */
+  base_filenames = Indexdb_get_filenames(&base_compression_type,&base_index1part,&base_index1interval,
+					 sourcedir,base_fileroot,IDX_FILESUFFIX,/*snps_root*/NULL,
+					 /*required_index1part*/index1part,/*required_interval*/index1interval,
+					 /*offsets_only_p*/false);
+  delta_filenames = Indexdb_get_filenames(&delta_compression_type,&delta_index1part,&delta_index1interval,
+					  delta_sourcedir,delta_fileroot,IDX_FILESUFFIX,/*snps_root*/NULL,
+					  /*required_index1part*/index1part,/*required_interval*/index1interval,
+					  /*offsets_only_p*/false);
+  if (base_filenames == NULL || delta_filenames == NULL) {
+    fprintf(stderr,"Could not find %d-mer index with sampling %d for both %s and %s\n",
+	    index1part,index1interval,base_fileroot,delta_fileroot);
+    exit(9);
+  } else if (base_compression_type != BITPACK64_COMPRESSION || delta_compression_type != BITPACK64_COMPRESSION) {
+    fprintf(stderr,"Merging requires bitpack64 offsets for both genomes\n");
+    exit(9);
+  }
+
+  pointersfile = (char *) CALLOC(strlen(destdir)+strlen("/")+strlen(fileroot)+strlen(".")+strlen(IDX_FILESUFFIX)+
+				 strlen(base_filenames->pointers_index1info_ptr)+1,sizeof(char));
+  sprintf(pointersfile,"%s/%s.%s%s",destdir,fileroot,IDX_FILESUFFIX,base_filenames->pointers_index1info_ptr);
+  offsetsfile = (char *) CALLOC(strlen(destdir)+strlen("/")+strlen(fileroot)+strlen(".")+strlen(IDX_FILESUFFIX)+
+				strlen(base_filenames->offsets_index1info_ptr)+1,sizeof(char));
+  sprintf(offsetsfile,"%s/%s.%s%s",destdir,fileroot,IDX_FILESUFFIX,base_filenames->offsets_index1info_ptr);
+
+  positionsfile_low = (char *) CALLOC(strlen(destdir)+strlen("/")+strlen(fileroot)+strlen(".")+strlen(IDX_FILESUFFIX)+
+				      /*for kmer*/2+/*for interval char*/1+
+				      strlen(POSITIONS_LOW_FILESUFFIX)+1,sizeof(char));
+  sprintf(positionsfile_low,"%s/%s.%s%02d%c%s",
+	  destdir,fileroot,IDX_FILESUFFIX,index1part,'0'+index1interval,POSITIONS_LOW_FILESUFFIX);
+  if (coord_values_8p == true) {
+    positionsfile_high = (char *) CALLOC(strlen(destdir)+strlen("/")+strlen(fileroot)+strlen(".")+strlen(IDX_FILESUFFIX)+
+					 /*for kmer*/2+/*for interval char*/1+
+					 strlen(POSITIONS_HIGH_FILESUFFIX)+1,sizeof(char));
+    sprintf(positionsfile_high,"%s/%s.%s%02d%c%s",
+	    destdir,fileroot,IDX_FILESUFFIX,index1part,'0'+index1interval,POSITIONS_HIGH_FILESUFFIX);
+  } else {
+    positionsfile_high = (char *) NULL;
+  }
+
+  Indexdb_merge_positions(pointersfile,offsetsfile,positionsfile_high,positionsfile_low,
+			  base_filenames,Univ_IIT_coord_values_8p(base_chromosome_iit),
+			  base_chrlows,base_chrhighs,base_newoffsets,base_keepp,base_nchromosomes,
+			  delta_filenames,Univ_IIT_coord_values_8p(delta_chromosome_iit),delta_shift,
+			  index1part,coord_values_8p);
+
+  FREE(positionsfile_high);
+  FREE(positionsfile_low);
+  FREE(offsetsfile);
+  FREE(pointersfile);
+  Filenames_free(&delta_filenames);
+  Filenames_free(&base_filenames);
+
+  FREE(base_newoffsets);
+  FREE(base_keepp);
+  FREE(delta_chrlengths);
+  FREE(delta_chrhighs);
+  FREE(delta_chrlows);
+  FREE(base_chrlengths);
+  FREE(base_chrhighs);
+  FREE(base_chrlows);
+  Univ_IIT_free(&delta_chromosome_iit);
+  Univ_IIT_free(&base_chromosome_iit);
+
+  return;
+}
+
+
 static int
 add_compression_type (char *string) {
   if (!strcmp(string,"none")) {
@@ -1076,6 +1368,9 @@ main (int argc, char *argv[]) {
   UINT4 *SA, *lcp, *child;
   UINT4 nbytes;
   Filenames_T filenames;
+  Indexdb_T indexdb;
+  Width_T index1part_found, index1interval_found;
+  char *imagefile;
   Chrpos_T seglength;
   bool coord_values_8p;
 
@@ -1101,7 +1396,7 @@ main (int argc, char *argv[]) {
   extern char *optarg;
   char *string;
 
-  while ((c = getopt(argc,argv,"F:D:d:z:k:q:ArlGUNHOPSLCXYWw:e:Ss:n:m9")) != -1) {
+  while ((c = getopt(argc,argv,"F:D:d:z:k:q:ArlGUNHOPSLCXYMJQIWw:e:Ss:n:m9")) != -1) {
     switch (c) {
     case 'F': sourcedir = optarg; break;
     case 'D': destdir = optarg; break;
@@ -1138,6 +1433,10 @@ main (int argc, char *argv[]) {
     case 'C': action = COMPRESSED_SUFFIX_ARRAY; break;
     case 'X': action = ARRAY_UNCOMPRESS; break;
     case 'Y': action = CHILD_UNCOMPRESS; break;
+    case 'M': action = MERGE; break;
+    case 'J': action = SPLICE_SCORES; break;
+    case 'Q': action = KMER_CLASSES; break;
+    case 'I': action = INDEX_IMAGE; break;
     case 'W': writefilep = true; break;
     case 'w': wraplength = atoi(optarg); break;
     case 'e': nmessages = atoi(optarg); break;
@@ -1755,6 +2054,65 @@ main (int argc, char *argv[]) {
       FREE(csacompfiles[0]); FREE(csaptrfiles[0]);
     }
 
+  } else if (action == MERGE) {
+    /* Usage: gmapindex [-F <sourcedir>] [-D <destdir>] -d <dbname> -k <kmer> -q <interval> -M <basedb> <deltadir> <deltadb>
+       Writes genome, chromosome, contig, offsets, and positions files for <dbname> */
+    if (argc < 3) {
+      fprintf(stderr,"Merge action requires <basedb> <deltadir> <deltadb>\n");
+      exit(9);
+    } else {
+      merge_genomes(/*base_fileroot*/argv[0],/*delta_sourcedir*/argv[1],/*delta_fileroot*/argv[2]);
+    }
+
+  } else if (action == SPLICE_SCORES) {
+    /* Usage: gmapindex [-F <sourcedir>] [-D <destdir>] -d <dbname> -J
+       Writes <destdir>/<dbname>.splicescores */
+    chromosomefile = (char *) CALLOC(strlen(sourcedir)+strlen("/")+
+				     strlen(fileroot)+strlen(".chromosome.iit")+1,sizeof(char));
+    sprintf(chromosomefile,"%s/%s.chromosome.iit",sourcedir,fileroot);
+    if ((chromosome_iit = Univ_IIT_read(chromosomefile,/*readonlyp*/true,/*add_iit_p*/false)) == NULL) {
+      fprintf(stderr,"IIT file %s is not valid\n",chromosomefile);
+      exit(9);
+    }
+    FREE(chromosomefile);
+    genomelength = Univ_IIT_genomelength(chromosome_iit,/*with_circular_alias_p*/true);
+    Univ_IIT_free(&chromosome_iit);
+
+    genomecomp = Genome_new(sourcedir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
+			    /*uncompressedp*/false,/*access*/USE_MMAP_ONLY,/*sharedp*/false);
+    Maxent_hr_setup(Genome_blocks(genomecomp),/*snp_blocks*/NULL);
+    Maxent_hr_write_track(destdir,fileroot,genomelength);
+    Genome_free(&genomecomp);
+
+  } else if (action == KMER_CLASSES) {
+    /* Usage: gmapindex [-F <sourcedir>] [-D <destdir>] -d <dbname> -k <kmer> -q <interval> -Q
+       Writes <destdir>/<dbname>.ref<kmer><interval>kmerclass */
+    indexdb = Indexdb_new_genome(&index1part_found,&index1interval_found,
+				 sourcedir,fileroot,IDX_FILESUFFIX,/*snps_root*/NULL,
+				 /*required_index1part*/index1part,/*required_interval*/index1interval,
+				 /*expand_offsets_p*/false,/*offsetsstrm_access*/USE_MMAP_ONLY,
+				 /*positions_access*/USE_MMAP_ONLY,/*sharedp*/false);
+    if (indexdb == NULL) {
+      fprintf(stderr,"Cannot find offsets file for k-mer %d, interval %d\n",index1part,index1interval);
+      exit(9);
+    }
+    Indexdb_write_kmerclasses(destdir,fileroot,IDX_FILESUFFIX,indexdb);
+    Indexdb_free(&indexdb);
+
+  } else if (action == INDEX_IMAGE) {
+    /* Usage: gmapindex [-F <sourcedir>] [-D <destdir>] -d <dbname> -I <file>...
+       Packs the given files from <sourcedir> into <destdir>/<dbname>.image */
+    if (argc < 1) {
+      fprintf(stderr,"Image action requires the names of the files to pack\n");
+      exit(9);
+    } else {
+      imagefile = (char *) CALLOC(strlen(destdir)+strlen("/")+strlen(fileroot)+strlen(".image")+1,sizeof(char));
+      sprintf(imagefile,"%s/%s.image",destdir,fileroot);
+      Access_image_write(imagefile,sourcedir,/*basenames*/argv,/*nfiles*/argc);
+      fprintf(stderr,"Wrote index image %s\n",imagefile);
+      FREE(imagefile);
+    }
+
   } else if (action == ARRAY_UNCOMPRESS) {
     if (argc <= 2) {
       start = end = 0;
@@ -40,7 +40,7 @@ static char rcsid[] = "$Id: gsnap.c 173896 2015-09-12 00:11:40Z twu $";
 
 #ifdef HAVE_ZLIB
 #include <zlib.h>
-#define GZBUFFER_SIZE 131072
+#include "bgzf.h"
 #endif
 
 #ifdef HAVE_BZLIB
@@ -70,6 +70,7 @@ static char rcsid[] = "$Id: gsnap.c 173896 2015-09-12 00:11:40Z twu $";
 #include "stage3hr.h"
 #include "spanningelt.h"
 #include "splicestringpool.h"
+#include "splicetrie_store.h"
 #include "splicetrie_build.h"
 #include "splice.h"		/* For Splice_setup */
 #include "oligo.h"		/* For Oligo_setup */
@@ -99,8 +100,10 @@ static char rcsid[] = "$Id: gsnap.c 173896 2015-09-12 00:11:40Z twu $";
 
 #include "filestring.h"
 #include "output.h"
+#include "resultcache.h"
 #include "inbuffer.h"
 #include "outbuffer.h"
+#include "manifest.h"
 #ifdef USE_MPI
 #include "master.h"
 #endif
@@ -231,6 +234,7 @@ static bool filter_chastity_p = false;
 static bool allow_paired_end_mismatch_p = false;
 static bool filter_if_both_p = false;
 static bool gunzip_p = false;
+static int gunzip_nthreads = 0;
 static bool bunzip2_p = false;
 
 /* Compute options */
@@ -246,6 +250,9 @@ static int trim_indel_score = -2; /* was -4 */
 
 static bool sharedp = true;
 static bool expand_offsets_p = false;
+static Access_warmup_T warmup = WARMUP_NONE;
+static int resultcache_mb = 0;
+static Resultcache_T resultcache = NULL;
 
 /* Note: sarray aux files (like lcpchilddc) are always allocated */
 #ifdef HAVE_MMAP
@@ -371,6 +378,7 @@ static Trieoffset_T *trieoffsets_obs = NULL;
 static Triecontent_T *triecontents_obs = NULL;
 static Trieoffset_T *trieoffsets_max = NULL;
 static Triecontent_T *triecontents_max = NULL;
+static Splicetrie_store_T splicetrie_store = NULL; /* If the arrays above are memory mapped */
 
 
 /* Cmet and AtoI */
@@ -446,6 +454,8 @@ static bool hide_soft_clips_p = false;
 /* Input/output */
 static char *split_output_root = NULL;
 static char *output_file = NULL;
+static char *manifest_file = NULL;
+static Manifest_T manifest = NULL;
 static char *failedinput_root = NULL;
 static bool appendp = false;
 static Outbuffer_T outbuffer;
@@ -480,6 +490,7 @@ static struct option long_options[] = {
 
 #ifdef HAVE_ZLIB
   {"gunzip", no_argument, 0, 0}, /* gunzip_p */
+  {"gunzip-threads", required_argument, 0, 0}, /* gunzip_nthreads */
 #endif
 
 #ifdef HAVE_BZLIB
@@ -492,6 +503,8 @@ static struct option long_options[] = {
   {"batch", required_argument, 0, 'B'}, /* offsetsstrm_access, positions_access, genome_access */
 #endif
   {"expand-offsets", required_argument, 0, 0}, /* expand_offsets_p */
+  {"warmup", required_argument, 0, 0}, /* warmup */
+  {"result-cache", required_argument, 0, 0}, /* resultcache_mb */
   {"pairmax-dna", required_argument, 0, 0}, /* pairmax_dna */
   {"pairmax-rna", required_argument, 0, 0}, /* pairmax_rna */
   {"pairexpect", required_argument, 0, 0},  /* expected_pairlength */
@@ -600,6 +613,7 @@ static struct option long_options[] = {
   {"nofails", no_argument, 0, 0}, /* nofailsp */
   {"output-file", required_argument, 0, 'o'}, /* output_file */
   {"split-output", required_argument, 0, 0}, /* split_output_root */
+  {"manifest", required_argument, 0, 0}, /* manifest_file */
   {"failed-input", required_argument, 0, 0}, /* failed_input_root */
   {"append-output", no_argument, 0, 0},	     /* appendp */
 
@@ -828,12 +842,12 @@ check_compiler_assumptions () {
 
 
 static Filestring_T
-process_request (Filestring_T *fp_failedinput_1, Filestring_T *fp_failedinput_2,
-		 double *worker_runtime, Request_T request, Floors_T *floors_array,
-		 Oligoindex_array_T oligoindices_major, Oligoindex_array_T oligoindices_minor,
-		 Pairpool_T pairpool, Diagpool_T diagpool, Cellpool_T cellpool,
-		 Dynprog_T dynprogL, Dynprog_T dynprogM, Dynprog_T dynprogR,
-		 Stopwatch_T worker_stopwatch) {
+align_request (Filestring_T *fp_failedinput_1, Filestring_T *fp_failedinput_2,
+	       double *worker_runtime, Request_T request, Floors_T *floors_array,
+	       Oligoindex_array_T oligoindices_major, Oligoindex_array_T oligoindices_minor,
+	       Pairpool_T pairpool, Diagpool_T diagpool, Cellpool_T cellpool,
+	       Dynprog_T dynprogL, Dynprog_T dynprogM, Dynprog_T dynprogR,
+	       Stopwatch_T worker_stopwatch) {
   Filestring_T fp;
   Result_T result;
   int jobid;
@@ -946,6 +960,39 @@ process_request (Filestring_T *fp_failedinput_1, Filestring_T *fp_failedinput_2,
 }
 
 
+/* Duplicate reads take their output from resultcache, when enabled */
+static Filestring_T
+process_request (Filestring_T *fp_failedinput_1, Filestring_T *fp_failedinput_2,
+		 double *worker_runtime, Request_T request, Floors_T *floors_array,
+		 Oligoindex_array_T oligoindices_major, Oligoindex_array_T oligoindices_minor,
+		 Pairpool_T pairpool, Diagpool_T diagpool, Cellpool_T cellpool,
+		 Dynprog_T dynprogL, Dynprog_T dynprogM, Dynprog_T dynprogR,
+		 Stopwatch_T worker_stopwatch) {
+  Filestring_T fp;
+  char *key;
+  int keylength;
+
+  if (resultcache == NULL) {
+    return align_request(&(*fp_failedinput_1),&(*fp_failedinput_2),&(*worker_runtime),request,floors_array,
+			 oligoindices_major,oligoindices_minor,pairpool,diagpool,cellpool,
+			 dynprogL,dynprogM,dynprogR,worker_stopwatch);
+
+  } else if ((fp = Resultcache_lookup(&key,&keylength,resultcache,request)) != NULL) {
+    /* Only used without --failed-input */
+    *fp_failedinput_1 = *fp_failedinput_2 = (Filestring_T) NULL;
+    *worker_runtime = 0.00;
+    return fp;
+
+  } else {
+    fp = align_request(&(*fp_failedinput_1),&(*fp_failedinput_2),&(*worker_runtime),request,floors_array,
+		       oligoindices_major,oligoindices_minor,pairpool,diagpool,cellpool,
+		       dynprogL,dynprogM,dynprogR,worker_stopwatch);
+    Resultcache_store(resultcache,key,keylength,request,fp);
+    return fp;
+  }
+}
+
+
 
 #ifdef HAVE_SIGACTION
 static const Except_T sigfpe_error = {"SIGFPE--arithmetic exception"};
@@ -1659,6 +1706,21 @@ parse_command_line (int argc, char *argv[], int optind) {
 	  return 9;
 	}
 
+      } else if (!strcmp(long_name,"warmup")) {
+	if (!strcmp(optarg,"none")) {
+	  warmup = WARMUP_NONE;
+	} else if (!strcmp(optarg,"touch")) {
+	  warmup = WARMUP_TOUCH;
+	} else if (!strcmp(optarg,"mlock")) {
+	  warmup = WARMUP_MLOCK;
+	} else {
+	  fprintf(stderr,"--warmup flag must be none, touch, or mlock\n");
+	  return 9;
+	}
+
+      } else if (!strcmp(long_name,"result-cache")) {
+	resultcache_mb = atoi(check_valid_int(optarg));
+
       } else if (!strcmp(long_name,"sampling")) {
 	required_index1interval = atoi(check_valid_int(optarg));
 
@@ -1811,6 +1873,8 @@ parse_command_line (int argc, char *argv[], int optind) {
 #ifdef HAVE_ZLIB
       } else if (!strcmp(long_name,"gunzip")) {
 	gunzip_p = true;
+      } else if (!strcmp(long_name,"gunzip-threads")) {
+	gunzip_nthreads = atoi(check_valid_int(optarg));
 #endif
 
 #ifdef HAVE_BZLIB
@@ -1835,6 +1899,9 @@ parse_command_line (int argc, char *argv[], int optind) {
       } else if (!strcmp(long_name,"split-output")) {
 	split_output_root = optarg;
 
+      } else if (!strcmp(long_name,"manifest")) {
+	manifest_file = optarg;
+
       } else if (!strcmp(long_name,"failed-input")) {
 	failedinput_root = optarg;
 
@@ -2333,6 +2400,21 @@ parse_command_line (int argc, char *argv[], int optind) {
     }
   }
 
+  if (manifest_file != NULL) {
+#ifdef USE_MPI
+    fprintf(stderr,"The --manifest flag is not supported by the MPI version\n");
+    return 9;
+#else
+    if (output_file != NULL) {
+      fprintf(stderr,"The --manifest flag writes one output per sample, so cannot be combined with -o.  Use --split-output to give a prefix.\n");
+      return 9;
+    } else if (force_single_end_p == true) {
+      fprintf(stderr,"The --manifest flag cannot be combined with --force-single-end.  List a single file for the sample instead.\n");
+      return 9;
+    }
+#endif
+  }
+
 #ifdef USE_MPI
   /* Code does allow for MPI output to stdout, but appears not to work
      yet, and may not work if rank 0 is also a worker */
@@ -2350,7 +2432,7 @@ static bool
 open_input_streams_parser (int *nextchar, int *nchars1, int *nchars2, char ***files, int *nfiles,
 			   FILE **input, FILE **input2,
 #ifdef HAVE_ZLIB
-			   gzFile *gzipped, gzFile *gzipped2,
+			   Bgzf_T *gzipped, Bgzf_T *gzipped2,
 #endif
 #ifdef HAVE_BZLIB
 			   Bzip2_T *bzipped, Bzip2_T *bzipped2,
@@ -2385,13 +2467,10 @@ open_input_streams_parser (int *nextchar, int *nchars1, int *nchars2, char ***fi
 
     if (gunzip_p == true) {
 #ifdef HAVE_ZLIB
-      if ((*gzipped = gzopen((*files)[0],"rb")) == NULL) {
+      if ((*gzipped = Bgzf_open((*files)[0])) == NULL) {
 	fprintf(stderr,"Cannot open gzipped file %s\n",(*files)[0]);
 	exit(9);
       } else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	gzbuffer(*gzipped,GZBUFFER_SIZE);
-#endif
 	*nextchar = Shortread_input_init_gzip(*gzipped);
       }
 #endif
@@ -2429,7 +2508,7 @@ open_input_streams_parser (int *nextchar, int *nchars1, int *nchars2, char ***fi
     /* Looks like a FASTQ file */
     if (*nfiles == 0 || force_single_end_p == true) {
 #ifdef HAVE_ZLIB
-      *gzipped2 = (gzFile) NULL;
+      *gzipped2 = (Bgzf_T) NULL;
 #endif
 #ifdef HAVE_BZLIB
       *bzipped2 = (Bzip2_T) NULL;
@@ -2438,13 +2517,10 @@ open_input_streams_parser (int *nextchar, int *nchars1, int *nchars2, char ***fi
     } else {
       if (gunzip_p == true) {
 #ifdef HAVE_ZLIB
-	if ((*gzipped2 = gzopen((*files)[0],"rb")) == NULL) {
+	if ((*gzipped2 = Bgzf_open((*files)[0])) == NULL) {
 	  fprintf(stderr,"Cannot open gzipped file %s\n",(*files)[0]);
 	  exit(9);
 	} else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	  gzbuffer(*gzipped2,GZBUFFER_SIZE);
-#endif
 	  /* nextchar2 = */ Shortread_input_init_gzip(*gzipped2);
 	}
 #endif
@@ -2494,7 +2570,7 @@ open_input_streams_worker (char ***files, int *nfiles,
 			  FILE **input, FILE **input2,
 #endif
 #ifdef HAVE_ZLIB
-			  gzFile *gzipped, gzFile *gzipped2,
+			  Bgzf_T *gzipped, Bgzf_T *gzipped2,
 #endif
 #ifdef HAVE_BZLIB
 			  Bzip2_T *bzipped, Bzip2_T *bzipped2,
@@ -2521,13 +2597,9 @@ open_input_streams_worker (char ***files, int *nfiles,
 
     if (gunzip_p == true) {
 #ifdef HAVE_ZLIB
-      if ((*gzipped = gzopen((*files)[0],"rb")) == NULL) {
+      if ((*gzipped = Bgzf_open((*files)[0])) == NULL) {
 	fprintf(stderr,"Cannot open gzipped file %s\n",(*files)[0]);
 	exit(9);
-      } else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	gzbuffer(*gzipped,GZBUFFER_SIZE);
-#endif
       }
 #endif
 
@@ -2563,7 +2635,7 @@ open_input_streams_worker (char ***files, int *nfiles,
     /* Looks like a FASTQ file */
     if (*nfiles == 0 || force_single_end_p == true) {
 #ifdef HAVE_ZLIB
-      *gzipped2 = (gzFile) NULL;
+      *gzipped2 = (Bgzf_T) NULL;
 #endif
 #ifdef HAVE_BZLIB
       *bzipped2 = (Bzip2_T) NULL;
@@ -2576,13 +2648,9 @@ open_input_streams_worker (char ***files, int *nfiles,
     } else {
       if (gunzip_p == true) {
 #ifdef HAVE_ZLIB
-	if ((*gzipped2 = gzopen((*files)[0],"rb")) == NULL) {
+	if ((*gzipped2 = Bgzf_open((*files)[0])) == NULL) {
 	  fprintf(stderr,"Cannot open gzipped file %s\n",(*files)[0]);
 	  exit(9);
-	} else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	  gzbuffer(*gzipped2,GZBUFFER_SIZE);
-#endif
 	}
 #endif
 
@@ -2653,13 +2721,24 @@ chromosome_iit_setup (int *nchromosomes, int *circular_typeint, bool *any_circul
 static void
 worker_setup (char *genomesubdir, char *fileroot) {
   char *snpsdir = NULL, *modedir = NULL, *mapdir = NULL, *iitfile = NULL;
+  char *splicing_path = NULL, *snps_path = NULL, *storefile;
   Splicestringpool_T splicestringpool;
+  int ntriecontents_obs, ntriecontents_max;
+
+  Access_warmup_init(warmup);
 
   if (snps_root == NULL) {
-    genomecomp = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
-			    uncompressedp,genome_access,sharedp);
     genomebits = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_BITS,
 			    uncompressedp,genome_access,sharedp);
+    if (uncompressedp == true) {
+      genomecomp = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
+			      uncompressedp,genome_access,sharedp);
+    } else {
+      /* The block readers are compiled for the genomebits128 layout
+	 in GSNAP (see genome.c), so a single resident copy serves both
+	 uses.  Genome_new exits if the genomebits128 file is missing. */
+      genomecomp = genomebits;
+    }
 
 #ifndef LARGE_GENOMES
     if (use_sarray_p == true) {
@@ -2789,14 +2868,19 @@ worker_setup (char *genomesubdir, char *fileroot) {
     }
 
     /* SNPs */
-    genomecomp = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
-			    uncompressedp,genome_access,sharedp);
-    genomecomp_alt = Genome_new(snpsdir,fileroot,snps_root,/*genometype*/GENOME_OLIGOS,
-				uncompressedp,genome_access,sharedp);
     genomebits = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_BITS,
 			    uncompressedp,genome_access,sharedp);
     genomebits_alt = Genome_new(snpsdir,fileroot,snps_root,/*genometype*/GENOME_BITS,
 				uncompressedp,genome_access,sharedp);
+    if (uncompressedp == true) {
+      genomecomp = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
+			      uncompressedp,genome_access,sharedp);
+      genomecomp_alt = Genome_new(snpsdir,fileroot,snps_root,/*genometype*/GENOME_OLIGOS,
+				  uncompressedp,genome_access,sharedp);
+    } else {
+      genomecomp = genomebits;
+      genomecomp_alt = genomebits_alt;
+    }
 
 #ifndef LARGE_GENOMES
     if (use_sarray_p == true) {
@@ -2922,7 +3006,7 @@ worker_setup (char *genomesubdir, char *fileroot) {
     snps_divint_crosstable = Univ_IIT_divint_crosstable(chromosome_iit,snps_iit);
 
     fprintf(stderr,"done\n");
-    FREE(iitfile);
+    snps_path = iitfile;	/* Identifies the SNP database to the splicetrie store */
     if (user_snpsdir == NULL) {
       FREE(mapdir);
     }
@@ -2975,6 +3059,8 @@ worker_setup (char *genomesubdir, char *fileroot) {
       if ((splicing_iit = IIT_read(splicing_file,/*name*/NULL,/*readonlyp*/true,/*divread*/READ_ALL,
 				   /*divstring*/NULL,/*add_iit_p*/true,/*labels_read_p*/true)) != NULL) {
 	fprintf(stderr,"Reading splicing file %s locally...",splicing_file);
+	splicing_path = (char *) CALLOC(strlen(splicing_file)+1,sizeof(char));
+	strcpy(splicing_path,splicing_file);
       }
     } else {
       iitfile = (char *) CALLOC(strlen(user_splicingdir)+strlen("/")+strlen(splicing_file)+1,sizeof(char));
@@ -2982,7 +3068,7 @@ worker_setup (char *genomesubdir, char *fileroot) {
       if ((splicing_iit = IIT_read(iitfile,/*name*/NULL,/*readonlyp*/true,/*divread*/READ_ALL,
 				   /*divstring*/NULL,/*add_iit_p*/true,/*labels_read_p*/true)) != NULL) {
 	fprintf(stderr,"Reading splicing file %s...",iitfile);
-	FREE(iitfile);
+	splicing_path = iitfile;
       }
     }
 
@@ -2994,7 +3080,7 @@ worker_setup (char *genomesubdir, char *fileroot) {
       if ((splicing_iit = IIT_read(iitfile,/*name*/NULL,/*readonlyp*/true,/*divread*/READ_ALL,
 				      /*divstring*/NULL,/*add_iit_p*/true,/*labels_read_p*/true)) != NULL) {
 	fprintf(stderr,"Reading splicing file %s...",iitfile);
-	FREE(iitfile);
+	splicing_path = iitfile;
 	FREE(mapdir);
       } else {
 	fprintf(stderr,"Splicing file %s.iit not found locally or in %s.  Available files:\n",splicing_file,mapdir);
@@ -3004,72 +3090,103 @@ worker_setup (char *genomesubdir, char *fileroot) {
       }
     }
 
+    /* Splicetries built from the splicing file are kept in the maps
+       directory, and rebuilt only when they no longer match */
+    mapdir = Datadir_find_mapdir(/*user_mapdir*/NULL,genomesubdir,fileroot);
+    storefile = Splicetrie_store_filename(mapdir,splicing_file,snps_root);
+    FREE(mapdir);
+
     splicing_divint_crosstable = Univ_IIT_divint_crosstable(chromosome_iit,splicing_iit);
     if ((donor_typeint = IIT_typeint(splicing_iit,"donor")) >= 0 && 
 	(acceptor_typeint = IIT_typeint(splicing_iit,"acceptor")) >= 0) {
       fprintf(stderr,"found donor and acceptor tags, so treating as splicesites file\n");
-      splicestringpool = Splicestringpool_new();
-      splicesites = Splicetrie_retrieve_via_splicesites(&distances_observed_p,&splicecomp,&splicetypes,&splicedists,
-							&splicestrings,&splicefrags_ref,&splicefrags_alt,
-							&nsplicesites,splicing_iit,splicing_divint_crosstable,
-							donor_typeint,acceptor_typeint,chromosome_iit,
-							genomecomp,genomecomp_alt,shortsplicedist,splicestringpool);
-      if (nsplicesites == 0) {
-	fprintf(stderr,"\nWarning: No splicesites observed for genome %s.  Are you sure this splicesite file was built for this genome?  Please compare chromosomes below:\n",
-		dbroot);
-	fprintf(stderr,"Chromosomes in the genome: ");
-	Univ_IIT_dump_labels(stderr,chromosome_iit);
-	fprintf(stderr,"Chromosomes in the splicesites IIT file: ");
-	IIT_dump_divstrings(stderr,splicing_iit);
-	exit(9);
+      if ((splicetrie_store = Splicetrie_store_read(&distances_observed_p,&splicecomp,&splicesites,&splicetypes,&splicedists,
+						    &splicefrags_ref,&splicefrags_alt,&trieoffsets_obs,&triecontents_obs,
+						    &trieoffsets_max,&triecontents_max,&nsplicesites,storefile,splicing_path,
+						    Genome_totallength(genomecomp),shortsplicedist,snps_root,snps_path)) == NULL) {
+	splicestringpool = Splicestringpool_new();
+	splicesites = Splicetrie_retrieve_via_splicesites(&distances_observed_p,&splicecomp,&splicetypes,&splicedists,
+							  &splicestrings,&splicefrags_ref,&splicefrags_alt,
+							  &nsplicesites,splicing_iit,splicing_divint_crosstable,
+							  donor_typeint,acceptor_typeint,chromosome_iit,
+							  genomecomp,genomecomp_alt,shortsplicedist,splicestringpool);
+	if (nsplicesites == 0) {
+	  fprintf(stderr,"\nWarning: No splicesites observed for genome %s.  Are you sure this splicesite file was built for this genome?  Please compare chromosomes below:\n",
+		  dbroot);
+	  fprintf(stderr,"Chromosomes in the genome: ");
+	  Univ_IIT_dump_labels(stderr,chromosome_iit);
+	  fprintf(stderr,"Chromosomes in the splicesites IIT file: ");
+	  IIT_dump_divstrings(stderr,splicing_iit);
+	  exit(9);
 
-      } else {
-	Splicetrie_npartners(&nsplicepartners_skip,&nsplicepartners_obs,&nsplicepartners_max,splicesites,splicetypes,splicedists,
-			     splicestrings,nsplicesites,chromosome_iit,shortsplicedist,distances_observed_p);
-	Splicetrie_build_via_splicesites(&triecontents_obs,&trieoffsets_obs,&triecontents_max,&trieoffsets_max,
-					 nsplicepartners_skip,nsplicepartners_obs,nsplicepartners_max,splicetypes,
-					 splicestrings,nsplicesites);
-	FREE(nsplicepartners_max);
-	FREE(nsplicepartners_obs);
-	FREE(nsplicepartners_skip);
-	/* Splicestring_gc(splicestrings,nsplicesites); */
-	FREE(splicestrings);
+	} else {
+	  Splicetrie_npartners(&nsplicepartners_skip,&nsplicepartners_obs,&nsplicepartners_max,splicesites,splicetypes,splicedists,
+			       splicestrings,nsplicesites,chromosome_iit,shortsplicedist,distances_observed_p);
+	  Splicetrie_build_via_splicesites(&triecontents_obs,&trieoffsets_obs,&triecontents_max,&trieoffsets_max,
+					   &ntriecontents_obs,&ntriecontents_max,nsplicepartners_skip,nsplicepartners_obs,
+					   nsplicepartners_max,splicetypes,splicestrings,nsplicesites);
+	  FREE(nsplicepartners_max);
+	  FREE(nsplicepartners_obs);
+	  FREE(nsplicepartners_skip);
+	  /* Splicestring_gc(splicestrings,nsplicesites); */
+	  FREE(splicestrings);
+	  Splicetrie_store_write(storefile,splicing_path,Genome_totallength(genomecomp),shortsplicedist,
+				 snps_root,snps_path,distances_observed_p,
+				 splicecomp,splicesites,splicetypes,splicedists,splicefrags_ref,splicefrags_alt,
+				 trieoffsets_obs,triecontents_obs,ntriecontents_obs,
+				 trieoffsets_max,triecontents_max,ntriecontents_max,nsplicesites);
+	}
+	Splicestringpool_free(&splicestringpool);
       }
-      Splicestringpool_free(&splicestringpool);
 
     } else {
       fprintf(stderr,"no donor or acceptor tags found, so treating as introns file\n");
-      splicestringpool = Splicestringpool_new();
-      splicesites = Splicetrie_retrieve_via_introns(&splicecomp,&splicetypes,&splicedists,
-						    &splicestrings,&splicefrags_ref,&splicefrags_alt,
-						    &nsplicesites,splicing_iit,splicing_divint_crosstable,
-						    chromosome_iit,genomecomp,genomecomp_alt,splicestringpool);
-      if (nsplicesites == 0) {
-	fprintf(stderr,"\nWarning: No splicesites observed for genome %s.  Are you sure this splicesite file was built for this genome?  Please compare chromosomes below:\n",
-		dbroot);
-	fprintf(stderr,"Chromosomes in the genome: ");
-	Univ_IIT_dump_labels(stderr,chromosome_iit);
-	fprintf(stderr,"Chromosomes in the splicesites IIT file: ");
-	IIT_dump_divstrings(stderr,splicing_iit);
-	exit(9);
-      } else {
-	Splicetrie_build_via_introns(&triecontents_obs,&trieoffsets_obs,splicesites,splicetypes,
-				     splicestrings,nsplicesites,chromosome_iit,splicing_iit,splicing_divint_crosstable);
-	triecontents_max = (Triecontent_T *) NULL;
-	trieoffsets_max =  (Trieoffset_T *) NULL;
-	/* Splicestring_gc(splicestrings,nsplicesites); */
-	FREE(splicestrings);
+      if ((splicetrie_store = Splicetrie_store_read(/*distances_observed_p*/NULL,&splicecomp,&splicesites,&splicetypes,&splicedists,
+						    &splicefrags_ref,&splicefrags_alt,&trieoffsets_obs,&triecontents_obs,
+						    &trieoffsets_max,&triecontents_max,&nsplicesites,storefile,splicing_path,
+						    Genome_totallength(genomecomp),/*shortsplicedist*/0,snps_root,snps_path)) == NULL) {
+	splicestringpool = Splicestringpool_new();
+	splicesites = Splicetrie_retrieve_via_introns(&splicecomp,&splicetypes,&splicedists,
+						      &splicestrings,&splicefrags_ref,&splicefrags_alt,
+						      &nsplicesites,splicing_iit,splicing_divint_crosstable,
+						      chromosome_iit,genomecomp,genomecomp_alt,splicestringpool);
+	if (nsplicesites == 0) {
+	  fprintf(stderr,"\nWarning: No splicesites observed for genome %s.  Are you sure this splicesite file was built for this genome?  Please compare chromosomes below:\n",
+		  dbroot);
+	  fprintf(stderr,"Chromosomes in the genome: ");
+	  Univ_IIT_dump_labels(stderr,chromosome_iit);
+	  fprintf(stderr,"Chromosomes in the splicesites IIT file: ");
+	  IIT_dump_divstrings(stderr,splicing_iit);
+	  exit(9);
+	} else {
+	  Splicetrie_build_via_introns(&triecontents_obs,&trieoffsets_obs,&ntriecontents_obs,splicesites,splicetypes,
+				       splicestrings,nsplicesites,chromosome_iit,splicing_iit,splicing_divint_crosstable);
+	  triecontents_max = (Triecontent_T *) NULL;
+	  trieoffsets_max =  (Trieoffset_T *) NULL;
+	  /* Splicestring_gc(splicestrings,nsplicesites); */
+	  FREE(splicestrings);
+	  Splicetrie_store_write(storefile,splicing_path,Genome_totallength(genomecomp),/*shortsplicedist*/0,
+				 snps_root,snps_path,/*distances_observed_p*/false,
+				 splicecomp,splicesites,splicetypes,splicedists,splicefrags_ref,splicefrags_alt,
+				 trieoffsets_obs,triecontents_obs,ntriecontents_obs,
+				 /*trieoffsets_max*/NULL,/*triecontents_max*/NULL,/*ntriecontents_max*/0,nsplicesites);
+	}
+	Splicestringpool_free(&splicestringpool);
       }
-      Splicestringpool_free(&splicestringpool);
       
     }
+    FREE(storefile);
+    FREE(splicing_path);
 
     /* For benchmarking purposes.  Can spend time/memory to load
        splicesites, but then not use them. */
     if (unloadp == true) {
       fprintf(stderr,"unloading...");
 
-      if (nsplicesites > 0) {
+      if (splicetrie_store != NULL) {
+	Splicetrie_store_free(&splicetrie_store);
+	nsplicesites = 0;
+      } else if (nsplicesites > 0) {
 	if (splicetrie_precompute_p == true) {
 	  FREE(triecontents_max);
 	  FREE(trieoffsets_max);
@@ -3196,6 +3313,7 @@ worker_setup (char *genomesubdir, char *fileroot) {
   }
   Genome_sites_setup(Genome_blocks(genomecomp),/*snp_blocks*/genomecomp_alt ? Genome_blocks(genomecomp_alt) : NULL);
   Maxent_hr_setup(Genome_blocks(genomecomp),/*snp_blocks*/genomecomp_alt ? Genome_blocks(genomecomp_alt) : NULL);
+  Maxent_hr_track_setup(genomesubdir,fileroot);
 
   Dynprog_init(mode);			    /* Need Dynprog for sarray_gmap */
   Dynprog_single_setup(/*homopolymerp*/false);
@@ -3267,7 +3385,22 @@ worker_setup (char *genomesubdir, char *fileroot) {
   Output_setup(chromosome_iit,nofailsp,failsonlyp,quiet_if_excessive_p,maxpaths_report,
 	       failedinput_root,quality_shift,
 	       output_sam_p,print_m8_p,invert_first_p,invert_second_p,
-	       merge_samechr_p,sam_read_group_id);
+	       merge_samechr_p,manifest,sam_read_group_id);
+
+  if (resultcache_mb > 0) {
+    /* Reused output needs only its QNAME replaced, which holds for SAM lines */
+    if (output_sam_p == false || failedinput_root != NULL) {
+      fprintf(stderr,"Note: --result-cache applies only to SAM output without --failed-input, so ignoring it\n");
+    } else {
+      resultcache = Resultcache_new((size_t) resultcache_mb * 1024*1024,quality_shift);
+    }
+  }
+
+  if (snps_path != NULL) {
+    FREE(snps_path);
+  }
+
+  Access_warmup_start();
 
   return;
 }
@@ -3276,6 +3409,12 @@ worker_setup (char *genomesubdir, char *fileroot) {
 static void
 worker_cleanup () {
 
+  Access_warmup_finish();
+
+  if (resultcache != NULL) {
+    Resultcache_free(&resultcache);
+  }
+
   if (use_only_sarray_p == false) {
     Stage1hr_cleanup();
   }
@@ -3301,19 +3440,29 @@ worker_cleanup () {
     }
   }
 #endif
+  Maxent_hr_track_free();
   if (genomecomp_alt != NULL) {
-    Genome_free(&genomecomp_alt);
+    if (genomecomp_alt != genomebits_alt) {
+      Genome_free(&genomecomp_alt);
+    }
     Genome_free(&genomebits_alt);
-    FREE(splicefrags_alt);	/* If genomealt == NULL, then splicefrags_alt == splicefrags_ref */
+    if (splicetrie_store == NULL) {
+      FREE(splicefrags_alt);	/* If genomealt == NULL, then splicefrags_alt == splicefrags_ref */
+    }
   }
   if (genomebits != NULL) {
+    if (genomecomp == genomebits) {
+      genomecomp = (Genome_T) NULL; /* Shared with genomebits */
+    }
     Genome_free(&genomebits);
   }
   if (genomecomp != NULL) {
     Genome_free(&genomecomp);
   }
 
-  if (nsplicesites > 0) {
+  if (splicetrie_store != NULL) {
+    Splicetrie_store_free(&splicetrie_store); /* Holds all of the splicesite arrays */
+  } else if (nsplicesites > 0) {
     if (splicetrie_precompute_p == true) {
       FREE(triecontents_max);
       FREE(trieoffsets_max);
@@ -3381,6 +3530,10 @@ main (int argc, char *argv[]) {
   char *genomesubdir, *fileroot, *dbversion;
   char **files;
   int nfiles;
+#ifndef USE_MPI
+  char **manifest_files;
+  int manifest_nfiles;
+#endif
 #if defined(USE_MPI) && defined(USE_MPI_FILE_INPUT)
   MPI_File mpi_file_input, mpi_file_input_2;
 #endif
@@ -3395,9 +3548,9 @@ main (int argc, char *argv[]) {
 
 #ifdef HAVE_ZLIB
 #ifdef USE_MPI
-  gzFile gzipped_master, gzipped2_master;
+  Bgzf_T gzipped_master, gzipped2_master;
 #endif
-  gzFile gzipped, gzipped2;
+  Bgzf_T gzipped, gzipped2;
 #endif
 
 #ifdef HAVE_BZLIB
@@ -3447,6 +3600,10 @@ main (int argc, char *argv[]) {
 
   check_compiler_assumptions();
 
+#ifdef HAVE_ZLIB
+  Bgzf_setup(gunzip_nthreads);
+#endif
+
   if (exception_raise_p == false) {
     fprintf(stderr,"Allowing signals and exceptions to pass through\n");
     Except_inactivate();
@@ -3583,14 +3740,38 @@ main (int argc, char *argv[]) {
 
 #else
   /* Non-MPI version */
-  fastq_format_p = open_input_streams_parser(&nextchar,&nchars1,&nchars2,&files,&nfiles,&input,&input2,
+  if (manifest_file != NULL) {
+    if (argc > 0) {
+      fprintf(stderr,"Input files are given by the manifest %s, so none should be given on the command line\n",manifest_file);
+      exit(9);
+    }
+    manifest = Manifest_read(manifest_file);
+    /* The first sample is opened as ordinary input.  Inbuffer opens the rest. */
+    manifest_files = Manifest_files(&manifest_nfiles,manifest,/*sampleid*/0);
+    fastq_format_p = open_input_streams_parser(&nextchar,&nchars1,&nchars2,&files,&nfiles,&input,&input2,
 #ifdef HAVE_ZLIB
-					     &gzipped,&gzipped2,
+					       &gzipped,&gzipped2,
 #endif
 #ifdef HAVE_BZLIB
-					     &bzipped,&bzipped2,
+					       &bzipped,&bzipped2,
 #endif
-					     gunzip_p,bunzip2_p,argc,argv);
+					       gunzip_p,bunzip2_p,manifest_nfiles,manifest_files);
+    if (nfiles > 0) {
+      fprintf(stderr,"Sample %s lists two files, but paired-end input is only supported for FASTQ\n",
+	      Manifest_sample(manifest,0));
+      exit(9);
+    }
+
+  } else {
+    fastq_format_p = open_input_streams_parser(&nextchar,&nchars1,&nchars2,&files,&nfiles,&input,&input2,
+#ifdef HAVE_ZLIB
+					       &gzipped,&gzipped2,
+#endif
+#ifdef HAVE_BZLIB
+					       &bzipped,&bzipped2,
+#endif
+					       gunzip_p,bunzip2_p,argc,argv);
+  }
 
   Inbuffer_setup(filter_if_both_p,part_modulus,part_interval);
 
@@ -3602,6 +3783,9 @@ main (int argc, char *argv[]) {
 			  bzipped,bzipped2,
 #endif
 			  files,nfiles,inbuffer_nspaces);
+  if (manifest != NULL) {
+    Inbuffer_set_manifest(inbuffer,manifest,gunzip_p,bunzip2_p);
+  }
 
   Shortread_setup(acc_fieldi_start,acc_fieldi_end,force_single_end_p,filter_chastity_p,
 		  allow_paired_end_mismatch_p,fastq_format_p,barcode_length,
@@ -3615,6 +3799,29 @@ main (int argc, char *argv[]) {
 #endif
 
   if (multiple_sequences_p == true) {
+#ifdef HAVE_MMAP
+    if (warmup != WARMUP_NONE) {
+      /* Pages are brought in by the warm-up thread instead, while reads are aligned */
+      if (positions_access == USE_MMAP_PRELOAD) {
+	positions_access = USE_MMAP_ONLY;
+      }
+      if (genome_access == USE_MMAP_PRELOAD) {
+	genome_access = USE_MMAP_ONLY;
+      }
+      if (sarray_access == USE_MMAP_PRELOAD) {
+	sarray_access = USE_MMAP_ONLY;
+      }
+      if (lcp_access == USE_MMAP_PRELOAD) {
+	lcp_access = USE_MMAP_ONLY;
+      }
+      if (guideexc_access == USE_MMAP_PRELOAD) {
+	guideexc_access = USE_MMAP_ONLY;
+      }
+      if (indexij_access == USE_MMAP_PRELOAD) {
+	indexij_access = USE_MMAP_ONLY;
+      }
+    }
+#endif
 #if 0
     if (offsetsstrm_access != USE_ALLOCATE || genome_access != USE_ALLOCATE ||
 	sarray_access != USE_ALLOCATE || lcp_access != USE_ALLOCATE) {
@@ -3632,6 +3839,7 @@ main (int argc, char *argv[]) {
   } else {
     /* fprintf(stderr,"Note: only 1 sequence detected.  Ignoring batch (-B) command\n"); */
     expand_offsets_p = false;
+    warmup = WARMUP_NONE;
 #ifdef HAVE_MMAP
     offsetsstrm_access = USE_MMAP_ONLY;
     positions_access = USE_MMAP_ONLY;
@@ -3658,7 +3866,7 @@ main (int argc, char *argv[]) {
 					genomesubdir,fileroot);
   Outbuffer_setup(argc,argv,optind,chromosome_iit,any_circular_p,
 		  nthreads,orderedp,quiet_if_excessive_p,
-		  output_sam_p,sam_headers_p,sam_read_group_id,sam_read_group_name,
+		  output_sam_p,manifest,sam_headers_p,sam_read_group_id,sam_read_group_name,
 		  sam_read_group_library,sam_read_group_platform,
 		  appendp,output_file,split_output_root,failedinput_root);
 
@@ -3726,7 +3934,10 @@ main (int argc, char *argv[]) {
   outbuffer = Outbuffer_new(output_buffer_size,nread);
   Inbuffer_set_outbuffer(inbuffer,outbuffer);
 
-  if (output_file != NULL) {
+  if (manifest != NULL) {
+    fprintf(stderr,"Starting alignment of %d samples from manifest %s.  Writing results per sample\n",
+	    Manifest_nsamples(manifest),manifest_file);
+  } else if (output_file != NULL) {
     fprintf(stderr,"Starting alignment.  Writing results to %s\n",output_file);
   } else if (split_output_root != NULL) {
     fprintf(stderr,"Starting alignment.  Writing results to %s.*\n",split_output_root);
@@ -3839,11 +4050,16 @@ main (int argc, char *argv[]) {
   /* nbeyond = Outbuffer_nbeyond(outbuffer); */
   fprintf(stderr,"Processed %u queries in %.2f seconds (%.2f queries/sec)\n",
 	  nread,runtime,(double) nread/runtime);
+  Genome_window_cache_report();
+  if (resultcache != NULL) {
+    Resultcache_report(resultcache);
+  }
   
   Outbuffer_free(&outbuffer);
   Inbuffer_free(&inbuffer);
 
   Outbuffer_close_files();
+  Manifest_free(&manifest);
 #endif
 
   Outbuffer_cleanup();
@@ -3929,6 +4145,10 @@ Usage: gsnap [OPTIONS...] <FASTA file>, or\n\
 #ifdef HAVE_ZLIB
   fprintf(stdout,"\
   --gunzip                       Uncompress gzipped input files\n\
+  --gunzip-threads=INT           Uncompress gzipped input on INT background threads (default 0,\n\
+                                   meaning in the threads that read input).  BGZF files, as\n\
+                                   written by bgzip, are inflated in parallel blocks.  Other\n\
+                                   gzipped files use one background thread\n\
 ");
 #endif
 #ifdef HAVE_BZLIB
@@ -3975,10 +4195,21 @@ is still designed to be fast.\n\
                        are accessed relatively fast in this version of GSNAP.\n\
 \n\
   --use-shared-memory=INT        If 1 (default), then allocated memory is shared among all processes\n\
-                                   on this node.  If 0, then each process has private allocated memory\n\
+                                   on this node.  If 0, then each process has private allocated memory.\n\
+                                   Shared copies are kept in /dev/shm, or in the directory given by\n\
+                                   the GMAP_SHMEM_DIR environment variable (e.g., a hugetlbfs mount)\n\
   --expand-offsets=INT           Whether to expand the genomic offsets index\n\
                                    Values: 0 (no, default), or 1 (yes).\n\
                                    Expansion gives faster alignment, but requires more memory\n\
+  --warmup=STRING                Bring memory-mapped index files into RAM in a background thread\n\
+                                   while alignment starts, instead of preloading them beforehand.\n\
+                                   Values: none (default), touch (fault pages in), or mlock (also\n\
+                                   lock them into RAM).  Stops early if available RAM runs out\n\
+  --result-cache=INT             Keep up to INT MB of SAM output for distinct reads, and reuse it\n\
+                                   for later reads or pairs with the same sequence, maximum quality\n\
+                                   score, and barcode, instead of aligning them again (default 0,\n\
+                                   off).  Output with more than one path is not kept.\n\
+                                   Requires -A sam, and is ignored with --failed-input\n\
 ");
 
   fprintf(stdout,"\
@@ -4312,6 +4543,12 @@ is still designed to be fast.\n\
                                    halfmapping_uniq, halfmapping_mult, unpaired_uniq, unpaired_mult,\n\
                                    paired_uniq, paired_mult, concordant_uniq, and concordant_mult results\n\
   -o, --output-file=STRING       File name for a single stream of output results.\n\
+  --manifest=STRING              Align several samples in one run.  Each line of the file gives\n\
+                                    <sample> <fastq1> [<fastq2>|-] [<read-group-id>], and input files\n\
+                                    are not given on the command line.  Results for each sample go to\n\
+                                    <sample>.sam (or .gsnap), or to <root>.<sample>.* with --split-output,\n\
+                                    with @RG lines and RG tags for the sample (read group defaults to the\n\
+                                    sample name).  All samples must be FASTQ, or all FASTA.\n\
   --failed-input=STRING          Print completely failed alignments as input FASTA or FASTQ format,\n\
                                     to the given file, appending .1 or .2, for paired-end data.\n\
                                     If the --split-output flag is also given, this file is generated\n\
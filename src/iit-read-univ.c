@@ -155,6 +155,12 @@ struct T {
   char *annotations;
 
   void **datapointers;
+
+  /* Interval lows in Eytzinger (breadth-first) order, 1-based, for
+     IITs whose intervals are sorted and disjoint, like chromosomes */
+  int nflat;
+  Univcoord_T *flat_lows;
+  int *flat_indices;
 };
 
 
@@ -706,13 +712,17 @@ Univ_IIT_reserve_sam (T this, char *sam_read_group_id, char *sam_read_group_name
 
 
 #else
+#define SAM_HEADER_BUFFERSIZE 65536
+#define SAM_HEADER_MAXFIXED 64	/* Room for everything in an @SQ line but the label */
+
 /* For chromosome.iit file, which is stored in version 1 */
 void
 Univ_IIT_dump_sam (FILE *fp, T this, char *sam_read_group_id, char *sam_read_group_name,
 		   char *sam_read_group_library, char *sam_read_group_platform) {
   int index = 0, i;
   Univinterval_T interval;
-  char *label;
+  char *label, *buffer, *p;
+  size_t labellength;
   bool allocp;
   int circular_typeint;
 
@@ -722,24 +732,43 @@ Univ_IIT_dump_sam (FILE *fp, T this, char *sam_read_group_id, char *sam_read_gro
     circular_typeint = Univ_IIT_typeint(this,"circular");
   }
 
+  /* Lines are assembled in a block buffer rather than by fprintf, since
+     draft assemblies can have millions of contigs */
+  buffer = (char *) MALLOC(SAM_HEADER_BUFFERSIZE * sizeof(char));
+  p = buffer;
   for (i = 0; i < this->total_nintervals; i++) {
     interval = &(this->intervals[i]);
     label = Univ_IIT_label(this,index+1,&allocp);
-    fprintf(fp,"@SQ\tSN:%s",label);
+    labellength = strlen(label);
+    if (p - buffer + labellength + SAM_HEADER_MAXFIXED > SAM_HEADER_BUFFERSIZE) {
+      fwrite(buffer,sizeof(char),p - buffer,fp);
+      p = buffer;
+    }
+    if (labellength + SAM_HEADER_MAXFIXED > SAM_HEADER_BUFFERSIZE) {
+      fprintf(fp,"@SQ\tSN:%s",label);
+    } else {
+      memcpy(p,"@SQ\tSN:",strlen("@SQ\tSN:"));
+      p += strlen("@SQ\tSN:");
+      memcpy(p,label,labellength);
+      p += labellength;
+    }
     if (allocp == true) {
       FREE(label);
     }
     /* startpos = Univinterval_low(interval); */
     /* endpos = startpos + Univinterval_length(interval) - 1U; */
 
-    fprintf(fp,"\tLN:%u",Univinterval_length(interval));
+    p += sprintf(p,"\tLN:%u",Univinterval_length(interval));
     if (Univinterval_type(interval) == circular_typeint) {
-      fprintf(fp,"\ttp:circular");
+      memcpy(p,"\ttp:circular",strlen("\ttp:circular"));
+      p += strlen("\ttp:circular");
     }
-    fprintf(fp,"\n");
+    *p++ = '\n';
 
     index++;
   }
+  fwrite(buffer,sizeof(char),p - buffer,fp);
+  FREE(buffer);
 
   if (sam_read_group_id != NULL) {
     fprintf(fp,"@RG\tID:%s",sam_read_group_id);
@@ -915,6 +944,8 @@ Univ_IIT_free (T *old) {
     FREE((*old)->typepointers);
 
     FREE((*old)->intervals);
+    FREE((*old)->flat_indices);
+    FREE((*old)->flat_lows);
 
     /* Note: we are depending on Mem_free() to check that these are non-NULL */
     FREE((*old)->nodes);
@@ -1405,6 +1436,68 @@ read_annotations (T new) {
 
 
 
+/* Fills the Eytzinger layout by an in-order walk of the implicit
+   tree, so that sorted position i lands at its breadth-first slot */
+static int
+flat_fill (T this, int i, int k) {
+  if (k <= this->nflat) {
+    i = flat_fill(this,i,2*k);
+    this->flat_lows[k] = Univinterval_low(&(this->intervals[i]));
+    this->flat_indices[k] = i + 1;
+    i = flat_fill(this,i+1,2*k+1);
+  }
+  return i;
+}
+
+static void
+flat_setup (T this) {
+  int i;
+
+  this->nflat = 0;
+  this->flat_lows = (Univcoord_T *) NULL;
+  this->flat_indices = (int *) NULL;
+
+  for (i = 1; i < this->total_nintervals; i++) {
+    if (Univinterval_low(&(this->intervals[i])) <= Univinterval_high(&(this->intervals[i-1]))) {
+      /* Overlapping or unsorted, so only the tree can answer queries */
+      return;
+    }
+  }
+
+  this->nflat = this->total_nintervals;
+  this->flat_lows = (Univcoord_T *) MALLOC((this->nflat + 1) * sizeof(Univcoord_T));
+  this->flat_indices = (int *) MALLOC((this->nflat + 1) * sizeof(int));
+  flat_fill(this,/*i*/0,/*k*/1);
+
+  return;
+}
+
+/* Returns the interval containing x, or 0 if x falls between
+   intervals.  The descent is branch-free and touches one cache line
+   per level near the root. */
+static int
+flat_find (T this, Univcoord_T x) {
+  int k = 1;
+
+  while (k <= this->nflat) {
+    k = 2*k + (this->flat_lows[k] <= x);
+  }
+  /* Undo the left turns after the last right turn, which was taken at the predecessor */
+  while ((k & 1) == 0) {
+    k >>= 1;
+  }
+  k >>= 1;
+
+  if (k == 0) {
+    return 0;
+  } else if (x > Univinterval_high(&(this->intervals[this->flat_indices[k]-1]))) {
+    return 0;
+  } else {
+    return this->flat_indices[k];
+  }
+}
+
+
 T
 Univ_IIT_read (char *filename, bool readonlyp, bool add_iit_p) {
   T new;
@@ -1524,6 +1617,8 @@ Univ_IIT_read (char *filename, bool readonlyp, bool add_iit_p) {
   }
 #endif
     
+  flat_setup(new);
+
   if (newfile != NULL) {
     FREE(newfile);
   }
@@ -1643,6 +1738,10 @@ Univ_IIT_debug (char *filename) {
   }
 #endif
 
+  new->nflat = 0;
+  new->flat_lows = (Univcoord_T *) NULL;
+  new->flat_indices = (int *) NULL;
+
   if (newfile != NULL) {
     FREE(newfile);
   }
@@ -1958,6 +2057,12 @@ Univ_IIT_get_one (T this, Univcoord_T x, Univcoord_T y) {
   bool stopp;
   Univinterval_T interval;
 
+  if (this->nflat > 0 && x <= y && (lambda = flat_find(this,x)) > 0 &&
+      y <= Univinterval_high(&(this->intervals[lambda-1]))) {
+    /* Disjoint intervals, so the one containing x..y is the only match */
+    return lambda;
+  }
+
   min1 = min2 = this->total_nintervals + 1;
 
   debug(printf("Entering Univ_IIT_get_one with query %llu %llu\n",(unsigned long long) x,(unsigned long long) y));
@@ -1452,6 +1452,15 @@ IIT_free (T *old) {
       FREE((*old)->alphas);
     }
 
+    if ((*old)->alpha_endpoints != NULL) {
+      for (divno = 0; divno < (*old)->ndivs; divno++) {
+	FREE((*old)->beta_endpoints[divno]);
+	FREE((*old)->alpha_endpoints[divno]);
+      }
+      FREE((*old)->beta_endpoints);
+      FREE((*old)->alpha_endpoints);
+    }
+
     FREE((*old)->divstrings);
     FREE((*old)->divpointers);
     FREE((*old)->cum_nnodes);
@@ -1510,6 +1519,64 @@ skip_trees (off_t offset, off_t filesize, FILE *fp, char *filename,
 
 
 
+/* The file stores the nodes of each div in preorder, so a query
+   descending to the right jumps across the array at every level.
+   Renumbering them breadth-first keeps the top levels of the tree,
+   which every query visits, within a few cache lines.  The root stays
+   at index 0. */
+static void
+relayout_nodes (struct FNode_T *nodes, int nnodes) {
+  struct FNode_T *copy;
+  int *order, *newindex;
+  int head, tail, i;
+
+  order = (int *) MALLOC(nnodes*sizeof(int));
+  newindex = (int *) MALLOC(nnodes*sizeof(int));
+
+  order[0] = 0;
+  tail = 1;
+  for (head = 0; head < tail; head++) {
+    newindex[order[head]] = head;
+    if (nodes[order[head]].leftindex >= 0) {
+      if (tail == nnodes) {
+	/* Not a tree.  Leave nodes in file order. */
+	FREE(newindex);
+	FREE(order);
+	return;
+      }
+      order[tail++] = nodes[order[head]].leftindex;
+    }
+    if (nodes[order[head]].rightindex >= 0) {
+      if (tail == nnodes) {
+	FREE(newindex);
+	FREE(order);
+	return;
+      }
+      order[tail++] = nodes[order[head]].rightindex;
+    }
+  }
+
+  if (tail == nnodes) {
+    copy = (struct FNode_T *) MALLOC(nnodes*sizeof(struct FNode_T));
+    for (i = 0; i < nnodes; i++) {
+      copy[i] = nodes[order[i]];
+      if (copy[i].leftindex >= 0) {
+	copy[i].leftindex = newindex[copy[i].leftindex];
+      }
+      if (copy[i].rightindex >= 0) {
+	copy[i].rightindex = newindex[copy[i].rightindex];
+      }
+    }
+    memcpy(nodes,copy,nnodes*sizeof(struct FNode_T));
+    FREE(copy);
+  }
+
+  FREE(newindex);
+  FREE(order);
+  return;
+}
+
+
 static off_t
 read_tree (off_t offset, off_t filesize, FILE *fp, char *filename, T new, int divno) {
   size_t items_read;
@@ -1635,6 +1702,8 @@ read_tree (off_t offset, off_t filesize, FILE *fp, char *filename, T new, int di
       exit(9);
     }
 
+    relayout_nodes(new->nodes[divno],new->nnodes[divno]);
+
 #if 1
     debug(
 	  for (i = 0; i < new->nnodes[divno]; i++) {
@@ -1650,6 +1719,48 @@ read_tree (off_t offset, off_t filesize, FILE *fp, char *filename, T new, int di
 }
 
 
+/* Copies the endpoints used by the flanking searches into Eytzinger
+   order, where slot k has children 2k and 2k+1.  A search then reads
+   one small array from the top down, instead of going through alphas
+   or betas into the intervals at every step. */
+static int
+fill_endpoints (struct Endpoint_T *endpoints, int k, int n, int lambda,
+		int *order, struct Interval_T *intervals, bool lowp) {
+  if (k <= n) {
+    lambda = fill_endpoints(endpoints,2*k,n,lambda,order,intervals,lowp);
+    endpoints[k].lambda = lambda;
+    if (lowp == true) {
+      endpoints[k].value = Interval_low(&(intervals[order[lambda]-1]));
+    } else {
+      endpoints[k].value = Interval_high(&(intervals[order[lambda]-1]));
+    }
+    lambda = fill_endpoints(endpoints,2*k+1,n,lambda+1,order,intervals,lowp);
+  }
+  return lambda;
+}
+
+static void
+make_endpoints (T new) {
+  int divno, n;
+
+  new->alpha_endpoints = (struct Endpoint_T **) CALLOC(new->ndivs,sizeof(struct Endpoint_T *));
+  new->beta_endpoints = (struct Endpoint_T **) CALLOC(new->ndivs,sizeof(struct Endpoint_T *));
+
+  for (divno = 0; divno < new->ndivs; divno++) {
+    if (new->alphas[divno] != NULL && (n = new->nintervals[divno]) > 0) {
+      new->alpha_endpoints[divno] = (struct Endpoint_T *) MALLOC((n+1)*sizeof(struct Endpoint_T));
+      new->beta_endpoints[divno] = (struct Endpoint_T *) MALLOC((n+1)*sizeof(struct Endpoint_T));
+      fill_endpoints(new->alpha_endpoints[divno],/*k*/1,n,/*lambda*/1,new->alphas[divno],
+		     new->intervals[divno],/*lowp*/true);
+      fill_endpoints(new->beta_endpoints[divno],/*k*/1,n,/*lambda*/1,new->betas[divno],
+		     new->intervals[divno],/*lowp*/false);
+    }
+  }
+
+  return;
+}
+
+
 static off_t
 skip_intervals (int *skip_nintervals, off_t offset, off_t filesize, FILE *fp, char *filename, T new, 
 		int divstart, int divend) {
@@ -2540,6 +2651,7 @@ IIT_read (char *filename, char *name, bool readonlyp, Divread_T divread, char *d
   }
 
   new = (T) MALLOC(sizeof(*new));
+  new->alpha_endpoints = new->beta_endpoints = (struct Endpoint_T **) NULL;
 
   filesize = Access_filesize(filename);
 
@@ -2895,6 +3007,8 @@ IIT_read (char *filename, char *name, bool readonlyp, Divread_T divread, char *d
     abort();
   }
 
+  make_endpoints(new);
+
   read_words(offset,filesize,fp,new);
   fclose(fp);
 
@@ -2957,6 +3071,7 @@ IIT_debug (char *filename) {
   }
 
   new = (T) MALLOC(sizeof(*new));
+  new->alpha_endpoints = new->beta_endpoints = (struct Endpoint_T **) NULL;
 
   filesize = Access_filesize(filename);
 
@@ -3331,63 +3446,65 @@ IIT_debug (char *filename) {
 
 /************************************************************************/
 
+/* Each node on the path from the root contributes to min and max
+   independently, so the path can be followed iteratively */
 static void 
 fnode_query_aux (int *min, int *max, T this, int divno, int nodeindex, Chrpos_T x) {
   int lambda;
   FNode_T node;
 
-  if (nodeindex == -1) {
-    return;
-  }
+  while (nodeindex != -1) {
+    node = &(this->nodes[divno][nodeindex]);
+    if (x == node->value) {
+      debug(printf("%uD:\n",node->value));
+      if (node->a < *min) {
+	*min = node->a;
+      }
+      if (node->b > *max) {
+	*max = node->b;
+      }
+      return;
 
-  node = &(this->nodes[divno][nodeindex]);
-  if (x == node->value) {
-    debug(printf("%uD:\n",node->value));
-    if (node->a < *min) {
-      *min = node->a;
-    }
-    if (node->b > *max) {
-      *max = node->b;
-    }
-    return;
-  } else if (x < node->value) {
-    fnode_query_aux(&(*min),&(*max),this,divno,node->leftindex,x);
-    debug(printf("%uL:\n",node->value));
-    if (node->a < *min) {
-      *min = node->a;
-    }
-    for (lambda = node->a; lambda <= node->b; lambda++) {
-      debug(printf("Looking at lambda %d, segment %d\n",
-		   lambda,this->sigmas[divno][lambda]));
-      if (Interval_is_contained(x,this->intervals[divno],this->sigmas[divno][lambda]) == true) {
-	if (lambda > *max) {
-	  *max = lambda;
+    } else if (x < node->value) {
+      debug(printf("%uL:\n",node->value));
+      if (node->a < *min) {
+	*min = node->a;
+      }
+      for (lambda = node->a; lambda <= node->b; lambda++) {
+	debug(printf("Looking at lambda %d, segment %d\n",
+		     lambda,this->sigmas[divno][lambda]));
+	if (Interval_is_contained(x,this->intervals[divno],this->sigmas[divno][lambda]) == true) {
+	  if (lambda > *max) {
+	    *max = lambda;
+	  }
+	} else {
+	  break;
 	}
-      } else {
-	return;
       }
-    }
-    return;
-  } else { 
-    /* (node->value < x) */
-    fnode_query_aux(&(*min),&(*max),this,divno,node->rightindex,x);
-    debug(printf("%uR:\n", node->value));
-    if (node->b > *max) {
-      *max = node->b;
-    }
-    for (lambda = node->b; lambda >= node->a; lambda--) {
-      debug(printf("Looking at lambda %d, segment %d\n",
-		   lambda,this->omegas[divno][lambda]));
-      if (Interval_is_contained(x,this->intervals[divno],this->omegas[divno][lambda]) == true) {
-	if (lambda < *min) {
-	  *min = lambda;
+      nodeindex = node->leftindex;
+
+    } else { 
+      /* (node->value < x) */
+      debug(printf("%uR:\n", node->value));
+      if (node->b > *max) {
+	*max = node->b;
+      }
+      for (lambda = node->b; lambda >= node->a; lambda--) {
+	debug(printf("Looking at lambda %d, segment %d\n",
+		     lambda,this->omegas[divno][lambda]));
+	if (Interval_is_contained(x,this->intervals[divno],this->omegas[divno][lambda]) == true) {
+	  if (lambda < *min) {
+	    *min = lambda;
+	  }
+	} else {
+	  break;
 	}
-      } else {
-	return;
       }
+      nodeindex = node->rightindex;
     }
-    return;
   }
+
+  return;
 }
 
 /************************************************************************/
@@ -4556,6 +4673,43 @@ IIT_get_signed_with_divno (int *nmatches, T this, int divno, Chrpos_T x, Chrpos_
 }
 
 
+/* Returns the first lambda whose Interval_low exceeds x, or the last
+   one if none does.  Callers step forward past any Interval_low <= x,
+   so this gives the same flanks as the binary search below. */
+static int
+eytzinger_search_low (struct Endpoint_T *endpoints, int n, Chrpos_T x) {
+  int k = 1;
+
+  while (k <= n) {
+    k = 2*k + (endpoints[k].value <= x);
+  }
+  /* Back up past the final right turns to the last left turn */
+  while (k & 1) {
+    k >>= 1;
+  }
+  k >>= 1;
+
+  return (k == 0) ? n : endpoints[k].lambda;
+}
+
+/* Returns the first lambda whose Interval_high is at least x, or the
+   last one if none is.  Callers step back past any Interval_high >= x. */
+static int
+eytzinger_search_high (struct Endpoint_T *endpoints, int n, Chrpos_T x) {
+  int k = 1;
+
+  while (k <= n) {
+    k = 2*k + (endpoints[k].value < x);
+  }
+  while (k & 1) {
+    k >>= 1;
+  }
+  k >>= 1;
+
+  return (k == 0) ? n : endpoints[k].lambda;
+}
+
+
 static int
 coord_search_low (T this, int divno, Chrpos_T x) {
   int low, middle, high;
@@ -4563,6 +4717,10 @@ coord_search_low (T this, int divno, Chrpos_T x) {
   Chrpos_T middlevalue;
   int index;
 
+  if (this->alpha_endpoints != NULL && this->alpha_endpoints[divno] != NULL) {
+    return eytzinger_search_low(this->alpha_endpoints[divno],this->nintervals[divno],x);
+  }
+
   low = 1;			/* not 0, because alphas[divno][0] not used */
   high = this->nintervals[divno];
 
@@ -4599,6 +4757,10 @@ coord_search_high (T this, int divno, Chrpos_T x) {
   Chrpos_T middlevalue;
   int index;
 
+  if (this->beta_endpoints != NULL && this->beta_endpoints[divno] != NULL) {
+    return eytzinger_search_high(this->beta_endpoints[divno],this->nintervals[divno],x);
+  }
+
   low = 1;			/* not 0, because betas[divno][0] not used */
   high = this->nintervals[divno];
 
@@ -1429,6 +1429,7 @@ IIT_create (List_T divlist, List_T typelist, List_T fieldlist, Table_T intervalt
   new->sigmas = (int **) CALLOC(new->ndivs,sizeof(int *));
   new->omegas = (int **) CALLOC(new->ndivs,sizeof(int *));
   new->nodes = (struct FNode_T **) CALLOC(new->ndivs,sizeof(struct FNode_T *));
+  new->alpha_endpoints = new->beta_endpoints = (struct Endpoint_T **) NULL;
 
   for (d = divlist, divno = 0; d != NULL; d = List_next(d), divno++) {
     divstring = (char *) List_head(d);
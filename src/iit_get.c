@@ -12,6 +12,9 @@ static char rcsid[] = "$Id: iit_get.c 153955 2014-11-24 17:54:45Z twu $";
 #include <strings.h>		/* For index, rindex */
 #include <ctype.h>
 #include <math.h>		/* For log */
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 #include "bool.h"
 #include "mem.h"
 #include "access.h"
@@ -26,6 +29,7 @@ static char rcsid[] = "$Id: iit_get.c 153955 2014-11-24 17:54:45Z twu $";
 #include "getopt.h"
 
 #define BUFLEN 1024
+#define BATCH_NQUERIES 65536
 
 
 #ifdef DEBUG
@@ -61,6 +65,8 @@ static bool statsp = false;
 static bool force_label_p = false;
 static bool force_coords_p = false;
 static bool overall_total_p = false;
+static bool batchp = false;
+static int nthreads = 1;
 
 static struct option long_options[] = {
   /* Input options */
@@ -80,6 +86,8 @@ static struct option long_options[] = {
   {"stats", no_argument, 0, 'N'}, /* statsp */
   {"label", no_argument, 0, 'L'}, /* force_label_p */
   {"coords", no_argument, 0, 'C'}, /* force_coords_p */
+  {"batch", no_argument, 0, 0}, /* batchp */
+  {"nthreads", required_argument, 0, 0}, /* nthreads */
 
   /* Help options */
   {"version", no_argument, 0, 'V'}, /* print_program_version */
@@ -122,6 +130,9 @@ Options\n\
   -S, --sort              Sort results by coordinates\n\
   -U, --unsigned          Print all intervals as low..high, even those entered as reverse (high < low)\n\
   -u, --flanking=INT      Show flanking segments on left and right\n\
+  --batch                 For queries from stdin, read them in blocks, answer each block\n\
+                            in chromosomal order, and print results in input order\n\
+  --nthreads=INT          Number of threads for --batch (default 1)\n\
 \n\
 Options for specific IIT formats\n\
   -a, --lowval=DOUBLE     Low bound on a values IIT (default -Inf)\n\
@@ -653,17 +664,86 @@ print_interval_univ (Univcoord_T coordstart, Univcoord_T coordend, int index,
 }
 
 
+/* Returns true if query should be treated as coordinates.  Uses iit
+   to look up divs if it has already been read. */
+static bool
+parse_coords (char **divstring, Univcoord_T *coordstart, Univcoord_T *coordend,
+	      char *query, IIT_T iit, char *filename) {
+  bool revcomp;
+
+  if (force_label_p == true) {
+    return false;
+  } else if (force_coords_p == true) {
+    return true;
+  } else if (iit != NULL) {
+    return Parserange_query_iit(&(*divstring),&(*coordstart),&(*coordend),&revcomp,query,iit);
+  } else {
+    return Parserange_query(&(*divstring),&(*coordstart),&(*coordend),&revcomp,query,filename);
+  }
+}
+
+
+static int *
+get_matches_coords (int *nmatches, char *divstring, Univcoord_T coordstart, Univcoord_T coordend,
+		    int **leftflanks, int *nleftflanks, int **rightflanks, int *nrightflanks,
+		    char *typestring, IIT_T iit) {
+  int *matches;
+  int typeint;
+
+  if (typestring == NULL) {
+    /* Treat query as coordinates, without a typestring */
+    if (exactp == true) {
+      matches = IIT_get_exact_multiple(&(*nmatches),iit,divstring,coordstart,coordend,/*type*/0);
+    } else {
+      matches = IIT_get(&(*nmatches),iit,divstring,coordstart,coordend,sortp);
+    }
+    if (nflanking > 0) {
+      IIT_get_flanking(&(*leftflanks),&(*nleftflanks),&(*rightflanks),&(*nrightflanks),iit,divstring,
+		       coordstart,coordend,nflanking,/*sign*/0);
+    }
+
+  } else if ((typeint = IIT_typeint(iit,typestring)) < 0) {
+    fprintf(stderr,"No such type as %s.\n",typestring);
+#if 0
+    /* Treat query as coordinates, without a typestring */
+    matches = IIT_get(&(*nmatches),iit,divstring,coordstart,coordend,sortp);
+    if (nflanking > 0) {
+      IIT_get_flanking(&(*leftflanks),&(*nleftflanks),&(*rightflanks),&(*nrightflanks),iit,divstring,
+		       coordstart,coordend,nflanking,/*sign*/0);
+    }
+#else
+    matches = (int *) NULL;
+    *nleftflanks = *nrightflanks = 0;
+    nmatches = 0;
+#endif      
+
+  } else {
+    /* Treat query as coordinates, with a typestring */
+    if (exactp == true) {
+      matches = IIT_get_exact_multiple(&(*nmatches),iit,divstring,coordstart,coordend,typeint);
+    } else {
+      matches = IIT_get_typed(&(*nmatches),iit,divstring,coordstart,coordend,typeint,sortp);
+    }
+    if (nflanking > 0) {
+      debug(printf("Running IIT_get_flanking_typed\n"));
+      IIT_get_flanking_typed(&(*leftflanks),&(*nleftflanks),&(*rightflanks),&(*nrightflanks),iit,divstring,
+			     coordstart,coordend,nflanking,typeint,/*sign*/0);
+    }
+  }
+
+  return matches;
+}
+
+
 static int *
 get_matches (int *nmatches, char **divstring, Univcoord_T *coordstart, Univcoord_T *coordend,
 	     int **leftflanks, int *nleftflanks, int **rightflanks, int *nrightflanks,
 	     char *query, char *typestring, IIT_T *iit, char *filename) {
   int *matches;
-  bool revcomp;
-  int typeint;
 
   debug(printf("Entering get_matches with query %s.\n",query));
 
-  if (force_label_p == true || (force_coords_p == false && Parserange_query(&(*divstring),&(*coordstart),&(*coordend),&revcomp,query,filename) == false)) {
+  if (parse_coords(&(*divstring),&(*coordstart),&(*coordend),query,*iit,filename) == false) {
     /* Treat query as a label */
     *divstring = (char *) NULL;
     if (*iit == NULL) {
@@ -706,47 +786,9 @@ get_matches (int *nmatches, char **divstring, Univcoord_T *coordstart, Univcoord
       }
     }
 
-    if (typestring == NULL) {
-      /* Treat query as coordinates, without a typestring */
-      if (exactp == true) {
-	matches = IIT_get_exact_multiple(&(*nmatches),*iit,*divstring,*coordstart,*coordend,/*type*/0);
-      } else {
-	matches = IIT_get(&(*nmatches),*iit,*divstring,*coordstart,*coordend,sortp);
-      }
-      if (nflanking > 0) {
-	IIT_get_flanking(&(*leftflanks),&(*nleftflanks),&(*rightflanks),&(*nrightflanks),*iit,*divstring,
-			 *coordstart,*coordend,nflanking,/*sign*/0);
-      }
-
-    } else if ((typeint = IIT_typeint(*iit,typestring)) < 0) {
-      fprintf(stderr,"No such type as %s.\n",typestring);
-#if 0
-      /* Treat query as coordinates, without a typestring */
-      matches = IIT_get(&(*nmatches),*iit,*divstring,*coordstart,*coordend,sortp);
-      if (nflanking > 0) {
-	IIT_get_flanking(&(*leftflanks),&(*nleftflanks),&(*rightflanks),&(*nrightflanks),*iit,*divstring,
-			 *coordstart,*coordend,nflanking,/*sign*/0);
-      }
-#else
-      matches = (int *) NULL;
-      *nleftflanks = *nrightflanks = 0;
-      nmatches = 0;
-#endif      
-
-    } else {
-      /* Treat query as coordinates, with a typestring */
-      if (exactp == true) {
-	matches = IIT_get_exact_multiple(&(*nmatches),*iit,*divstring,*coordstart,*coordend,typeint);
-      } else {
-	matches = IIT_get_typed(&(*nmatches),*iit,*divstring,*coordstart,*coordend,typeint,sortp);
-      }
-      if (nflanking > 0) {
-	debug(printf("Running IIT_get_flanking_typed\n"));
-	IIT_get_flanking_typed(&(*leftflanks),&(*nleftflanks),&(*rightflanks),&(*nrightflanks),*iit,*divstring,
-			       *coordstart,*coordend,nflanking,typeint,/*sign*/0);
-      }
-    }
-
+    matches = get_matches_coords(&(*nmatches),*divstring,*coordstart,*coordend,
+				 &(*leftflanks),&(*nleftflanks),&(*rightflanks),&(*nrightflanks),
+				 typestring,*iit);
   }
 
   return matches;
@@ -865,6 +907,276 @@ get_matches_multiple_typed (int *nmatches, char **divstring, Univcoord_T *coords
 }
 
 
+/* Prints the results for one query from stdin, and frees them */
+static void
+print_query (Chrpos_T *lastcoord, char *line, bool skipp, int *matches, int nmatches,
+	     char *divstring, Chrpos_T coordstart, Chrpos_T coordend,
+	     int *leftflanks, int nleftflanks, int *rightflanks, int nrightflanks, IIT_T iit) {
+  long int total = 0;
+  int ndivs, i;
+
+  if (skipp == false) {
+    fprintf(stdout,"# Query: %s\n",line);
+    ndivs = IIT_ndivs(iit);
+    if (nflanking > 0) {
+      for (i = nleftflanks-1; i >= 0; i--) {
+	debug(printf("\nleft index = %d\n",leftflanks[i]));
+	print_interval(&(*lastcoord),/*total*/0,divstring,coordstart,coordend,leftflanks[i],iit,ndivs,fieldint);
+      }
+      printf("====================\n");
+      FREE(leftflanks);
+    }
+
+    *lastcoord = coordstart;
+    for (i = 0; i < nmatches; i++) {
+      debug(printf("\nindex = %d\n",matches[i]));
+      total = print_interval(&(*lastcoord),total,divstring,coordstart,coordend,matches[i],iit,ndivs,fieldint);
+    }
+
+    if (nflanking > 0) {
+      printf("====================\n");
+      for (i = 0; i < nrightflanks; i++) {
+	debug(printf("\nright index = %d\n",rightflanks[i]));
+	print_interval(&(*lastcoord),/*total*/0,divstring,coordstart,coordend,rightflanks[i],iit,ndivs,fieldint);
+      }
+      FREE(rightflanks);
+    }
+
+    if (zeroesp == true) {
+      while (*lastcoord <= coordend) {
+	printf("%s\t%u\t%d\n",divstring,*lastcoord,0);
+	(*lastcoord)++;
+      }
+    }
+  }
+
+  if (divstring != NULL) {
+    FREE(divstring);
+  }
+  FREE(matches);
+  printf("%ld\n",total);
+  fprintf(stdout,"# End\n");
+  fflush(stdout);
+
+  return;
+}
+
+
+/************************************************************************
+ *   Batch mode.  Queries from stdin are read in blocks.  Each block
+ *   is parsed in input order, sorted by div and position so that
+ *   lookups sweep through each div's intervals in order, answered by
+ *   nthreads threads over contiguous ranges of the sorted block, and
+ *   printed in input order.
+ ************************************************************************/
+
+typedef struct Batch_T *Batch_T;
+struct Batch_T {
+  char *line;
+  bool skipp;
+  bool coordsp;
+  char *query;
+  char *typestring;
+
+  char *divstring;
+  int divno;
+  Univcoord_T coordstart;
+  Univcoord_T coordend;
+
+  int *matches;
+  int nmatches;
+  int *leftflanks;
+  int nleftflanks;
+  int *rightflanks;
+  int nrightflanks;
+};
+
+static IIT_T batch_iit;
+static Batch_T *batch_sorted;
+
+
+static void
+batch_answer (Batch_T this) {
+  if (this->skipp == true) {
+    /* Nothing to answer */
+  } else if (this->coordsp == false) {
+    this->nleftflanks = this->nrightflanks = 0;
+    this->matches = IIT_find(&this->nmatches,batch_iit,this->query);
+  } else {
+    this->matches = get_matches_coords(&this->nmatches,this->divstring,this->coordstart,this->coordend,
+				       &this->leftflanks,&this->nleftflanks,&this->rightflanks,&this->nrightflanks,
+				       this->typestring,batch_iit);
+  }
+  return;
+}
+
+#ifdef HAVE_PTHREAD
+typedef struct Batch_range_T *Batch_range_T;
+struct Batch_range_T {
+  int start;
+  int end;
+};
+
+static void *
+batch_thread (void *data) {
+  Batch_range_T range = (Batch_range_T) data;
+  int k;
+
+  for (k = range->start; k < range->end; k++) {
+    batch_answer(batch_sorted[k]);
+  }
+  return (void *) NULL;
+}
+#endif
+
+
+static int
+batch_cmp (const void *x, const void *y) {
+  Batch_T a = * (Batch_T *) x;
+  Batch_T b = * (Batch_T *) y;
+
+  if (a->divno < b->divno) {
+    return -1;
+  } else if (b->divno < a->divno) {
+    return +1;
+  } else if (a->coordstart < b->coordstart) {
+    return -1;
+  } else if (b->coordstart < a->coordstart) {
+    return +1;
+  } else if (a->coordend < b->coordend) {
+    return -1;
+  } else if (b->coordend < a->coordend) {
+    return +1;
+  } else {
+    return 0;
+  }
+}
+
+
+static void
+answer_batch (Batch_T *batch, int nqueries) {
+  int k;
+#ifdef HAVE_PTHREAD
+  pthread_t *threads;
+  struct Batch_range_T *ranges;
+  int nworkers, t;
+#endif
+
+  batch_sorted = (Batch_T *) MALLOC(nqueries*sizeof(Batch_T));
+  memcpy(batch_sorted,batch,nqueries*sizeof(Batch_T));
+  qsort(batch_sorted,nqueries,sizeof(Batch_T),batch_cmp);
+
+#ifdef HAVE_PTHREAD
+  if ((nworkers = nthreads) > nqueries) {
+    nworkers = nqueries;
+  }
+  if (nworkers > 1) {
+    threads = (pthread_t *) MALLOC(nworkers*sizeof(pthread_t));
+    ranges = (struct Batch_range_T *) MALLOC(nworkers*sizeof(struct Batch_range_T));
+    for (t = 0; t < nworkers; t++) {
+      ranges[t].start = (int) ((long int) nqueries * t / nworkers);
+      ranges[t].end = (int) ((long int) nqueries * (t + 1) / nworkers);
+      pthread_create(&(threads[t]),NULL,batch_thread,(void *) &(ranges[t]));
+    }
+    for (t = 0; t < nworkers; t++) {
+      pthread_join(threads[t],NULL);
+    }
+    FREE(ranges);
+    FREE(threads);
+    FREE(batch_sorted);
+    return;
+  }
+#endif
+
+  for (k = 0; k < nqueries; k++) {
+    batch_answer(batch_sorted[k]);
+  }
+  FREE(batch_sorted);
+  return;
+}
+
+
+static void
+process_batches (Chrpos_T *lastcoord, IIT_T iit) {
+  Batch_T *batch, this;
+  char Buffer[BUFLEN], nocomment[BUFLEN], query[BUFLEN], typestring[BUFLEN], *ptr;
+  int nargs, nqueries, k;
+  Univcoord_T coordstart = 0, coordend = 0;
+  bool eofp = false;
+
+  batch_iit = iit;
+  batch = (Batch_T *) MALLOC(BATCH_NQUERIES*sizeof(Batch_T));
+
+  while (eofp == false) {
+    nqueries = 0;
+    while (nqueries < BATCH_NQUERIES && (eofp = (fgets(Buffer,BUFLEN,stdin) == NULL)) == false) {
+      if ((ptr = rindex(Buffer,'\n')) != NULL) {
+	*ptr = '\0';
+      }
+      strcpy(nocomment,Buffer);
+      if ((ptr = rindex(nocomment,'#')) != NULL) {
+	*ptr = '\0';
+      }
+
+      this = batch[nqueries++] = (Batch_T) MALLOC(sizeof(*this));
+      this->line = (char *) MALLOC((strlen(Buffer)+1)*sizeof(char));
+      strcpy(this->line,Buffer);
+      this->query = this->typestring = this->divstring = (char *) NULL;
+      this->matches = this->leftflanks = this->rightflanks = (int *) NULL;
+      this->nmatches = this->nleftflanks = this->nrightflanks = 0;
+      this->coordstart = this->coordend = 0;
+      this->skipp = this->coordsp = false;
+
+      if ((nargs = sscanf(nocomment,"%s %s",query,typestring)) < 1) {
+	fprintf(stderr,"Can't parse line %s.  Ignoring.\n",nocomment);
+	this->skipp = true;
+	this->divno = -1;
+      } else {
+	this->query = (char *) MALLOC((strlen(query)+1)*sizeof(char));
+	strcpy(this->query,query);
+	if (nargs == 2) {
+	  this->typestring = (char *) MALLOC((strlen(typestring)+1)*sizeof(char));
+	  strcpy(this->typestring,typestring);
+	}
+	if ((this->coordsp = parse_coords(&this->divstring,&this->coordstart,&this->coordend,query,iit,
+					  /*filename*/NULL)) == false) {
+	  /* Labels are looked up after all coordinates */
+	  this->divstring = (char *) NULL;
+	  this->divno = IIT_ndivs(iit);
+	} else {
+	  this->divno = IIT_divint(iit,this->divstring);
+	}
+      }
+    }
+
+    answer_batch(batch,nqueries);
+
+    for (k = 0; k < nqueries; k++) {
+      this = batch[k];
+      if (this->coordsp == true) {
+	/* Otherwise, keep coordinates from the previous query, as in the unbatched loop */
+	coordstart = this->coordstart;
+	coordend = this->coordend;
+      }
+      print_query(&(*lastcoord),this->line,this->skipp,this->matches,this->nmatches,this->divstring,
+		  (Chrpos_T) coordstart,(Chrpos_T) coordend,
+		  this->leftflanks,this->nleftflanks,this->rightflanks,this->nrightflanks,iit);
+      FREE(this->line);
+      if (this->query != NULL) {
+	FREE(this->query);
+      }
+      if (this->typestring != NULL) {
+	FREE(this->typestring);
+      }
+      FREE(this);
+    }
+  }
+
+  FREE(batch);
+  return;
+}
+
+
 static int
 int_cmp (const void *x, const void *y) {
   int a = * (int *) x;
@@ -965,6 +1277,13 @@ main (int argc, char *argv[]) {
 	exit(0);
       } else if (!strcmp(long_name,"exact")) {
 	exactp = true;
+      } else if (!strcmp(long_name,"batch")) {
+	batchp = true;
+      } else if (!strcmp(long_name,"nthreads")) {
+	if ((nthreads = atoi(optarg)) < 1) {
+	  fprintf(stderr,"--nthreads must be at least 1\n");
+	  exit(9);
+	}
       } else {
 	/* Shouldn't reach here */
 	fprintf(stderr,"Don't recognize option %s.  For usage, run 'gsnap --help'",long_name);
@@ -1128,81 +1447,44 @@ main (int argc, char *argv[]) {
       }
     }
 	
-    while (fgets(Buffer,BUFLEN,stdin) != NULL) {
-      if ((ptr = rindex(Buffer,'\n')) != NULL) {
-	*ptr = '\0';
-      }
-      strcpy(nocomment,Buffer);
-      if ((ptr = rindex(nocomment,'#')) != NULL) {
-	*ptr = '\0';
-      }
-
-      skipp = false;
-
-      if ((nargs = sscanf(nocomment,"%s %s",query,typestring)) == 2) {
-	debug(printf("typestring is %s\n",typestring));
-	matches = get_matches(&nmatches,&divstring,&univ_coordstart,&univ_coordend,
-			      &leftflanks,&nleftflanks,&rightflanks,&nrightflanks,
-			      query,typestring,&iit,filename);
-	coordstart = (Chrpos_T) univ_coordstart;
-	coordend = (Chrpos_T) univ_coordend;
-
-      } else if (nargs == 1) {
-	debug(printf("typestring is NULL\n"));
-	matches = get_matches(&nmatches,&divstring,&univ_coordstart,&univ_coordend,
-			      &leftflanks,&nleftflanks,&rightflanks,&nrightflanks,
-			      query,/*typestring*/NULL,&iit,filename);
-	coordstart = (Chrpos_T) univ_coordstart;
-	coordend = (Chrpos_T) univ_coordend;
-
-      } else {
-	fprintf(stderr,"Can't parse line %s.  Ignoring.\n",nocomment);
-	skipp = true;
-      }
-	
-      total = 0;
-      if (skipp == false) {
-	fprintf(stdout,"# Query: %s\n",Buffer);
-	ndivs = IIT_ndivs(iit);
-	if (nflanking > 0) {
-	  for (i = nleftflanks-1; i >= 0; i--) {
-	    debug(printf("\nleft index = %d\n",leftflanks[i]));
-	    print_interval(&lastcoord,/*total*/0,divstring,coordstart,coordend,leftflanks[i],iit,ndivs,fieldint);
-	  }
-	  printf("====================\n");
-	  FREE(leftflanks);
+    if (batchp == true) {
+      process_batches(&lastcoord,iit);
+    } else {
+      while (fgets(Buffer,BUFLEN,stdin) != NULL) {
+	if ((ptr = rindex(Buffer,'\n')) != NULL) {
+	  *ptr = '\0';
 	}
-
-	lastcoord = coordstart;
-	for (i = 0; i < nmatches; i++) {
-	  debug(printf("\nindex = %d\n",matches[i]));
-	  total = print_interval(&lastcoord,total,divstring,coordstart,coordend,matches[i],iit,ndivs,fieldint);
+	strcpy(nocomment,Buffer);
+	if ((ptr = rindex(nocomment,'#')) != NULL) {
+	  *ptr = '\0';
 	}
 
-	if (nflanking > 0) {
-	  printf("====================\n");
-	  for (i = 0; i < nrightflanks; i++) {
-	    debug(printf("\nright index = %d\n",rightflanks[i]));
-	    print_interval(&lastcoord,/*total*/0,divstring,coordstart,coordend,rightflanks[i],iit,ndivs,fieldint);
-	  }
-	  FREE(rightflanks);
-	}
+	skipp = false;
+
+	if ((nargs = sscanf(nocomment,"%s %s",query,typestring)) == 2) {
+	  debug(printf("typestring is %s\n",typestring));
+	  matches = get_matches(&nmatches,&divstring,&univ_coordstart,&univ_coordend,
+				&leftflanks,&nleftflanks,&rightflanks,&nrightflanks,
+				query,typestring,&iit,filename);
 
-	if (zeroesp == true) {
-	  while (lastcoord <= coordend) {
-	    printf("%s\t%u\t%d\n",divstring,lastcoord,0);
-	    lastcoord++;
-	  }
+	} else if (nargs == 1) {
+	  debug(printf("typestring is NULL\n"));
+	  matches = get_matches(&nmatches,&divstring,&univ_coordstart,&univ_coordend,
+				&leftflanks,&nleftflanks,&rightflanks,&nrightflanks,
+				query,/*typestring*/NULL,&iit,filename);
+
+	} else {
+	  fprintf(stderr,"Can't parse line %s.  Ignoring.\n",nocomment);
+	  skipp = true;
 	}
-      }
 
-      if (divstring != NULL) {
-	FREE(divstring);
+	print_query(&lastcoord,Buffer,skipp,matches,nmatches,divstring,
+		    (Chrpos_T) univ_coordstart,(Chrpos_T) univ_coordend,
+		    leftflanks,nleftflanks,rightflanks,nrightflanks,iit);
+	divstring = (char *) NULL;
+	matches = leftflanks = rightflanks = (int *) NULL;
+	nmatches = 0;
       }
-      FREE(matches);
-      printf("%ld\n",total);
-      fprintf(stdout,"# End\n");
-      fflush(stdout);
     }
 
     IIT_free(&iit);
@@ -46,6 +46,13 @@ struct FNode_T {
   int rightindex;
 };
 
+/* Interval endpoint, with its rank in alphas or betas */
+typedef struct Endpoint_T *Endpoint_T;
+struct Endpoint_T {
+  Chrpos_T value;
+  int lambda;
+};
+
 
 #define T IIT_T
 typedef struct T *T;
@@ -81,6 +88,9 @@ struct T {
   int **sigmas;			/* Ordering for IIT */
   int **omegas;			/* Ordering for IIT */
 
+  struct Endpoint_T **alpha_endpoints; /* Interval_low over alphas, in Eytzinger order.  Built on read */
+  struct Endpoint_T **beta_endpoints;  /* Interval_high over betas, in Eytzinger order.  Built on read */
+
   struct FNode_T **nodes;	/* Per div */
   struct Interval_T **intervals; /* Per div */
 
@@ -22,6 +22,9 @@ static char rcsid[] = "$Id: inbuffer.c 175728 2015-09-30 15:08:16Z twu $";
 #ifdef GSNAP
 #include "shortread.h"
 #endif
+#if defined(GSNAP) && !defined(USE_MPI)
+#include "fopen.h"
+#endif
 
 
 #ifdef DEBUG
@@ -45,6 +48,30 @@ static Sequence_T global_usersegment;
 static int part_modulus;
 static int part_interval;
 
+
+#if defined(HAVE_PTHREAD)
+/* Each worker thread takes requests from the shared buffer in batches
+   and keeps them in its own queue, so that short reads do not make the
+   shared lock hot.  A thread whose trylock on the shared buffer fails
+   doubles its batch, and otherwise shrinks it by one.  Once the input
+   is exhausted, batches are capped so the remaining requests spread
+   over all workers, and a worker whose queue runs dry steals half of
+   the fullest remaining queue. */
+#define MAX_BATCH 64
+#define MIN_FILL_PER_WORKER 8
+
+typedef struct Localqueue_T *Localqueue_T;
+struct Localqueue_T {
+  pthread_mutex_t lock;
+  Request_T requests[MAX_BATCH];
+  int head;
+  int tail;
+  int batchsize;
+  bool waitingp;		/* Blocked on the shared buffer */
+  Localqueue_T next;
+};
+#endif
+
 void
 Inbuffer_setup (bool filter_if_both_p_in, 
 #if defined(USE_MPI) && defined(USE_MPI_FILE_INPUT)
@@ -110,8 +137,8 @@ struct T {
 #endif
 
 #ifdef HAVE_ZLIB
-  gzFile gzipped;
-  gzFile gzipped2;
+  Bgzf_T gzipped;
+  Bgzf_T gzipped2;
 #else
   void *gzipped;
   void *gzipped2;
@@ -136,12 +163,31 @@ struct T {
 #ifndef GSNAP
   Sequence_T pairalign_segment;
 #endif
+
+#if defined(GSNAP) && !defined(USE_MPI)
+  Manifest_T manifest;		/* Samples to be streamed in turn, or NULL */
+  int sampleid;
+  bool gunzip_p;
+  bool bunzip2_p;
+  int format_char;		/* First char of the first sample, '@' or '>' */
+  unsigned int *sample_nrequests; /* Known once the sample reaches EOF */
+  int sample_firstid;		/* requestid at the start of the current sample */
+  int nsamples_done;		/* Finished samples reported to Outbuffer */
+#endif
+
   Request_T *buffer;
   unsigned int nspaces;
+  unsigned int nfill;		/* Requests read per refill, at most nspaces */
   int ptr;
   int nleft;
   int inputid;
   int requestid;
+
+#if defined(HAVE_PTHREAD)
+  pthread_key_t queue_key;
+  Localqueue_T queues;		/* Queues of all worker threads, for stealing */
+  int nqueues;
+#endif
 };
 
 
@@ -167,6 +213,7 @@ Inbuffer_cmdline (char *contents, int length) {
 
   new->pairalign_segment = (Sequence_T) NULL;
   new->buffer = (Request_T *) CALLOC(1,sizeof(Request_T));
+  new->nspaces = new->nfill = 1;
 
   new->ptr = 0;
   new->nleft = 1;
@@ -177,6 +224,9 @@ Inbuffer_cmdline (char *contents, int length) {
 
 #if defined(HAVE_PTHREAD)
   pthread_mutex_init(&new->lock,NULL);
+  pthread_key_create(&new->queue_key,NULL);
+  new->queues = (Localqueue_T) NULL;
+  new->nqueues = 0;
 #endif
 
   return new;
@@ -201,7 +251,7 @@ Inbuffer_new (int nextchar,
 	      FILE *input2,
 #endif
 #ifdef HAVE_ZLIB
-	      gzFile gzipped, gzFile gzipped2,
+	      Bgzf_T gzipped, Bgzf_T gzipped2,
 #endif
 #ifdef HAVE_BZLIB
 	      Bzip2_T bzipped, Bzip2_T bzipped2,
@@ -250,13 +300,25 @@ Inbuffer_new (int nextchar,
 #ifndef GSNAP
   new->pairalign_segment = (Sequence_T) NULL;
 #endif
+#if defined(GSNAP) && !defined(USE_MPI)
+  new->manifest = (Manifest_T) NULL;
+  new->sampleid = 0;
+  new->sample_nrequests = (unsigned int *) NULL;
+#endif
+  new->outbuffer = (Outbuffer_T) NULL;
   new->buffer = (Request_T *) CALLOC(nspaces,sizeof(Request_T));
-  new->nspaces = nspaces;
+  new->nspaces = new->nfill = nspaces;
   new->ptr = 0;
   new->nleft = 0;
   new->inputid = 0;
   new->requestid = 0;
 
+#if defined(HAVE_PTHREAD)
+  pthread_key_create(&new->queue_key,NULL);
+  new->queues = (Localqueue_T) NULL;
+  new->nqueues = 0;
+#endif
+
   return new;
 }
 
@@ -268,14 +330,58 @@ Inbuffer_set_master (T this, Master_T master) {
 }
 #endif
 
+#if defined(GSNAP) && !defined(USE_MPI)
+/* Tells Outbuffer the number of requests in each finished sample, so
+   it can close that sample's files.  Counts wait here until the
+   outbuffer is set, since Inbuffer_fill_init may read past a sample
+   before then. */
+static void
+report_samples_done (T this) {
+  if (this->outbuffer != NULL) {
+    while (this->nsamples_done < this->sampleid) {
+      Outbuffer_sample_done(this->nsamples_done,this->sample_nrequests[this->nsamples_done]);
+      this->nsamples_done += 1;
+    }
+  }
+  return;
+}
+#endif
+
 void
 Inbuffer_set_outbuffer (T this, Outbuffer_T outbuffer) {
   this->outbuffer = outbuffer;
+#if defined(GSNAP) && !defined(USE_MPI)
+  if (this->manifest != NULL) {
+    report_samples_done(this);
+  }
+#endif
+  return;
+}
+
+#if defined(GSNAP) && !defined(USE_MPI)
+/* The streams given to Inbuffer_new must already hold the first sample
+   of the manifest.  Remaining samples are opened as each one reaches
+   EOF, so all samples share the worker threads. */
+void
+Inbuffer_set_manifest (T this, Manifest_T manifest, bool gunzip_p, bool bunzip2_p) {
+  this->manifest = manifest;
+  this->sampleid = 0;
+  this->sample_nrequests = (unsigned int *) CALLOC(Manifest_nsamples(manifest),sizeof(unsigned int));
+  this->sample_firstid = this->requestid;
+  this->nsamples_done = 0;
+  this->gunzip_p = gunzip_p;
+  this->bunzip2_p = bunzip2_p;
+  this->format_char = this->nextchar;
   return;
 }
+#endif
 
 void
 Inbuffer_free (T *old) {
+#if defined(HAVE_PTHREAD)
+  Localqueue_T queue, next;
+#endif
+
   if (*old) {
     /* No need to close input, since done by Shortread and Sequence read procedures */
 
@@ -285,8 +391,19 @@ Inbuffer_free (T *old) {
 #endif
 
     FREE((*old)->buffer);
+#if defined(GSNAP) && !defined(USE_MPI)
+    if ((*old)->sample_nrequests != NULL) {
+      FREE((*old)->sample_nrequests);
+    }
+#endif
     
 #if defined(HAVE_PTHREAD)
+    for (queue = (*old)->queues; queue != NULL; queue = next) {
+      next = queue->next;
+      pthread_mutex_destroy(&queue->lock);
+      FREE_KEEP(queue);
+    }
+    pthread_key_delete((*old)->queue_key);
     pthread_mutex_destroy(&(*old)->lock);
 #endif
 
@@ -485,7 +602,7 @@ fill_buffer_master (T this) {
       }
       
     } else {
-      this->buffer[nread++] = Request_new(this->requestid++,queryseq1,queryseq2);
+      this->buffer[nread++] = Request_new(this->requestid++,/*sampleid*/0,queryseq1,queryseq2);
     }
     this->inputid++;
   }
@@ -683,7 +800,7 @@ fill_buffer_slave (T this) {
       }
       
     } else {
-      this->buffer[nread++] = Request_new(this->requestid++,queryseq1,queryseq2);
+      this->buffer[nread++] = Request_new(this->requestid++,/*sampleid*/0,queryseq1,queryseq2);
     }
     this->inputid++;
   }
@@ -704,6 +821,100 @@ fill_buffer_slave (T this) {
 
 #elif defined(GSNAP)
 
+/* Opens the files for the next sample in the manifest.  Returns false
+   if no samples remain. */
+static bool
+open_next_sample (T this) {
+  char **files;
+  int nfiles, nchars = 0;
+  char *sample;
+
+  if (this->manifest == NULL || this->sampleid + 1 >= Manifest_nsamples(this->manifest)) {
+    return false;
+  }
+
+  this->sample_nrequests[this->sampleid] = this->requestid - this->sample_firstid;
+  this->sample_firstid = this->requestid;
+  this->sampleid += 1;
+  report_samples_done(this);
+
+  sample = Manifest_sample(this->manifest,this->sampleid);
+  files = Manifest_files(&nfiles,this->manifest,this->sampleid);
+
+  this->input = this->input2 = (FILE *) NULL;
+#ifdef HAVE_ZLIB
+  this->gzipped = this->gzipped2 = (Bgzf_T) NULL;
+#endif
+#ifdef HAVE_BZLIB
+  this->bzipped = this->bzipped2 = (Bzip2_T) NULL;
+#endif
+
+  if (this->gunzip_p == true) {
+#ifdef HAVE_ZLIB
+    if ((this->gzipped = Bgzf_open(files[0])) == NULL) {
+      fprintf(stderr,"Cannot open gzipped file %s for sample %s\n",files[0],sample);
+      exit(9);
+    }
+    this->nextchar = Shortread_input_init_gzip(this->gzipped);
+#endif
+
+  } else if (this->bunzip2_p == true) {
+#ifdef HAVE_BZLIB
+    if ((this->bzipped = Bzip2_new(files[0])) == NULL) {
+      fprintf(stderr,"Cannot open bzipped file %s for sample %s\n",files[0],sample);
+      exit(9);
+    }
+    this->nextchar = Shortread_input_init_bzip2(this->bzipped);
+#endif
+
+  } else if ((this->input = FOPEN_READ_TEXT(files[0])) == NULL) {
+    fprintf(stderr,"Cannot open file %s for sample %s\n",files[0],sample);
+    exit(9);
+  } else {
+    this->nextchar = Shortread_input_init(&nchars,this->input);
+  }
+
+  if (this->nextchar == EOF) {
+    /* Empty sample.  Shortread_read will close the stream and return NULL. */
+    return true;
+  } else if (this->nextchar != this->format_char) {
+    fprintf(stderr,"Sample %s has first char %c, but the first sample in the manifest starts with %c.  All samples must be FASTA or all FASTQ.\n",
+	    sample,this->nextchar,this->format_char);
+    exit(9);
+  }
+
+  if (nfiles > 1) {
+    if (this->nextchar != '@') {
+      fprintf(stderr,"Sample %s lists two files, but paired-end input is only supported for FASTQ\n",sample);
+      exit(9);
+    } else if (this->gunzip_p == true) {
+#ifdef HAVE_ZLIB
+      if ((this->gzipped2 = Bgzf_open(files[1])) == NULL) {
+	fprintf(stderr,"Cannot open gzipped file %s for sample %s\n",files[1],sample);
+	exit(9);
+      }
+      /* nextchar2 = */ Shortread_input_init_gzip(this->gzipped2);
+#endif
+    } else if (this->bunzip2_p == true) {
+#ifdef HAVE_BZLIB
+      if ((this->bzipped2 = Bzip2_new(files[1])) == NULL) {
+	fprintf(stderr,"Cannot open bzipped file %s for sample %s\n",files[1],sample);
+	exit(9);
+      }
+      /* nextchar2 = */ Shortread_input_init_bzip2(this->bzipped2);
+#endif
+    } else if ((this->input2 = FOPEN_READ_TEXT(files[1])) == NULL) {
+      fprintf(stderr,"Cannot open file %s for sample %s\n",files[1],sample);
+      exit(9);
+    } else {
+      /* nextchar2 = */ Shortread_input_init(&nchars,this->input2);
+    }
+  }
+
+  return true;
+}
+
+
 /* Returns number of requests read */
 static unsigned int
 fill_buffer (T this) {
@@ -712,43 +923,49 @@ fill_buffer (T this) {
   bool skipp;
   int nchars1 = 0, nchars2 = 0;		/* Returned only because MPI master needs it.  Doesn't need to be saved as a field in Inbuffer_T. */
 
-  while (nread < this->nspaces &&
-	 (queryseq1 = Shortread_read(&this->nextchar,&nchars1,&nchars2,&queryseq2,
-				     &this->input,&this->input2,
+  while (nread < this->nfill) {
+    if ((queryseq1 = Shortread_read(&this->nextchar,&nchars1,&nchars2,&queryseq2,
+				    &this->input,&this->input2,
 #ifdef HAVE_ZLIB
-				     &this->gzipped,&this->gzipped2,
+				    &this->gzipped,&this->gzipped2,
 #endif
 #ifdef HAVE_BZLIB
-				     &this->bzipped,&this->bzipped2,
+				    &this->bzipped,&this->bzipped2,
 #endif
-				     &this->files,&this->nfiles,skipp = (this->inputid % part_interval != part_modulus))) != NULL) {
-    if (skipp) {
-#if 0
-      /* Shortread procedures won't allocate in this situation */
-      Shortread_free(&queryseq1);
-      if (queryseq2 != NULL) {
-	Shortread_free(&queryseq2);
+				    &this->files,&this->nfiles,skipp = (this->inputid % part_interval != part_modulus))) == NULL) {
+      if (open_next_sample(this) == false) {
+	break;
       }
+
+    } else {
+      if (skipp) {
+#if 0
+	/* Shortread procedures won't allocate in this situation */
+	Shortread_free(&queryseq1);
+	if (queryseq2 != NULL) {
+	  Shortread_free(&queryseq2);
+	}
 #endif
       
-    } else if (filter_if_both_p == true &&
-	       Shortread_filterp(queryseq1) == true && (queryseq2 == NULL || Shortread_filterp(queryseq2) == true)) {
-      Shortread_free(&queryseq1);
-      if (queryseq2 != NULL) {
-	Shortread_free(&queryseq2);
-      }
+      } else if (filter_if_both_p == true &&
+		 Shortread_filterp(queryseq1) == true && (queryseq2 == NULL || Shortread_filterp(queryseq2) == true)) {
+	Shortread_free(&queryseq1);
+	if (queryseq2 != NULL) {
+	  Shortread_free(&queryseq2);
+	}
       
-    } else if (filter_if_both_p == false &&
-	       (Shortread_filterp(queryseq1) == true || (queryseq2 != NULL && Shortread_filterp(queryseq2) == true))) {
-      Shortread_free(&queryseq1);
-      if (queryseq2 != NULL) {
-	Shortread_free(&queryseq2);
-      }
+      } else if (filter_if_both_p == false &&
+		 (Shortread_filterp(queryseq1) == true || (queryseq2 != NULL && Shortread_filterp(queryseq2) == true))) {
+	Shortread_free(&queryseq1);
+	if (queryseq2 != NULL) {
+	  Shortread_free(&queryseq2);
+	}
       
-    } else {
-      this->buffer[nread++] = Request_new(this->requestid++,queryseq1,queryseq2);
+      } else {
+	this->buffer[nread++] = Request_new(this->requestid++,this->sampleid,queryseq1,queryseq2);
+      }
+      this->inputid++;
     }
-    this->inputid++;
   }
 
   this->nleft = nread;
@@ -769,7 +986,7 @@ fill_buffer (T this) {
 #endif
   Sequence_T queryseq;
 
-  while (nread < this->nspaces &&
+  while (nread < this->nfill &&
 	 (queryseq = Sequence_read_multifile(&this->nextchar,&this->input,
 					     &this->files,&this->nfiles)) != NULL) {
     if (this->inputid % part_interval != part_modulus) {
@@ -809,29 +1026,78 @@ Inbuffer_fill_init (T this) {
 #endif
   
 
-Request_T
-#ifdef GSNAP
-Inbuffer_get_request (T this)
-#else
-Inbuffer_get_request (Sequence_T *pairalign_segment, T this) 
+static bool
+input_exhausted_p (T this) {
+  return (this->nextchar == EOF
+#if defined(GSNAP) && !defined(USE_MPI)
+	  && (this->manifest == NULL || this->sampleid + 1 >= Manifest_nsamples(this->manifest))
 #endif
-{
-  Request_T request;
-  unsigned int nread;
+	  );
+}
 
-#if defined(HAVE_PTHREAD)
-  pthread_mutex_lock(&this->lock);
+
+#if defined(HAVE_PTHREAD) && !defined(USE_MPI)
+/* Called after a refill, with this->lock held.  Workers that ran out
+   of requests during the refill mean it took too long, so the next
+   one reads less.  Otherwise the refill size grows back towards
+   nspaces, which keeps refills rare. */
+static void
+adjust_nfill (T this, Localqueue_T self) {
+  Localqueue_T queue;
+  unsigned int minfill;
+  int nwaiting = 0;
+
+#ifndef GSNAP
+  if (user_pairalign_p == true) {
+    return;
+  }
 #endif
-  
+
+  for (queue = this->queues; queue != NULL; queue = queue->next) {
+    if (queue != self) {
+      pthread_mutex_lock(&queue->lock);
+      if (queue->waitingp == true) {
+	nwaiting++;
+      }
+      pthread_mutex_unlock(&queue->lock);
+    }
+  }
+
+  if ((minfill = this->nqueues * MIN_FILL_PER_WORKER) > this->nspaces) {
+    minfill = this->nspaces;
+  }
+  if (nwaiting > 0) {
+    if ((this->nfill /= 2) < minfill) {
+      this->nfill = minfill;
+    }
+  } else {
+    if ((this->nfill *= 2) > this->nspaces) {
+      this->nfill = this->nspaces;
+    }
+  }
+  debug(printf("inbuffer: %d workers waiting, so nfill is now %u\n",nwaiting,this->nfill));
+
+  return;
+}
+#endif
+
+
+/* Moves up to maxrequests requests from the shared buffer into batch,
+   refilling the buffer first if it is empty.  Caller holds this->lock.
+   Returns the number of requests moved. */
+static int
+take_requests (Request_T *batch, int maxrequests, T this, void *self) {
+  unsigned int nread;
+  int n, i;
+
   if (this->nleft > 0) {
-    request = this->buffer[this->ptr++];
-    this->nleft -= 1;
+    /* Take from buffer */
 
-  } else if (this->nextchar == EOF) {
+  } else if (input_exhausted_p(this) == true) {
     /* ? Causes stall at end */
     /* Already know it is pointless to fill buffer */
     Outbuffer_add_nread(this->outbuffer,/*nread*/0);
-    request = NULL;
+    return 0;
 
   } else {
 #ifdef USE_MPI
@@ -865,22 +1131,196 @@ Inbuffer_get_request (Sequence_T *pairalign_segment, T this)
     debug(printf("Worker %d: ",this->myid));
 #endif
     debug(printf("inbuffer read %d sequences\n",nread));
-    
+
+#if defined(HAVE_PTHREAD) && !defined(USE_MPI)
+    adjust_nfill(this,(Localqueue_T) self);
+#endif
+
     if (nread == 0) {
       /* Still empty */
-      request = NULL;
-    } else {
-      request = this->buffer[this->ptr++];
-      this->nleft -= 1;
+      return 0;
     }
   }
 
-#ifndef GSNAP
-  *pairalign_segment = this->pairalign_segment;
+#if defined(HAVE_PTHREAD)
+  if (maxrequests > 1 && input_exhausted_p(this) == true) {
+    /* Last buffer, so leave some for each worker */
+    if ((n = this->nleft / (2 * this->nqueues)) < maxrequests) {
+      maxrequests = (n > 0) ? n : 1;
+    }
+  }
 #endif
 
+  n = (maxrequests < this->nleft) ? maxrequests : this->nleft;
+  for (i = 0; i < n; i++) {
+    batch[i] = this->buffer[this->ptr++];
+  }
+  this->nleft -= n;
+
+  return n;
+}
+
+
 #if defined(HAVE_PTHREAD)
+static Localqueue_T
+get_queue (T this) {
+  Localqueue_T queue;
+
+  if ((queue = (Localqueue_T) pthread_getspecific(this->queue_key)) == NULL) {
+    queue = (Localqueue_T) MALLOC_KEEP(sizeof(*queue));
+    pthread_mutex_init(&queue->lock,NULL);
+    queue->head = queue->tail = 0;
+    queue->batchsize = 1;
+    queue->waitingp = false;
+
+    pthread_mutex_lock(&this->lock);
+    queue->next = this->queues;
+    this->queues = queue;
+    this->nqueues += 1;
+    pthread_mutex_unlock(&this->lock);
+
+    pthread_setspecific(this->queue_key,(void *) queue);
+  }
+
+  return queue;
+}
+
+/* Moves the newer half of the fullest other queue into queue, which
+   is empty.  Returns the first stolen request, or NULL if every queue
+   is empty. */
+static Request_T
+steal_requests (Localqueue_T queue, T this) {
+  Localqueue_T queues, victim, p;
+  Request_T stolen[MAX_BATCH];
+  int most, n, i;
+
+  pthread_mutex_lock(&this->lock);
+  queues = this->queues;
   pthread_mutex_unlock(&this->lock);
+
+  while (1) {
+    victim = (Localqueue_T) NULL;
+    most = 0;
+    for (p = queues; p != NULL; p = p->next) {
+      if (p != queue) {
+	pthread_mutex_lock(&p->lock);
+	if (p->tail - p->head > most) {
+	  most = p->tail - p->head;
+	  victim = p;
+	}
+	pthread_mutex_unlock(&p->lock);
+      }
+    }
+
+    if (victim == NULL) {
+      return (Request_T) NULL;
+    }
+
+    pthread_mutex_lock(&victim->lock);
+    if ((n = (victim->tail - victim->head + 1)/2) > 0) {
+      victim->tail -= n;
+      for (i = 0; i < n; i++) {
+	stolen[i] = victim->requests[victim->tail + i];
+      }
+    }
+    pthread_mutex_unlock(&victim->lock);
+
+    if (n > 0) {
+      debug(printf("inbuffer: stole %d requests\n",n));
+      pthread_mutex_lock(&queue->lock);
+      for (i = 1; i < n; i++) {
+	queue->requests[i-1] = stolen[i];
+      }
+      queue->head = 0;
+      queue->tail = n - 1;
+      pthread_mutex_unlock(&queue->lock);
+      return stolen[0];
+    }
+    /* Victim ran dry in the meantime, so look again */
+  }
+}
+#endif
+
+
+Request_T
+#ifdef GSNAP
+Inbuffer_get_request (T this)
+#else
+Inbuffer_get_request (Sequence_T *pairalign_segment, T this) 
+#endif
+{
+  Request_T request;
+#if defined(HAVE_PTHREAD)
+  Localqueue_T queue;
+  Request_T batch[MAX_BATCH];
+  int n, i;
+
+  queue = get_queue(this);
+
+  pthread_mutex_lock(&queue->lock);
+  if (queue->head < queue->tail) {
+    request = queue->requests[queue->head++];
+    pthread_mutex_unlock(&queue->lock);
+#ifndef GSNAP
+    *pairalign_segment = this->pairalign_segment;
+#endif
+    return request;
+  }
+  queue->waitingp = true;
+  pthread_mutex_unlock(&queue->lock);
+
+  if (pthread_mutex_trylock(&this->lock) == 0) {
+    if (queue->batchsize > 1) {
+      queue->batchsize -= 1;
+    }
+  } else {
+    pthread_mutex_lock(&this->lock);
+    if ((queue->batchsize *= 2) > MAX_BATCH) {
+      queue->batchsize = MAX_BATCH;
+    }
+  }
+
+  pthread_mutex_lock(&queue->lock);
+  queue->waitingp = false;
+  pthread_mutex_unlock(&queue->lock);
+
+#ifndef GSNAP
+  if (user_pairalign_p == true) {
+    /* Each request goes with the usersegment read just before it */
+    queue->batchsize = 1;
+  }
+#endif
+
+  n = take_requests(batch,queue->batchsize,this,(void *) queue);
+#ifndef GSNAP
+  *pairalign_segment = this->pairalign_segment;
+#endif
+  pthread_mutex_unlock(&this->lock);
+
+  if (n == 0) {
+    /* Input is exhausted */
+    request = steal_requests(queue,this);
+
+  } else {
+    request = batch[0];
+    if (n > 1) {
+      pthread_mutex_lock(&queue->lock);
+      for (i = 1; i < n; i++) {
+	queue->requests[i-1] = batch[i];
+      }
+      queue->head = 0;
+      queue->tail = n - 1;
+      pthread_mutex_unlock(&queue->lock);
+    }
+  }
+
+#else
+  if (take_requests(&request,/*maxrequests*/1,this,/*self*/NULL) == 0) {
+    request = (Request_T) NULL;
+  }
+#ifndef GSNAP
+  *pairalign_segment = this->pairalign_segment;
+#endif
 #endif
 
   return request;
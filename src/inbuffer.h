@@ -18,12 +18,13 @@
 
 #ifdef GSNAP
 #include "shortread.h"
+#include "manifest.h"
 #else
 #include "sequence.h"
 #endif
 
 #ifdef HAVE_ZLIB
-#include <zlib.h>
+#include "bgzf.h"
 #endif
 
 #ifdef HAVE_BZLIB
@@ -66,7 +67,7 @@ Inbuffer_new (int nextchar,
 	      FILE *input2,
 #endif
 #ifdef HAVE_ZLIB
-	      gzFile gzipped, gzFile gzipped2,
+	      Bgzf_T gzipped, Bgzf_T gzipped2,
 #endif
 #ifdef HAVE_BZLIB
 	      Bzip2_T bzipped, Bzip2_T bzipped2,
@@ -82,6 +83,11 @@ Inbuffer_set_master (T this, Master_T master);
 extern void
 Inbuffer_set_outbuffer (T this, Outbuffer_T outbuffer);
 
+#if defined(GSNAP) && !defined(USE_MPI)
+extern void
+Inbuffer_set_manifest (T this, Manifest_T manifest, bool gunzip_p, bool bunzip2_p);
+#endif
+
 extern void
 Inbuffer_free (T *old);
 
@@ -116,7 +122,7 @@ extern int
 Inbuffer_master_process (int n_worker_ranks, int nextchar, int nchars1, int nchars2,
 			 FILE *input, FILE *input2,
 #ifdef HAVE_ZLIB
-			 gzFile gzipped, gzFile gzipped2,
+			 Bgzf_T gzipped, Bgzf_T gzipped2,
 #endif
 #ifdef HAVE_BZLIB
 			 Bzip2_T bzipped, Bzip2_T bzipped2,
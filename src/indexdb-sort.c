@@ -0,0 +1,287 @@
+static char rcsid[] = "$Id: indexdb-sort.c $";
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "indexdb-sort.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>		/* For memset and memcpy */
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "mem.h"
+
+
+#define POSITIONS8_HIGH_SHIFT 32
+#define POSITIONS8_LOW_MASK 0xFFFFFFFF
+
+/* Blocks at or below this size are cheaper to insertion sort than to
+   run through the 256-entry radix histograms */
+#define INSERTION_SORT_MAX 32
+
+
+static void
+insertion_sort_uint4 (UINT4 *x, Positionsptr_T n) {
+  Positionsptr_T i, j;
+  UINT4 value;
+
+  for (i = 1; i < n; i++) {
+    value = x[i];
+    for (j = i; j > 0 && x[j-1] > value; j--) {
+      x[j] = x[j-1];
+    }
+    x[j] = value;
+  }
+  return;
+}
+
+static void
+insertion_sort_uint8 (UINT8 *x, Positionsptr_T n) {
+  Positionsptr_T i, j;
+  UINT8 value;
+
+  for (i = 1; i < n; i++) {
+    value = x[i];
+    for (j = i; j > 0 && x[j-1] > value; j--) {
+      x[j] = x[j-1];
+    }
+    x[j] = value;
+  }
+  return;
+}
+
+
+/* LSD radix sort on 8-bit digits.  The histograms for all digits are
+   gathered in one pass, and a digit on which every value agrees is
+   skipped, which is common since the positions in a block often share
+   their high bytes.  Returns whichever of x or scratch holds the
+   result. */
+static UINT4 *
+radix_sort_uint4 (UINT4 *x, UINT4 *scratch, Positionsptr_T n) {
+  Positionsptr_T counts[4][256], total, count, i;
+  UINT4 *src = x, *dest = scratch, *temp;
+  int digit, shift, b;
+
+  memset(counts,0,4*256*sizeof(Positionsptr_T));
+  for (i = 0; i < n; i++) {
+    counts[0][x[i] & 0xFF] += 1;
+    counts[1][(x[i] >> 8) & 0xFF] += 1;
+    counts[2][(x[i] >> 16) & 0xFF] += 1;
+    counts[3][x[i] >> 24] += 1;
+  }
+
+  for (digit = 0, shift = 0; digit < 4; digit++, shift += 8) {
+    if (counts[digit][(x[0] >> shift) & 0xFF] != n) {
+      total = 0;
+      for (b = 0; b < 256; b++) {
+	count = counts[digit][b];
+	counts[digit][b] = total;
+	total += count;
+      }
+      for (i = 0; i < n; i++) {
+	dest[counts[digit][(src[i] >> shift) & 0xFF]++] = src[i];
+      }
+      temp = src; src = dest; dest = temp;
+    }
+  }
+
+  return src;
+}
+
+/* Keys hold at most 40 bits (8 high + 32 low) */
+static UINT8 *
+radix_sort_uint8 (UINT8 *x, UINT8 *scratch, Positionsptr_T n) {
+  Positionsptr_T counts[5][256], total, count, i;
+  UINT8 *src = x, *dest = scratch, *temp;
+  int digit, shift, b;
+
+  memset(counts,0,5*256*sizeof(Positionsptr_T));
+  for (i = 0; i < n; i++) {
+    for (digit = 0, shift = 0; digit < 5; digit++, shift += 8) {
+      counts[digit][(x[i] >> shift) & 0xFF] += 1;
+    }
+  }
+
+  for (digit = 0, shift = 0; digit < 5; digit++, shift += 8) {
+    if (counts[digit][(x[0] >> shift) & 0xFF] != n) {
+      total = 0;
+      for (b = 0; b < 256; b++) {
+	count = counts[digit][b];
+	counts[digit][b] = total;
+	total += count;
+      }
+      for (i = 0; i < n; i++) {
+	dest[counts[digit][(src[i] >> shift) & 0xFF]++] = src[i];
+      }
+      temp = src; src = dest; dest = temp;
+    }
+  }
+
+  return src;
+}
+
+
+typedef struct Sortjob_T *Sortjob_T;
+struct Sortjob_T {
+  UINT4 *positions4;
+  unsigned char *positions8_high;
+  UINT4 *positions8_low;
+  Positionsptr_T *offsets;
+  Oligospace_T start;
+  Oligospace_T end;
+};
+
+
+static Positionsptr_T
+max_blocksize (Positionsptr_T *offsets, Oligospace_T start, Oligospace_T end) {
+  Positionsptr_T maxsize = 0;
+  Oligospace_T oligoi;
+
+  for (oligoi = start; oligoi < end; oligoi++) {
+    if (offsets[oligoi+1] - offsets[oligoi] > maxsize) {
+      maxsize = offsets[oligoi+1] - offsets[oligoi];
+    }
+  }
+  return maxsize;
+}
+
+static void *
+sort_positions4_worker (void *data) {
+  Sortjob_T job = (Sortjob_T) data;
+  UINT4 *block, *scratch, *sorted;
+  Positionsptr_T npositions;
+  Oligospace_T oligoi;
+
+  scratch = (UINT4 *) MALLOC((max_blocksize(job->offsets,job->start,job->end) + 1)*sizeof(UINT4));
+  for (oligoi = job->start; oligoi < job->end; oligoi++) {
+    block = &(job->positions4[job->offsets[oligoi]]);
+    if ((npositions = job->offsets[oligoi+1] - job->offsets[oligoi]) <= INSERTION_SORT_MAX) {
+      insertion_sort_uint4(block,npositions);
+    } else if ((sorted = radix_sort_uint4(block,scratch,npositions)) != block) {
+      memcpy(block,sorted,npositions*sizeof(UINT4));
+    }
+  }
+  FREE(scratch);
+
+  return (void *) NULL;
+}
+
+static void *
+sort_positions8_worker (void *data) {
+  Sortjob_T job = (Sortjob_T) data;
+  UINT8 *keys, *scratch, *sorted;
+  unsigned char *high;
+  UINT4 *low;
+  Positionsptr_T npositions, maxsize, i;
+  Oligospace_T oligoi;
+
+  maxsize = max_blocksize(job->offsets,job->start,job->end) + 1;
+  keys = (UINT8 *) MALLOC(maxsize*sizeof(UINT8));
+  scratch = (UINT8 *) MALLOC(maxsize*sizeof(UINT8));
+  for (oligoi = job->start; oligoi < job->end; oligoi++) {
+    if ((npositions = job->offsets[oligoi+1] - job->offsets[oligoi]) > 1) {
+      high = &(job->positions8_high[job->offsets[oligoi]]);
+      low = &(job->positions8_low[job->offsets[oligoi]]);
+      for (i = 0; i < npositions; i++) {
+	keys[i] = ((UINT8) high[i] << POSITIONS8_HIGH_SHIFT) + low[i];
+      }
+      if (npositions <= INSERTION_SORT_MAX) {
+	insertion_sort_uint8(sorted = keys,npositions);
+      } else {
+	sorted = radix_sort_uint8(keys,scratch,npositions);
+      }
+      for (i = 0; i < npositions; i++) {
+	high[i] = sorted[i] >> POSITIONS8_HIGH_SHIFT;
+	low[i] = sorted[i] & POSITIONS8_LOW_MASK;
+      }
+    }
+  }
+  FREE(scratch);
+  FREE(keys);
+
+  return (void *) NULL;
+}
+
+
+/* Splits the oligospace into nthreads ranges holding roughly equal
+   numbers of positions, and runs worker on each */
+static void
+run_jobs (void *(*worker)(void *), UINT4 *positions4,
+	  unsigned char *positions8_high, UINT4 *positions8_low,
+	  Positionsptr_T *offsets, Oligospace_T oligospace, int nthreads) {
+  struct Sortjob_T *jobs;
+  Positionsptr_T total, target;
+  Oligospace_T oligoi;
+  int t;
+#ifdef HAVE_PTHREAD
+  pthread_t *threads;
+#endif
+
+#ifndef HAVE_PTHREAD
+  nthreads = 1;
+#endif
+  if (nthreads < 1) {
+    nthreads = 1;
+  }
+
+  jobs = (struct Sortjob_T *) MALLOC(nthreads*sizeof(struct Sortjob_T));
+  total = offsets[oligospace];
+  oligoi = 0;
+  for (t = 0; t < nthreads; t++) {
+    jobs[t].positions4 = positions4;
+    jobs[t].positions8_high = positions8_high;
+    jobs[t].positions8_low = positions8_low;
+    jobs[t].offsets = offsets;
+    jobs[t].start = oligoi;
+    if (t == nthreads - 1) {
+      oligoi = oligospace;
+    } else {
+      target = (Positionsptr_T) ((double) total * (t + 1) / nthreads);
+      while (oligoi < oligospace && offsets[oligoi] < target) {
+	oligoi++;
+      }
+    }
+    jobs[t].end = oligoi;
+  }
+
+#ifdef HAVE_PTHREAD
+  if (nthreads > 1) {
+    threads = (pthread_t *) MALLOC(nthreads*sizeof(pthread_t));
+    for (t = 0; t < nthreads; t++) {
+      if (pthread_create(&(threads[t]),NULL,worker,(void *) &(jobs[t])) != 0) {
+	fprintf(stderr,"Unable to create sorting thread %d\n",t);
+	exit(9);
+      }
+    }
+    for (t = 0; t < nthreads; t++) {
+      pthread_join(threads[t],NULL);
+    }
+    FREE(threads);
+    FREE(jobs);
+    return;
+  }
+#endif
+
+  (*worker)((void *) &(jobs[0]));
+  FREE(jobs);
+  return;
+}
+
+
+void
+Indexdb_sort_positions4 (UINT4 *positions4, Positionsptr_T *offsets, Oligospace_T oligospace,
+			 int nthreads) {
+  run_jobs(sort_positions4_worker,positions4,/*positions8_high*/NULL,/*positions8_low*/NULL,
+	   offsets,oligospace,nthreads);
+  return;
+}
+
+void
+Indexdb_sort_positions8 (unsigned char *positions8_high, UINT4 *positions8_low,
+			 Positionsptr_T *offsets, Oligospace_T oligospace, int nthreads) {
+  run_jobs(sort_positions8_worker,/*positions4*/NULL,positions8_high,positions8_low,
+	   offsets,oligospace,nthreads);
+  return;
+}
@@ -0,0 +1,15 @@
+/* $Id: indexdb-sort.h $ */
+#ifndef INDEXDB_SORT_INCLUDED
+#define INDEXDB_SORT_INCLUDED
+#include "types.h"
+
+/* Sorts the positions within each block [offsets[i]..offsets[i+1]) of
+   the oligospace, dividing the blocks among nthreads workers */
+extern void
+Indexdb_sort_positions4 (UINT4 *positions4, Positionsptr_T *offsets, Oligospace_T oligospace,
+			 int nthreads);
+extern void
+Indexdb_sort_positions8 (unsigned char *positions8_high, UINT4 *positions8_low,
+			 Positionsptr_T *offsets, Oligospace_T oligospace, int nthreads);
+
+#endif
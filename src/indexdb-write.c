@@ -2436,3 +2436,243 @@ Indexdb_write_positions_huge (char *positionsfile_high, char *positionsfile_low,
 #endif
 
 
+
+
+/************************************************************************
+ *   Merging -- called by gmapindex -M to append or replace chromosomes
+ *   without rebuilding the index for the whole genome
+ ************************************************************************/
+
+#ifndef PMAP
+/* Finds the base chromosome containing position and returns its
+   coordinate in the merged genome.  Returns false if the chromosome
+   is being replaced. */
+static bool
+merge_remap_position (Univcoord_T *newposition, Univcoord_T position,
+		      Univcoord_T *chrlows, Univcoord_T *chrhighs, Univcoord_T *newoffsets,
+		      bool *keepp, int nchromosomes) {
+  int low = 0, high = nchromosomes, middle;
+
+  while (low + 1 < high) {
+    middle = low + (high - low)/2;
+    if (chrlows[middle] <= position) {
+      low = middle;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (keepp[low] == false || position < chrlows[low] || position >= chrhighs[low]) {
+    return false;
+  } else {
+    *newposition = position - chrlows[low] + newoffsets[low];
+    return true;
+  }
+}
+
+static void
+merge_write_position (FILE *positions_high_fp, FILE *positions_low_fp, Univcoord_T position,
+		      bool coord_values_8p) {
+  unsigned char position8_high;
+  UINT4 position4;
+
+  if (coord_values_8p == true) {
+    position8_high = (unsigned char) (position >> POSITIONS8_HIGH_SHIFT);
+    position4 = (UINT4) (position & POSITIONS8_LOW_MASK);
+    FWRITE_CHAR(position8_high,positions_high_fp);
+    FWRITE_UINT(position4,positions_low_fp);
+  } else {
+    position4 = (UINT4) position;
+    FWRITE_UINT(position4,positions_low_fp);
+  }
+
+  return;
+}
+
+
+/* Positions within each k-mer bucket are written as the remapped base
+   positions followed by the shifted delta positions.  Since all delta
+   chromosomes are placed after the base chromosomes, and remapping
+   preserves order, each bucket stays sorted. */
+void
+Indexdb_merge_positions (char *pointersfile, char *offsetsfile,
+			 char *positionsfile_high, char *positionsfile_low,
+			 Filenames_T base_filenames, bool base_coord_values_8p,
+			 Univcoord_T *base_chrlows, Univcoord_T *base_chrhighs,
+			 Univcoord_T *base_newoffsets, bool *base_keepp, int base_nchromosomes,
+			 Filenames_T delta_filenames, bool delta_coord_values_8p, Univcoord_T delta_shift,
+			 Width_T index1part, bool coord_values_8p) {
+  FILE *positions_high_fp = NULL, *positions_low_fp;
+  Positionsptr_T *offsets;
+  Positionsptr_T base_block[MAX_BITPACK_BLOCKSIZE+1], delta_block[MAX_BITPACK_BLOCKSIZE+1], j;
+  UINT4 *base_meta, *base_strm, *delta_meta, *delta_strm;
+  unsigned char *base_positions8_high = NULL, *delta_positions8_high = NULL;
+  UINT4 *base_positions_low, *delta_positions_low;
+  int base_meta_fd, base_strm_fd, delta_meta_fd, delta_strm_fd;
+  int base_high_fd, base_low_fd, delta_high_fd, delta_low_fd;
+  size_t base_meta_len, base_strm_len, delta_meta_len, delta_strm_len;
+  size_t base_high_len, base_low_len, delta_high_len, delta_low_len;
+  Univcoord_T position, newposition;
+  UINT8 npositions = 0, ndropped = 0;
+  Oligospace_T oligospace, oligoi;
+  bool identityp = true;
+  int i;
+
+  if (base_filenames->pages_filename != NULL || delta_filenames->pages_filename != NULL) {
+    fprintf(stderr,"Merging is not supported for genomes whose offsets require a pages file.  Please rebuild with gmap_build.\n");
+    exit(9);
+  }
+
+  for (i = 0; i < base_nchromosomes; i++) {
+    if (base_keepp[i] == false || base_newoffsets[i] != base_chrlows[i]) {
+      identityp = false;
+    }
+  }
+
+  oligospace = power(4,index1part);
+  fprintf(stderr,"Allocating %llu*%d bytes for offsets\n",(unsigned long long) oligospace+1UL,(int) sizeof(Positionsptr_T));
+  offsets = (Positionsptr_T *) CALLOC_NO_EXCEPTION(oligospace+1,sizeof(Positionsptr_T));
+  if (offsets == NULL) {
+    fprintf(stderr,"Unable to allocate %llu bytes of memory, needed to merge offsets with %d-mers\n",
+	    (unsigned long long) oligospace+1UL,index1part);
+    exit(9);
+  }
+
+  base_meta = (UINT4 *) Access_mmap(&base_meta_fd,&base_meta_len,base_filenames->pointers_filename,sizeof(UINT4),/*randomp*/false);
+  base_strm = (UINT4 *) Access_mmap(&base_strm_fd,&base_strm_len,base_filenames->offsets_filename,sizeof(UINT4),/*randomp*/false);
+  delta_meta = (UINT4 *) Access_mmap(&delta_meta_fd,&delta_meta_len,delta_filenames->pointers_filename,sizeof(UINT4),/*randomp*/false);
+  delta_strm = (UINT4 *) Access_mmap(&delta_strm_fd,&delta_strm_len,delta_filenames->offsets_filename,sizeof(UINT4),/*randomp*/false);
+
+  if (base_coord_values_8p == true) {
+    base_positions8_high = (unsigned char *) Access_mmap(&base_high_fd,&base_high_len,base_filenames->positions_high_filename,
+							 sizeof(unsigned char),/*randomp*/false);
+  }
+  base_positions_low = (UINT4 *) Access_mmap(&base_low_fd,&base_low_len,base_filenames->positions_low_filename,
+					     sizeof(UINT4),/*randomp*/false);
+  if (delta_coord_values_8p == true) {
+    delta_positions8_high = (unsigned char *) Access_mmap(&delta_high_fd,&delta_high_len,delta_filenames->positions_high_filename,
+							  sizeof(unsigned char),/*randomp*/false);
+  }
+  delta_positions_low = (UINT4 *) Access_mmap(&delta_low_fd,&delta_low_len,delta_filenames->positions_low_filename,
+					      sizeof(UINT4),/*randomp*/false);
+
+  if (coord_values_8p == true) {
+    if ((positions_high_fp = FOPEN_WRITE_BINARY(positionsfile_high)) == NULL) {
+      fprintf(stderr,"Can't open file %s\n",positionsfile_high);
+      exit(9);
+    }
+  }
+  if ((positions_low_fp = FOPEN_WRITE_BINARY(positionsfile_low)) == NULL) {
+    fprintf(stderr,"Can't open file %s\n",positionsfile_low);
+    exit(9);
+  }
+
+  fprintf(stderr,"Merging positions (base %s, delta shifted by %llu)...",
+	  identityp == true ? "unchanged" : "remapped",(unsigned long long) delta_shift);
+  offsets[0] = 0U;
+  for (oligoi = 0UL; oligoi < oligospace; oligoi += 64) {
+    if (oligoi % MONITOR_INTERVAL == 0) {
+      fprintf(stderr,".");
+    }
+    Bitpack64_block_offsets(base_block,oligoi,base_meta,base_strm);
+    Bitpack64_block_offsets(delta_block,oligoi,delta_meta,delta_strm);
+
+    for (i = 0; i < 64; i++) {
+      for (j = base_block[i]; j < base_block[i+1]; j++) {
+#ifdef WORDS_BIGENDIAN
+	if (base_coord_values_8p == true) {
+	  position = ((Univcoord_T) base_positions8_high[j] << POSITIONS8_HIGH_SHIFT) + Bigendian_convert_uint(base_positions_low[j]);
+	} else {
+	  position = (Univcoord_T) Bigendian_convert_uint(base_positions_low[j]);
+	}
+#else
+	if (base_coord_values_8p == true) {
+	  position = ((Univcoord_T) base_positions8_high[j] << POSITIONS8_HIGH_SHIFT) + base_positions_low[j];
+	} else {
+	  position = (Univcoord_T) base_positions_low[j];
+	}
+#endif
+
+	if (identityp == true) {
+	  merge_write_position(positions_high_fp,positions_low_fp,position,coord_values_8p);
+	  npositions++;
+	} else if (merge_remap_position(&newposition,position,base_chrlows,base_chrhighs,base_newoffsets,
+					base_keepp,base_nchromosomes) == true) {
+	  merge_write_position(positions_high_fp,positions_low_fp,newposition,coord_values_8p);
+	  npositions++;
+	} else {
+	  ndropped++;
+	}
+      }
+
+      for (j = delta_block[i]; j < delta_block[i+1]; j++) {
+#ifdef WORDS_BIGENDIAN
+	if (delta_coord_values_8p == true) {
+	  position = ((Univcoord_T) delta_positions8_high[j] << POSITIONS8_HIGH_SHIFT) + Bigendian_convert_uint(delta_positions_low[j]);
+	} else {
+	  position = (Univcoord_T) Bigendian_convert_uint(delta_positions_low[j]);
+	}
+#else
+	if (delta_coord_values_8p == true) {
+	  position = ((Univcoord_T) delta_positions8_high[j] << POSITIONS8_HIGH_SHIFT) + delta_positions_low[j];
+	} else {
+	  position = (Univcoord_T) delta_positions_low[j];
+	}
+#endif
+	merge_write_position(positions_high_fp,positions_low_fp,position + delta_shift,coord_values_8p);
+	npositions++;
+      }
+
+      if (npositions > 4294967295UL) {
+	fprintf(stderr,"\nMerged genome has more than 2^32 k-mer positions and requires a pages file.  Please rebuild with gmap_build.\n");
+	exit(9);
+      }
+      offsets[oligoi+i+1] = (Positionsptr_T) npositions;
+    }
+  }
+  fprintf(stderr,"done.  Wrote %llu positions, dropped %llu from replaced chromosomes\n",
+	  (unsigned long long) npositions,(unsigned long long) ndropped);
+
+  fclose(positions_low_fp);
+  if (coord_values_8p == true) {
+    fclose(positions_high_fp);
+  }
+
+  munmap((void *) delta_positions_low,delta_low_len);
+  close(delta_low_fd);
+  if (delta_coord_values_8p == true) {
+    munmap((void *) delta_positions8_high,delta_high_len);
+    close(delta_high_fd);
+  }
+  munmap((void *) base_positions_low,base_low_len);
+  close(base_low_fd);
+  if (base_coord_values_8p == true) {
+    munmap((void *) base_positions8_high,base_high_len);
+    close(base_high_fd);
+  }
+
+  munmap((void *) delta_strm,delta_strm_len);
+  munmap((void *) delta_meta,delta_meta_len);
+  close(delta_strm_fd);
+  close(delta_meta_fd);
+  munmap((void *) base_strm,base_strm_len);
+  munmap((void *) base_meta,base_meta_len);
+  close(base_strm_fd);
+  close(base_meta_fd);
+
+  fprintf(stderr,"Writing %llu offsets compressed via bitpack64 to file with total of %llu k-mers...",
+	  (unsigned long long) oligospace+1UL,(unsigned long long) offsets[oligospace]);
+  Bitpack64_write_differential(pointersfile,offsetsfile,offsets,oligospace);
+  if (offsets[oligospace] == 0) {
+    /* Don't check bitpack, which will crash on an empty file */
+  } else {
+    fprintf(stderr,"Checking bitpack...");
+    check_offsets_from_bitpack(pointersfile,offsetsfile,offsets,oligospace,/*blocksize*/64);
+  }
+  fprintf(stderr,"done\n");
+
+  FREE(offsets);
+
+  return;
+}
+#endif
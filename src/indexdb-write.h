@@ -8,6 +8,7 @@
 #include "bool.h"
 #include "types.h"		/* For Oligospace_T */
 #include "iit-read-univ.h"
+#include "indexdb.h"		/* For Filenames_T */
 
 #ifdef PMAP
 #include "alphabet.h"
@@ -82,5 +83,16 @@ Indexdb_write_positions_huge (char *positionsfile_high, char *positionsfile_low,
 			      bool coord_values_8p);
 #endif
 
+#ifndef PMAP
+extern void
+Indexdb_merge_positions (char *pointersfile, char *offsetsfile,
+			 char *positionsfile_high, char *positionsfile_low,
+			 Filenames_T base_filenames, bool base_coord_values_8p,
+			 Univcoord_T *base_chrlows, Univcoord_T *base_chrhighs,
+			 Univcoord_T *base_newoffsets, bool *base_keepp, int base_nchromosomes,
+			 Filenames_T delta_filenames, bool delta_coord_values_8p, Univcoord_T delta_shift,
+			 Width_T index1part, bool coord_values_8p);
+#endif
+
 #endif
 
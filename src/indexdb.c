@@ -198,6 +198,13 @@ Indexdb_free (T *old) {
       abort();
     }
 
+#ifdef HAVE_MMAP
+    if ((*old)->kmerclass_header != NULL) {
+      munmap((void *) (*old)->kmerclass_header,(*old)->kmerclass_len);
+      close((*old)->kmerclass_fd);
+    }
+#endif
+
 #ifdef LARGE_GENOMES
     if ((*old)->offsetspages_access == ALLOCATED_PRIVATE) {
       FREE((*old)->offsetspages);
@@ -1076,6 +1083,154 @@ Indexdb_shmem_remove (char *genomesubdir, char *fileroot, char *idx_filesuffix,
 }
 
 
+#ifndef PMAP
+/************************************************************************
+ *   K-mer class sketch.  gmapindex -Q records a 2-bit count class for
+ *   every oligo (absent, unique, or multiple), so that the reads and
+ *   counts of stage 1 can answer absent and unique oligos from one
+ *   byte, without decoding offsets.  The file is a header of
+ *   KMERCLASS_HEADER_NUINT4 words (index1part, index1interval,
+ *   reserved, version) followed by 4^index1part/4 bytes.  Version 0
+ *   files also had a repetitive class, which nothing used, and are
+ *   ignored.
+ ************************************************************************/
+
+#define KMERCLASS_HEADER_NUINT4 4
+#define KMERCLASS_VERSION 1
+
+static char *
+kmerclass_filename (char *genomesubdir, char *fileroot, char *idx_filesuffix,
+		    Width_T index1part, Width_T index1interval) {
+  char *filename;
+
+  filename = (char *) CALLOC(strlen(genomesubdir)+strlen("/")+strlen(fileroot)+strlen(".")+strlen(idx_filesuffix)+
+			     /*for kmer*/2+/*for interval char*/1+
+			     strlen(KMERCLASS_FILESUFFIX)+1,sizeof(char));
+  sprintf(filename,"%s/%s.%s%02d%c%s",
+	  genomesubdir,fileroot,idx_filesuffix,index1part,'0'+index1interval,KMERCLASS_FILESUFFIX);
+  return filename;
+}
+
+#ifdef HAVE_MMAP
+static void
+kmerclass_setup (T this, char *genomesubdir, char *fileroot, char *idx_filesuffix) {
+  char *filename;
+  size_t expected_len;
+  UINT4 header_index1part, header_index1interval, version;
+
+  filename = kmerclass_filename(genomesubdir,fileroot,idx_filesuffix,this->index1part,this->index1interval);
+  if (Access_file_exists_p(filename) == false) {
+    FREE(filename);
+    return;
+  }
+
+  this->kmerclass_header = (UINT4 *) Access_mmap(&this->kmerclass_fd,&this->kmerclass_len,filename,
+						 sizeof(UINT4),/*randomp*/true);
+  if (this->kmerclass_header == NULL || this->kmerclass_len < KMERCLASS_HEADER_NUINT4*sizeof(UINT4)) {
+    fprintf(stderr,"K-mer class file %s is not valid\n",filename);
+    exit(9);
+  }
+
+#ifdef WORDS_BIGENDIAN
+  header_index1part = Bigendian_convert_uint(this->kmerclass_header[0]);
+  header_index1interval = Bigendian_convert_uint(this->kmerclass_header[1]);
+  version = Bigendian_convert_uint(this->kmerclass_header[3]);
+#else
+  header_index1part = this->kmerclass_header[0];
+  header_index1interval = this->kmerclass_header[1];
+  version = this->kmerclass_header[3];
+#endif
+  if (version != KMERCLASS_VERSION) {
+    fprintf(stderr,"Ignoring k-mer class file %s from an older gmapindex.  Rebuild it with gmap_build --build-kmerclasses=1\n",
+	    filename);
+    munmap((void *) this->kmerclass_header,this->kmerclass_len);
+    close(this->kmerclass_fd);
+    this->kmerclass_header = (UINT4 *) NULL;
+    FREE(filename);
+    return;
+  }
+
+  expected_len = KMERCLASS_HEADER_NUINT4*sizeof(UINT4) + (power(4,this->index1part) + 3)/4;
+  if (header_index1part != (UINT4) this->index1part || header_index1interval != (UINT4) this->index1interval ||
+      this->kmerclass_len != expected_len) {
+    fprintf(stderr,"K-mer class file %s does not match the index (kmer %u, interval %u, length %llu)\n",
+	    filename,header_index1part,header_index1interval,(unsigned long long) this->kmerclass_len);
+    exit(9);
+  }
+
+  this->kmerclasses = (unsigned char *) &(this->kmerclass_header[KMERCLASS_HEADER_NUINT4]);
+  fprintf(stderr,"Using k-mer class file %s\n",filename);
+  FREE(filename);
+
+  return;
+}
+#endif
+
+
+/* Called by gmapindex */
+void
+Indexdb_write_kmerclasses (char *destdir, char *fileroot, char *idx_filesuffix, T this) {
+  char *filename;
+  FILE *fp;
+  unsigned char *classes, *saved_classes;
+  Oligospace_T oligospace, oligo;
+  UINT4 header[KMERCLASS_HEADER_NUINT4];
+  int nentries, class, i;
+  Oligospace_T counts[3];
+#ifdef LARGE_GENOMES
+  unsigned char *positions_high;
+#endif
+
+  oligospace = power(4,this->index1part);
+  classes = (unsigned char *) CALLOC((oligospace + 3)/4,sizeof(unsigned char));
+  saved_classes = this->kmerclasses;
+  this->kmerclasses = (unsigned char *) NULL; /* Count from the offsets, not from a previous sketch */
+  counts[0] = counts[1] = counts[2] = 0;
+  for (oligo = 0; oligo < oligospace; oligo++) {
+#ifdef LARGE_GENOMES
+    Indexdb_read_inplace(&nentries,&positions_high,this,oligo);
+#else
+    Indexdb_read_inplace(&nentries,this,oligo);
+#endif
+    if (nentries == 0) {
+      class = KMERCLASS_ABSENT;
+    } else if (nentries == 1) {
+      class = KMERCLASS_UNIQUE;
+    } else {
+      class = KMERCLASS_MULTIPLE;
+    }
+    classes[oligo >> 2] |= (unsigned char) (class << ((oligo & 0x3) << 1));
+    counts[class] += 1;
+  }
+  this->kmerclasses = saved_classes;
+
+  header[0] = this->index1part;
+  header[1] = this->index1interval;
+  header[2] = 0;
+  header[3] = KMERCLASS_VERSION;
+
+  filename = kmerclass_filename(destdir,fileroot,idx_filesuffix,this->index1part,this->index1interval);
+  if ((fp = FOPEN_WRITE_BINARY(filename)) == NULL) {
+    fprintf(stderr,"Can't open file %s for writing\n",filename);
+    exit(9);
+  }
+  for (i = 0; i < KMERCLASS_HEADER_NUINT4; i++) {
+    FWRITE_UINT(header[i],fp);
+  }
+  fwrite(classes,sizeof(unsigned char),(oligospace + 3)/4,fp);
+  fclose(fp);
+
+  fprintf(stderr,"Wrote %s: %llu absent, %llu unique, %llu multiple oligos\n",
+	  filename,(unsigned long long) counts[0],(unsigned long long) counts[1],
+	  (unsigned long long) counts[2]);
+  FREE(filename);
+  FREE(classes);
+
+  return;
+}
+#endif
+
+
 T
 Indexdb_new_genome (Width_T *index1part, Width_T *index1interval,
 		    char *genomesubdir, char *fileroot, char *idx_filesuffix, char *snps_root,
@@ -1565,6 +1720,18 @@ Indexdb_new_genome (Width_T *index1part, Width_T *index1interval,
   }
 #endif
 
+  new->kmerclass_header = (UINT4 *) NULL;
+  new->kmerclasses = (unsigned char *) NULL;
+#if !defined(PMAP) && defined(HAVE_MMAP)
+  /* The sketch is built from the reference offsets.  A SNP-tolerant
+     index also has positions for alternate alleles, so an oligo absent
+     or unique in the reference may not be in it, and the sketch would
+     drop real hits. */
+  if (snps_root == NULL) {
+    kmerclass_setup(new,genomesubdir,fileroot,idx_filesuffix);
+  }
+#endif
+
   Filenames_free(&filenames);
 
   return new;
@@ -2159,6 +2326,12 @@ Indexdb_read (int *nentries, T this, Storedoligomer_T oligo) {
     return NULL;
   }
 
+  /* Absent oligos need no offsets lookup */
+  if (this->kmerclasses != NULL && kmerclass_get(this->kmerclasses,part0) == KMERCLASS_ABSENT) {
+    *nentries = 0;
+    return NULL;
+  }
+
   if (this->compression_type == NO_COMPRESSION) {
 #ifdef WORDS_BIGENDIAN
     /* Also holds for ALLOCATED_PRIVATE and ALLOCATED_SHARED */
@@ -2308,6 +2481,12 @@ Indexdb_read_inplace (int *nentries,
   }
 #endif
 
+  /* Absent oligos need no offsets lookup */
+  if (this->kmerclasses != NULL && kmerclass_get(this->kmerclasses,part0) == KMERCLASS_ABSENT) {
+    *nentries = 0;
+    return NULL;
+  }
+
   if (this->compression_type == NO_COMPRESSION) {
 #ifdef WORDS_BIGENDIAN
     /* Also holds for ALLOCATED_PRIVATE and ALLOCATED_SHARED */
@@ -2622,6 +2801,9 @@ Indexdb_new_segment (char *genomicseg,
 #endif
   new->index1interval = 1;
 
+  new->kmerclass_header = (UINT4 *) NULL;
+  new->kmerclasses = (unsigned char *) NULL;
+
   new->compression_type = NO_COMPRESSION;
 
   new->offsetsmeta = (UINT4 *) CALLOC(oligospace+1,sizeof(UINT4));
@@ -37,6 +37,12 @@
 #define OFFSETS_FILESUFFIX "offsets"
 #define POSITIONS_HIGH_FILESUFFIX "positionsh"
 #define POSITIONS_LOW_FILESUFFIX "positions"
+#define KMERCLASS_FILESUFFIX "kmerclass"
+
+/* Count classes in the k-mer class sketch */
+#define KMERCLASS_ABSENT 0
+#define KMERCLASS_UNIQUE 1
+#define KMERCLASS_MULTIPLE 2
 
 
 #define T Indexdb_T
@@ -169,6 +175,8 @@ Indexdb_read_inplace (int *nentries,
 		      unsigned char **positions_high,
 #endif
 		      T this, Storedoligomer_T oligo);
+extern void
+Indexdb_write_kmerclasses (char *destdir, char *fileroot, char *idx_filesuffix, T this);
 #endif
 
 extern Univcoord_T *
@@ -805,10 +805,35 @@ shortoligo_nt (Storedoligomer_T oligo, int oligosize) {
 #endif
 
 
+/* Counts oligos from subst to subst+nadjacent-1 from the k-mer class
+   sketch.  Returns false if any of them has multiple positions, in
+   which case the offsets are needed. */
+static bool
+kmerclass_count (int *nentries, unsigned char *classes, Storedoligomer_T subst, int nadjacent) {
+  Storedoligomer_T oligo;
+  int class;
+
+  *nentries = 0;
+  for (oligo = subst; oligo < subst + nadjacent; oligo++) {
+    if ((class = kmerclass_get(classes,oligo)) == KMERCLASS_MULTIPLE) {
+      return false;
+    } else if (class == KMERCLASS_UNIQUE) {
+      *nentries += 1;
+    }
+  }
+  return true;
+}
+
+
 #ifdef LARGE_GENOMES
 static int
 count_one_shift (T this, Storedoligomer_T subst, int nadjacent) {
   Positionsptr_T ptr0, end0;
+  int nentries;
+
+  if (this->kmerclasses != NULL && kmerclass_count(&nentries,this->kmerclasses,subst,nadjacent) == true) {
+    return nentries;
+  }
 
   if (this->compression_type == NO_COMPRESSION) {
 #ifdef WORDS_BIGENDIAN
@@ -846,6 +871,11 @@ count_one_shift (T this, Storedoligomer_T subst, int nadjacent) {
 static int
 count_one_shift (T this, Storedoligomer_T subst, int nadjacent) {
   Positionsptr_T ptr0, end0;
+  int nentries;
+
+  if (this->kmerclasses != NULL && kmerclass_count(&nentries,this->kmerclasses,subst,nadjacent) == true) {
+    return nentries;
+  }
 
   if (this->compression_type == NO_COMPRESSION) {
 #ifdef WORDS_BIGENDIAN
@@ -1845,6 +1875,11 @@ Indexdb_merge_compoundpos (int *nmerged, Compoundpos_T compoundpos, int diagterm
 int
 Indexdb_count_no_subst (T this, Storedoligomer_T oligo) {
   Positionsptr_T ptr0, end0;
+  int class;
+
+  if (this->kmerclasses != NULL && (class = kmerclass_get(this->kmerclasses,oligo)) != KMERCLASS_MULTIPLE) {
+    return class;		/* KMERCLASS_ABSENT is 0 and KMERCLASS_UNIQUE is 1 */
+  }
 
   if (this->compression_type == NO_COMPRESSION) {
 #ifdef WORDS_BIGENDIAN
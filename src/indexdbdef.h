@@ -20,6 +20,9 @@
 #define NO_COMPRESSION 0
 #define BITPACK64_COMPRESSION 1
 
+/* Class of an oligo in the k-mer class sketch */
+#define kmerclass_get(classes,oligo) (((classes)[(oligo) >> 2] >> (((oligo) & 0x3) << 1)) & 0x3)
+
 
 #define T Indexdb_T
 struct T {
@@ -70,6 +73,12 @@ struct T {
   UINT4 *positions;		/* For small genomes, same as Univcoord_T */
 #endif
 
+  /* Optional k-mer class sketch, 2 bits per oligo, read with kmerclass_get */
+  int kmerclass_fd;
+  size_t kmerclass_len;
+  UINT4 *kmerclass_header;
+  unsigned char *kmerclasses;
+
 #ifdef HAVE_PTHREAD
   pthread_mutex_t positions_read_mutex;
 #endif
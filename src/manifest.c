@@ -0,0 +1,194 @@
+static char rcsid[] = "$Id: manifest.c $";
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "manifest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>		/* For isspace */
+#include "mem.h"
+#include "fopen.h"
+#include "list.h"
+
+
+/* A manifest lists one sample per line:
+
+       <sample> <fastq1> [<fastq2>|-] [<read-group-id>]
+
+   separated by tabs or spaces.  Blank lines and lines starting with
+   '#' are ignored.  The read group defaults to the sample name. */
+
+#define BUFFERSIZE 8192
+#define MAXFIELDS 4
+
+#define T Manifest_T
+struct T {
+  int nsamples;
+  char **samples;
+  char **read_group_ids;
+  char ***files;		/* files[i] holds nfiles[i] names */
+  int *nfiles;
+};
+
+
+int
+Manifest_nsamples (T this) {
+  return this->nsamples;
+}
+
+char *
+Manifest_sample (T this, int sampleid) {
+  return this->samples[sampleid];
+}
+
+char *
+Manifest_read_group_id (T this, int sampleid) {
+  return this->read_group_ids[sampleid];
+}
+
+char **
+Manifest_files (int *nfiles, T this, int sampleid) {
+  *nfiles = this->nfiles[sampleid];
+  return this->files[sampleid];
+}
+
+
+static char *
+copy_string (char *string) {
+  char *copy;
+
+  copy = (char *) MALLOC((strlen(string)+1)*sizeof(char));
+  strcpy(copy,string);
+  return copy;
+}
+
+/* Splits line in place.  Returns number of fields, or MAXFIELDS+1 if too many. */
+static int
+split_fields (char **fields, char *line) {
+  int nfields = 0;
+  char *p = line;
+
+  while (*p != '\0') {
+    while (*p != '\0' && isspace(*p)) {
+      p++;
+    }
+    if (*p == '\0') {
+      return nfields;
+    } else if (nfields == MAXFIELDS) {
+      return MAXFIELDS + 1;
+    } else {
+      fields[nfields++] = p;
+      while (*p != '\0' && !isspace(*p)) {
+	p++;
+      }
+      if (*p != '\0') {
+	*p++ = '\0';
+      }
+    }
+  }
+
+  return nfields;
+}
+
+
+T
+Manifest_read (char *filename) {
+  T new;
+  FILE *fp;
+  char Buffer[BUFFERSIZE], *fields[MAXFIELDS], **files;
+  List_T samples = NULL, read_group_ids = NULL, filelists = NULL, p;
+  int nfields, linenum = 0, i;
+
+  if ((fp = FOPEN_READ_TEXT(filename)) == NULL) {
+    fprintf(stderr,"Cannot open manifest file %s\n",filename);
+    exit(9);
+  }
+
+  while (fgets(Buffer,BUFFERSIZE,fp) != NULL) {
+    linenum++;
+    if (strchr(Buffer,'\n') == NULL && !feof(fp)) {
+      fprintf(stderr,"Line %d of manifest %s exceeds %d characters\n",linenum,filename,BUFFERSIZE);
+      exit(9);
+    }
+
+    if ((nfields = split_fields(fields,Buffer)) == 0 || fields[0][0] == '#') {
+      /* Skip blank line or comment */
+
+    } else if (nfields < 2 || nfields > MAXFIELDS) {
+      fprintf(stderr,"Line %d of manifest %s should have 2 to %d fields: <sample> <fastq1> [<fastq2>|-] [<read-group-id>]\n",
+	      linenum,filename,MAXFIELDS);
+      exit(9);
+
+    } else {
+      for (p = samples; p != NULL; p = List_next(p)) {
+	if (!strcmp((char *) List_head(p),fields[0])) {
+	  fprintf(stderr,"Sample %s appears more than once in manifest %s\n",fields[0],filename);
+	  exit(9);
+	}
+      }
+      samples = List_push(samples,(void *) copy_string(fields[0]));
+      read_group_ids = List_push(read_group_ids,(void *) copy_string(nfields == 4 ? fields[3] : fields[0]));
+
+      files = (char **) CALLOC(2,sizeof(char *));
+      files[0] = copy_string(fields[1]);
+      if (nfields >= 3 && strcmp(fields[2],"-")) {
+	files[1] = copy_string(fields[2]);
+      }
+      filelists = List_push(filelists,(void *) files);
+    }
+  }
+  fclose(fp);
+
+  if (samples == NULL) {
+    fprintf(stderr,"Manifest %s lists no samples\n",filename);
+    exit(9);
+  }
+
+  new = (T) MALLOC(sizeof(*new));
+  samples = List_reverse(samples);
+  read_group_ids = List_reverse(read_group_ids);
+  filelists = List_reverse(filelists);
+
+  new->nsamples = List_length(samples);
+  new->samples = (char **) List_to_array(samples,NULL);
+  new->read_group_ids = (char **) List_to_array(read_group_ids,NULL);
+  new->files = (char ***) CALLOC(new->nsamples,sizeof(char **));
+  new->nfiles = (int *) CALLOC(new->nsamples,sizeof(int));
+  for (p = filelists, i = 0; p != NULL; p = List_next(p), i++) {
+    new->files[i] = (char **) List_head(p);
+    new->nfiles[i] = (new->files[i][1] == NULL) ? 1 : 2;
+  }
+
+  List_free(&filelists);
+  List_free(&read_group_ids);
+  List_free(&samples);
+
+  return new;
+}
+
+
+void
+Manifest_free (T *old) {
+  int i;
+
+  if (*old) {
+    for (i = 0; i < (*old)->nsamples; i++) {
+      FREE((*old)->files[i][0]);
+      if ((*old)->nfiles[i] > 1) {
+	FREE((*old)->files[i][1]);
+      }
+      FREE((*old)->files[i]);
+      FREE((*old)->read_group_ids[i]);
+      FREE((*old)->samples[i]);
+    }
+    FREE((*old)->nfiles);
+    FREE((*old)->files);
+    FREE((*old)->read_group_ids);
+    FREE((*old)->samples);
+    FREE(*old);
+  }
+  return;
+}
+
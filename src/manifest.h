@@ -0,0 +1,24 @@
+/* $Id: manifest.h $ */
+#ifndef MANIFEST_INCLUDED
+#define MANIFEST_INCLUDED
+
+#define T Manifest_T
+typedef struct T *T;
+
+extern int
+Manifest_nsamples (T this);
+extern char *
+Manifest_sample (T this, int sampleid);
+extern char *
+Manifest_read_group_id (T this, int sampleid);
+extern char **
+Manifest_files (int *nfiles, T this, int sampleid);
+
+extern T
+Manifest_read (char *filename);
+extern void
+Manifest_free (T *old);
+
+#undef T
+#endif
+
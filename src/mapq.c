@@ -97,6 +97,27 @@ MAPQ_max_quality_score (char *quality_string, int querylength) {
 
 
 
+/* As MAPQ_max_quality_score, but without warnings, for the result
+   cache to key on */
+int
+MAPQ_max_quality_score_quiet (char *quality_string, int querylength) {
+  int max_quality_score = 1;
+  int Q;
+  int querypos;
+
+  if (quality_string == NULL) {
+    return MAX_QUALITY_SCORE;
+  } else {
+    for (querypos = 0; querypos < querylength; querypos++) {
+      if ((Q = quality_string[querypos] - quality_score_adj) > max_quality_score) {
+	max_quality_score = Q;
+      }
+    }
+    return (max_quality_score > MAX_QUALITY_SCORE) ? MAX_QUALITY_SCORE : max_quality_score;
+  }
+}
+
+
 float
 MAPQ_loglik_exact (char *quality_string, int querystart, int queryend) {
 
@@ -14,6 +14,8 @@ extern void
 MAPQ_init (int quality_score_adj_in);
 extern int
 MAPQ_max_quality_score (char *quality_string, int querylength);
+extern int
+MAPQ_max_quality_score_quiet (char *quality_string, int querylength);
 extern float
 MAPQ_loglik_exact (char *quality_string, int querystart, int queryend);
 extern float
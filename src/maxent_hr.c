@@ -6,6 +6,15 @@ static char rcsid[] = "$Id: maxent_hr.c 99737 2013-06-27 19:33:03Z twu $";
 #include "maxent_hr.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>		/* For close */
+#include <sys/mman.h>		/* For munmap */
+#include "bool.h"
+#include "mem.h"
+#include "fopen.h"
+#include "access.h"
+#include "popcount.h"
+#include "genome.h"		/* For BLOCK_HIGH */
 
 
 #define DONOR_MODEL_LEFT_MARGIN 3 /* Amount in exon.  Does not include GT */
@@ -22,6 +31,7 @@ static char rcsid[] = "$Id: maxent_hr.c 99737 2013-06-27 19:33:03Z twu $";
 #endif
 
 
+
 static const double donor_score_plus[16384] =
 {1.4359596e-01, 2.3564868e-01, 6.8940261e-02, 2.2479970e-02, 1.9498629e-02, 1.8962596e-02, 6.5353213e-03, 7.5289169e-03,
  1.1135722e-02, 2.4760753e-02, 2.9084585e-03, 3.7937509e-03, 5.6493183e-03, 7.9177177e-03, 1.6257963e-03, 1.5311906e-03,
@@ -24707,8 +24717,8 @@ print_blocks (Genomecomp_T *blocks, int nblocks) {
 
   while (ptr < nblocks*3) {
     printf("high: %08X  low: %08X  flags: %08X\t",
-	   blocks[ptr],blocks[ptr+1],blocks[ptr+2]);
-    write_chars(blocks[ptr],blocks[ptr+1],blocks[ptr+2]);
+	   BLOCK_HIGH(blocks,ptr),BLOCK_LOW(blocks,ptr),BLOCK_FLAGS(blocks,ptr));
+    write_chars(BLOCK_HIGH(blocks,ptr),BLOCK_LOW(blocks,ptr),BLOCK_FLAGS(blocks,ptr));
     printf("\n");
     ptr += 3;
   }
@@ -24732,11 +24742,11 @@ Genome_print_blocks (Genomecomp_T *blocks, Univcoord_T startpos, Univcoord_T end
   
   for (ptr = startblock ; ptr <= endblock; ptr += 3) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     printf("high: %08X  low: %08X  flags: %08X\t",high,low,flags);
     write_chars(high,low,flags);
@@ -24770,18 +24780,18 @@ donor_prob_plus (Univcoord_T startpos, Genomecomp_T *blocks) {
   /* Get 9-mer at startpos+0.  Want 3 bits, then skip 2, then 4 bits. */
   if (shift <= 7) {
 #ifdef WORDS_BIGENDIAN
-    low = Bigendian_convert_uint(blocks[ptr+1]);
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-    low = blocks[ptr+1];
+    low = BLOCK_LOW(blocks,ptr);
 #endif
     seq = low >> (2 * shift);
 
   } else if (shift <= 15) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr);
 #endif
 
     seq = low >> (2 * shift);
@@ -24789,19 +24799,19 @@ donor_prob_plus (Univcoord_T startpos, Genomecomp_T *blocks) {
 
   } else if (shift <= 23) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
 #else
-    high = blocks[ptr];
+    high = BLOCK_HIGH(blocks,ptr);
 #endif
 
     seq = high >> (2 * (shift - 16));
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    nextlow = Bigendian_convert_uint(blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr+3));
 #else
-    high = blocks[ptr]; nextlow = blocks[ptr+4];
+    high = BLOCK_HIGH(blocks,ptr); nextlow = BLOCK_LOW(blocks,ptr+3);
 #endif
 
     seq = high >> (2 * (shift - 16));
@@ -25173,13 +25183,13 @@ acceptor_prob_plus (Univcoord_T startpos, Genomecomp_T *blocks) {
   debug(printf("startpos is %u, shift is %d\n",startpos,shift));
 
 #ifdef WORDS_BIGENDIAN
-  high = Bigendian_convert_uint(blocks[ptr]);
-  low = Bigendian_convert_uint(blocks[ptr+1]);
-  nexthigh = Bigendian_convert_uint(blocks[ptr+3]);
-  nextlow = Bigendian_convert_uint(blocks[ptr+4]);
+  high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+  low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+  nexthigh = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr+3));
+  nextlow = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr+3));
 #else
-  high = blocks[ptr]; low = blocks[ptr+1];
-  nexthigh = blocks[ptr+3]; nextlow = blocks[ptr+4];
+  high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr);
+  nexthigh = BLOCK_HIGH(blocks,ptr+3); nextlow = BLOCK_LOW(blocks,ptr+3);
 #endif
 
 
@@ -25994,18 +26004,18 @@ donor_prob_minus (Univcoord_T startpos, Genomecomp_T *blocks) {
   /* On minus strand, want 4 bits, then skip 2, then 3 bits. */
   if (shift <= 7) {
 #ifdef WORDS_BIGENDIAN
-    low = Bigendian_convert_uint(blocks[ptr+1]);
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-    low = blocks[ptr+1];
+    low = BLOCK_LOW(blocks,ptr);
 #endif
     seq = low >> (2 * shift);
 
   } else if (shift <= 15) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr);
 #endif
 
     seq = low >> (2 * shift);
@@ -26013,19 +26023,19 @@ donor_prob_minus (Univcoord_T startpos, Genomecomp_T *blocks) {
 
   } else if (shift <= 23) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
 #else
-    high = blocks[ptr];
+    high = BLOCK_HIGH(blocks,ptr);
 #endif
 
     seq = high >> (2 * (shift - 16));
 
   } else {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    nextlow = Bigendian_convert_uint(blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr+3));
 #else
-    high = blocks[ptr]; nextlow = blocks[ptr+4];
+    high = BLOCK_HIGH(blocks,ptr); nextlow = BLOCK_LOW(blocks,ptr+3);
 #endif
 
     seq = high >> (2 * (shift - 16));
@@ -26396,13 +26406,13 @@ acceptor_prob_minus (Univcoord_T startpos, Genomecomp_T *blocks) {
   debug(printf("startpos is %u, shift is %d\n",startpos,shift));
 
 #ifdef WORDS_BIGENDIAN
-  high = Bigendian_convert_uint(blocks[ptr]);
-  low = Bigendian_convert_uint(blocks[ptr+1]);
-  nexthigh = Bigendian_convert_uint(blocks[ptr+3]);
-  nextlow = Bigendian_convert_uint(blocks[ptr+4]);
+  high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+  low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+  nexthigh = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr+3));
+  nextlow = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr+3));
 #else
-  high = blocks[ptr]; low = blocks[ptr+1];
-  nexthigh = blocks[ptr+3]; nextlow = blocks[ptr+4];
+  high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr);
+  nexthigh = BLOCK_HIGH(blocks,ptr+3); nextlow = BLOCK_LOW(blocks,ptr+3);
 #endif
 
 
@@ -27201,6 +27211,77 @@ Maxent_hr_setup (Genomecomp_T *ref_blocks_in, Genomecomp_T *snp_blocks_in) {
   return;
 }
 
+/************************************************************************
+ *   Precomputed score track, written by gmapindex -J
+ *
+ *   Each side of a splice site has a bit vector over genomic
+ *   positions marking canonical dinucleotides, a rank array holding
+ *   the number of marked positions before each 32-bit word, and a
+ *   16-bit entry for each marked position.  The high bit of an entry
+ *   gives the model, and the low 15 bits give the quantized
+ *   probability.
+ *
+ *   Right side, dinucleotide at splice_pos: GT or GC (donor), CT (antiacceptor)
+ *   Left side, dinucleotide at splice_pos - 2: AG (acceptor), AC or GC (antidonor)
+ ************************************************************************/
+
+#define TRACK_FILESUFFIX "splicescores"
+#define TRACK_HEADER_NUINT4 4
+#define TRACK_TYPE_SHIFT 15
+#define TRACK_PROB_MASK 0x7FFF
+#define TRACK_PROB_SCALE 32767.0
+
+#define TRACK_DONOR 0
+#define TRACK_ANTIACCEPTOR 1
+#define TRACK_ACCEPTOR 0
+#define TRACK_ANTIDONOR 1
+
+#if defined(HAVE_BUILTIN_POPCOUNT)
+#define popcount_ones(diff) (__builtin_popcount(diff))
+#else
+#define popcount_ones(diff) (count_bits[diff & 0x0000FFFF] + count_bits[diff >> 16])
+#endif
+
+static bool track_p = false;
+static UINT4 *track;
+static int track_fd;
+static size_t track_len;
+static Univcoord_T track_nwords;
+static UINT4 *right_bits, *right_ranks, *left_bits, *left_ranks;
+static UINT2 *right_entries, *left_entries;
+
+
+static bool
+track_lookup (double *prob, UINT4 *bits, UINT4 *ranks, UINT2 *entries, Univcoord_T splice_pos, int type) {
+  Univcoord_T wordi;
+  UINT4 word;
+  UINT2 entry;
+  int bit;
+
+  if (track_p == false) {
+    return false;
+  } else if ((wordi = splice_pos/32U) >= track_nwords) {
+    return false;
+  } else {
+    bit = splice_pos % 32;
+    word = bits[wordi];
+    if ((word & (1U << bit)) == 0) {
+      /* Not a canonical dinucleotide, so compute from genome */
+      return false;
+    } else {
+      word &= (1U << bit) - 1U;
+      entry = entries[ranks[wordi] + popcount_ones(word)];
+      if ((entry >> TRACK_TYPE_SHIFT) != type) {
+	return false;
+      } else {
+	*prob = (double) (entry & TRACK_PROB_MASK)/TRACK_PROB_SCALE;
+	return true;
+      }
+    }
+  }
+}
+
+
 /************************************************************************
  *   Dispatch procedures
  ************************************************************************/
@@ -27232,6 +27313,8 @@ Maxent_hr_donor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
 
   if (splice_pos < chroffset + DONOR_MODEL_LEFT_MARGIN) {
     return 0.0;
+  } else if (track_lookup(&refprob,right_bits,right_ranks,right_entries,splice_pos,TRACK_DONOR) == true) {
+    return refprob;
   } else {
     startpos = splice_pos - DONOR_MODEL_LEFT_MARGIN;
     ptr = startpos/32U*3;
@@ -27244,13 +27327,13 @@ Maxent_hr_donor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
     debug(printf("startpos is %u, shift is %d\n",startpos,shift));
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     refprob = (donor_plus_table[shift])(low,high,nextlow);
 
@@ -27258,13 +27341,13 @@ Maxent_hr_donor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
       return refprob;
     } else {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(snp_blocks[ptr]);
-      low = Bigendian_convert_uint(snp_blocks[ptr+1]);
-      nextlow = Bigendian_convert_uint(snp_blocks[ptr+4]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(snp_blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,ptr));
+      nextlow = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,ptr+3));
 #else
-      high = snp_blocks[ptr];
-      low = snp_blocks[ptr+1];
-      nextlow = snp_blocks[ptr+4];
+      high = BLOCK_HIGH(snp_blocks,ptr);
+      low = BLOCK_LOW(snp_blocks,ptr);
+      nextlow = BLOCK_LOW(snp_blocks,ptr+3);
 #endif
 
       if ((altprob = (donor_plus_table[shift])(low,high,nextlow)) > refprob) {
@@ -27299,6 +27382,8 @@ Maxent_hr_acceptor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
 
   if (splice_pos < chroffset + ACCEPTOR_MODEL_LEFT_MARGIN) {
     return 0.0;
+  } else if (track_lookup(&refprob,left_bits,left_ranks,left_entries,splice_pos,TRACK_ACCEPTOR) == true) {
+    return refprob;
   } else {
     startpos = splice_pos - ACCEPTOR_MODEL_LEFT_MARGIN;
     ptr = startpos/32U*3;
@@ -27311,15 +27396,15 @@ Maxent_hr_acceptor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
     debug(printf("startpos is %u, shift is %d\n",startpos,shift));
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nexthigh = Bigendian_convert_uint(ref_blocks[ptr+3]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nexthigh = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nexthigh = ref_blocks[ptr+3];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nexthigh = BLOCK_HIGH(ref_blocks,ptr+3);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     refprob = (acceptor_plus_table[shift])(low,high,nextlow,nexthigh);
 
@@ -27327,15 +27412,15 @@ Maxent_hr_acceptor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
       return refprob;
     } else {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(snp_blocks[ptr]);
-      low = Bigendian_convert_uint(snp_blocks[ptr+1]);
-      nexthigh = Bigendian_convert_uint(snp_blocks[ptr+3]);
-      nextlow = Bigendian_convert_uint(snp_blocks[ptr+4]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(snp_blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,ptr));
+      nexthigh = Bigendian_convert_uint(BLOCK_HIGH(snp_blocks,ptr+3));
+      nextlow = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,ptr+3));
 #else
-      high = snp_blocks[ptr];
-      low = snp_blocks[ptr+1];
-      nexthigh = snp_blocks[ptr+3];
-      nextlow = snp_blocks[ptr+4];
+      high = BLOCK_HIGH(snp_blocks,ptr);
+      low = BLOCK_LOW(snp_blocks,ptr);
+      nexthigh = BLOCK_HIGH(snp_blocks,ptr+3);
+      nextlow = BLOCK_LOW(snp_blocks,ptr+3);
 #endif
 
       if ((altprob = (acceptor_plus_table[shift])(low,high,nextlow,nexthigh)) > refprob) {
@@ -27370,6 +27455,8 @@ Maxent_hr_antidonor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
 
   if (splice_pos < chroffset + DONOR_MODEL_RIGHT_MARGIN) {
     return 0.0;
+  } else if (track_lookup(&refprob,left_bits,left_ranks,left_entries,splice_pos,TRACK_ANTIDONOR) == true) {
+    return refprob;
   } else {
     startpos = splice_pos - DONOR_MODEL_RIGHT_MARGIN;
     ptr = startpos/32U*3;
@@ -27382,13 +27469,13 @@ Maxent_hr_antidonor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
     debug(printf("startpos is %u, shift is %d\n",startpos,shift));
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     refprob = (donor_minus_table[shift])(low,high,nextlow);
 
@@ -27396,13 +27483,13 @@ Maxent_hr_antidonor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
       return refprob;
     } else {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(snp_blocks[ptr]);
-      low = Bigendian_convert_uint(snp_blocks[ptr+1]);
-      nextlow = Bigendian_convert_uint(snp_blocks[ptr+4]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(snp_blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,ptr));
+      nextlow = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,ptr+3));
 #else
-      high = snp_blocks[ptr];
-      low = snp_blocks[ptr+1];
-      nextlow = snp_blocks[ptr+4];
+      high = BLOCK_HIGH(snp_blocks,ptr);
+      low = BLOCK_LOW(snp_blocks,ptr);
+      nextlow = BLOCK_LOW(snp_blocks,ptr+3);
 #endif
       if ((altprob = (donor_minus_table[shift])(low,high,nextlow)) > refprob) {
 	return altprob;
@@ -27436,6 +27523,8 @@ Maxent_hr_antiacceptor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
 
   if (splice_pos < chroffset + ACCEPTOR_MODEL_RIGHT_MARGIN) {
     return 0.0;
+  } else if (track_lookup(&refprob,right_bits,right_ranks,right_entries,splice_pos,TRACK_ANTIACCEPTOR) == true) {
+    return refprob;
   } else {
     startpos = splice_pos - ACCEPTOR_MODEL_RIGHT_MARGIN;
     ptr = startpos/32U*3;
@@ -27448,15 +27537,15 @@ Maxent_hr_antiacceptor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
     debug(printf("startpos is %u, shift is %d\n",startpos,shift));
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nexthigh = Bigendian_convert_uint(ref_blocks[ptr+3]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nexthigh = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nexthigh = ref_blocks[ptr+3];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nexthigh = BLOCK_HIGH(ref_blocks,ptr+3);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     refprob = (acceptor_minus_table[shift])(low,high,nextlow,nexthigh);
 
@@ -27464,15 +27553,15 @@ Maxent_hr_antiacceptor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
       return refprob;
     } else {
 #ifdef WORDS_BIGENDIAN
-      high = Bigendian_convert_uint(snp_blocks[ptr]);
-      low = Bigendian_convert_uint(snp_blocks[ptr+1]);
-      nexthigh = Bigendian_convert_uint(snp_blocks[ptr+3]);
-      nextlow = Bigendian_convert_uint(snp_blocks[ptr+4]);
+      high = Bigendian_convert_uint(BLOCK_HIGH(snp_blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,ptr));
+      nexthigh = Bigendian_convert_uint(BLOCK_HIGH(snp_blocks,ptr+3));
+      nextlow = Bigendian_convert_uint(BLOCK_LOW(snp_blocks,ptr+3));
 #else
-      high = snp_blocks[ptr];
-      low = snp_blocks[ptr+1];
-      nexthigh = snp_blocks[ptr+3];
-      nextlow = snp_blocks[ptr+4];
+      high = BLOCK_HIGH(snp_blocks,ptr);
+      low = BLOCK_LOW(snp_blocks,ptr);
+      nexthigh = BLOCK_HIGH(snp_blocks,ptr+3);
+      nextlow = BLOCK_LOW(snp_blocks,ptr+3);
 #endif
 
       if ((altprob = (acceptor_minus_table[shift])(low,high,nextlow,nexthigh)) > refprob) {
@@ -27484,3 +27573,258 @@ Maxent_hr_antiacceptor_prob (Univcoord_T splice_pos, Univcoord_T chroffset) {
   }
 }
 
+
+
+/************************************************************************
+ *   Reading and writing the score track
+ ************************************************************************/
+
+static char *
+track_filename (char *genomesubdir, char *fileroot) {
+  char *filename;
+
+  filename = (char *) CALLOC(strlen(genomesubdir)+strlen("/")+strlen(fileroot)+strlen(".")+
+			     strlen(TRACK_FILESUFFIX)+1,sizeof(char));
+  sprintf(filename,"%s/%s.%s",genomesubdir,fileroot,TRACK_FILESUFFIX);
+  return filename;
+}
+
+
+/* Optional.  Must be called after Maxent_hr_setup.  The track is
+   computed from the reference genome only, so it is not used when
+   alternate (SNP) blocks differ from the reference. */
+void
+Maxent_hr_track_setup (char *genomesubdir, char *fileroot) {
+  char *filename;
+  UINT4 nsites_right, nsites_left;
+  size_t expected_len;
+
+  track_p = false;
+  filename = track_filename(genomesubdir,fileroot);
+  if (Access_file_exists_p(filename) == false) {
+    FREE(filename);
+    return;
+  } else if (snp_blocks != NULL && snp_blocks != ref_blocks) {
+    fprintf(stderr,"Not using splice-site score track %s, since genome has SNPs\n",filename);
+    FREE(filename);
+    return;
+  }
+
+#ifdef WORDS_BIGENDIAN
+  fprintf(stderr,"Not using splice-site score track %s on a big-endian machine\n",filename);
+  FREE(filename);
+  return;
+#else
+  track = (UINT4 *) Access_mmap(&track_fd,&track_len,filename,sizeof(UINT4),/*randomp*/true);
+  if (track == NULL || track_len < TRACK_HEADER_NUINT4*sizeof(UINT4)) {
+    fprintf(stderr,"Splice-site score track %s is not valid\n",filename);
+    exit(9);
+  }
+
+  track_nwords = (Univcoord_T) track[0];
+  nsites_right = track[1];
+  nsites_left = track[2];
+  expected_len = (TRACK_HEADER_NUINT4 + 4*track_nwords)*sizeof(UINT4) +
+    ((size_t) nsites_right + (size_t) nsites_left)*sizeof(UINT2);
+  if (track_len != expected_len) {
+    fprintf(stderr,"Splice-site score track %s has length %llu, but expected %llu\n",
+	    filename,(unsigned long long) track_len,(unsigned long long) expected_len);
+    exit(9);
+  }
+
+  right_bits = &(track[TRACK_HEADER_NUINT4]);
+  right_ranks = &(right_bits[track_nwords]);
+  left_bits = &(right_ranks[track_nwords]);
+  left_ranks = &(left_bits[track_nwords]);
+  right_entries = (UINT2 *) &(left_ranks[track_nwords]);
+  left_entries = &(right_entries[nsites_right]);
+
+  fprintf(stderr,"Using splice-site score track %s with %u donor/antiacceptor and %u acceptor/antidonor sites\n",
+	  filename,nsites_right,nsites_left);
+  track_p = true;
+  FREE(filename);
+
+  return;
+#endif
+}
+
+void
+Maxent_hr_track_free () {
+  if (track_p == true) {
+    munmap((void *) track,track_len);
+    close(track_fd);
+    track_p = false;
+  }
+  return;
+}
+
+
+/* Returns nucleotide 0..3 for ACGT, or -1 for a non-ACGT character */
+static int
+track_nt (Univcoord_T pos) {
+  Univcoord_T ptr;
+  int bit;
+
+  ptr = pos/32U*3;
+  bit = pos % 32;
+  if (BLOCK_FLAGS(ref_blocks,ptr) & (1U << bit)) {
+    return -1;
+  } else if (bit < 16) {
+    return (BLOCK_LOW(ref_blocks,ptr) >> (bit+bit)) & 0x3;
+  } else {
+    return (BLOCK_HIGH(ref_blocks,ptr) >> (bit+bit-32)) & 0x3;
+  }
+}
+
+#define NT_A 0
+#define NT_C 1
+#define NT_G 2
+#define NT_T 3
+
+static UINT2
+track_entry (int type, double prob) {
+  return (UINT2) ((type << TRACK_TYPE_SHIFT) | (int) (prob*TRACK_PROB_SCALE + 0.5));
+}
+
+static void
+track_write_entries (FILE *fp, UINT2 *entries, int n) {
+  fwrite(entries,sizeof(UINT2),n,fp);
+  return;
+}
+
+
+/* Called by gmapindex after Maxent_hr_setup(blocks,NULL).  Scores
+   are computed as for a chromosome starting at position 0, since
+   callers check the chromosome margin before consulting the track.
+   Sites whose model would read past the end of the genome blocks are
+   left unmarked, and are computed on the fly as before. */
+void
+Maxent_hr_write_track (char *genomesubdir, char *fileroot, Univcoord_T genomelength) {
+  char *filename, *tempfilename;
+  FILE *fp, *right_fp, *left_fp;
+  UINT4 *right_bits, *right_ranks, *left_bits, *left_ranks;
+  UINT2 right_buffer[32], left_buffer[32];
+  UINT4 nsites_right = 0, nsites_left = 0, header[TRACK_HEADER_NUINT4];
+  Univcoord_T nwords, nuint4, wordi, pos, endpos;
+  int nright, nleft, bit, nt, prev_nt, prev2_nt;
+  size_t nread;
+
+  nwords = (genomelength + 31)/32U;
+  nuint4 = nwords*3;
+  if (track_p == true) {
+    fprintf(stderr,"Cannot write splice-site score track while one is in use\n");
+    exit(9);
+  }
+
+  right_bits = (UINT4 *) CALLOC(nwords,sizeof(UINT4));
+  right_ranks = (UINT4 *) CALLOC(nwords,sizeof(UINT4));
+  left_bits = (UINT4 *) CALLOC(nwords,sizeof(UINT4));
+  left_ranks = (UINT4 *) CALLOC(nwords,sizeof(UINT4));
+
+  /* Entries are staged in temporary files, since their number is known only at the end */
+  filename = track_filename(genomesubdir,fileroot);
+  tempfilename = (char *) CALLOC(strlen(filename)+strlen(".right")+1,sizeof(char));
+  sprintf(tempfilename,"%s.right",filename);
+  if ((right_fp = FOPEN_RW_BINARY(tempfilename)) == NULL) {
+    fprintf(stderr,"Can't write to file %s\n",tempfilename);
+    exit(9);
+  }
+  remove(tempfilename);
+  sprintf(tempfilename,"%s.left",filename);
+  if ((left_fp = FOPEN_RW_BINARY(tempfilename)) == NULL) {
+    fprintf(stderr,"Can't write to file %s\n",tempfilename);
+    exit(9);
+  }
+  remove(tempfilename);
+  FREE(tempfilename);
+
+  fprintf(stderr,"Computing splice-site scores over %llu positions",(unsigned long long) genomelength);
+  prev2_nt = prev_nt = -1;
+  for (wordi = 0; wordi < nwords; wordi++) {
+    if (wordi % 1000000 == 0) {
+      fprintf(stderr,".");
+    }
+    right_ranks[wordi] = nsites_right;
+    left_ranks[wordi] = nsites_left;
+    nright = nleft = 0;
+
+    if ((endpos = (wordi + 1)*32U) > genomelength) {
+      endpos = genomelength;
+    }
+    for (pos = wordi*32U, bit = 0; pos < endpos; pos++, bit++) {
+      nt = track_nt(pos);
+
+      /* Left side, using dinucleotide at pos - 2 */
+      if (pos/32U*3 + 5 > nuint4) {
+	/* Model would read past last block */
+      } else if (prev2_nt == NT_A && prev_nt == NT_G) {
+	left_bits[wordi] |= (1U << bit);
+	left_buffer[nleft++] = track_entry(TRACK_ACCEPTOR,Maxent_hr_acceptor_prob(pos,/*chroffset*/0));
+      } else if ((prev2_nt == NT_A || prev2_nt == NT_G) && prev_nt == NT_C) {
+	left_bits[wordi] |= (1U << bit);
+	left_buffer[nleft++] = track_entry(TRACK_ANTIDONOR,Maxent_hr_antidonor_prob(pos,/*chroffset*/0));
+      }
+
+      /* Right side, using dinucleotide at pos */
+      if (pos + 1 >= genomelength || pos/32U*3 + 5 > nuint4) {
+	/* Model would read past last block */
+      } else if (nt == NT_G && (track_nt(pos+1) == NT_T || track_nt(pos+1) == NT_C)) {
+	right_bits[wordi] |= (1U << bit);
+	right_buffer[nright++] = track_entry(TRACK_DONOR,Maxent_hr_donor_prob(pos,/*chroffset*/0));
+      } else if (nt == NT_C && track_nt(pos+1) == NT_T) {
+	right_bits[wordi] |= (1U << bit);
+	right_buffer[nright++] = track_entry(TRACK_ANTIACCEPTOR,Maxent_hr_antiacceptor_prob(pos,/*chroffset*/0));
+      }
+
+      prev2_nt = prev_nt;
+      prev_nt = nt;
+    }
+
+    if ((UINT8) nsites_right + nright > 4294967295U || (UINT8) nsites_left + nleft > 4294967295U) {
+      fprintf(stderr,"\nGenome has too many splice sites for a score track\n");
+      exit(9);
+    }
+    track_write_entries(right_fp,right_buffer,nright);
+    track_write_entries(left_fp,left_buffer,nleft);
+    nsites_right += nright;
+    nsites_left += nleft;
+  }
+  fprintf(stderr,"done\n");
+
+  if ((fp = FOPEN_WRITE_BINARY(filename)) == NULL) {
+    fprintf(stderr,"Can't write to file %s\n",filename);
+    exit(9);
+  }
+  header[0] = (UINT4) nwords;
+  header[1] = nsites_right;
+  header[2] = nsites_left;
+  header[3] = 0;		/* Reserved */
+  fwrite(header,sizeof(UINT4),TRACK_HEADER_NUINT4,fp);
+  fwrite(right_bits,sizeof(UINT4),nwords,fp);
+  fwrite(right_ranks,sizeof(UINT4),nwords,fp);
+  fwrite(left_bits,sizeof(UINT4),nwords,fp);
+  fwrite(left_ranks,sizeof(UINT4),nwords,fp);
+
+  rewind(right_fp);
+  while ((nread = fread(right_buffer,sizeof(UINT2),32,right_fp)) > 0) {
+    fwrite(right_buffer,sizeof(UINT2),nread,fp);
+  }
+  rewind(left_fp);
+  while ((nread = fread(left_buffer,sizeof(UINT2),32,left_fp)) > 0) {
+    fwrite(left_buffer,sizeof(UINT2),nread,fp);
+  }
+  fclose(left_fp);
+  fclose(right_fp);
+  fclose(fp);
+
+  fprintf(stderr,"Wrote %u donor/antiacceptor and %u acceptor/antidonor sites to %s\n",
+	  nsites_right,nsites_left,filename);
+  FREE(filename);
+
+  FREE(left_ranks);
+  FREE(left_bits);
+  FREE(right_ranks);
+  FREE(right_bits);
+
+  return;
+}
@@ -20,5 +20,12 @@ Maxent_hr_antidonor_prob (Univcoord_T splice_pos, Univcoord_T chroffset);
 extern double
 Maxent_hr_antiacceptor_prob (Univcoord_T splice_pos, Univcoord_T chroffset);
 
+extern void
+Maxent_hr_track_setup (char *genomesubdir, char *fileroot);
+extern void
+Maxent_hr_track_free ();
+extern void
+Maxent_hr_write_track (char *genomesubdir, char *fileroot, Univcoord_T genomelength);
+
 #endif
 
@@ -17,6 +17,7 @@ static char rcsid[] = "$Id: oligoindex_hr.c 175547 2015-09-28 21:31:01Z twu $";
 #include "mem.h"
 #include "orderstat.h"
 #include "cmet.h"
+#include "genome.h"		/* For BLOCK_HIGH */
 
 #ifdef DEBUG14
 /* Need to change Makefile.am to include oligoindex_old.c and oligoindex_old.h */
@@ -92,6 +93,7 @@ struct T {
 #else
   bool *inquery;
 #endif
+  UINT4 *querybits;		/* Bitmap of query oligos, used by tally_querytable */
   Count_T *counts;
 #ifdef PMAP
   int *relevant_counts;
@@ -155,6 +157,7 @@ struct Oligoindex_array_T {
 #endif
 
 
+
 #if defined(DEBUG)
 #ifdef HAVE_SSE2
 /* For debugging of SIMD procedures*/
@@ -8560,6 +8563,7 @@ Oligoindex_new (int indexsize, int diag_lookback, int suffnconsecutive
   memset((void *) new->inquery,false,new->oligospace*sizeof(bool));
 #endif
   memset((void *) new->counts,0,new->oligospace*sizeof(Count_T));
+  new->querybits = (UINT4 *) CALLOC(new->oligospace/32 + 1,sizeof(UINT4));
 
 
 #ifdef PMAP
@@ -8695,11 +8699,11 @@ Genome_print_blocks (Genomecomp_T *blocks, Univcoord_T startpos, Univcoord_T end
   
   for (ptr = startblock ; ptr <= endblock; ptr += 3) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(blocks[ptr]);
-    low = Bigendian_convert_uint(blocks[ptr+1]);
-    flags = Bigendian_convert_uint(blocks[ptr+2]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(blocks,ptr));
+    flags = Bigendian_convert_uint(BLOCK_FLAGS(blocks,ptr));
 #else
-    high = blocks[ptr]; low = blocks[ptr+1]; flags = blocks[ptr+2];
+    high = BLOCK_HIGH(blocks,ptr); low = BLOCK_LOW(blocks,ptr); flags = BLOCK_FLAGS(blocks,ptr);
 #endif
     printf("high: %08X  low: %08X  flags: %08X\t",high,low,flags);
     write_chars(high,low,flags);
@@ -8720,7 +8724,7 @@ Genome_print_blocks (Genomecomp_T *blocks, Univcoord_T startpos, Univcoord_T end
 /*                      87654321 */
 #define LOW_TWO_BITS  0x00000003
 
-#if defined(DEBUG) || defined(DEBUG9) || defined(DEBUG14)
+#if defined(DEBUG) || defined(DEBUG9) || defined(DEBUG14) || defined(DEBUG15)
 static char *
 shortoligo_nt (Shortoligomer_T oligo, int oligosize) {
   char *nt;
@@ -16170,13 +16174,13 @@ count_positions_fwd_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 
   } else if (startptr == endptr) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -16215,13 +16219,13 @@ count_positions_fwd_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 
     /* End block */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -16260,13 +16264,13 @@ count_positions_fwd_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -16293,13 +16297,13 @@ count_positions_fwd_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -16326,13 +16330,13 @@ count_positions_fwd_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -16359,13 +16363,13 @@ count_positions_fwd_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -16392,13 +16396,13 @@ count_positions_fwd_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -16430,13 +16434,13 @@ count_positions_fwd_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
     assert(ptr == startptr);
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -16525,13 +16529,13 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 
   } else if (startptr == endptr) {
 #ifdef WORDS_BIGENDIAN
-    high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high0 = ref_blocks[ptr];
-    low0 = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high0 = BLOCK_HIGH(ref_blocks,ptr);
+    low0 = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); nextlow = Cmet_reduce_ct(nextlow);
@@ -16583,13 +16587,13 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 
     /* End block */
 #ifdef WORDS_BIGENDIAN
-    high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high0 = ref_blocks[ptr];
-    low0 = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high0 = BLOCK_HIGH(ref_blocks,ptr);
+    low0 = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); nextlow = Cmet_reduce_ct(nextlow);
@@ -16641,17 +16645,17 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -16710,13 +16714,13 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -16755,17 +16759,17 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -16824,13 +16828,13 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -16869,17 +16873,17 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -16938,13 +16942,13 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -16983,17 +16987,17 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -17052,13 +17056,13 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -17097,17 +17101,17 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -17165,13 +17169,13 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -17215,13 +17219,13 @@ count_positions_fwd_simd (Count_T *counts, int indexsize,
     assert(ptr == startptr);
 
 #ifdef WORDS_BIGENDIAN
-    high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    /* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+    high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    /* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-    high0 = ref_blocks[ptr];
-    low0 = ref_blocks[ptr+1];
-    /* nextlow = ref_blocks[ptr+4]; */
+    high0 = BLOCK_HIGH(ref_blocks,ptr);
+    low0 = BLOCK_LOW(ref_blocks,ptr);
+    /* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
     if (mode == CMET_STRANDED) {
       high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -17300,13 +17304,13 @@ store_positions_fwd_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 
   } else if (startptr == endptr) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -17345,13 +17349,13 @@ store_positions_fwd_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 
     /* End block */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -17389,13 +17393,13 @@ store_positions_fwd_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -17422,13 +17426,13 @@ store_positions_fwd_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -17455,13 +17459,13 @@ store_positions_fwd_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -17488,13 +17492,13 @@ store_positions_fwd_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -17521,13 +17525,13 @@ store_positions_fwd_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -17558,13 +17562,13 @@ store_positions_fwd_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
     assert(ptr == startptr);
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low); nextlow = Cmet_reduce_ct(nextlow);
@@ -17654,13 +17658,13 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
   } else if (startptr == endptr) {
 #ifdef WORDS_BIGENDIAN
-    high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high0 = ref_blocks[ptr];
-    low0 = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high0 = BLOCK_HIGH(ref_blocks,ptr);
+    low0 = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); nextlow = Cmet_reduce_ct(nextlow);
@@ -17712,13 +17716,13 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
     /* End block */
 #ifdef WORDS_BIGENDIAN
-    high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high0 = ref_blocks[ptr];
-    low0 = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high0 = BLOCK_HIGH(ref_blocks,ptr);
+    low0 = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); nextlow = Cmet_reduce_ct(nextlow);
@@ -17770,17 +17774,17 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -17834,13 +17838,13 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -17879,17 +17883,17 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -17943,13 +17947,13 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -17988,17 +17992,17 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -18052,13 +18056,13 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -18097,17 +18101,17 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -18161,13 +18165,13 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -18206,17 +18210,17 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 6;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]); */
-#else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	/* nextlow = ref_blocks[ptr+7]; */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6)); */
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+6); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0);
@@ -18270,13 +18274,13 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 	ptr -= 3;
 
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	/* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	/* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-	high0 = ref_blocks[ptr];
-	low0 = ref_blocks[ptr+1];
-	/* nextlow = ref_blocks[ptr+4]; */
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	low0 = BLOCK_LOW(ref_blocks,ptr);
+	/* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -18320,13 +18324,13 @@ store_positions_fwd_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
     assert(ptr == startptr);
 
 #ifdef WORDS_BIGENDIAN
-    high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low0 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    /* nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]); */
+    high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    /* nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3)); */
 #else
-    high0 = ref_blocks[ptr];
-    low0 = ref_blocks[ptr+1];
-    /* nextlow = ref_blocks[ptr+4]; */
+    high0 = BLOCK_HIGH(ref_blocks,ptr);
+    low0 = BLOCK_LOW(ref_blocks,ptr);
+    /* nextlow = BLOCK_LOW(ref_blocks,ptr+3); */
 #endif
     if (mode == CMET_STRANDED) {
       high0 = Cmet_reduce_ct(high0); low0 = Cmet_reduce_ct(low0); /* nextlow = Cmet_reduce_ct(nextlow); */
@@ -24916,13 +24920,13 @@ count_positions_rev_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 
   } else if (startptr == endptr) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -24958,13 +24962,13 @@ count_positions_rev_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
 
     /* Start block */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25001,13 +25005,13 @@ count_positions_rev_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
     if (indexsize == 9) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25030,13 +25034,13 @@ count_positions_rev_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
     } else if (indexsize == 8) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25059,13 +25063,13 @@ count_positions_rev_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
     } else if (indexsize == 7) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25088,13 +25092,13 @@ count_positions_rev_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
     } else if (indexsize == 6) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25117,13 +25121,13 @@ count_positions_rev_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
     } else if (indexsize == 5) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25151,13 +25155,13 @@ count_positions_rev_std (Count_T *counts, int indexsize, Univcoord_T left, Univc
     assert(ptr == endptr);
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25229,13 +25233,13 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
 
   } else if (startptr == endptr) {
 #ifdef WORDS_BIGENDIAN
-    high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low1 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high1 = ref_blocks[ptr];
-    low1 = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high1 = BLOCK_HIGH(ref_blocks,ptr);
+    low1 = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high1 = Cmet_reduce_ga(high1); low1 = Cmet_reduce_ga(low1); nextlow = Cmet_reduce_ga(nextlow);
@@ -25271,13 +25275,13 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
 
     /* Start block */
 #ifdef WORDS_BIGENDIAN
-    high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low1 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high1 = ref_blocks[ptr];
-    low1 = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high1 = BLOCK_HIGH(ref_blocks,ptr);
+    low1 = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high1 = Cmet_reduce_ga(high1); low1 = Cmet_reduce_ga(low1); nextlow = Cmet_reduce_ga(nextlow);
@@ -25314,17 +25318,17 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
     if (indexsize == 9) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -25371,13 +25375,13 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -25402,17 +25406,17 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
     } else if (indexsize == 8) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -25459,13 +25463,13 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -25490,17 +25494,17 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
     } else if (indexsize == 7) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -25547,13 +25551,13 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -25578,17 +25582,17 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
     } else if (indexsize == 6) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -25635,13 +25639,13 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -25666,17 +25670,17 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
     } else if (indexsize == 5) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -25723,13 +25727,13 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -25760,13 +25764,13 @@ count_positions_rev_simd (Count_T *counts, int indexsize,
     assert(ptr == endptr);
 
 #ifdef WORDS_BIGENDIAN
-    high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-    /* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    /* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high1 = ref_blocks[ptr];
-    /* low1 = ref_blocks[ptr+1]; */
-    nextlow = ref_blocks[ptr+4];
+    high1 = BLOCK_HIGH(ref_blocks,ptr);
+    /* low1 = BLOCK_LOW(ref_blocks,ptr); */
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -25831,13 +25835,13 @@ store_positions_rev_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 
   } else if (startptr == endptr) {
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25873,13 +25877,13 @@ store_positions_rev_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
 
     /* Start block */
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25916,13 +25920,13 @@ store_positions_rev_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
     if (indexsize == 9) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25945,13 +25949,13 @@ store_positions_rev_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
     } else if (indexsize == 8) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -25974,13 +25978,13 @@ store_positions_rev_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
     } else if (indexsize == 7) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -26003,13 +26007,13 @@ store_positions_rev_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
     } else if (indexsize == 6) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -26032,13 +26036,13 @@ store_positions_rev_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
     } else if (indexsize == 5) {
       while (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high = Bigendian_convert_uint(ref_blocks[ptr]);
-	low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high = ref_blocks[ptr];
-	low = ref_blocks[ptr+1];
-	nextlow = ref_blocks[ptr+4];
+	high = BLOCK_HIGH(ref_blocks,ptr);
+	low = BLOCK_LOW(ref_blocks,ptr);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -26067,13 +26071,13 @@ store_positions_rev_std (Chrpos_T **pointers, Chrpos_T **positions, Count_T *cou
     assert(ptr == endptr);
 
 #ifdef WORDS_BIGENDIAN
-    high = Bigendian_convert_uint(ref_blocks[ptr]);
-    low = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high = ref_blocks[ptr];
-    low = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high = BLOCK_HIGH(ref_blocks,ptr);
+    low = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low); nextlow = Cmet_reduce_ga(nextlow);
@@ -26144,13 +26148,13 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
   } else if (startptr == endptr) {
 #ifdef WORDS_BIGENDIAN
-    high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low1 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high1 = ref_blocks[ptr];
-    low1 = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high1 = BLOCK_HIGH(ref_blocks,ptr);
+    low1 = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high1 = Cmet_reduce_ga(high1); low1 = Cmet_reduce_ga(low1); nextlow = Cmet_reduce_ga(nextlow);
@@ -26186,13 +26190,13 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
     /* Start block */
 #ifdef WORDS_BIGENDIAN
-    high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-    low1 = Bigendian_convert_uint(ref_blocks[ptr+1]);
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high1 = ref_blocks[ptr];
-    low1 = ref_blocks[ptr+1];
-    nextlow = ref_blocks[ptr+4];
+    high1 = BLOCK_HIGH(ref_blocks,ptr);
+    low1 = BLOCK_LOW(ref_blocks,ptr);
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high1 = Cmet_reduce_ga(high1); low1 = Cmet_reduce_ga(low1); nextlow = Cmet_reduce_ga(nextlow);
@@ -26229,17 +26233,17 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
     if (indexsize == 9) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -26282,13 +26286,13 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -26313,17 +26317,17 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
     } else if (indexsize == 8) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -26366,13 +26370,13 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -26397,17 +26401,17 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
     } else if (indexsize == 7) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -26450,13 +26454,13 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]);*/
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));*/
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -26481,17 +26485,17 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
     } else if (indexsize == 6) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -26534,13 +26538,13 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -26565,17 +26569,17 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
     } else if (indexsize == 5) {
       while (ptr + 6 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high0 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low0 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	high1 = Bigendian_convert_uint(ref_blocks[ptr+3]);
-	low1 = Bigendian_convert_uint(ref_blocks[ptr+4]);
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+7]);
-#else
-	high0 = ref_blocks[ptr];
-	/* low0 = ref_blocks[ptr+1]; */
-	high1 = ref_blocks[ptr+3];
-	low1 = ref_blocks[ptr+4];
-	nextlow = ref_blocks[ptr+7];
+	high0 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low0 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr+3));
+	low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+6));
+#else
+	high0 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low0 = BLOCK_LOW(ref_blocks,ptr); */
+	high1 = BLOCK_HIGH(ref_blocks,ptr+3);
+	low1 = BLOCK_LOW(ref_blocks,ptr+3);
+	nextlow = BLOCK_LOW(ref_blocks,ptr+6);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high0 = Cmet_reduce_ga(high0); /* low0 = Cmet_reduce_ga(low0); */
@@ -26618,13 +26622,13 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
 
       if (ptr + 3 <= endptr) {
 #ifdef WORDS_BIGENDIAN
-	high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-	/* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-	nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+	high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+	/* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+	nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-	high1 = ref_blocks[ptr];
-	/* low1 = ref_blocks[ptr+1]; */
-	nextlow = ref_blocks[ptr+4];
+	high1 = BLOCK_HIGH(ref_blocks,ptr);
+	/* low1 = BLOCK_LOW(ref_blocks,ptr); */
+	nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
 	if (mode == CMET_STRANDED) {
 	  high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -26655,13 +26659,13 @@ store_positions_rev_simd (Chrpos_T **pointers, Chrpos_T **positions, Count_T *co
     assert(ptr == endptr);
 
 #ifdef WORDS_BIGENDIAN
-    high1 = Bigendian_convert_uint(ref_blocks[ptr]);
-    /* low1 = Bigendian_convert_uint(ref_blocks[ptr+1]); */
-    nextlow = Bigendian_convert_uint(ref_blocks[ptr+4]);
+    high1 = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+    /* low1 = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr)); */
+    nextlow = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr+3));
 #else
-    high1 = ref_blocks[ptr];
-    /* low1 = ref_blocks[ptr+1]; */
-    nextlow = ref_blocks[ptr+4];
+    high1 = BLOCK_HIGH(ref_blocks,ptr);
+    /* low1 = BLOCK_LOW(ref_blocks,ptr); */
+    nextlow = BLOCK_LOW(ref_blocks,ptr+3);
 #endif
     if (mode == CMET_STRANDED) {
       high1 = Cmet_reduce_ga(high1); /* low1 = Cmet_reduce_ga(low1); */ nextlow = Cmet_reduce_ga(nextlow);
@@ -27658,6 +27662,203 @@ store_positions (Chrpos_T **pointers, bool *overabundant,
 
 
 
+/* Query-side tally.  The oligospace tally clears, counts, and scans
+   all 4^indexsize entries, which dominates when the genomic region is
+   short relative to the oligospace.  Here the distinct query oligos go
+   into a small open-addressing table, with a bitmap over the
+   oligospace as a filter that is set and cleared only for those
+   oligos.  The region is streamed through it once, and counts and
+   positions are filled in only for query oligos, which are the only
+   ones that Oligoindex_get_mappings looks up.  Results are the same as
+   the oligospace tally, including the dropping of oligos whose counts
+   overflow Count_T. */
+
+/* The query table is used when the region and query lengths together
+   are below this fraction of the oligospace.  Above it, the SIMD
+   oligospace tally is faster per position than the table lookups. */
+#define QUERYTABLE_REGION_RATIO 8
+
+/* Fibonacci hashing into a table of 2^tablebits entries */
+#define QUERYTABLE_HASH(masked,tablebits) (((masked) * 2654435769U) >> (32 - (tablebits)))
+#define QUERYTABLE_EMPTY ((Shortoligomer_T) -1)
+
+static void
+tally_querytable (T this, Univcoord_T mappingstart, Univcoord_T mappingend, bool plusp,
+		  char *queryuc_ptr, int querystart, int queryend, Chrpos_T chrpos, int genestrand) {
+  Shortoligomer_T *keys, oligo, masked, mask = this->mask;
+  UINT4 *querybits = this->querybits;
+  int indexsize = this->indexsize, tablebits, tablesize, nunique = 0, in_counter = 0;
+  int *slots, *nhits, *hit_slots = NULL, slot, nmatches = 0, totalcounts = 0, i;
+  int rc_shift = 2*(indexsize - 1);
+  Chrpos_T **pointers, *hit_offsets = NULL, *p, noligos = 0;
+  Univcoord_T left_plus_length, pos, endpos;
+  Genomecomp_T ptr, high, low, nt;
+  int bitpos, startbit, endbit;
+  char *q;
+
+  tablebits = 1;
+  while ((1 << tablebits) < 2*(queryend - querystart)) {
+    tablebits++;
+  }
+  tablesize = 1 << tablebits;
+  keys = (Shortoligomer_T *) MALLOC(tablesize*sizeof(Shortoligomer_T));
+  memset((void *) keys,0xFF,tablesize*sizeof(Shortoligomer_T));
+  nhits = (int *) CALLOC(tablesize,sizeof(int));
+  slots = (int *) MALLOC((queryend - querystart)*sizeof(int));
+
+  oligo = 0U;
+  for (i = querystart, q = &(queryuc_ptr[querystart]); i < queryend; i++, q++) {
+    in_counter++;
+
+    switch (*q) {
+    case 'A': oligo = (oligo << 2); break;
+    case 'C': oligo = (oligo << 2) | 1; break;
+    case 'G': oligo = (oligo << 2) | 2; break;
+    case 'T': oligo = (oligo << 2) | 3; break;
+    default: oligo = 0U; in_counter = 0; break;
+    }
+
+    if (in_counter == indexsize) {
+      masked = oligo & mask;
+      slot = QUERYTABLE_HASH(masked,tablebits);
+      while (keys[slot] != masked && keys[slot] != QUERYTABLE_EMPTY) {
+	slot = (slot + 1) & (tablesize - 1);
+      }
+      if (keys[slot] == QUERYTABLE_EMPTY) {
+	keys[slot] = masked;
+	slots[nunique++] = slot;
+	querybits[masked/32] |= (1U << (masked % 32));
+      }
+      in_counter--;
+    }
+  }
+
+  /* Same region as count_positions and store_positions: oligos start
+     at mappingstart through left_plus_length, and a region with one
+     oligo or none is skipped */
+  if (mappingend < (Univcoord_T) indexsize) {
+    left_plus_length = 0;
+  } else {
+    left_plus_length = mappingend - indexsize;
+  }
+
+  if (nunique > 0 && left_plus_length > mappingstart) {
+    noligos = left_plus_length - mappingstart + 1;
+    hit_slots = (int *) MALLOC(noligos*sizeof(int));
+    hit_offsets = (Chrpos_T *) MALLOC(noligos*sizeof(Chrpos_T));
+
+    /* Oligo ending at pos is complete once pos reaches mappingstart + indexsize - 1 */
+    oligo = 0U;
+    endpos = mappingend - 1;
+    for (ptr = mappingstart/32U*3; ptr <= endpos/32U*3; ptr += 3) {
+#ifdef WORDS_BIGENDIAN
+      high = Bigendian_convert_uint(BLOCK_HIGH(ref_blocks,ptr));
+      low = Bigendian_convert_uint(BLOCK_LOW(ref_blocks,ptr));
+#else
+      high = BLOCK_HIGH(ref_blocks,ptr);
+      low = BLOCK_LOW(ref_blocks,ptr);
+#endif
+      if (mode == CMET_STRANDED) {
+	if (plusp == true) {
+	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low);
+	} else {
+	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low);
+	}
+      } else if (mode == CMET_NONSTRANDED) {
+	if (genestrand > 0) {
+	  high = Cmet_reduce_ct(high); low = Cmet_reduce_ct(low);
+	} else {
+	  high = Cmet_reduce_ga(high); low = Cmet_reduce_ga(low);
+	}
+      }
+
+      pos = ptr/3*32U;
+      startbit = (pos < mappingstart) ? (int) (mappingstart - pos) : 0;
+      endbit = (pos + 31 > endpos) ? (int) (endpos - pos) : 31;
+      for (bitpos = startbit, pos += startbit; bitpos <= endbit; bitpos++, pos++) {
+	nt = (bitpos < 16) ? (low >> 2*bitpos) & 0x3 : (high >> 2*(bitpos - 16)) & 0x3;
+	if (plusp == true) {
+	  oligo = ((oligo << 2) | nt) & mask;
+	} else {
+	  oligo = (oligo >> 2) | ((3 - nt) << rc_shift);
+	}
+
+	if (pos >= mappingstart + indexsize - 1 &&
+	    (querybits[oligo/32] & (1U << (oligo % 32))) != 0) {
+	  slot = QUERYTABLE_HASH(oligo,tablebits);
+	  while (keys[slot] != oligo) {
+	    slot = (slot + 1) & (tablesize - 1);
+	  }
+	  nhits[slot] += 1;
+	  hit_slots[nmatches] = slot;
+	  hit_offsets[nmatches++] = pos - (indexsize - 1) - mappingstart;
+	}
+      }
+    }
+
+    for (i = 0; i < nunique; i++) {
+      slot = slots[i];
+      if ((Count_T) nhits[slot] != nhits[slot]) {
+	/* Overflows Count_T, so dropped as in store_positions */
+	nhits[slot] = 0;
+      }
+      totalcounts += nhits[slot];
+    }
+  }
+
+  if (totalcounts == 0) {
+    this->positions_space = (Chrpos_T *) NULL;
+    for (i = 0; i < nunique; i++) {
+      this->counts[keys[slots[i]]] = 0;
+    }
+
+  } else {
+    pointers = (Chrpos_T **) MALLOC(tablesize*sizeof(Chrpos_T *));
+    p = this->positions_space = (Chrpos_T *) MALLOC(totalcounts*sizeof(Chrpos_T));
+    for (i = 0; i < nunique; i++) {
+      slot = slots[i];
+      masked = keys[slot];
+      this->counts[masked] = (Count_T) nhits[slot];
+      this->positions[masked] = pointers[slot] = p;
+      p += nhits[slot];
+    }
+
+    /* Filled in ascending order of chrpos, as the store_positions
+       procedures leave them.  On the minus strand, chrpos increases
+       from the right end of the region. */
+    if (plusp == true) {
+      for (i = 0; i < nmatches; i++) {
+	if (nhits[slot = hit_slots[i]] > 0) {
+	  *(pointers[slot]++) = chrpos + hit_offsets[i];
+	}
+      }
+    } else {
+      for (i = nmatches - 1; i >= 0; i--) {
+	if (nhits[slot = hit_slots[i]] > 0) {
+	  *(pointers[slot]++) = chrpos + (noligos - 1 - hit_offsets[i]);
+	}
+      }
+    }
+    FREE(pointers);
+  }
+
+  for (i = 0; i < nunique; i++) {
+    masked = keys[slots[i]];
+    querybits[masked/32] &= ~(1U << (masked % 32));
+  }
+
+  if (hit_slots != NULL) {
+    FREE(hit_offsets);
+    FREE(hit_slots);
+  }
+  FREE(slots);
+  FREE(nhits);
+  FREE(keys);
+
+  return;
+}
+
+
 /* Notes: genomicstart and genomicend define the region for alignment.
    Within that interval, mappingstart and mappingend define the region
    for allowable mappings.  This allows GSNAP to define a larger
@@ -27665,10 +27866,9 @@ store_positions (Chrpos_T **pointers, bool *overabundant,
    running stage 2 */
 
 
-/* chrpos is sequencepos */
-void
-Oligoindex_hr_tally (T this, Univcoord_T mappingstart, Univcoord_T mappingend, bool plusp,
-		     char *queryuc_ptr, int querystart, int queryend, Chrpos_T chrpos, int genestrand) {
+static void
+tally_oligospace (T this, Univcoord_T mappingstart, Univcoord_T mappingend, bool plusp,
+		  char *queryuc_ptr, int querystart, int queryend, Chrpos_T chrpos, int genestrand) {
   int badoligos, repoligos, trimoligos, trim_start, trim_end;
 #ifdef DEBUG14
   Count0_T *counts_old;
@@ -27768,6 +27968,94 @@ Oligoindex_hr_tally (T this, Univcoord_T mappingstart, Univcoord_T mappingend, b
   return;
 }
 
+
+#ifdef DEBUG15
+/* Runs both engines on the same region and query, and checks that the
+   query table gives the oligospace tally's counts and positions for
+   every query oligo, including oligos dropped for overflowing Count_T,
+   the order of positions on the minus strand, and the CMET reduction */
+static void
+querytable_compare (T this, Univcoord_T mappingstart, Univcoord_T mappingend, bool plusp,
+		    char *queryuc_ptr, int querystart, int queryend, Chrpos_T chrpos, int genestrand) {
+  Count_T *counts;
+  Chrpos_T **positions, *positions_space;
+  Shortoligomer_T oligo = 0U, masked;
+  int in_counter = 0, i, hit;
+  char *q, *nt;
+
+  tally_oligospace(this,mappingstart,mappingend,plusp,queryuc_ptr,querystart,queryend,chrpos,genestrand);
+  counts = (Count_T *) MALLOC(this->oligospace*sizeof(Count_T));
+  positions = (Chrpos_T **) MALLOC(this->oligospace*sizeof(Chrpos_T *));
+  memcpy((void *) counts,this->counts,this->oligospace*sizeof(Count_T));
+  memcpy((void *) positions,this->positions,this->oligospace*sizeof(Chrpos_T *));
+  positions_space = this->positions_space;
+
+  tally_querytable(this,mappingstart,mappingend,plusp,queryuc_ptr,querystart,queryend,chrpos,genestrand);
+
+  for (i = querystart, q = &(queryuc_ptr[querystart]); i < queryend; i++, q++) {
+    in_counter++;
+
+    switch (*q) {
+    case 'A': oligo = (oligo << 2); break;
+    case 'C': oligo = (oligo << 2) | 1; break;
+    case 'G': oligo = (oligo << 2) | 2; break;
+    case 'T': oligo = (oligo << 2) | 3; break;
+    default: oligo = 0U; in_counter = 0; break;
+    }
+
+    if (in_counter == this->indexsize) {
+      masked = oligo & this->mask;
+      if (this->counts[masked] != counts[masked]) {
+	nt = shortoligo_nt(masked,this->indexsize);
+	printf("%s strand, mapping %u..%u, oligo %s: query table count %d != oligospace count %d\n",
+	       plusp == true ? "plus" : "minus",mappingstart,mappingend,nt,this->counts[masked],counts[masked]);
+	FREE(nt);
+	abort();
+      }
+      for (hit = 0; hit < counts[masked]; hit++) {
+	if (this->positions[masked][hit] != positions[masked][hit]) {
+	  nt = shortoligo_nt(masked,this->indexsize);
+	  printf("%s strand, mapping %u..%u, oligo %s, hit %d/%d: query table position %u != oligospace position %u\n",
+		 plusp == true ? "plus" : "minus",mappingstart,mappingend,nt,hit,counts[masked],
+		 this->positions[masked][hit],positions[masked][hit]);
+	  FREE(nt);
+	  abort();
+	}
+      }
+      in_counter--;
+    }
+  }
+
+  if (positions_space != NULL) {
+    FREE(positions_space);
+  }
+  FREE(positions);
+  FREE(counts);
+
+  return;
+}
+#endif
+
+
+/* chrpos is sequencepos */
+void
+Oligoindex_hr_tally (T this, Univcoord_T mappingstart, Univcoord_T mappingend, bool plusp,
+		     char *queryuc_ptr, int querystart, int queryend, Chrpos_T chrpos, int genestrand) {
+
+  if (queryend - querystart > this->indexsize && mappingend > mappingstart &&
+      (mappingend - mappingstart) + (queryend - querystart) < this->oligospace/QUERYTABLE_REGION_RATIO) {
+#ifdef DEBUG15
+    querytable_compare(this,mappingstart,mappingend,plusp,queryuc_ptr,querystart,queryend,chrpos,genestrand);
+#else
+    tally_querytable(this,mappingstart,mappingend,plusp,queryuc_ptr,querystart,queryend,chrpos,genestrand);
+#endif
+  } else {
+    tally_oligospace(this,mappingstart,mappingend,plusp,queryuc_ptr,querystart,queryend,chrpos,genestrand);
+  }
+
+  return;
+}
+
   
 
 void
@@ -27858,6 +28146,7 @@ Oligoindex_free (T *old) {
   if (*old) {
     FREE((*old)->pointers_allocated);
     FREE((*old)->positions);
+    FREE((*old)->querybits);
 #ifdef HAVE_SSE2
     _mm_free((*old)->counts_allocated);
     _mm_free((*old)->inquery_allocated);
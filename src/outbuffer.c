@@ -56,6 +56,7 @@ static bool quiet_if_excessive_p;
 
 #ifdef GSNAP
 static bool output_sam_p;
+static Manifest_T manifest;
 #else
 static Printtype_T printtype;
 static Sequence_T usersegment;
@@ -88,6 +89,27 @@ static FILE **outputs = NULL;
 #ifdef GSNAP
 static FILE *output_failedinput_1;
 static FILE *output_failedinput_2;
+
+/* With a manifest, each sample gets its own set of outputs.
+   sample_roots holds the --split-output root for the sample, or its
+   output file if --split-output was not given.  header_sampleid
+   selects the @RG line and is set only by the output thread, before
+   it opens or touches a sample's files. */
+static FILE ***sample_outputs = NULL;
+static char **sample_roots = NULL;
+static int header_sampleid = 0;
+
+/* A sample's files are closed once all of its requests are printed,
+   so that a long manifest does not hold every sample's files open.
+   sample_nrequests is -1U until Inbuffer has moved past the sample.
+   Samples are finished in order, so samples below sample_nclosed are
+   closed. */
+static unsigned int *sample_nrequests = NULL;
+static unsigned int *sample_nprinted = NULL;
+static int sample_nclosed = 0;
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t sample_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 #else
 static FILE *output_failedinput;
 #endif
@@ -151,6 +173,14 @@ print_file_headers (
   if (output_sam_p == true && sam_headers_p == true) {
     SAM_header_print_HD(output,nworkers,orderedp);
     SAM_header_print_PG(output,argc,argv,optind_save);
+#ifndef USE_MPI
+    if (manifest != NULL) {
+      Univ_IIT_dump_sam(output,chromosome_iit,Manifest_read_group_id(manifest,header_sampleid),
+			Manifest_sample(manifest,header_sampleid),
+			sam_read_group_library,sam_read_group_platform);
+      return;
+    }
+#endif
     Univ_IIT_dump_sam(output,chromosome_iit,sam_read_group_id,sam_read_group_name,
 		      sam_read_group_library,sam_read_group_platform);
   }
@@ -262,7 +292,7 @@ Outbuffer_setup (int argc_in, char **argv_in, int optind_in,
 		 Univ_IIT_T chromosome_iit_in, bool any_circular_p_in,
 		 int nworkers_in, bool orderedp_in, bool quiet_if_excessive_p_in,
 #ifdef GSNAP
-		 bool output_sam_p_in, 
+		 bool output_sam_p_in, Manifest_T manifest_in,
 #else
 		 Printtype_T printtype_in, Sequence_T usersegment_in,
 #endif
@@ -271,6 +301,9 @@ Outbuffer_setup (int argc_in, char **argv_in, int optind_in,
 		 bool appendp_in, char *output_file_in, char *split_output_root_in, char *failedinput_root_in) {
 #ifdef USE_MPI
   SAM_split_output_type split_output;
+#elif defined(GSNAP)
+  int sampleid;
+  char *sample, *suffix;
 #endif
 
   
@@ -287,6 +320,7 @@ Outbuffer_setup (int argc_in, char **argv_in, int optind_in,
 
 #ifdef GSNAP
   output_sam_p = output_sam_p_in;
+  manifest = manifest_in;
 #else
   printtype = printtype_in;
   usersegment = usersegment_in;
@@ -346,6 +380,29 @@ Outbuffer_setup (int argc_in, char **argv_in, int optind_in,
     write_mode = "w";
   }
   outputs = (FILE **) CALLOC_KEEP(1+N_SPLIT_OUTPUTS,sizeof(FILE *));
+
+#ifdef GSNAP
+  if (manifest != NULL) {
+    suffix = (split_output_root != NULL) ? "" : (output_sam_p == true) ? ".sam" : ".gsnap";
+    sample_outputs = (FILE ***) CALLOC_KEEP(Manifest_nsamples(manifest),sizeof(FILE **));
+    sample_roots = (char **) CALLOC_KEEP(Manifest_nsamples(manifest),sizeof(char *));
+    sample_nrequests = (unsigned int *) MALLOC_KEEP(Manifest_nsamples(manifest)*sizeof(unsigned int));
+    sample_nprinted = (unsigned int *) CALLOC_KEEP(Manifest_nsamples(manifest),sizeof(unsigned int));
+    sample_nclosed = 0;
+    for (sampleid = 0; sampleid < Manifest_nsamples(manifest); sampleid++) {
+      sample = Manifest_sample(manifest,sampleid);
+      sample_nrequests[sampleid] = -1U;
+      sample_outputs[sampleid] = (FILE **) CALLOC_KEEP(1+N_SPLIT_OUTPUTS,sizeof(FILE *));
+      if (split_output_root != NULL) {
+	sample_roots[sampleid] = (char *) MALLOC_KEEP((strlen(split_output_root)+strlen(".")+strlen(sample)+1)*sizeof(char));
+	sprintf(sample_roots[sampleid],"%s.%s",split_output_root,sample);
+      } else {
+	sample_roots[sampleid] = (char *) MALLOC_KEEP((strlen(sample)+strlen(suffix)+1)*sizeof(char));
+	sprintf(sample_roots[sampleid],"%s%s",sample,suffix);
+      }
+    }
+  }
+#endif
 #endif
 
 
@@ -702,10 +759,80 @@ touch_all_files (FILE **outputs, char *split_output_root, bool appendp) {
 #endif
 
 
+#if defined(GSNAP) && !defined(USE_MPI)
+/* Every sample gets its files, even if none of its reads were output */
+static void
+close_sample_outputs (int sampleid) {
+  SAM_split_output_type split_output;
+
+  header_sampleid = sampleid;
+  if (split_output_root != NULL) {
+    touch_all_files(sample_outputs[sampleid],sample_roots[sampleid],appendp);
+    for (split_output = 1; split_output <= N_SPLIT_OUTPUTS; split_output++) {
+      if (sample_outputs[sampleid][split_output] != NULL) {
+	fclose(sample_outputs[sampleid][split_output]);
+	sample_outputs[sampleid][split_output] = (FILE *) NULL;
+      }
+    }
+  } else {
+    if (sample_outputs[sampleid][0] == NULL) {
+      sample_outputs[sampleid][0] = SAM_header_open_file(/*split_output*/OUTPUT_NONE,sample_roots[sampleid],appendp);
+      print_file_headers(sample_outputs[sampleid][0]);
+    }
+    fclose(sample_outputs[sampleid][0]);
+    sample_outputs[sampleid][0] = (FILE *) NULL;
+  }
+  return;
+}
+
+/* Called by the output thread after it prints a request of printed_sampleid */
+static void
+close_finished_samples (int printed_sampleid) {
+  int sampleid;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&sample_lock);
+#endif
+  sample_nprinted[printed_sampleid] += 1;
+  while (sample_nclosed < Manifest_nsamples(manifest) &&
+	 sample_nprinted[sample_nclosed] == sample_nrequests[sample_nclosed]) {
+    sampleid = sample_nclosed++;
+#ifdef HAVE_PTHREAD
+    pthread_mutex_unlock(&sample_lock);
+#endif
+    close_sample_outputs(sampleid);
+#ifdef HAVE_PTHREAD
+    pthread_mutex_lock(&sample_lock);
+#endif
+  }
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&sample_lock);
+#endif
+  return;
+}
+
+/* Called by Inbuffer once it has read the last request of a sample */
+void
+Outbuffer_sample_done (int sampleid, unsigned int nrequests) {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&sample_lock);
+#endif
+  sample_nrequests[sampleid] = nrequests;
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&sample_lock);
+#endif
+  return;
+}
+#endif
+
+
 
 void
 Outbuffer_close_files () {
   SAM_split_output_type split_output;
+#if defined(GSNAP) && !defined(USE_MPI)
+  int sampleid;
+#endif
 
   if (failedinput_root != NULL) {
 #ifdef USE_MPI
@@ -739,6 +866,22 @@ Outbuffer_close_files () {
   }
 
 #else
+#ifdef GSNAP
+  if (manifest != NULL) {
+    for (sampleid = 0; sampleid < Manifest_nsamples(manifest); sampleid++) {
+      if (sampleid >= sample_nclosed) {
+	close_sample_outputs(sampleid);
+      }
+      FREE_KEEP(sample_outputs[sampleid]);
+      FREE_KEEP(sample_roots[sampleid]);
+    }
+    FREE_KEEP(sample_nprinted);
+    FREE_KEEP(sample_nrequests);
+    FREE_KEEP(sample_roots);
+    FREE_KEEP(sample_outputs);
+
+  } else
+#endif
   if (split_output_root != NULL) {
     touch_all_files(outputs,split_output_root,appendp);
 
@@ -889,7 +1032,8 @@ Outbuffer_print_filestrings (Filestring_T fp, Filestring_T fp_failedinput_1, Fil
 #ifdef USE_MPI
   MPI_File output;
 #else
-  FILE *output;
+  FILE *output, **these_outputs;
+  char *root;
 #endif
 
 #ifdef USE_MPI
@@ -897,10 +1041,19 @@ Outbuffer_print_filestrings (Filestring_T fp, Filestring_T fp_failedinput_1, Fil
   output = outputs[split_output];
 
 #else
+  if (manifest == NULL) {
+    these_outputs = outputs;
+    root = split_output_root;
+  } else {
+    header_sampleid = Filestring_sampleid(fp);
+    these_outputs = sample_outputs[header_sampleid];
+    root = sample_roots[header_sampleid];
+  }
+
   if (split_output_root != NULL) {
     split_output = Filestring_split_output(fp);
-    if ((output = outputs[split_output]) == NULL) {
-      output = outputs[split_output] = SAM_header_open_file(split_output,split_output_root,appendp);
+    if ((output = these_outputs[split_output]) == NULL) {
+      output = these_outputs[split_output] = SAM_header_open_file(split_output,root,appendp);
       if (split_output == OUTPUT_NONE && split_output_root != NULL) {
 	/* Don't print file headers, since no output will go to
 	   stdout.  Must be a nomapping when --nofails is specified */
@@ -908,8 +1061,11 @@ Outbuffer_print_filestrings (Filestring_T fp, Filestring_T fp_failedinput_1, Fil
 	print_file_headers(output);
       }
     }
-  } else if ((output = outputs[0]) == NULL) {
-    if (output_file == NULL) {
+  } else if ((output = these_outputs[0]) == NULL) {
+    if (manifest != NULL) {
+      output = these_outputs[0] = SAM_header_open_file(/*split_output*/OUTPUT_NONE,root,appendp);
+      print_file_headers(output);
+    } else if (output_file == NULL) {
       output = outputs[0] = stdout;
       print_file_headers(stdout);
     } else {
@@ -926,6 +1082,12 @@ Outbuffer_print_filestrings (Filestring_T fp, Filestring_T fp_failedinput_1, Fil
   Filestring_print(output,fp);
   Filestring_free(&fp);
 
+#ifndef USE_MPI
+  if (manifest != NULL) {
+    close_finished_samples(header_sampleid);
+  }
+#endif
+
   if (failedinput_root != NULL) {
     if (fp_failedinput_1 != NULL) {
 #ifdef USE_MPI
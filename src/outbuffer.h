@@ -16,6 +16,7 @@
 
 #ifdef GSNAP
 #include "resulthr.h"
+#include "manifest.h"
 
 #else
 #include "stage3.h"		/* Has Printtype_T */
@@ -32,7 +33,7 @@ Outbuffer_setup (int argc_in, char **argv_in, int optind_in,
 		 Univ_IIT_T chromosome_iit_in, bool any_circular_p_in,
 		 int nworkers_in, bool orderedp_in, bool quiet_if_excessive_p_in,
 #ifdef GSNAP
-		 bool output_sam_p_in, 
+		 bool output_sam_p_in, Manifest_T manifest_in,
 #else
 		 Printtype_T printtype_in, Sequence_T usersegment_in,
 #endif
@@ -49,6 +50,11 @@ Outbuffer_new (unsigned int output_buffer_size, unsigned int nread);
 extern void
 Outbuffer_close_files ();
 
+#if defined(GSNAP) && !defined(USE_MPI)
+extern void
+Outbuffer_sample_done (int sampleid, unsigned int nrequests);
+#endif
+
 extern void
 Outbuffer_free (T *old);
 
@@ -38,6 +38,7 @@ static bool invert_first_p;
 static bool invert_second_p;
 
 static bool merge_samechr_p;
+static Manifest_T manifest;
 
 #else
 static Printtype_T printtype;
@@ -81,7 +82,7 @@ Output_setup (Univ_IIT_T chromosome_iit_in,
 	      char *failedinput_root_in, int quality_shift_in,
 #ifdef GSNAP
 	      bool output_sam_p_in, bool print_m8_p_in,	bool invert_first_p_in, bool invert_second_p_in,
-	      bool merge_samechr_p_in,
+	      bool merge_samechr_p_in, Manifest_T manifest_in,
 #else
 	      Printtype_T printtype_in, int invertmode_in, int wraplength_in, int ngap_in,
 	      bool nointronlenp_in, bool sam_paired_p_in, int cds_startpos_in,
@@ -112,6 +113,7 @@ Output_setup (Univ_IIT_T chromosome_iit_in,
   invert_second_p = invert_second_p_in;
 
   merge_samechr_p = merge_samechr_p_in;
+  manifest = manifest_in;
 
 #else
   printtype = printtype_in;
@@ -166,7 +168,13 @@ filestring_fromresult_sam (Filestring_T *fp_failedinput_1, Filestring_T *fp_fail
   Stage3end_T *stage3array, stage3;
   Chrpos_T chrpos;
   int npaths, pathnum, first_absmq, second_absmq;
-  char *abbrev;
+  char *abbrev, *read_group_id;
+
+  if (manifest == NULL) {
+    read_group_id = sam_read_group_id;
+  } else {
+    read_group_id = Manifest_read_group_id(manifest,Request_sampleid(request));
+  }
 
   fp = Filestring_new(Request_id(request));
   if (failedinput_root == NULL) {
@@ -187,7 +195,7 @@ filestring_fromresult_sam (Filestring_T *fp_failedinput_1, Filestring_T *fp_fail
 			  queryseq1,/*mate*/NULL,/*acc1*/Shortread_accession(queryseq1),
 			  /*acc2*/NULL,chromosome_iit,resulttype,
 			  /*first_read_p*/true,/*npaths*/0,/*npaths_mate*/0,/*mate_chrpos*/0U,
-			  quality_shift,sam_read_group_id,invert_first_p,invert_second_p);
+			  quality_shift,read_group_id,invert_first_p,invert_second_p);
       if (failedinput_root != NULL) {
 	Shortread_print_query_singleend(*fp_failedinput_1,queryseq1,/*headerseq*/queryseq1);
       }
@@ -222,7 +230,7 @@ filestring_fromresult_sam (Filestring_T *fp_failedinput_1, Filestring_T *fp_fail
 		/*pairedlength*/0,chrpos,/*mate_chrpos*/0U,
 		/*clipdir*/0,/*hardclip5_low*/0,/*hardclip5_high*/0,/*hardclip3_low*/0,/*hardclip3_high*/0,
 		resulttype,/*first_read_p*/true,/*npaths_mate*/0,quality_shift,
-		sam_read_group_id,invert_first_p,invert_second_p,merge_samechr_p);
+		read_group_id,invert_first_p,invert_second_p,merge_samechr_p);
     }
 
   } else if (resulttype == SINGLEEND_TRANSLOC) {
@@ -238,7 +246,7 @@ filestring_fromresult_sam (Filestring_T *fp_failedinput_1, Filestring_T *fp_fail
 			  queryseq1,/*mate*/NULL,/*acc1*/Shortread_accession(queryseq1),
 			  /*acc2*/NULL,chromosome_iit,resulttype,
 			  /*first_read_p*/true,npaths,/*npaths_mate*/0,/*mate_chrpos*/0U,
-			  quality_shift,sam_read_group_id,invert_first_p,invert_second_p);
+			  quality_shift,read_group_id,invert_first_p,invert_second_p);
       if (failedinput_root != NULL) {
 	Shortread_print_query_singleend(*fp_failedinput_1,queryseq1,/*headerseq*/queryseq1);
       }
@@ -263,7 +271,7 @@ filestring_fromresult_sam (Filestring_T *fp_failedinput_1, Filestring_T *fp_fail
 		  /*pairedlength*/0,chrpos,/*mate_chrpos*/0U,
 		  /*clipdir*/0,/*hardclip5_low*/0,/*hardclip5_high*/0,/*hardclip3_low*/0,/*hardclip3_high*/0,
 		  resulttype,/*first_read_p*/true,/*npaths_mate*/0,quality_shift,
-		  sam_read_group_id,invert_first_p,invert_second_p,merge_samechr_p);
+		  read_group_id,invert_first_p,invert_second_p,merge_samechr_p);
       }
     }
 
@@ -280,7 +288,7 @@ filestring_fromresult_sam (Filestring_T *fp_failedinput_1, Filestring_T *fp_fail
 			  queryseq1,/*mate*/NULL,/*acc1*/Shortread_accession(queryseq1),
 			  /*acc2*/NULL,chromosome_iit,resulttype,
 			  /*first_read_p*/true,npaths,/*npaths_mate*/0,/*mate_chrpos*/0U,
-			  quality_shift,sam_read_group_id,invert_first_p,invert_second_p);
+			  quality_shift,read_group_id,invert_first_p,invert_second_p);
       if (failedinput_root != NULL) {
 	Shortread_print_query_singleend(*fp_failedinput_1,queryseq1,/*headerseq*/queryseq1);
       }
@@ -305,7 +313,7 @@ filestring_fromresult_sam (Filestring_T *fp_failedinput_1, Filestring_T *fp_fail
 		  /*pairedlength*/0,chrpos,/*mate_chrpos*/0U,
 		  /*clipdir*/0,/*hardclip5_low*/0,/*hardclip5_high*/0,/*hardclip3_low*/0,/*hardclip3_high*/0,
 		  resulttype,/*first_read_p*/true,/*npaths_mate*/0,quality_shift,
-		  sam_read_group_id,invert_first_p,invert_second_p,merge_samechr_p);
+		  read_group_id,invert_first_p,invert_second_p,merge_samechr_p);
       }
     }
 
@@ -318,7 +326,7 @@ filestring_fromresult_sam (Filestring_T *fp_failedinput_1, Filestring_T *fp_fail
     SAM_print_paired(fp,*fp_failedinput_1,*fp_failedinput_2,result,resulttype,chromosome_iit,
 		     Request_queryseq1(request),Request_queryseq2(request),
 		     invert_first_p,invert_second_p,nofailsp,failsonlyp,
-		     merge_samechr_p,quality_shift,sam_read_group_id);
+		     merge_samechr_p,quality_shift,read_group_id);
   }
 
   return fp;
@@ -538,11 +546,15 @@ filestring_fromresult_gsnap (Filestring_T *fp_failedinput_1, Filestring_T *fp_fa
 Filestring_T
 Output_filestring_fromresult (Filestring_T *fp_failedinput_1, Filestring_T *fp_failedinput_2,
 			      Result_T result, Request_T request) {
+  Filestring_T fp;
+
   if (output_sam_p == true) {
-    return filestring_fromresult_sam(&(*fp_failedinput_1),&(*fp_failedinput_2),result,request);
+    fp = filestring_fromresult_sam(&(*fp_failedinput_1),&(*fp_failedinput_2),result,request);
   } else {
-    return filestring_fromresult_gsnap(&(*fp_failedinput_1),&(*fp_failedinput_2),result,request);
+    fp = filestring_fromresult_gsnap(&(*fp_failedinput_1),&(*fp_failedinput_2),result,request);
   }
+  Filestring_set_sampleid(fp,Request_sampleid(request));
+  return fp;
 }
 
 #else
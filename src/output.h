@@ -15,6 +15,7 @@
 
 #ifdef GSNAP
 #include "resulthr.h"
+#include "manifest.h"
 #else
 #include "result.h"
 #include "sequence.h"
@@ -27,7 +28,7 @@ Output_setup (Univ_IIT_T chromosome_iit_in,
 	      char *failedinput_root_in, int quality_shift_in,
 #ifdef GSNAP
 	      bool output_sam_p_in, bool print_m8_p_in, bool invert_first_p_in, bool invert_second_p_in,
-	      bool merge_samechr_p_in,
+	      bool merge_samechr_p_in, Manifest_T manifest_in,
 #else
 	      Printtype_T printtype_in, int invertmode_in, int wraplength_in, int ngap_in,
 	      bool nointronlenp_in, bool sam_paired_p_in, int cds_startpos_in,
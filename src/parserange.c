@@ -297,13 +297,15 @@ find_div (int *div_strlen, char *string, int sep) {
 }
 
 
-bool
-Parserange_query (char **divstring, Univcoord_T *coordstart, Univcoord_T *coordend, bool *revcomp,
-		  char *query, char *filename) {
+/* If query_iit is non-NULL, it must have been read from filename with
+   all divs, and is used instead of re-reading the file */
+static bool
+parse_query (char **divstring, Univcoord_T *coordstart, Univcoord_T *coordend, bool *revcomp,
+	     char *query, char *filename, IIT_T query_iit) {
   char *coords;
   Univcoord_T result, left;
   Chrpos_T length;
-  int div_strlen;
+  int div_strlen, divint;
   IIT_T iit;
   
   *divstring = NULL;
@@ -313,15 +315,27 @@ Parserange_query (char **divstring, Univcoord_T *coordstart, Univcoord_T *coorde
     /* Query may have a div */
     *divstring = (char *) MALLOC((div_strlen+1) * sizeof(char)); /* Return value */
     strncpy(*divstring,query,div_strlen);
+    (*divstring)[div_strlen] = '\0';
 
     debug(printf("Parsed query %s into divstring %s and coords %s\n",
 		 query,*divstring,coords));
 
-    if (IIT_read_divint(filename,*divstring,/*add_iit_p*/true) < 0) {
+    if (query_iit != NULL) {
+      divint = IIT_divint(query_iit,*divstring);
+    } else {
+      divint = IIT_read_divint(filename,*divstring,/*add_iit_p*/true);
+    }
+
+    if (divint < 0) {
       fprintf(stderr,"Chromosome %s not found in IIT file\n",*divstring);
       debug(printf("  but divstring not found, so treat as label\n"));
       FREE(*divstring);	/* free only when returning false */
       return false;
+    } else if ((coords == NULL || *coords == '\0') && query_iit != NULL) {
+      debug(printf("  entire div\n"));
+      *coordstart= 0;
+      *coordend = IIT_divlength(query_iit,*divstring);
+      return true;
     } else if (coords == NULL || *coords == '\0') {
       debug(printf("  entire div\n"));
       if ((iit = IIT_read(filename,/*name*/NULL,/*readonlyp*/true,/*divread*/READ_ONE,*divstring,
@@ -378,6 +392,22 @@ Parserange_query (char **divstring, Univcoord_T *coordstart, Univcoord_T *coorde
 }
 
 
+bool
+Parserange_query (char **divstring, Univcoord_T *coordstart, Univcoord_T *coordend, bool *revcomp,
+		  char *query, char *filename) {
+  return parse_query(&(*divstring),&(*coordstart),&(*coordend),&(*revcomp),query,filename,
+		     /*query_iit*/NULL);
+}
+
+/* Same as Parserange_query, but looks up divs in an IIT already read
+   from the file with all divs */
+bool
+Parserange_query_iit (char **divstring, Univcoord_T *coordstart, Univcoord_T *coordend, bool *revcomp,
+		      char *query, IIT_T iit) {
+  return parse_query(&(*divstring),&(*coordstart),&(*coordend),&(*revcomp),query,/*filename*/NULL,iit);
+}
+
+
 
 bool
 Parserange_universal (char **div, bool *revcomp,
@@ -6,6 +6,7 @@
 #include "genomicpos.h"
 #include "types.h"
 #include "iit-read-univ.h"
+#include "iit-read.h"
 
 extern bool
 Parserange_iscoordp (Univcoord_T *result, char *string);
@@ -17,6 +18,9 @@ Parserange_israngep (Univcoord_T *left, Chrpos_T *length, bool *revcomp, char *s
 extern bool
 Parserange_query (char **divstring, Univcoord_T *coordstart, Univcoord_T *coordend, bool *revcomp,
 		  char *query, char *filename);
+extern bool
+Parserange_query_iit (char **divstring, Univcoord_T *coordstart, Univcoord_T *coordend, bool *revcomp,
+		      char *query, IIT_T iit);
 
 
 /* genomicstart is 0-based, chrstart is 1-based */
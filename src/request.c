@@ -11,6 +11,7 @@ static char rcsid[] = "$Id: request.c 155282 2014-12-12 19:42:54Z twu $";
 struct T {
   int id;
 #ifdef GSNAP
+  int sampleid;			/* Index into the manifest, or 0 */
   Shortread_T queryseq1;
   Shortread_T queryseq2;
 #else
@@ -36,12 +37,18 @@ Request_queryseq2 (T this) {
   return this->queryseq2;
 }
 
+int
+Request_sampleid (T this) {
+  return this->sampleid;
+}
+
 
 T
-Request_new (int id, Shortread_T queryseq1, Shortread_T queryseq2) {
+Request_new (int id, int sampleid, Shortread_T queryseq1, Shortread_T queryseq2) {
   T new = (T) MALLOC_IN(sizeof(*new));
 
   new->id = id;
+  new->sampleid = sampleid;
   new->queryseq1 = queryseq1;
   new->queryseq2 = queryseq2;
   return new;
@@ -20,8 +20,10 @@ extern Shortread_T
 Request_queryseq1 (T this);
 extern Shortread_T
 Request_queryseq2 (T this);
+extern int
+Request_sampleid (T this);
 extern T
-Request_new (int id, Shortread_T queryseq1, Shortread_T queryseq2);
+Request_new (int id, int sampleid, Shortread_T queryseq1, Shortread_T queryseq2);
 
 #else
 
@@ -0,0 +1,565 @@
+static char rcsid[] = "$Id: resultcache.c $";
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "resultcache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>		/* For memcpy, memcmp, strlen */
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
+#include "mem.h"
+#include "bool.h"
+#include "types.h"
+#include "shortread.h"
+
+
+/* Caches the SAM output of each distinct read (or pair), so that
+   duplicate reads skip alignment.  The stored text has the QNAME and
+   QUAL fields removed from each line, and both are printed from the
+   new read when the text is reused.  Reads are keyed with only their
+   maximum quality score (see Shortread_cache_keylength), which
+   determines the MAPQ of a unique alignment, so output with more than
+   one path is not cached.  Entries are spread over independently
+   locked stripes, and each stripe evicts with the CLOCK policy once
+   it has used its share of the memory budget. */
+
+#define NSTRIPES 64
+#define BYTES_PER_ENTRY_ESTIMATE 1024 /* For sizing the hash tables */
+#define MIN_NBUCKETS 64
+
+#ifdef DEBUG
+#define debug(x) x
+#else
+#define debug(x)
+#endif
+
+
+/* Where the QUAL field was removed from a stored line, and how to
+   print it from the new read */
+typedef struct Qual_T *Qual_T;
+struct Qual_T {
+  int textpos;			/* Offset in text */
+  bool secondp;			/* From queryseq2 */
+  bool revcompp;
+};
+
+typedef struct Entry_T *Entry_T;
+struct Entry_T {
+  UINT8 hashval;
+  char *key;
+  int keylength;
+  char *text;			/* Output lines, each starting at the tab after the QNAME */
+  int textlength;
+  struct Qual_T *quals;		/* One per line */
+  int nlines;
+  SAM_split_output_type split_output;
+  bool referencedp;		/* CLOCK reference bit */
+  Entry_T next;			/* In hash chain */
+};
+
+struct Stripe_T {
+#ifdef HAVE_PTHREAD
+  pthread_mutex_t lock;
+#endif
+  Entry_T *buckets;
+  UINT8 bucketmask;
+
+  Entry_T *clock;		/* Entries, visited in turn by the CLOCK hand */
+  int nentries;
+  int maxentries;
+  int hand;
+
+  size_t nbytes;
+  UINT8 nhits;
+  UINT8 nmisses;
+};
+
+#define T Resultcache_T
+struct T {
+  struct Stripe_T stripes[NSTRIPES];
+  size_t maxbytes_per_stripe;
+  int quality_shift;
+};
+
+
+T
+Resultcache_new (size_t maxbytes, int quality_shift) {
+  T new = (T) MALLOC_KEEP(sizeof(*new));
+  struct Stripe_T *stripe;
+  UINT8 nbuckets;
+  int s;
+
+  new->maxbytes_per_stripe = maxbytes/NSTRIPES;
+  new->quality_shift = quality_shift;
+
+  nbuckets = MIN_NBUCKETS;
+  while (nbuckets * BYTES_PER_ENTRY_ESTIMATE < new->maxbytes_per_stripe) {
+    nbuckets *= 2;
+  }
+
+  for (s = 0; s < NSTRIPES; s++) {
+    stripe = &(new->stripes[s]);
+#ifdef HAVE_PTHREAD
+    pthread_mutex_init(&stripe->lock,NULL);
+#endif
+    stripe->buckets = (Entry_T *) CALLOC_KEEP(nbuckets,sizeof(Entry_T));
+    stripe->bucketmask = nbuckets - 1;
+    stripe->maxentries = MIN_NBUCKETS;
+    stripe->clock = (Entry_T *) MALLOC_KEEP(stripe->maxentries*sizeof(Entry_T));
+    stripe->nentries = 0;
+    stripe->hand = 0;
+    stripe->nbytes = 0;
+    stripe->nhits = stripe->nmisses = 0;
+  }
+
+  return new;
+}
+
+
+static size_t
+entry_size (Entry_T entry) {
+  return sizeof(*entry) + entry->keylength + entry->textlength + entry->nlines*sizeof(struct Qual_T);
+}
+
+static void
+entry_free (Entry_T *old) {
+  FREE_KEEP((*old)->key);
+  if ((*old)->text != NULL) {
+    FREE_KEEP((*old)->text);
+  }
+  if ((*old)->quals != NULL) {
+    FREE_KEEP((*old)->quals);
+  }
+  FREE_KEEP(*old);
+  return;
+}
+
+
+void
+Resultcache_free (T *old) {
+  struct Stripe_T *stripe;
+  int s, i;
+
+  if (*old) {
+    for (s = 0; s < NSTRIPES; s++) {
+      stripe = &((*old)->stripes[s]);
+      for (i = 0; i < stripe->nentries; i++) {
+	entry_free(&(stripe->clock[i]));
+      }
+      FREE_KEEP(stripe->clock);
+      FREE_KEEP(stripe->buckets);
+#ifdef HAVE_PTHREAD
+      pthread_mutex_destroy(&stripe->lock);
+#endif
+    }
+    FREE_KEEP(*old);
+  }
+  return;
+}
+
+
+/* FNV-1a */
+static UINT8
+hash_key (char *key, int keylength) {
+  UINT8 hashval = 14695981039346656037ULL;
+  int i;
+
+  for (i = 0; i < keylength; i++) {
+    hashval ^= (unsigned char) key[i];
+    hashval *= 1099511628211ULL;
+  }
+  return hashval;
+}
+
+static struct Stripe_T *
+get_stripe (T this, UINT8 hashval) {
+  /* High bits choose the stripe, and low bits the bucket within it */
+  return &(this->stripes[(hashval >> 58) % NSTRIPES]);
+}
+
+
+static char *
+make_key (int *keylength, Request_T request) {
+  char *key, *ptr;
+  Shortread_T queryseq1, queryseq2;
+  int sampleid;
+
+  queryseq1 = Request_queryseq1(request);
+  queryseq2 = Request_queryseq2(request);
+  sampleid = Request_sampleid(request);
+
+  /* The sample determines the read group, and a single end must not
+     match a pair */
+  *keylength = sizeof(int) + 1 + Shortread_cache_keylength(queryseq1);
+  if (queryseq2 != NULL) {
+    *keylength += Shortread_cache_keylength(queryseq2);
+  }
+
+  ptr = key = (char *) MALLOC_KEEP((*keylength)*sizeof(char));
+  memcpy(ptr,&sampleid,sizeof(int));
+  ptr += sizeof(int);
+  *ptr++ = (queryseq2 == NULL) ? 1 : 2;
+  ptr = Shortread_fill_cache_key(ptr,queryseq1);
+  if (queryseq2 != NULL) {
+    ptr = Shortread_fill_cache_key(ptr,queryseq2);
+  }
+
+  return key;
+}
+
+
+static Entry_T
+find_entry (struct Stripe_T *stripe, UINT8 hashval, char *key, int keylength) {
+  Entry_T entry;
+
+  for (entry = stripe->buckets[hashval & stripe->bucketmask]; entry != NULL; entry = entry->next) {
+    if (entry->hashval == hashval && entry->keylength == keylength &&
+	memcmp(entry->key,key,keylength) == 0) {
+      return entry;
+    }
+  }
+  return (Entry_T) NULL;
+}
+
+
+/* The QNAME printed by SAM_print and SAM_print_nomapping */
+static char *
+make_qname (int *qlength, Request_T request) {
+  char *qname, *acc1, *acc2;
+
+  acc1 = Shortread_accession(Request_queryseq1(request));
+  if (Request_queryseq2(request) == NULL ||
+      (acc2 = Shortread_accession(Request_queryseq2(request))) == NULL) {
+    *qlength = strlen(acc1);
+    qname = (char *) MALLOC((*qlength + 1)*sizeof(char));
+    strcpy(qname,acc1);
+  } else {
+    *qlength = strlen(acc1) + 1 + strlen(acc2);
+    qname = (char *) MALLOC((*qlength + 1)*sizeof(char));
+    sprintf(qname,"%s,%s",acc1,acc2);
+  }
+  return qname;
+}
+
+
+/* On a hit, returns the output for request and frees the key.  On a
+   miss, returns NULL and hands back the key for Resultcache_store */
+Filestring_T
+Resultcache_lookup (char **key, int *keylength, T this, Request_T request) {
+  Filestring_T fp;
+  struct Stripe_T *stripe;
+  Entry_T entry;
+  Qual_T qual;
+  Shortread_T queryseq;
+  UINT8 hashval;
+  char *qname, *p, *eol, *qualp;
+  int qlength, i;
+
+  *key = make_key(&(*keylength),request);
+  hashval = hash_key(*key,*keylength);
+  stripe = get_stripe(this,hashval);
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&stripe->lock);
+#endif
+  if ((entry = find_entry(stripe,hashval,*key,*keylength)) == NULL) {
+    stripe->nmisses += 1;
+    fp = (Filestring_T) NULL;
+
+  } else {
+    stripe->nhits += 1;
+    entry->referencedp = true;
+
+    fp = Filestring_new(Request_id(request));
+    Filestring_set_split_output(fp,entry->split_output);
+    Filestring_set_sampleid(fp,Request_sampleid(request));
+    qname = make_qname(&qlength,request);
+    p = entry->text;
+    for (i = 0; i < entry->nlines; i++) {
+      qual = &(entry->quals[i]);
+      qualp = &(entry->text[qual->textpos]);
+      eol = (char *) memchr(qualp,'\n',&(entry->text[entry->textlength]) - qualp);
+      queryseq = (qual->secondp == true) ? Request_queryseq2(request) : Request_queryseq1(request);
+
+      Filestring_puts(fp,qname,qlength);
+      Filestring_puts(fp,p,qualp - p);
+      if (qual->revcompp == false) {
+	Shortread_print_quality(fp,queryseq,/*hardclip_low*/0,/*hardclip_high*/0,
+				this->quality_shift,/*show_chopped_p*/false);
+      } else {
+	Shortread_print_quality_revcomp(fp,queryseq,/*hardclip_low*/0,/*hardclip_high*/0,
+					this->quality_shift,/*show_chopped_p*/false);
+      }
+      Filestring_puts(fp,qualp,eol + 1 - qualp);
+      p = eol + 1;
+    }
+    FREE(qname);
+  }
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&stripe->lock);
+#endif
+
+  if (fp != NULL) {
+    FREE_KEEP(*key);
+  }
+  return fp;
+}
+
+
+static void
+evict (struct Stripe_T *stripe, size_t maxbytes) {
+  Entry_T entry, *prev;
+
+  while (stripe->nbytes > maxbytes && stripe->nentries > 0) {
+    if (stripe->hand >= stripe->nentries) {
+      stripe->hand = 0;
+    }
+    entry = stripe->clock[stripe->hand];
+    if (entry->referencedp == true) {
+      entry->referencedp = false;
+      stripe->hand += 1;
+
+    } else {
+      prev = &(stripe->buckets[entry->hashval & stripe->bucketmask]);
+      while (*prev != entry) {
+	prev = &((*prev)->next);
+      }
+      *prev = entry->next;
+
+      stripe->nbytes -= entry_size(entry);
+      stripe->clock[stripe->hand] = stripe->clock[--stripe->nentries];
+      entry_free(&entry);
+    }
+  }
+
+  return;
+}
+
+
+/* Finds the QUAL field of line, which starts at the tab after the
+   QNAME, and works out how it was printed from its read.  Returns
+   false if it was not printed whole, as when the line keeps
+   hard-clipped quality scores in an XI tag. */
+static bool
+parse_qual (Qual_T qual, char **field, int *fieldlength, char *line, char *eol,
+	    Request_T request, int quality_shift) {
+  char *tab, *field_end, *quality, *p;
+  Shortread_T queryseq;
+  unsigned int flag;
+  int querylength, i, k;
+
+  tab = line;
+  for (k = 1; k < 10; k++) {
+    if ((tab = (char *) memchr(&(tab[1]),'\t',eol - &(tab[1]))) == NULL) {
+      return false;
+    }
+  }
+  *field = &(tab[1]);
+  if ((field_end = (char *) memchr(*field,'\t',eol - *field)) == NULL) {
+    field_end = eol;
+  }
+  *fieldlength = field_end - *field;
+
+  flag = (unsigned int) strtoul(&(line[1]),NULL,10);
+  qual->secondp = ((flag & 0x1) && (flag & 0x80)) ? true : false;
+  if ((queryseq = (qual->secondp == true) ? Request_queryseq2(request) : Request_queryseq1(request)) == NULL) {
+    return false;
+  } else if ((quality = Shortread_quality_string(queryseq)) == NULL) {
+    qual->revcompp = false;
+    return (*fieldlength == 1 && **field == '*') ? true : false;
+  } else if ((querylength = Shortread_fulllength(queryseq)) != *fieldlength) {
+    return false;
+  }
+
+  for (p = field_end; p + 6 <= eol; p++) {
+    if (strncmp(p,"\tXI:Z:",6) == 0) {
+      return false;
+    }
+  }
+
+  /* Unmapped reads have no 0x10 flag, and are printed as input */
+  qual->revcompp = ((flag & 0x10) != 0) != Shortread_invertedp(queryseq);
+  if (qual->revcompp == false) {
+    for (i = 0, k = 0; i < querylength; i++, k++) {
+      if ((*field)[k] != quality[i] + quality_shift) {
+	return false;
+      }
+    }
+  } else {
+    for (i = querylength - 1, k = 0; i >= 0; --i, k++) {
+      if ((*field)[k] != quality[i] + quality_shift) {
+	return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+/* Several paths get their MAPQ and order from the quality scores at
+   their mismatches, which the key leaves out */
+static bool
+multiple_paths_p (char *line, char *eol) {
+  char *p;
+
+  for (p = line; p + 6 <= eol; p++) {
+    if (strncmp(p,"\tNH:i:",6) == 0) {
+      return (atoi(&(p[6])) > 1) ? true : false;
+    }
+  }
+  return false;
+}
+
+
+/* Takes ownership of key.  Output that does not have the expected
+   QNAME at the start of every line, that has more than one path, or
+   that has a QUAL field that cannot be printed again from the next
+   read, is not cached. */
+void
+Resultcache_store (T this, char *key, int keylength, Request_T request, Filestring_T fp) {
+  struct Stripe_T *stripe;
+  Entry_T entry, *clock;
+  struct Qual_T *quals;
+  char *string, *qname, *p, *end, *eol, *dest, **fields;
+  int strlength, qlength, nlines, *fieldlengths, i;
+
+  string = Filestring_get(&strlength,fp);
+  qname = make_qname(&qlength,request);
+
+  /* Check that each line starts with the QNAME */
+  nlines = 0;
+  p = string;
+  end = &(string[strlength]);
+  while (p < end) {
+    if ((eol = (char *) memchr(p,'\n',end - p)) == NULL ||
+	eol - p <= qlength || p[qlength] != '\t' || strncmp(p,qname,qlength) != 0) {
+      FREE(qname);
+      FREE_KEEP(key);
+      return;
+    }
+    nlines++;
+    p = eol + 1;
+  }
+  FREE(qname);
+
+  if (nlines == 0) {
+    quals = (struct Qual_T *) NULL;
+  } else {
+    quals = (struct Qual_T *) MALLOC_KEEP(nlines*sizeof(struct Qual_T));
+  }
+  fields = (char **) MALLOC((nlines+1)*sizeof(char *));
+  fieldlengths = (int *) MALLOC((nlines+1)*sizeof(int));
+
+  p = string;
+  for (i = 0; i < nlines; i++) {
+    eol = (char *) memchr(p,'\n',end - p);
+    if (multiple_paths_p(&(p[qlength]),eol) == true ||
+	parse_qual(&(quals[i]),&(fields[i]),&(fieldlengths[i]),&(p[qlength]),eol,
+		   request,this->quality_shift) == false) {
+      FREE(fieldlengths);
+      FREE(fields);
+      FREE_KEEP(quals);
+      FREE_KEEP(key);
+      return;
+    }
+    p = eol + 1;
+  }
+
+  entry = (Entry_T) MALLOC_KEEP(sizeof(*entry));
+  entry->hashval = hash_key(key,keylength);
+  entry->key = key;
+  entry->keylength = keylength;
+  entry->split_output = Filestring_split_output(fp);
+  entry->referencedp = false;
+  entry->quals = quals;
+  entry->nlines = nlines;
+  entry->textlength = strlength - nlines*qlength;
+  for (i = 0; i < nlines; i++) {
+    entry->textlength -= fieldlengths[i];
+  }
+  if (entry->textlength == 0) {
+    entry->text = (char *) NULL;
+  } else {
+    dest = entry->text = (char *) MALLOC_KEEP(entry->textlength*sizeof(char));
+    p = string;
+    for (i = 0; i < nlines; i++) {
+      eol = (char *) memchr(p,'\n',end - p);
+      memcpy(dest,&(p[qlength]),fields[i] - &(p[qlength]));
+      dest += fields[i] - &(p[qlength]);
+      quals[i].textpos = dest - entry->text;
+      memcpy(dest,&(fields[i][fieldlengths[i]]),eol + 1 - &(fields[i][fieldlengths[i]]));
+      dest += eol + 1 - &(fields[i][fieldlengths[i]]);
+      p = eol + 1;
+    }
+  }
+  FREE(fieldlengths);
+  FREE(fields);
+
+  if (entry_size(entry) > this->maxbytes_per_stripe) {
+    entry_free(&entry);
+    return;
+  }
+
+  stripe = get_stripe(this,entry->hashval);
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&stripe->lock);
+#endif
+  if (find_entry(stripe,entry->hashval,key,keylength) != NULL) {
+    /* Another thread stored the same read first */
+    entry_free(&entry);
+
+  } else {
+    evict(stripe,this->maxbytes_per_stripe - entry_size(entry));
+    stripe->nbytes += entry_size(entry);
+
+    if (stripe->nentries == stripe->maxentries) {
+      clock = (Entry_T *) MALLOC_KEEP(2*stripe->maxentries*sizeof(Entry_T));
+      for (i = 0; i < stripe->nentries; i++) {
+	clock[i] = stripe->clock[i];
+      }
+      FREE_KEEP(stripe->clock);
+      stripe->clock = clock;
+      stripe->maxentries *= 2;
+    }
+    stripe->clock[stripe->nentries++] = entry;
+
+    entry->next = stripe->buckets[entry->hashval & stripe->bucketmask];
+    stripe->buckets[entry->hashval & stripe->bucketmask] = entry;
+  }
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&stripe->lock);
+#endif
+
+  return;
+}
+
+
+void
+Resultcache_report (T this) {
+  struct Stripe_T *stripe;
+  UINT8 nhits = 0, nmisses = 0;
+  size_t nbytes = 0;
+  int nentries = 0, s;
+
+  for (s = 0; s < NSTRIPES; s++) {
+    stripe = &(this->stripes[s]);
+    nhits += stripe->nhits;
+    nmisses += stripe->nmisses;
+    nentries += stripe->nentries;
+    nbytes += stripe->nbytes;
+  }
+
+  if (nhits + nmisses > 0) {
+    fprintf(stderr,"Result cache: %llu hits, %llu misses (%.1f%% hit rate), %d entries in %.1f MB\n",
+	    (unsigned long long) nhits,(unsigned long long) nmisses,
+	    100.0 * (double) nhits/(double) (nhits + nmisses),nentries,(double) nbytes/1048576.0);
+  }
+  return;
+}
+
@@ -0,0 +1,25 @@
+/* $Id: resultcache.h $ */
+#ifndef RESULTCACHE_INCLUDED
+#define RESULTCACHE_INCLUDED
+
+#include <stddef.h>
+#include "filestring.h"
+#include "request.h"
+
+#define T Resultcache_T
+typedef struct T *T;
+
+extern T
+Resultcache_new (size_t maxbytes, int quality_shift);
+extern void
+Resultcache_free (T *old);
+extern Filestring_T
+Resultcache_lookup (char **key, int *keylength, T this, Request_T request);
+extern void
+Resultcache_store (T this, char *key, int keylength, Request_T request, Filestring_T fp);
+extern void
+Resultcache_report (T this);
+
+#undef T
+#endif
+
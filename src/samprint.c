@@ -29,7 +29,7 @@ static char rcsid[] = "$Id: samprint.c 172734 2015-08-27 16:35:15Z twu $";
 #endif
 
 
-/* compute_cigar */
+/* print_cigar */
 #ifdef DEBUG1
 #define debug1(x) x
 #else
@@ -249,6 +249,55 @@ SAM_compute_chrpos (int hardclip_low, int hardclip_high, Stage3end_T this, int q
   }
 }
 
+/* The routines below emit the common SAM fields straight into the
+   Filestring_T, avoiding format parsing for every record */
+
+static void
+print_tab_int (Filestring_T fp, int x) {
+  PUTC('\t',fp);
+  Filestring_put_int(fp,x);
+  return;
+}
+
+static void
+print_tab_uint (Filestring_T fp, unsigned int x) {
+  PUTC('\t',fp);
+  Filestring_put_uint(fp,x);
+  return;
+}
+
+/* Prints \t<tag>:i:<x> */
+static void
+print_int_tag (Filestring_T fp, char *tag, int x) {
+  PUTC('\t',fp);
+  PUTC(tag[0],fp);
+  PUTC(tag[1],fp);
+  Filestring_puts(fp,":i:",3);
+  Filestring_put_int(fp,x);
+  return;
+}
+
+/* Prints \t<tag>:Z:<string> */
+static void
+print_string_tag (Filestring_T fp, char *tag, char *string) {
+  PUTC('\t',fp);
+  PUTC(tag[0],fp);
+  PUTC(tag[1],fp);
+  Filestring_puts(fp,":Z:",3);
+  Filestring_puts(fp,string,strlen(string));
+  return;
+}
+
+/* Prints the RNAME/POS or MRNM/MPOS pair */
+static void
+print_chr_pos (Filestring_T fp, char *chr, Chrpos_T chrpos) {
+  PUTC('\t',fp);
+  Filestring_puts(fp,chr,strlen(chr));
+  PUTC('\t',fp);
+  Filestring_put_uint(fp,chrpos);
+  return;
+}
+
 static void
 print_chromosomal_pos (Filestring_T fp, Chrnum_T chrnum, Chrpos_T chrpos, Chrpos_T chrlength,
 		       Univ_IIT_T chromosome_iit) {
@@ -273,9 +322,9 @@ print_chromosomal_pos (Filestring_T fp, Chrnum_T chrnum, Chrpos_T chrpos, Chrpos
 
     /* chrpos already in 1-based coordinates */
     if (chrpos > chrlength) {
-      FPRINTF(fp,"\t%s\t%u",chr,chrpos - chrlength /*+1U*/);
+      print_chr_pos(fp,chr,chrpos - chrlength /*+1U*/);
     } else {
-      FPRINTF(fp,"\t%s\t%u",chr,chrpos /*+1U*/);
+      print_chr_pos(fp,chr,chrpos /*+1U*/);
     }
 
     if (allocp == true) {
@@ -306,9 +355,9 @@ print_mate_chromosomal_pos (Filestring_T fp, Chrnum_T mate_chrnum, Chrnum_T mate
     if (anchor_chrpos > 0U && anchor_chrnum > 0 && mate_chrnum == anchor_chrnum) {
       /* chrpos already in 1-based coordinates */
       if (mate_chrpos > mate_chrlength) {
-	FPRINTF(fp,"\t=\t%u",mate_chrpos - mate_chrlength /*+1U*/);
+	print_chr_pos(fp,"=",mate_chrpos - mate_chrlength /*+1U*/);
       } else {
-	FPRINTF(fp,"\t=\t%u",mate_chrpos /*+1U*/);
+	print_chr_pos(fp,"=",mate_chrpos /*+1U*/);
       }
 
     } else {
@@ -316,9 +365,9 @@ print_mate_chromosomal_pos (Filestring_T fp, Chrnum_T mate_chrnum, Chrnum_T mate
 
       /* chrpos already in 1-based coordinates */
       if (mate_chrpos > mate_chrlength) {
-	FPRINTF(fp,"\t%s\t%u",chr,mate_chrpos - mate_chrlength /*+1U*/);
+	print_chr_pos(fp,chr,mate_chrpos - mate_chrlength /*+1U*/);
       } else {
-	FPRINTF(fp,"\t%s\t%u",chr,mate_chrpos /*+1U*/);
+	print_chr_pos(fp,chr,mate_chrpos /*+1U*/);
       }
 
       if (allocp == true) {
@@ -403,12 +452,12 @@ SAM_print_nomapping (Filestring_T fp, char *abbrev, Shortread_T queryseq, Stage3
 
   /* 12. TAGS: RG */
   if (sam_read_group_id != NULL) {
-    FPRINTF(fp,"\tRG:Z:%s",sam_read_group_id);
+    print_string_tag(fp,"RG",sam_read_group_id);
   }
   
   /* 12. TAGS: NH */
   if (npaths > 0) {
-    FPRINTF(fp,"\tNH:i:%d",npaths);
+    print_int_tag(fp,"NH",npaths);
   }
 
   /* 12. TAGS: XB */
@@ -418,7 +467,7 @@ SAM_print_nomapping (Filestring_T fp, char *abbrev, Shortread_T queryseq, Stage3
   Shortread_print_chop(fp,queryseq,invertp);
 
   /* 12. TAGS: XO */
-  FPRINTF(fp,"\tXO:Z:%s",abbrev);
+  print_string_tag(fp,"XO",abbrev);
 
   FPRINTF(fp,"\n");
 
@@ -426,289 +475,7 @@ SAM_print_nomapping (Filestring_T fp, char *abbrev, Shortread_T queryseq, Stage3
 }
 
 
-/* Derived from print_tokens_gff3 */
-static void
-print_tokens_sam (Filestring_T fp, List_T tokens) {
-  List_T p;
-  char *token;
-  
-  for (p = tokens; p != NULL; p = List_next(p)) {
-    token = (char *) List_head(p);
-    FPRINTF(fp,"%s",token);
-    FREE(token);
-  }
-
-  return;
-}
-
-static List_T
-push_token (List_T tokens, char *token) {
-  char *copy;
-
-  copy = (char *) CALLOC(strlen(token)+1,sizeof(char));
-  strcpy(copy,token);
-  return List_push(tokens,(void *) copy);
-}
-
-
-#if 0
-/* Currently used for insertions and deletions */
-static List_T
-compute_cigar_old (List_T tokens, char type, int stringlength, int querypos, int querylength,
-		   int hardclip_low, int hardclip_high, bool plusp, bool firstp, bool lastp) {
-  char token[10];
-  
-  debug1(printf("\nEntering compute_cigar with type %c, stringlength %d, querypos %d, querylength %d, hardclip_low %d, hardclip_high %d, plusp %d\n",
-		type,stringlength,querypos,querylength,hardclip_low,hardclip_high,plusp));
-
-  if (firstp == true) {
-    debug1(printf("firstp is true\n"));
-    if (plusp == true) {
-      if (hardclip_low > 0) {
-	sprintf(token,"%dH",hardclip_low);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-      if (querypos > hardclip_low) {
-	sprintf(token,"%dS",querypos - hardclip_low);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-    } else {
-      if (hardclip_high > 0) {
-	sprintf(token,"%dH",hardclip_high);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-      if (querypos < querylength - hardclip_high) {
-	sprintf(token,"%dS",querypos - hardclip_high);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-    }
-  }
-
-  if (type == 'D' || type == 'N') {
-    if (querypos < hardclip_low || querypos >= querylength - hardclip_high) {
-      stringlength = 0;
-    }
-
-  } else if (plusp == true) {
-    debug1(printf("Comparing querypos %d..%d against %d..%d\n",
-		  querypos,querypos + stringlength,hardclip_low,querylength - hardclip_high));
-    if (/* querypos < hardclip_low && */querypos + stringlength < hardclip_low) {
-      /* Print nothing */
-      stringlength = 0;
-      debug1(printf("Case 1: stringlength 0\n"));
-    } else if (querypos < hardclip_low) {
-      if (querypos + stringlength < querylength - hardclip_high) {
-	/* Print part after hardclip_low */
-	stringlength = (querypos + stringlength) - hardclip_low;
-	debug1(printf("Case 2: stringlength %d\n",stringlength));
-      } else {
-	/* Print part between hardclip_low and hardclip_high */
-	stringlength = (querylength - hardclip_high) - hardclip_low;
-	debug1(printf("Case 3: stringlength %d\n",stringlength));
-      }
-    } else if (querypos < querylength - hardclip_high) {
-      if (querypos + stringlength >= querylength - hardclip_high) {
-	/* Print up to hardclip_high */
-	stringlength = (querylength - hardclip_high) - querypos;
-	debug1(printf("Case 4: stringlength %d\n",stringlength));
-      } else {
-	/* Print full stringlength */
-	debug1(printf("Case 5: stringlength %d\n",stringlength));
-      }
-    } else {
-      /* Print nothing */
-      stringlength = 0;
-      debug1(printf("Case 6: stringlength 0\n"));
-    }
-
-  } else {
-    debug1(printf("Comparing querypos %d..%d against %d..%d\n",
-		  querypos,querypos - stringlength,hardclip_low,querylength - hardclip_high));
-    if (/* querypos >= querylength - hardclip_high && */ querypos - stringlength >= querylength - hardclip_high) {
-      /* Print nothing */
-      stringlength = 0;
-      debug1(printf("Case 1: stringlength 0\n"));
-    } else if (querypos >= querylength - hardclip_high) {
-      if (querypos - stringlength >= hardclip_low) {
-	/* Print part after hardclip_high */
-	stringlength = (querylength - hardclip_high) - (querypos - stringlength);
-	debug1(printf("Case 2: stringlength %d\n",stringlength));
-      } else {
-	/* Print part between hardclip_low and hardclip_high */
-	stringlength = (querylength - hardclip_high) - hardclip_low;
-	debug1(printf("Case 3: stringlength %d\n",stringlength));
-      }
-    } else if (querypos >= hardclip_low) {
-      if (querypos - stringlength < hardclip_low) {
-	/* Print up to hardclip_low */
-	stringlength = querypos - hardclip_low;
-	debug1(printf("Case 4: stringlength %d\n",stringlength));
-      } else {
-	/* Print full stringlength */
-	debug1(printf("Case 5: stringlength %d\n",stringlength));
-      }
-    } else {
-      /* Print nothing */
-      stringlength = 0;
-      debug1(printf("Case 5: stringlength 0\n"));
-    }
-  }
-
-  if (stringlength > 0) {
-    sprintf(token,"%d%c",stringlength,type);
-    debug1(printf("Pushing token %s\n",token));
-    tokens = push_token(tokens,token);
-  }
-
-  if (lastp == true) {
-    debug1(printf("lastp is true\n"));
-    if (plusp == true) {
-      querypos += stringlength;
-      if (querypos < querylength - 1 - hardclip_high) {
-	sprintf(token,"%dS",querylength - 1 - hardclip_high - querypos);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-      if (hardclip_high > 0) {
-	sprintf(token,"%dH",hardclip_high);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-    } else {
-      querypos -= stringlength;
-      if (querypos > hardclip_low) {
-	sprintf(token,"%dS",hardclip_low - querypos);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-      if (hardclip_low > 0) {
-	sprintf(token,"%dH",hardclip_low);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-    }
-  }
-
-  return tokens;
-}
-#endif
-
-
-/* Currently used for insertions and deletions */
-static List_T
-compute_cigar (List_T tokens, char type, int stringlength, int querypos, int querylength,
-	       int hardclip_low, int hardclip_high, bool plusp, int lastp) {
-  int matchlength = 0;
-  int startpos, endpos;
-  int cliplength = 0;
-  char token[10];
-  
-  if (plusp == true) {
-    debug1(printf("\nEntering compute_cigar with type %c, stringlength %d, querypos %d, querylength %d, hardclip_low %d, hardclip_high %d, plus\n",
-		  type,stringlength,querypos,querylength,hardclip_low,hardclip_high));
-    if (hardclip_low > querypos) { /* > not >= */
-      startpos = hardclip_low;
-      cliplength = hardclip_low;
-    } else {
-      startpos = querypos;
-    }
-
-    if (querylength - hardclip_high < querypos + stringlength) {
-      endpos = querylength - hardclip_high;
-      debug1(printf("  endpos %d = querylength %d - hardclip_high %d\n",endpos,querylength,hardclip_high));
-    } else {
-      endpos = querypos + stringlength;
-      debug1(printf("  endpos %d = querypos %d + stringlength %d\n",endpos,querypos,stringlength));
-    }
-
-    debug1(printf("  new startpos %d, endpos %d, cliplength %d\n",startpos,endpos,cliplength));
-
-    if (endpos >= startpos) {
-      if (cliplength > 0) {
-	debug1(printf("  Pushing initial %dH\n",cliplength));
-	sprintf(token,"%dH",cliplength);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-      matchlength = endpos - startpos;
-      if (matchlength > 0) {
-	debug1(printf("  Pushing %d%c\n",matchlength,type));
-	sprintf(token,"%d%c",matchlength,type);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-    }
-
-
-    if (lastp == true) {
-      /* cliplength = querypos + stringlength - endpos; */
-      cliplength = querylength - endpos;
-      if (cliplength > 0) {
-	debug1(printf("  Pushing final %dH\n",cliplength));
-	sprintf(token,"%dH",cliplength);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-    }
-
-  } else {
-    debug1(printf("\nEntering compute_cigar with type %c, stringlength %d, querypos %d, querylength %d, hardclip_low %d, hardclip_high %d, minus\n",
-		  type,stringlength,querypos,querylength,hardclip_low,hardclip_high));
-
-    if (querylength - hardclip_low < querypos) {
-      startpos = querylength - hardclip_low;
-      cliplength = hardclip_low;
-    } else {
-      startpos = querypos;
-    }
-
-    if (hardclip_high >= querypos - stringlength) {
-      endpos = hardclip_high;
-      debug1(printf("  endpos %d = hardclip_high %d\n",endpos,hardclip_high));
-    } else {
-      endpos = querypos - stringlength;
-      debug1(printf("  endpos %d = querypos %d - stringlength %d\n",endpos,querypos,stringlength));
-    }
-
-    debug1(printf("  new startpos %d, endpos %d, cliplength %d\n",startpos,endpos,cliplength));
-
-    if (endpos <= startpos) {
-      if (cliplength > 0) {
-	debug1(printf("  Pushing initial %dH\n",cliplength));
-	sprintf(token,"%dH",cliplength);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-      matchlength = startpos - endpos;
-      if (matchlength > 0) {
-	debug1(printf("  Pushing %d%c\n",matchlength,type));
-	sprintf(token,"%d%c",matchlength,type);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-    }
-
-
-    if (lastp == true) {
-      cliplength = endpos;
-      if (cliplength > 0) {
-	debug1(printf("  Pushing final %dH\n",cliplength));
-	sprintf(token,"%dH",cliplength);
-	debug1(printf("Pushing token %s\n",token));
-	tokens = push_token(tokens,token);
-      }
-    }
-  }
-
-  return tokens;
-}
-
-
-/* Modified from compute_cigar */
+/* Modified from print_cigar */
 static Intlist_T
 compute_cigar_types_only (Intlist_T types, char type, int stringlength, int querypos, int querylength,
 			  int hardclip_low, int hardclip_high, bool plusp, int lastp) {
@@ -805,6 +572,14 @@ compute_cigar_types_only (Intlist_T types, char type, int stringlength, int quer
 }
 
 
+/* Emits one CIGAR operation directly, without parsing a format */
+static void
+print_cigar_op (Filestring_T fp, unsigned int length, char op) {
+  Filestring_put_uint(fp,length);
+  PUTC(op,fp);
+  return;
+}
+
 static void
 print_cigar (Filestring_T fp, char type, int stringlength, int querypos, int querylength,
 	     int hardclip_low, int hardclip_high, bool plusp, bool lastp, int trimlength) {
@@ -835,20 +610,20 @@ print_cigar (Filestring_T fp, char type, int stringlength, int querypos, int que
     if (endpos >= startpos) {
       if (cliplength > 0) {
 	debug1(printf("  Pushing initial %dH\n",cliplength));
-	FPRINTF(fp,"%dH",cliplength);
+	print_cigar_op(fp,cliplength,'H');
       }
       matchlength = endpos - startpos;
       if (matchlength <= 0) {
 	/* Skip */
       } else if (type != 'E') {
 	debug1(printf("  Pushing %d%c\n",matchlength,type));
-	FPRINTF(fp,"%d%c",matchlength,type);
+	print_cigar_op(fp,matchlength,type);
       } else if (matchlength == trimlength) {
 	debug1(printf("  Pushing %dS\n",matchlength));
-	FPRINTF(fp,"%dS",matchlength);
+	print_cigar_op(fp,matchlength,'S');
       } else {
 	debug1(printf("  Pushing %dH\n",matchlength));
-	FPRINTF(fp,"%dH",matchlength);
+	print_cigar_op(fp,matchlength,'H');
       }
     }
 
@@ -858,7 +633,7 @@ print_cigar (Filestring_T fp, char type, int stringlength, int querypos, int que
       cliplength = querylength - endpos;
       if (cliplength > 0) {
 	debug1(printf("  Pushing final %dH\n",cliplength));
-	FPRINTF(fp,"%dH",cliplength);
+	print_cigar_op(fp,cliplength,'H');
       }
     }
 
@@ -886,20 +661,20 @@ print_cigar (Filestring_T fp, char type, int stringlength, int querypos, int que
     if (endpos <= startpos) {
       if (cliplength > 0) {
 	debug1(printf("  Pushing initial %dH\n",cliplength));
-	FPRINTF(fp,"%dH",cliplength);
+	print_cigar_op(fp,cliplength,'H');
       }
       matchlength = startpos - endpos;
       if (matchlength <= 0) {
 	/* Skip */
       } else if (type != 'E') {
 	debug1(printf("  Pushing %d%c\n",matchlength,type));
-	FPRINTF(fp,"%d%c",matchlength,type);
+	print_cigar_op(fp,matchlength,type);
       } else if (matchlength == trimlength) {
 	debug1(printf("  Pushing %dS\n",matchlength));
-	FPRINTF(fp,"%dS",matchlength);
+	print_cigar_op(fp,matchlength,'S');
       } else {
 	debug1(printf("  Pushing %dH\n",matchlength));
-	FPRINTF(fp,"%dH",matchlength);
+	print_cigar_op(fp,matchlength,'H');
       }
     }
 
@@ -908,7 +683,7 @@ print_cigar (Filestring_T fp, char type, int stringlength, int querypos, int que
       cliplength = endpos;
       if (cliplength > 0) {
 	debug1(printf("  Pushing final %dH\n",cliplength));
-	FPRINTF(fp,"%dH",cliplength);
+	print_cigar_op(fp,cliplength,'H');
       }
     }
   }
@@ -968,11 +743,11 @@ print_md_string (bool *printp, int *nmismatches_refdiff, int *nmismatches_bothdi
 	} else {
 	  /* A true mismatch against both variants */
 	  if (matchlength > 0 || hardclip_end_p == true) {
-	    FPRINTF(fp,"%d",matchlength);
+	    Filestring_put_int(fp,matchlength);
 	    *printp = true;
 	    hardclip_end_p = false;
 	  }
-	  FPRINTF(fp,"%c",toupper(genomicfwd_refdiff[i]));
+	  PUTC(toupper(genomicfwd_refdiff[i]),fp);
 	  *printp = true;
 	  local_nmismatches += 1;
 	  matchlength = 0;
@@ -988,11 +763,11 @@ print_md_string (bool *printp, int *nmismatches_refdiff, int *nmismatches_bothdi
 	} else if (isupper(genomicfwd_bothdiff[i])) {
 	  /* A mismatch against the reference only => alternate variant */
 	  if (matchlength > 0 || hardclip_end_p == true) {
-	    FPRINTF(fp,"%d",matchlength);
+	    Filestring_put_int(fp,matchlength);
 	    *printp = true;
 	    hardclip_end_p = false;
 	  }
-	  FPRINTF(fp,"%c",genomicfwd_refdiff[i]); /* Leave as lower case */
+	  PUTC(genomicfwd_refdiff[i],fp); /* Leave as lower case */
 	  *printp = true;
 	  local_nmismatches += 1;
 	  matchlength = 0;
@@ -1000,11 +775,11 @@ print_md_string (bool *printp, int *nmismatches_refdiff, int *nmismatches_bothdi
 	} else {
 	  /* A true mismatch against both variants */
 	  if (matchlength > 0 || hardclip_end_p == true) {
-	    FPRINTF(fp,"%d",matchlength);
+	    Filestring_put_int(fp,matchlength);
 	    *printp = true;
 	    hardclip_end_p = false;
 	  }
-	  FPRINTF(fp,"%c",toupper(genomicfwd_refdiff[i]));
+	  PUTC(toupper(genomicfwd_refdiff[i]),fp);
 	  *printp = true;
 	  local_nmismatches += 1;
 	  matchlength = 0;
@@ -1057,11 +832,11 @@ print_md_string (bool *printp, int *nmismatches_refdiff, int *nmismatches_bothdi
 
 	} else {
 	  if (matchlength > 0 || hardclip_end_p == true) {
-	    FPRINTF(fp,"%d",matchlength);
+	    Filestring_put_int(fp,matchlength);
 	    *printp = true;
 	    hardclip_end_p = false;
 	  }
-	  FPRINTF(fp,"%c",toupper(genomicfwd_refdiff[i]));
+	  PUTC(toupper(genomicfwd_refdiff[i]),fp);
 	  *printp = true;
 	  local_nmismatches += 1;
 	  matchlength = 0;
@@ -1077,11 +852,11 @@ print_md_string (bool *printp, int *nmismatches_refdiff, int *nmismatches_bothdi
 	} else if (isupper(genomicfwd_bothdiff[i])) {
 	  /* A mismatch against the reference only => alternate variant */
 	  if (matchlength > 0 || hardclip_end_p == true) {
-	    FPRINTF(fp,"%d",matchlength);
+	    Filestring_put_int(fp,matchlength);
 	    *printp = true;
 	    hardclip_end_p = false;
 	  }
-	  FPRINTF(fp,"%c",genomicfwd_refdiff[i]); /* Leave as lower case */
+	  PUTC(genomicfwd_refdiff[i],fp); /* Leave as lower case */
 	  *printp = true;
 	  local_nmismatches += 1;
 	  matchlength = 0;
@@ -1089,11 +864,11 @@ print_md_string (bool *printp, int *nmismatches_refdiff, int *nmismatches_bothdi
 	} else {
 	  /* A true mismatch against both variants */
 	  if (matchlength > 0 || hardclip_end_p == true) {
-	    FPRINTF(fp,"%d",matchlength);
+	    Filestring_put_int(fp,matchlength);
 	    *printp = true;
 	    hardclip_end_p = false;
 	  }
-	  FPRINTF(fp,"%c",toupper(genomicfwd_refdiff[i]));
+	  PUTC(toupper(genomicfwd_refdiff[i]),fp);
 	  *printp = true;
 	  local_nmismatches += 1;
 	  matchlength = 0;
@@ -1121,7 +896,7 @@ print_md_string (bool *printp, int *nmismatches_refdiff, int *nmismatches_bothdi
   if (lastp == false) {
     return matchlength;
   } else if (matchlength > 0) {
-    FPRINTF(fp,"%d",matchlength);
+    Filestring_put_int(fp,matchlength);
     *printp = true;
     return 0;
   } else {
@@ -1208,7 +983,7 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
   flag = SAM_compute_flag(plusp,mate,resulttype,first_read_p,
 			  pathnum,npaths,npaths_mate,absmq_score,first_absmq,
 			  invertp,invert_mate_p);
-  FPRINTF(fp,"\t%u",flag);
+  print_tab_uint(fp,flag);
 
   /* 3. RNAME: chr */
   /* 4. POS: chrpos */
@@ -1216,7 +991,7 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
 
 
   /* 5. MAPQ: Mapping quality */
-  FPRINTF(fp,"\t%d",mapq_score);
+  print_tab_int(fp,mapq_score);
 
   /* 6. CIGAR */
   FPRINTF(fp,"\t");
@@ -1304,13 +1079,13 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
       
       while (p != endp && Substring_queryend((Substring_T) List_head(p)) < querylength - hardclip_high) {
 	if ((type = Junction_type(post_junction)) == DEL_JUNCTION) {
-	  FPRINTF(fp,"%dD",Junction_nindels(post_junction));
+	  print_cigar_op(fp,Junction_nindels(post_junction),'D');
 	  nindels += Junction_nindels(post_junction);
 	} else if (type == INS_JUNCTION) {
-	  FPRINTF(fp,"%dI",Junction_nindels(post_junction));
+	  print_cigar_op(fp,Junction_nindels(post_junction),'I');
 	  nindels += Junction_nindels(post_junction);
 	} else if (type == SPLICE_JUNCTION) {
-	  FPRINTF(fp,"%uN",Junction_splice_distance(post_junction));
+	  print_cigar_op(fp,Junction_splice_distance(post_junction),'N');
 	}
 	q = List_next(q);
 	if (q == NULL) {
@@ -1355,13 +1130,13 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
       
       if (p != endp) {
 	if ((type = Junction_type(post_junction)) == DEL_JUNCTION) {
-	  FPRINTF(fp,"%dD",Junction_nindels(post_junction));
+	  print_cigar_op(fp,Junction_nindels(post_junction),'D');
 	  nindels += Junction_nindels(post_junction);
 	} else if (type == INS_JUNCTION) {
-	  FPRINTF(fp,"%dI",Junction_nindels(post_junction));
+	  print_cigar_op(fp,Junction_nindels(post_junction),'I');
 	  nindels += Junction_nindels(post_junction);
 	} else if (type == SPLICE_JUNCTION) {
-	  FPRINTF(fp,"%uN",Junction_splice_distance(post_junction));
+	  print_cigar_op(fp,Junction_splice_distance(post_junction),'N');
 	}
 
 	/* Last substring, plus, hard-clipped */
@@ -1450,13 +1225,13 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
 
       while (p != endp && Substring_querystart((Substring_T) List_head(p)) >= hardclip_high) {
 	if ((type = Junction_type(post_junction)) == DEL_JUNCTION) {
-	  FPRINTF(fp,"%dD",Junction_nindels(post_junction));
+	  print_cigar_op(fp,Junction_nindels(post_junction),'D');
 	  nindels += Junction_nindels(post_junction);
 	} else if (type == INS_JUNCTION) {
-	  FPRINTF(fp,"%dI",Junction_nindels(post_junction));
+	  print_cigar_op(fp,Junction_nindels(post_junction),'I');
 	  nindels += Junction_nindels(post_junction);
 	} else if (type == SPLICE_JUNCTION) {
-	  FPRINTF(fp,"%uN",Junction_splice_distance(post_junction));
+	  print_cigar_op(fp,Junction_splice_distance(post_junction),'N');
 	}
 	q = List_next(q);
 	if (q == NULL) {
@@ -1501,13 +1276,13 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
 
       if (p != endp) {
 	if ((type = Junction_type(post_junction)) == DEL_JUNCTION) {
-	  FPRINTF(fp,"%dD",Junction_nindels(post_junction));
+	  print_cigar_op(fp,Junction_nindels(post_junction),'D');
 	  nindels += Junction_nindels(post_junction);
 	} else if (type == INS_JUNCTION) {
-	  FPRINTF(fp,"%dI",Junction_nindels(post_junction));
+	  print_cigar_op(fp,Junction_nindels(post_junction),'I');
 	  nindels += Junction_nindels(post_junction);
 	} else if (type == SPLICE_JUNCTION) {
-	  FPRINTF(fp,"%uN",Junction_splice_distance(post_junction));
+	  print_cigar_op(fp,Junction_splice_distance(post_junction),'N');
 	}
 
 	/* Last substring, minus, hard-clipped */
@@ -1547,20 +1322,20 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
   /* 9. ISIZE: Insert size */
   if (resulttype == CONCORDANT_UNIQ || resulttype == CONCORDANT_TRANSLOC || resulttype == CONCORDANT_MULT) {
     if (plusp == invertp) {
-      FPRINTF(fp,"\t%d",-pairedlength);
+      print_tab_int(fp,-pairedlength);
     } else {
-      FPRINTF(fp,"\t%d",pairedlength);
+      print_tab_int(fp,pairedlength);
     }
   } else if (mate_chrpos == 0) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
   } else if (chrpos < mate_chrpos) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
   } else if (chrpos > mate_chrpos) {
-    FPRINTF(fp,"\t%d",-pairedlength);
+    print_tab_int(fp,-pairedlength);
   } else if (first_read_p == true) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
   } else {
-    FPRINTF(fp,"\t%d",-pairedlength);
+    print_tab_int(fp,-pairedlength);
   }
 
 
@@ -1580,7 +1355,7 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
 
   /* 12. TAGS: RG */
   if (sam_read_group_id != NULL) {
-    FPRINTF(fp,"\tRG:Z:%s",sam_read_group_id);
+    print_string_tag(fp,"RG",sam_read_group_id);
   }
 
   /* 12. TAGS: XH and XI */
@@ -2004,7 +1779,9 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
   /* 12. TAGS: NH */
   /* 12. TAGS: HI */
   /* 12. TAGS: NM */
-  FPRINTF(fp,"\tNH:i:%d\tHI:i:%d\tNM:i:%d",npaths,pathnum,nmismatches_refdiff + nindels);
+  print_int_tag(fp,"NH",npaths);
+  print_int_tag(fp,"HI",pathnum);
+  print_int_tag(fp,"NM",nmismatches_refdiff + nindels);
   
   if (snps_iit) {
     /* 12. TAGS: XW and XV */
@@ -2015,10 +1792,12 @@ print_substrings (Filestring_T fp, char *abbrev, Stage3end_T stage3end, Stage3en
   /* 12. TAGS: SM */
   /* 12. TAGS: XQ */
   /* 12. TAGS: X2 */
-  FPRINTF(fp,"\tSM:i:%d\tXQ:i:%d\tX2:i:%d",mapq_score,absmq_score,second_absmq);
+  print_int_tag(fp,"SM",mapq_score);
+  print_int_tag(fp,"XQ",absmq_score);
+  print_int_tag(fp,"X2",second_absmq);
 
   /* 12. TAGS: XO */
-  FPRINTF(fp,"\tXO:Z:%s",abbrev);
+  print_string_tag(fp,"XO",abbrev);
 
   /* 12. TAGS: XS */
   if (sensedir == SENSE_FORWARD) {
@@ -2201,7 +1980,7 @@ print_halfdonor (Filestring_T fp, char *abbrev, Substring_T donor, Stage3end_T t
   flag = SAM_compute_flag(plusp,mate,resulttype,first_read_p,
 			  pathnum,npaths,npaths_mate,absmq_score,first_absmq,
 			  invertp,invert_mate_p);
-  FPRINTF(fp,"\t%u",flag);
+  print_tab_uint(fp,flag);
 
   /* 3. RNAME: chr */
   /* 4. POS: chrpos */
@@ -2209,7 +1988,7 @@ print_halfdonor (Filestring_T fp, char *abbrev, Substring_T donor, Stage3end_T t
   
 
   /* 5. MAPQ: Mapping quality */
-  FPRINTF(fp,"\t%d",mapq_score);
+  print_tab_int(fp,mapq_score);
 
   /* 6. CIGAR */
   FPRINTF(fp,"\t");
@@ -2374,22 +2153,22 @@ print_halfdonor (Filestring_T fp, char *abbrev, Substring_T donor, Stage3end_T t
   /* 9. ISIZE: Insert size */
   if (resulttype == CONCORDANT_UNIQ || resulttype == CONCORDANT_TRANSLOC || resulttype == CONCORDANT_MULT) {
     if (plusp == invertp) {
-      FPRINTF(fp,"\t%d",-pairedlength);
+      print_tab_int(fp,-pairedlength);
     } else {
-      FPRINTF(fp,"\t%d",pairedlength);
+      print_tab_int(fp,pairedlength);
     }
   } else if (mate_chrpos == 0) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
 #if 0
   } else if (concordant_chrpos < mate_chrpos) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
   } else if (concordant_chrpos > mate_chrpos) {
-    FPRINTF(fp,"\t%d",-pairedlength);
+    print_tab_int(fp,-pairedlength);
 #endif
   } else if (first_read_p == true) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
   } else {
-    FPRINTF(fp,"\t%d",-pairedlength);
+    print_tab_int(fp,-pairedlength);
   }
 
 
@@ -2410,7 +2189,7 @@ print_halfdonor (Filestring_T fp, char *abbrev, Substring_T donor, Stage3end_T t
 
   /* 12. TAGS: RG */
   if (sam_read_group_id != NULL) {
-    FPRINTF(fp,"\tRG:Z:%s",sam_read_group_id);
+    print_string_tag(fp,"RG",sam_read_group_id);
   }
 
   /* 12. TAGS: XH and XI */
@@ -2553,7 +2332,9 @@ print_halfdonor (Filestring_T fp, char *abbrev, Substring_T donor, Stage3end_T t
   /* 12. TAGS: NH */
   /* 12. TAGS: HI */
   /* 12. TAGS: NM */
-  FPRINTF(fp,"\tNH:i:%d\tHI:i:%d\tNM:i:%d",npaths,pathnum,nmismatches_refdiff);
+  print_int_tag(fp,"NH",npaths);
+  print_int_tag(fp,"HI",pathnum);
+  print_int_tag(fp,"NM",nmismatches_refdiff);
   
   if (snps_iit) {
     /* 12. TAGS: XW and XV */
@@ -2564,10 +2345,12 @@ print_halfdonor (Filestring_T fp, char *abbrev, Substring_T donor, Stage3end_T t
   /* 12. TAGS: SM */
   /* 12. TAGS: XQ */
   /* 12. TAGS: X2 */
-  FPRINTF(fp,"\tSM:i:%d\tXQ:i:%d\tX2:i:%d",mapq_score,absmq_score,second_absmq);
+  print_int_tag(fp,"SM",mapq_score);
+  print_int_tag(fp,"XQ",absmq_score);
+  print_int_tag(fp,"X2",second_absmq);
 
   /* 12. TAGS: XO */
-  FPRINTF(fp,"\tXO:Z:%s",abbrev);
+  print_string_tag(fp,"XO",abbrev);
 
   /* 12. TAGS: XS */
   assert(donor_sensedir != SENSE_NULL);
@@ -2716,7 +2499,7 @@ print_halfacceptor (Filestring_T fp, char *abbrev, Substring_T acceptor, Stage3e
   flag = SAM_compute_flag(plusp,mate,resulttype,first_read_p,
 			  pathnum,npaths,npaths_mate,absmq_score,first_absmq,
 			  invertp,invert_mate_p);
-  FPRINTF(fp,"\t%u",flag);
+  print_tab_uint(fp,flag);
 
   /* 3. RNAME: chr */
   /* 4. POS: chrpos */
@@ -2724,7 +2507,7 @@ print_halfacceptor (Filestring_T fp, char *abbrev, Substring_T acceptor, Stage3e
 
 
   /* 5. MAPQ: Mapping quality */
-  FPRINTF(fp,"\t%d",mapq_score);
+  print_tab_int(fp,mapq_score);
 
   /* 6. CIGAR */
   FPRINTF(fp,"\t");
@@ -2880,22 +2663,22 @@ print_halfacceptor (Filestring_T fp, char *abbrev, Substring_T acceptor, Stage3e
   /* 9. ISIZE: Insert size */
   if (resulttype == CONCORDANT_UNIQ || resulttype == CONCORDANT_TRANSLOC || resulttype == CONCORDANT_MULT) {
     if (plusp == invertp) {
-      FPRINTF(fp,"\t%d",-pairedlength);
+      print_tab_int(fp,-pairedlength);
     } else {
-      FPRINTF(fp,"\t%d",pairedlength);
+      print_tab_int(fp,pairedlength);
     }
   } else if (mate_chrpos == 0) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
 #if 0
   } else if (concordant_chrpos < mate_chrpos) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
   } else if (concordant_chrpos > mate_chrpos) {
-    FPRINTF(fp,"\t%d",-pairedlength);
+    print_tab_int(fp,-pairedlength);
 #endif
   } else if (first_read_p == true) {
-    FPRINTF(fp,"\t%d",pairedlength);
+    print_tab_int(fp,pairedlength);
   } else {
-    FPRINTF(fp,"\t%d",-pairedlength);
+    print_tab_int(fp,-pairedlength);
   }
 
 
@@ -2916,7 +2699,7 @@ print_halfacceptor (Filestring_T fp, char *abbrev, Substring_T acceptor, Stage3e
 
   /* 12. TAGS: RG */
   if (sam_read_group_id != NULL) {
-    FPRINTF(fp,"\tRG:Z:%s",sam_read_group_id);
+    print_string_tag(fp,"RG",sam_read_group_id);
   }
 
   /* 12. TAGS: XH and XI */
@@ -3060,7 +2843,9 @@ print_halfacceptor (Filestring_T fp, char *abbrev, Substring_T acceptor, Stage3e
   /* 12. TAGS: NH */
   /* 12. TAGS: HI */
   /* 12. TAGS: NM */
-  FPRINTF(fp,"\tNH:i:%d\tHI:i:%d\tNM:i:%d",npaths,pathnum,nmismatches_refdiff);
+  print_int_tag(fp,"NH",npaths);
+  print_int_tag(fp,"HI",pathnum);
+  print_int_tag(fp,"NM",nmismatches_refdiff);
   
   if (snps_iit) {
     /* 12. TAGS: XW and XV */
@@ -3071,10 +2856,12 @@ print_halfacceptor (Filestring_T fp, char *abbrev, Substring_T acceptor, Stage3e
   /* 12. TAGS: SM */
   /* 12. TAGS: XQ */
   /* 12. TAGS: X2 */
-  FPRINTF(fp,"\tSM:i:%d\tXQ:i:%d\tX2:i:%d",mapq_score,absmq_score,second_absmq);
+  print_int_tag(fp,"SM",mapq_score);
+  print_int_tag(fp,"XQ",absmq_score);
+  print_int_tag(fp,"X2",second_absmq);
 
   /* 12. TAGS: XO */
-  FPRINTF(fp,"\tXO:Z:%s",abbrev);
+  print_string_tag(fp,"XO",abbrev);
 
   /* 12. TAGS: XS */
   assert(acceptor_sensedir != SENSE_NULL);
@@ -16,12 +16,24 @@ static char rcsid[] = "$Id: shortread.c 160871 2015-03-13 00:14:41Z twu $";
 #include <string.h>
 #include <strings.h>		/* For rindex */
 #include <ctype.h>		/* For iscntrl and isspace */
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 #ifdef HAVE_ZLIB
 #include <zlib.h>
+#include "bgzf.h"
 #define GZBUFFER_SIZE 131072
 #endif
 
+#if defined(HAVE_MMAP) && !defined(USE_MPI)
+/* MPI master needs exact character counts from stdio */
+#define MAPPED_INPUT 1
+#include <sys/mman.h>		/* For mmap */
+#include <sys/stat.h>		/* For fstat */
+#include <unistd.h>		/* For getpagesize */
+#endif
+
 #define PAIRED_ADAPTER_NMISMATCHES_ALLOWED 1
 #define PAIRED_ADAPTER_MINLENGTH 20 /* Must exceed 14 or stage1 will complain */
 
@@ -34,6 +46,8 @@ static char rcsid[] = "$Id: shortread.c 160871 2015-03-13 00:14:41Z twu $";
 #include "complement.h"
 #include "intlist.h"
 #include "fopen.h"
+#include "popcount.h"
+#include "mapq.h"		/* For MAPQ_max_quality_score_quiet */
 
 
 #ifdef DEBUG
@@ -168,6 +182,42 @@ Shortread_fulllength (T this) {
 }
 
 
+/* The result cache keys a read on everything that determines its
+   alignment and SAM output, except for the accession and the QUAL
+   field, which it prints from the new read.  Of the quality string,
+   the key has only the maximum score, which is all that the MAPQ of
+   a unique alignment depends on, so that duplicates sequenced with
+   different quality scores match. */
+int
+Shortread_cache_keylength (T this) {
+  return 5*sizeof(int) + this->fulllength + this->barcode_length;
+}
+
+/* Writes Shortread_cache_keylength(this) bytes at dest, and returns a
+   pointer past them */
+char *
+Shortread_fill_cache_key (char *dest, T this) {
+  int header[5];
+
+  header[0] = this->fulllength;
+  header[1] = (this->quality == NULL) ? -1 : (int) strlen(this->quality);
+  header[2] = this->barcode_length;
+  header[3] = (this->filterp == true ? 1 : 0) + (this->invertedp == true ? 2 : 0);
+  header[4] = (this->quality == NULL) ? -1 : MAPQ_max_quality_score_quiet(this->quality,header[1]);
+  memcpy(dest,header,5*sizeof(int));
+  dest += 5*sizeof(int);
+
+  memcpy(dest,this->contents,this->fulllength*sizeof(char));
+  dest += this->fulllength;
+  if (this->barcode_length > 0) {
+    memcpy(dest,this->barcode,this->barcode_length*sizeof(char));
+    dest += this->barcode_length;
+  }
+
+  return dest;
+}
+
+
 void
 Shortread_free (T *old) {
 
@@ -468,13 +518,13 @@ Shortread_input_init_filecontents (char **filecontents) {
 #ifdef HAVE_ZLIB
 /* Returns '>' if FASTA file, first sequence char if not */
 int
-Shortread_input_init_gzip (gzFile fp) {
+Shortread_input_init_gzip (Bgzf_T fp) {
   int c;
   bool okayp = false;
 
   Header[0] = '\0';
 
-  while (okayp == false && (c = gzgetc(fp)) != EOF) {
+  while (okayp == false && (c = bgzfgetc(fp)) != EOF) {
     debug(printf("Read character %c\n",c));
     if (iscntrl(c)) {
 #ifdef DASH
@@ -705,7 +755,7 @@ input_header_gzip (bool *filterp, char **restofheader, int nextchar,
 #ifdef USE_MPI
 		   Filestring_T filestring,
 #endif
-		   gzFile fp, bool skipp) {
+		   Bgzf_T fp, bool skipp) {
   char *acc = NULL, *p, *q;
   size_t length;
 
@@ -713,7 +763,7 @@ input_header_gzip (bool *filterp, char **restofheader, int nextchar,
 
   if (nextchar == EOF) {	/* Was gzeof(fp) */
     return NULL;
-  } else if ((p = gzgets(fp,&(Header[0]),HEADERLEN)) == NULL) {
+  } else if ((p = bgzfgets(fp,&(Header[0]),HEADERLEN)) == NULL) {
     /* File must terminate after > */
     return NULL;
 #ifdef USE_MPI
@@ -732,12 +782,12 @@ input_header_gzip (bool *filterp, char **restofheader, int nextchar,
   } else {
     /* Eliminate rest of header from input */
 #ifdef USE_MPI
-    while ((p = gzgets(fp,&(Discard[0]),DISCARDLEN)) != NULL &&
+    while ((p = bgzfgets(fp,&(Discard[0]),DISCARDLEN)) != NULL &&
 	   rindex(&(Discard[0]),'\n') == NULL) {
       Filestring_puts(filestring,p,strlen(p));
     }
 #else
-    while (gzgets(fp,&(Discard[0]),DISCARDLEN) != NULL &&
+    while (bgzfgets(fp,&(Discard[0]),DISCARDLEN) != NULL &&
 	   rindex(&(Discard[0]),'\n') == NULL) ;
 #endif
   }
@@ -936,39 +986,14 @@ strip_illumina_acc_ending (char *acc1, char *acc2) {
 }
 
 
+/* Extracts the accession (and chastity filter flag) from the
+   newline-stripped header line in Header */
 static char *
-input_header_fastq (int *nchars, bool *filterp, char **restofheader, int nextchar,
-		    FILE *fp, bool skipp) {
+parse_header_fastq (bool *filterp, char **restofheader, bool skipp) {
   char *acc, *p, *q, *start;
   size_t length;
   int fieldi = 0;
 
-  *filterp = false;
-
-  if (nextchar == EOF) { /* Was feof(fp) */
-    return NULL;
-  } else if ((p = fgets(&(Header[0]),HEADERLEN,fp)) == NULL) {
-    /* File must terminate after > */
-    return NULL;
-  } else {
-    *nchars += strlen(p);
-  }
-
-  if (Header[0] == '\n') {
-    Header[0] = '\0';
-  } else if ((p = rindex(&(Header[0]),'\n')) != NULL) {
-    if (p[-1] == '\r') {
-      p--;
-    }
-    *p = '\0';
-  } else {
-    /* Eliminate rest of header from input */
-    while ((p = fgets(&(Discard[0]),DISCARDLEN,fp)) != NULL &&
-	   rindex(&(Discard[0]),'\n') == NULL) {
-      *nchars += strlen(p);
-    }
-  }
-
   if (skipp == true) {
     return (char *) skipped_acc;
   } else {
@@ -1022,6 +1047,41 @@ input_header_fastq (int *nchars, bool *filterp, char **restofheader, int nextcha
 
     return acc;
   }
+}
+
+
+static char *
+input_header_fastq (int *nchars, bool *filterp, char **restofheader, int nextchar,
+		    FILE *fp, bool skipp) {
+  char *p;
+
+  *filterp = false;
+
+  if (nextchar == EOF) { /* Was feof(fp) */
+    return NULL;
+  } else if ((p = fgets(&(Header[0]),HEADERLEN,fp)) == NULL) {
+    /* File must terminate after > */
+    return NULL;
+  } else {
+    *nchars += strlen(p);
+  }
+
+  if (Header[0] == '\n') {
+    Header[0] = '\0';
+  } else if ((p = rindex(&(Header[0]),'\n')) != NULL) {
+    if (p[-1] == '\r') {
+      p--;
+    }
+    *p = '\0';
+  } else {
+    /* Eliminate rest of header from input */
+    while ((p = fgets(&(Discard[0]),DISCARDLEN,fp)) != NULL &&
+	   rindex(&(Discard[0]),'\n') == NULL) {
+      *nchars += strlen(p);
+    }
+  }
+
+  return parse_header_fastq(&(*filterp),&(*restofheader),skipp);
 } 
 
 
@@ -1118,7 +1178,7 @@ input_header_fastq_gzip (bool *filterp, char **restofheader, int nextchar,
 #ifdef USE_MPI
 			 Filestring_T filestring,
 #endif
-			 gzFile fp, bool skipp) {
+			 Bgzf_T fp, bool skipp) {
   char *acc, *p, *q, *start;
   size_t length;
   int fieldi = 0;
@@ -1127,7 +1187,7 @@ input_header_fastq_gzip (bool *filterp, char **restofheader, int nextchar,
 
   if (nextchar == EOF) {	/* Was gzeof(fp) */
     return NULL;
-  } else if ((p = gzgets(fp,&(Header[0]),HEADERLEN)) == NULL) {
+  } else if ((p = bgzfgets(fp,&(Header[0]),HEADERLEN)) == NULL) {
     /* File must terminate after > */
     return NULL;
 #ifdef USE_MPI
@@ -1146,12 +1206,12 @@ input_header_fastq_gzip (bool *filterp, char **restofheader, int nextchar,
   } else {
     /* Eliminate rest of header from input */
 #ifdef USE_MPI
-    while ((p = gzgets(fp,&(Discard[0]),DISCARDLEN)) != NULL &&
+    while ((p = bgzfgets(fp,&(Discard[0]),DISCARDLEN)) != NULL &&
 	   rindex(&(Discard[0]),'\n') == NULL) {
       Filestring_puts(filestring,p,strlen(p));
     }
 #else
-    while (gzgets(fp,&(Discard[0]),DISCARDLEN) != NULL &&
+    while (bgzfgets(fp,&(Discard[0]),DISCARDLEN) != NULL &&
 	   rindex(&(Discard[0]),'\n') == NULL) ;
 #endif
   }
@@ -1361,18 +1421,18 @@ skip_header_filecontents (char **filecontents, int nextchar) {
 
 #ifdef HAVE_ZLIB
 static bool
-skip_header_gzip (gzFile fp, int nextchar) {
+skip_header_gzip (Bgzf_T fp, int nextchar) {
 
   if (nextchar == EOF) {	/* was gzeof(fp) */
     return false;
-  } else if (gzgets(fp,&(Header[0]),HEADERLEN) == NULL) {
+  } else if (bgzfgets(fp,&(Header[0]),HEADERLEN) == NULL) {
     /* File must terminate after > */
     return false;
   }
 
   if (rindex(&(Header[0]),'\n') == NULL) {
     /* Eliminate rest of header from input */
-    while (gzgets(fp,&(Discard[0]),DISCARDLEN) != NULL &&
+    while (bgzfgets(fp,&(Discard[0]),DISCARDLEN) != NULL &&
 	   rindex(&(Discard[0]),'\n') == NULL) ;
   }
 
@@ -1565,6 +1625,243 @@ input_oneline (int *nextchar, int *nchars, char **longstring, char *Start,
 }
 
 
+/* Uncompressed FASTQ files that are regular files are read through a
+   read-only memory mapping instead of stdio.  Lines are located with
+   memchr, and sequences and qualities are passed to Shortread_new
+   directly from the mapped pages, so the only copy is the one made
+   into the Shortread_T.  Pages behind the read position are released
+   periodically, so long files do not stay resident. */
+
+#define MAPPED_RELEASE_SIZE 67108864 /* 64 MB */
+
+typedef struct Mapped_T *Mapped_T;
+struct Mapped_T {
+  FILE *fp;			/* Stream being read, or NULL */
+  char *base;			/* NULL if fp could not be mapped */
+  size_t len;
+  char *ptr;			/* Next unread character */
+  char *end;
+  char *released;		/* Pages below this were released */
+};
+
+static struct Mapped_T mapped1 = {NULL, NULL, 0, NULL, NULL, NULL};
+static struct Mapped_T mapped2 = {NULL, NULL, 0, NULL, NULL, NULL};
+
+
+/* Maps the rest of the file underlying fp, starting from its current
+   stream position.  Returns false if the stream cannot be mapped, in
+   which case the caller keeps reading with stdio. */
+static bool
+mapped_open (Mapped_T this, FILE *fp) {
+#ifdef MAPPED_INPUT
+  struct stat sb;
+  off_t offset;
+  void *memory;
+#endif
+
+  this->fp = fp;
+  this->base = (char *) NULL;
+
+#ifndef MAPPED_INPUT
+  return false;
+#else
+  if (fstat(fileno(fp),&sb) < 0 || !S_ISREG(sb.st_mode)) {
+    return false;
+  } else if ((offset = ftello(fp)) < 0 || offset >= sb.st_size) {
+    return false;
+  } else if (sizeof(size_t) <= 4 && sb.st_size > MAX32BIT) {
+    return false;
+  } else {
+    memory = mmap(NULL,(size_t) sb.st_size,PROT_READ,0
+#ifdef HAVE_MMAP_MAP_SHARED
+		  |MAP_SHARED
+#endif
+#ifdef HAVE_MMAP_MAP_FILE
+		  |MAP_FILE
+#endif
+#ifdef HAVE_MMAP_MAP_VARIABLE
+		  |MAP_VARIABLE
+#endif
+		  ,fileno(fp),0);
+    if (memory == MAP_FAILED) {
+      return false;
+    } else {
+#ifdef HAVE_MADVISE_MADV_SEQUENTIAL
+      madvise(memory,(size_t) sb.st_size,MADV_SEQUENTIAL);
+#endif
+      this->base = this->released = (char *) memory;
+      this->len = (size_t) sb.st_size;
+      this->ptr = &(this->base[offset]);
+      this->end = &(this->base[this->len]);
+      return true;
+    }
+  }
+#endif
+}
+
+static void
+mapped_close (Mapped_T this) {
+  if (this->base != NULL) {
+#ifdef MAPPED_INPUT
+    munmap((void *) this->base,this->len);
+#endif
+    this->base = (char *) NULL;
+  }
+  this->fp = (FILE *) NULL;
+  return;
+}
+
+/* Returns true if fp is being read through a mapping */
+static bool
+mapped_p (Mapped_T this, FILE *fp) {
+  if (fp == NULL) {
+    return false;
+  } else if (this->fp != fp) {
+    mapped_open(this,fp);
+  }
+  return (this->base != NULL);
+}
+
+static void
+mapped_release (Mapped_T this) {
+#if defined(MAPPED_INPUT) && defined(HAVE_MADVISE_MADV_DONTNEED)
+  char *upto;
+  size_t pagesize;
+
+  if (this->ptr - this->released >= MAPPED_RELEASE_SIZE) {
+    pagesize = (size_t) getpagesize();
+    upto = &(this->base[((this->ptr - this->base) - 1)/pagesize*pagesize]);
+    if (upto > this->released) {
+      madvise((void *) this->released,upto - this->released,MADV_DONTNEED);
+      this->released = upto;
+    }
+  }
+#endif
+  return;
+}
+
+static int
+mapped_getc (Mapped_T this) {
+  if (this->ptr >= this->end) {
+    return EOF;
+  } else {
+    return (int) (unsigned char) *this->ptr++;
+  }
+}
+
+/* Returns the end of the current line (the newline or the end of the
+   mapping) and advances past it */
+static char *
+mapped_nextline (int *nchars, Mapped_T this) {
+  char *eol;
+
+  if ((eol = (char *) memchr(this->ptr,'\n',this->end - this->ptr)) == NULL) {
+    eol = this->end;
+    *nchars += (this->end - this->ptr);
+    this->ptr = this->end;
+  } else {
+    *nchars += (eol + 1 - this->ptr);
+    this->ptr = eol + 1;
+  }
+  return eol;
+}
+
+
+/* Same as input_header_fastq */
+static char *
+input_header_fastq_mapped (int *nchars, bool *filterp, char **restofheader, int nextchar,
+			   Mapped_T this, bool skipp) {
+  char *start, *eol;
+  size_t length;
+
+  *filterp = false;
+
+  if (nextchar == EOF) {
+    return NULL;
+  } else if (this->ptr >= this->end) {
+    /* File must terminate after > */
+    return NULL;
+  }
+
+  mapped_release(this);
+
+  start = this->ptr;
+  eol = mapped_nextline(&(*nchars),this);
+  if ((length = eol - start) >= HEADERLEN - 1) {
+    /* Eliminate rest of header from input */
+    length = HEADERLEN - 1;
+  } else if (length > 0 && eol < this->end && eol[-1] == '\r') {
+    length--;
+  }
+  memcpy(Header,start,length*sizeof(char));
+  Header[length] = '\0';
+
+  return parse_header_fastq(&(*filterp),&(*restofheader),skipp);
+}
+
+static bool
+skip_header_mapped (int *nchars, Mapped_T this, int nextchar) {
+  if (nextchar == EOF) {
+    return false;
+  } else if (this->ptr >= this->end) {
+    return false;
+  } else {
+    mapped_nextline(&(*nchars),this);
+    return true;
+  }
+}
+
+/* Same as input_oneline, but *line is set to the line contents,
+   which point into the mapping unless spaces had to be removed */
+static int
+input_oneline_mapped (int *nextchar, int *nchars, char **line, char **longstring, char *Start,
+		      Mapped_T this, bool possible_fasta_header_p) {
+  char *start, *eol, *p, *q;
+  int length;
+
+  *longstring = (char *) NULL;
+
+  if (*nextchar == EOF || (possible_fasta_header_p == true && (*nextchar == '>' || *nextchar == '+'))) {
+    return 0;
+  } else if (*nextchar == '\n') {
+    return 0;
+  } else {
+    /* nextchar is the character just before ptr */
+    start = &(this->ptr[-1]);
+    eol = mapped_nextline(&(*nchars),this);
+    if (eol > &(start[1]) && eol < this->end && eol[-1] == '\r') {
+      eol--;
+    }
+
+    if (memchr(&(start[1]),' ',eol - &(start[1])) == NULL) {
+      *line = start;
+      length = (eol - start)/sizeof(char);
+    } else {
+      if (eol - start > MAX_READLENGTH) {
+	*line = *longstring = (char *) MALLOC_IN((eol - start + 1)*sizeof(char));
+      } else {
+	*line = Start;
+      }
+      q = *line;
+      *q++ = *start;
+      for (p = &(start[1]); p < eol; p++) {
+	if (*p != ' ') {
+	  *q++ = *p;
+	}
+      }
+      *q = '\0';
+      length = (q - *line)/sizeof(char);
+    }
+
+    /* Peek at character after eoln */
+    *nextchar = mapped_getc(this);
+    *nchars += 1;
+
+    return length;
+  }
+}
+
+
 #ifdef USE_MPI
 static int
 input_oneline_filecontents (int *nextchar, char **longstring, char *Start,
@@ -1665,7 +1962,7 @@ input_oneline_gzip (int *nextchar, char **longstring, char *Start,
 #ifdef USE_MPI
 		    Filestring_T filestring,
 #endif
-		    gzFile fp, bool possible_fasta_header_p) {
+		    Bgzf_T fp, bool possible_fasta_header_p) {
   int remainder;
   char *ptr, *p = NULL;
   int strlenp, nspaces;
@@ -1686,7 +1983,7 @@ input_oneline_gzip (int *nextchar, char **longstring, char *Start,
     return 0;
   } else {
     *ptr++ = (char) *nextchar;
-    if ((p = gzgets(fp,ptr,remainder+1)) == NULL) {
+    if ((p = bgzfgets(fp,ptr,remainder+1)) == NULL) {
       /* NULL if file ends with a blank line */
       debug(printf("Blank line. read %s.\n",ptr));
     } else {
@@ -1731,7 +2028,7 @@ input_oneline_gzip (int *nextchar, char **longstring, char *Start,
 	  intlist = Intlist_push_in(intlist,Start[i]);
 	  i++;
 	}
-	while ((*nextchar = gzgetc(fp)) != EOF && *nextchar != '\n') {
+	while ((*nextchar = bgzfgetc(fp)) != EOF && *nextchar != '\n') {
 #ifdef USE_MPI
           Filestring_putc(*nextchar,filestring);
 #endif
@@ -1741,7 +2038,7 @@ input_oneline_gzip (int *nextchar, char **longstring, char *Start,
         Filestring_putc(*nextchar,filestring);
 #endif
 	if (*nextchar == '\n') {
-	  *nextchar = gzgetc(fp);
+	  *nextchar = bgzfgetc(fp);
 #ifdef USE_MPI
           Filestring_putc(*nextchar,filestring);
 #endif
@@ -1758,7 +2055,7 @@ input_oneline_gzip (int *nextchar, char **longstring, char *Start,
     ptr += strlen(ptr);
 
     /* Peek at character after eoln */
-    *nextchar = gzgetc(fp);
+    *nextchar = bgzfgetc(fp);
 #ifdef USE_MPI
     Filestring_putc(*nextchar,filestring);
 #endif
@@ -2434,10 +2731,57 @@ Shortread_chop_primers_slow (T queryseq1, T queryseq2) {
 #endif
 
 
-bool
-Shortread_chop_primers (T queryseq1, T queryseq2) {
-  bool choppedp = false;
-  int chop1 = 0, chop2 = 0;
+#if defined(HAVE_BUILTIN_POPCOUNT)
+#define popcount_ones(diff) (__builtin_popcount(diff))
+#else
+#define popcount_ones(diff) (count_bits[diff & 0x0000FFFF] + count_bits[diff >> 16])
+#endif
+
+/* Counts mismatches between sequence1 and sequence2 over length
+   characters, 16 at a time.  Stops early once max_mismatches is
+   exceeded, so the result is exact only up to max_mismatches + 1. */
+static int
+count_mismatches_limit (char *sequence1, char *sequence2, int length, int max_mismatches) {
+  int nmismatches = 0;
+  int i = 0;
+#ifdef HAVE_SSE2
+  __m128i _seq1, _seq2;
+  unsigned int diff;
+
+  while (i + 16 <= length) {
+    _seq1 = _mm_loadu_si128((__m128i *) &(sequence1[i]));
+    _seq2 = _mm_loadu_si128((__m128i *) &(sequence2[i]));
+    diff = (~(unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(_seq1,_seq2))) & 0xFFFF;
+    if (diff != 0) {
+      if ((nmismatches += popcount_ones(diff)) > max_mismatches) {
+	return nmismatches;
+      }
+    }
+    i += 16;
+  }
+#endif
+
+  while (i < length) {
+    if (sequence1[i] != sequence2[i]) {
+      if (++nmismatches > max_mismatches) {
+	return nmismatches;
+      }
+    }
+    i++;
+  }
+
+  return nmismatches;
+}
+
+
+/* Returns the shift of queryseq2 against the start of queryseq1
+   that best explains adapter read-through, or 0 if none.  Every
+   shift compares minlength - jstart characters, so the score
+   depends only on the number of mismatches, and the search can stop
+   at the first shift without any. */
+static int
+find_primer_chop (T queryseq1, T queryseq2) {
+  int chop = 0;
   int nmatches, nmismatches;
   int fulllength1 = queryseq1->fulllength;
   int fulllength2 = queryseq2->fulllength;
@@ -2446,7 +2790,7 @@ Shortread_chop_primers (T queryseq1, T queryseq2) {
   char *contents2 = queryseq2->contents_uc;
 
   int best_score = 0, score;
-  int jstart, j, i;
+  int jstart;
 
   if (fulllength1 < fulllength2) {
     minlength = fulllength1;
@@ -2456,31 +2800,31 @@ Shortread_chop_primers (T queryseq1, T queryseq2) {
 
   debug2(printf("jstart must be < %d - %d and < %d - %d\n",
 		fulllength2,PAIRED_ADAPTER_MINLENGTH,fulllength1,PAIRED_ADAPTER_MINLENGTH));
-  for (jstart = 0; jstart < minlength - PAIRED_ADAPTER_MINLENGTH; jstart++) {
-    debug2(printf("jstart = %d\n",jstart));
-    i = 0;
-    j = jstart;
-    nmismatches = 0;
-    while (nmismatches <= PAIRED_ADAPTER_NMISMATCHES_ALLOWED && i < minlength - jstart) {
-      debug2(printf("At i = %d, j = %d, comparing %c and %c\n",i,j,contents1[i],contents2[j]));
-      assert(i < fulllength1);
-      assert(j < fulllength2);
-      if (contents1[i] != contents2[j]) {
-	nmismatches++;
-      }
-      i++;
-      j++;
-    }
+  for (jstart = 0; jstart < minlength - PAIRED_ADAPTER_MINLENGTH && best_score < minlength*3; jstart++) {
+    nmismatches = count_mismatches_limit(contents1,&(contents2[jstart]),minlength - jstart,
+					 PAIRED_ADAPTER_NMISMATCHES_ALLOWED);
+    debug2(printf("jstart = %d, nmismatches = %d\n",jstart,nmismatches));
     if (nmismatches <= PAIRED_ADAPTER_NMISMATCHES_ALLOWED) {
-      nmatches = j - nmismatches;
+      nmatches = minlength - nmismatches;
       if ((score = nmatches*3 - nmismatches) > best_score) {
 	best_score = score;
-	chop1 = jstart;
-	chop2 = jstart;
+	chop = jstart;
       }
     }
   }
 
+  return chop;
+}
+
+
+bool
+Shortread_chop_primers (T queryseq1, T queryseq2) {
+  bool choppedp = false;
+  int chop1, chop2;
+  int fulllength1;
+
+  chop1 = chop2 = find_primer_chop(queryseq1,queryseq2);
+
   debug2(printf("chop1 = %d, chop2 = %d\n",chop1,chop2));
 
   if (chop1 > 0) {
@@ -2525,49 +2869,9 @@ Shortread_chop_primers (T queryseq1, T queryseq2) {
 
 bool
 Shortread_find_primers (T queryseq1, T queryseq2) {
-  int chop1 = 0, chop2 = 0;
-  int nmatches, nmismatches;
-  int fulllength1 = queryseq1->fulllength;
-  int fulllength2 = queryseq2->fulllength;
-  int minlength;
-  char *contents1 = queryseq1->contents_uc;
-  char *contents2 = queryseq2->contents_uc;
-
-  int best_score = 0, score;
-  int jstart, j, i;
-
-  if (fulllength1 < fulllength2) {
-    minlength = fulllength1;
-  } else {
-    minlength = fulllength2;
-  }
+  int chop1, chop2;
 
-  debug2(printf("jstart must be < %d - %d and < %d - %d\n",
-		fulllength2,PAIRED_ADAPTER_MINLENGTH,fulllength1,PAIRED_ADAPTER_MINLENGTH));
-  for (jstart = 0; jstart < minlength - PAIRED_ADAPTER_MINLENGTH; jstart++) {
-    debug2(printf("jstart = %d\n",jstart));
-    i = 0;
-    j = jstart;
-    nmismatches = 0;
-    while (nmismatches <= PAIRED_ADAPTER_NMISMATCHES_ALLOWED && i < minlength - jstart) {
-      debug2(printf("At i = %d, j = %d, comparing %c and %c\n",i,j,contents1[i],contents2[j]));
-      assert(i < fulllength1);
-      assert(j < fulllength2);
-      if (contents1[i] != contents2[j]) {
-	nmismatches++;
-      }
-      i++;
-      j++;
-    }
-    if (nmismatches <= PAIRED_ADAPTER_NMISMATCHES_ALLOWED) {
-      nmatches = j - nmismatches;
-      if ((score = nmatches*3 - nmismatches) > best_score) {
-	best_score = score;
-	chop1 = jstart;
-	chop2 = jstart;
-      }
-    }
-  }
+  chop1 = chop2 = find_primer_chop(queryseq1,queryseq2);
 
   debug2(printf("chop1 = %d, chop2 = %d\n",chop1,chop2));
 
@@ -2600,7 +2904,7 @@ Shortread_find_overlap (T queryseq1, T queryseq2) {
   char *contents2 = queryseq2->contents_uc;
 
   int best_score = 0, score;
-  int istart, i, j;
+  int istart, length, nbeyond;
 
   if (queryseq1->overlap >= 0) {
     return queryseq1->overlap;
@@ -2608,20 +2912,28 @@ Shortread_find_overlap (T queryseq1, T queryseq2) {
     debug2(printf("istart must be < %d - %d and < %d - %d\n",
 		  fulllength1,OVERLAP_MINLENGTH,fulllength2,OVERLAP_MINLENGTH));
     for (istart = 0; istart < fulllength1 - OVERLAP_MINLENGTH && istart < fulllength2 - OVERLAP_MINLENGTH; istart++) {
-      debug2(printf("istart = %d\n",istart));
-      i = istart;
-      j = 0;
-      nmismatches = 0;
-      while (nmismatches <= OVERLAP_NMISMATCHES_ALLOWED && i < fulllength1 - istart) {
-	debug2(printf("At i = %d, j = %d, comparing %c and %c\n",i,j,contents1[i],contents2[j]));
-	if (contents1[i] != contents2[j]) {
-	  nmismatches++;
-	}
-	i++;
-	j++;
+      /* Compares contents1[istart..fulllength1-istart) against the start of contents2 */
+      if ((length = fulllength1 - 2*istart) * 3 <= best_score) {
+	/* Shorter comparisons cannot score higher */
+	break;
+      } else if (length <= fulllength2) {
+	nbeyond = 0;
+      } else {
+	/* Characters past the end of contents2 count as mismatches */
+	nbeyond = length - fulllength2;
+      }
+
+      if (nbeyond > OVERLAP_NMISMATCHES_ALLOWED) {
+	nmismatches = nbeyond;
+      } else {
+	nmismatches = nbeyond +
+	  count_mismatches_limit(&(contents1[istart]),contents2,length - nbeyond,
+				 OVERLAP_NMISMATCHES_ALLOWED - nbeyond);
       }
+      debug2(printf("istart = %d, nmismatches = %d\n",istart,nmismatches));
+
       if (nmismatches <= OVERLAP_NMISMATCHES_ALLOWED) {
-	nmatches = j - nmismatches;
+	nmatches = length - nmismatches;
 	if ((score = nmatches*3 - nmismatches) > best_score) {
 	  best_score = score;
 	  overlap = istart;
@@ -3315,7 +3627,7 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 #ifdef USE_MPI
 			   Filestring_T filestring1, Filestring_T filestring2,
 #endif
-			   gzFile *input1, gzFile *input2,
+			   Bgzf_T *input1, Bgzf_T *input2,
 			   char ***files, int *nfiles, bool skipp) {
   T queryseq1;
   int nextchar2;
@@ -3328,11 +3640,11 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
     queryseq1 = *queryseq2 = (T) NULL;
     if (*input1 == NULL || *nextchar == EOF) { /* was gzeof(*input1) */
       if (*input1 != NULL) {
-	gzclose(*input1);
+	Bgzf_free(&(*input1));
 	*input1 = NULL;
       }
       if (*input2 != NULL) {
-	gzclose(*input2);
+	Bgzf_free(&(*input2));
 	*input2 = NULL;
       }
 
@@ -3341,16 +3653,13 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 	return (T) NULL;
 
       } else if (*nfiles == 1 || force_single_end_p == true) {
-	if ((*input1 = gzopen((*files)[0],"rb")) == NULL) {
+	if ((*input1 = Bgzf_open((*files)[0])) == NULL) {
 	  fprintf(stderr,"Can't open file %s => skipping it.\n",(*files)[0]);
 	  (*files) += 1;
 	  (*nfiles) -= 1;
 	  *nextchar = EOF;
 	  return (T) NULL;
 	} else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	  gzbuffer(*input1,GZBUFFER_SIZE);
-#endif
 	  *input2 = NULL;
 	  (*files) += 1;
 	  (*nfiles) -= 1;
@@ -3358,7 +3667,7 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 	}
 
       } else {
-	while (*nfiles > 0 && (*input1 = gzopen((*files)[0],"rb")) == NULL) {
+	while (*nfiles > 0 && (*input1 = Bgzf_open((*files)[0])) == NULL) {
 	  fprintf(stderr,"Can't open file %s => skipping it.\n",(*files)[0]);
 	  (*files)++;
 	  (*nfiles)--;
@@ -3367,9 +3676,6 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 	  *nextchar = EOF;
 	  return (T) NULL;
 	} else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	  gzbuffer(*input1,GZBUFFER_SIZE);
-#endif
 	  (*files)++;
 	  (*nfiles)--;
 	  *nextchar = '\0';
@@ -3392,9 +3698,9 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
       /* fprintf(stderr,"No header\n"); */
       /* File ends after >.  Don't process, but loop again */
       *nextchar = EOF;
-    } else if ((*nextchar = gzgetc(*input1)) == '\r' || *nextchar == '\n') {
+    } else if ((*nextchar = bgzfgetc(*input1)) == '\r' || *nextchar == '\n') {
       /* Process blank lines and loop again */
-      while (*nextchar != EOF && ((*nextchar = gzgetc(*input1)) != '>')) {
+      while (*nextchar != EOF && ((*nextchar = bgzfgetc(*input1)) != '>')) {
 #ifdef USE_MPI
 	Filestring_putc(*nextchar,filestring1);
 #endif
@@ -3430,7 +3736,7 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 	if (*nextchar == '+') {
 	  /* Paired-end with quality strings */
 	  skip_header_gzip(*input1,*nextchar);
-	  *nextchar = gzgetc(*input1);
+	  *nextchar = bgzfgetc(*input1);
 #ifdef USE_MPI
 	  Filestring_putc(*nextchar,filestring1);
 #endif
@@ -3473,10 +3779,7 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 
       } else {
 	if (*input2 == NULL && *nfiles > 0 && force_single_end_p == false &&
-	    (*input2 = gzopen((*files)[0],"rb")) != NULL) {
-#ifdef HAVE_ZLIB_GZBUFFER
-	  gzbuffer(*input2,GZBUFFER_SIZE);
-#endif
+	    (*input2 = Bgzf_open((*files)[0])) != NULL) {
 	  (*files) += 1;
 	  (*nfiles) -= 1;
 	  nextchar2 = '\0';
@@ -3493,9 +3796,9 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 	    /* File ends after >.  Don't process, but loop again */
 	    (*queryseq2) = (T) NULL;
 	    nextchar2 = EOF;
-	  } else if ((nextchar2 = gzgetc(*input2)) == '\r' || nextchar2 == '\n') {
+	  } else if ((nextchar2 = bgzfgetc(*input2)) == '\r' || nextchar2 == '\n') {
 	    /* Process blank lines and loop again */
-	    while (nextchar2 != EOF && ((nextchar2 = gzgetc(*input2)) != '>')) {
+	    while (nextchar2 != EOF && ((nextchar2 = bgzfgetc(*input2)) != '>')) {
 #ifdef USE_MPI
 	      Filestring_putc(nextchar2,filestring2);
 #endif
@@ -3525,7 +3828,7 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 	    if (*nextchar == '+') {
 	      /* End 1 with a quality string */
 	      skip_header_gzip(*input1,*nextchar);
-	      *nextchar = gzgetc(*input1);
+	      *nextchar = bgzfgetc(*input1);
 #ifdef USE_MPI
 	      Filestring_putc(*nextchar,filestring1);
 #endif
@@ -3553,7 +3856,7 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 	    if (nextchar2 == '+') {
 	      /* End 2 with a quality string */
 	      skip_header_gzip(*input2,nextchar2);
-	      nextchar2 = gzgetc(*input2);
+	      nextchar2 = bgzfgetc(*input2);
 #ifdef USE_MPI
 	      Filestring_putc(nextchar2,filestring2);
 #endif
@@ -3589,7 +3892,7 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 	  if (*nextchar == '+') {
 	    /* Single-end with a quality string */
 	    skip_header_gzip(*input1,*nextchar);
-	    *nextchar = gzgetc(*input1);
+	    *nextchar = bgzfgetc(*input1);
 #ifdef USE_MPI
 	    Filestring_putc(*nextchar,filestring1);
 #endif
@@ -3951,6 +4254,7 @@ Shortread_read_fastq_text (int *nextchar, int *nchars1, int *nchars2, T *queryse
   char *acc, *restofheader;
   char *long_read_1, *long_read_2, *long_quality;
   int fulllength, quality_length;
+  char *read_1, *read_2, *quality;
   bool filterp;
 
   while (1) {
@@ -3958,11 +4262,13 @@ Shortread_read_fastq_text (int *nextchar, int *nchars1, int *nchars2, T *queryse
     if (*input1 == NULL || *nextchar == EOF) { /* was feof(input1) */
       if (*input1 != NULL) {
 	debugf(fprintf(stderr,"Master closing input 1 using fclose\n"));
+	mapped_close(&mapped1);
 	fclose(*input1);
 	*input1 = NULL;
       }
       if (*input2 != NULL) {
 	debugf(fprintf(stderr,"Master closing input 2 using fclose\n"));
+	mapped_close(&mapped2);
 	fclose(*input2);
 	*input2 = NULL;
       }
@@ -4008,15 +4314,29 @@ Shortread_read_fastq_text (int *nextchar, int *nchars1, int *nchars2, T *queryse
     }
 
     debug(printf("** Getting header\n"));
-    if ((acc = input_header_fastq(&(*nchars1),&filterp,&restofheader,*nextchar,*input1,skipp)) == NULL) {
+    if (mapped_p(&mapped1,*input1) == true) {
+      acc = input_header_fastq_mapped(&(*nchars1),&filterp,&restofheader,*nextchar,&mapped1,skipp);
+    } else {
+      acc = input_header_fastq(&(*nchars1),&filterp,&restofheader,*nextchar,*input1,skipp);
+    }
+    if (acc == NULL) {
       /* fprintf(stderr,"No header\n"); */
       /* File ends after >.  Don't process, but loop again */
       *nextchar = EOF;
     } else {
-      *nextchar = fgetc(*input1);
-      *nchars1 += 1;
-      if ((fulllength = input_oneline(&(*nextchar),&(*nchars1),&long_read_1,&(Read1[0]),*input1,
-				      /*possible_fasta_header_p*/true)) == 0) {
+      if (mapped1.base != NULL) {
+	*nextchar = mapped_getc(&mapped1);
+	*nchars1 += 1;
+	fulllength = input_oneline_mapped(&(*nextchar),&(*nchars1),&read_1,&long_read_1,&(Read1[0]),&mapped1,
+					  /*possible_fasta_header_p*/true);
+      } else {
+	*nextchar = fgetc(*input1);
+	*nchars1 += 1;
+	fulllength = input_oneline(&(*nextchar),&(*nchars1),&long_read_1,&(Read1[0]),*input1,
+				   /*possible_fasta_header_p*/true);
+	read_1 = &(Read1[0]);
+      }
+      if (fulllength == 0) {
 	FREE_IN(acc);
 	FREE_IN(restofheader);
 	/* fprintf(stderr,"length is zero\n"); */
@@ -4025,23 +4345,32 @@ Shortread_read_fastq_text (int *nextchar, int *nchars1, int *nchars2, T *queryse
 
       } else if (*nextchar != '+') {
 	/* No quality */
-	queryseq1 = Shortread_new(acc,restofheader,filterp,Read1,long_read_1,fulllength,
+	queryseq1 = Shortread_new(acc,restofheader,filterp,read_1,long_read_1,fulllength,
 				  /*quality*/NULL,/*long_quality*/NULL,/*quality_length*/0,barcode_length,
 				  invert_first_p,/*copy_acc_p*/false,skipp);
       } else {
-	skip_header(&(*nchars1),*input1,*nextchar);
-	*nextchar = fgetc(*input1);
-	*nchars1 += 1;
-	quality_length = input_oneline(&(*nextchar),&(*nchars1),&long_quality,&(Quality[0]),*input1,
-				       /*possible_fasta_header_p*/false);
+	if (mapped1.base != NULL) {
+	  skip_header_mapped(&(*nchars1),&mapped1,*nextchar);
+	  *nextchar = mapped_getc(&mapped1);
+	  *nchars1 += 1;
+	  quality_length = input_oneline_mapped(&(*nextchar),&(*nchars1),&quality,&long_quality,&(Quality[0]),&mapped1,
+						/*possible_fasta_header_p*/false);
+	} else {
+	  skip_header(&(*nchars1),*input1,*nextchar);
+	  *nextchar = fgetc(*input1);
+	  *nchars1 += 1;
+	  quality_length = input_oneline(&(*nextchar),&(*nchars1),&long_quality,&(Quality[0]),*input1,
+					 /*possible_fasta_header_p*/false);
+	  quality = &(Quality[0]);
+	}
 	if (quality_length != fulllength) {
 	  fprintf(stderr,"Length %d of quality score differs from length %d of nucleotides in sequence %s\n",
 		  quality_length,fulllength,acc);
 	  abort();
 	} else {
 	  /* Has quality */
-	  queryseq1 = Shortread_new(acc,restofheader,filterp,Read1,long_read_1,fulllength,
-				    Quality,long_quality,quality_length,barcode_length,
+	  queryseq1 = Shortread_new(acc,restofheader,filterp,read_1,long_read_1,fulllength,
+				    quality,long_quality,quality_length,barcode_length,
 				    invert_first_p,/*copy_acc_p*/false,skipp);
 	}
       }
@@ -4052,7 +4381,12 @@ Shortread_read_fastq_text (int *nextchar, int *nchars1, int *nchars2, T *queryse
     } else if (*input2 == NULL) {
       *queryseq2 = (T) NULL;
     } else {
-      if ((acc = input_header_fastq(&(*nchars2),&filterp,&restofheader,nextchar2,*input2,skipp)) == NULL) {
+      if (mapped_p(&mapped2,*input2) == true) {
+	acc = input_header_fastq_mapped(&(*nchars2),&filterp,&restofheader,nextchar2,&mapped2,skipp);
+      } else {
+	acc = input_header_fastq(&(*nchars2),&filterp,&restofheader,nextchar2,*input2,skipp);
+      }
+      if (acc == NULL) {
 	/* fprintf(stderr,"No header\n"); */
 	/* File ends after >.  Don't process, but loop again */
 	nextchar2 = EOF;
@@ -4073,10 +4407,19 @@ Shortread_read_fastq_text (int *nextchar, int *nchars1, int *nchars2, T *queryse
 	    acc = (char *) NULL;
 	  }
 	}
-	nextchar2 = fgetc(*input2);
-	*nchars2 += 1;
-	if ((fulllength = input_oneline(&nextchar2,&(*nchars2),&long_read_2,&(Read2[0]),*input2,
-					/*possible_fasta_header_p*/true)) == 0) {
+	if (mapped2.base != NULL) {
+	  nextchar2 = mapped_getc(&mapped2);
+	  *nchars2 += 1;
+	  fulllength = input_oneline_mapped(&nextchar2,&(*nchars2),&read_2,&long_read_2,&(Read2[0]),&mapped2,
+					    /*possible_fasta_header_p*/true);
+	} else {
+	  nextchar2 = fgetc(*input2);
+	  *nchars2 += 1;
+	  fulllength = input_oneline(&nextchar2,&(*nchars2),&long_read_2,&(Read2[0]),*input2,
+				     /*possible_fasta_header_p*/true);
+	  read_2 = &(Read2[0]);
+	}
+	if (fulllength == 0) {
 	  FREE_IN(acc);
 	  FREE_IN(restofheader);
 	  /* fprintf(stderr,"length is zero\n"); */
@@ -4085,23 +4428,32 @@ Shortread_read_fastq_text (int *nextchar, int *nchars1, int *nchars2, T *queryse
 
 	} else if (nextchar2 != '+') {
 	  /* No quality */
-	  (*queryseq2) = Shortread_new(acc,/*restofheader*/NULL,filterp,Read2,long_read_2,fulllength,
+	  (*queryseq2) = Shortread_new(acc,/*restofheader*/NULL,filterp,read_2,long_read_2,fulllength,
 				       /*quality*/NULL,/*long_quality*/NULL,/*quality_length*/0,barcode_length,
 				       invert_second_p,/*copy_acc_p*/false,skipp);
 	} else {
-	  skip_header(&(*nchars2),*input2,nextchar2);
-	  nextchar2 = fgetc(*input2);
-	  *nchars2 += 1;
-	  quality_length = input_oneline(&nextchar2,&(*nchars2),&long_quality,&(Quality[0]),*input2,
-					 /*possible_fasta_header_p*/false);
+	  if (mapped2.base != NULL) {
+	    skip_header_mapped(&(*nchars2),&mapped2,nextchar2);
+	    nextchar2 = mapped_getc(&mapped2);
+	    *nchars2 += 1;
+	    quality_length = input_oneline_mapped(&nextchar2,&(*nchars2),&quality,&long_quality,&(Quality[0]),&mapped2,
+						  /*possible_fasta_header_p*/false);
+	  } else {
+	    skip_header(&(*nchars2),*input2,nextchar2);
+	    nextchar2 = fgetc(*input2);
+	    *nchars2 += 1;
+	    quality_length = input_oneline(&nextchar2,&(*nchars2),&long_quality,&(Quality[0]),*input2,
+					   /*possible_fasta_header_p*/false);
+	    quality = &(Quality[0]);
+	  }
 	  if (quality_length != fulllength) {
 	    fprintf(stderr,"Length %d of quality score differs from length %d of nucleotides in sequence %s\n",
 		    quality_length,fulllength,acc);
 	    abort();
 	  } else {
 	    /* Has quality */
-	    (*queryseq2) = Shortread_new(acc,/*restofheader*/NULL,filterp,Read2,long_read_2,fulllength,
-					 Quality,long_quality,quality_length,barcode_length,
+	    (*queryseq2) = Shortread_new(acc,/*restofheader*/NULL,filterp,read_2,long_read_2,fulllength,
+					 quality,long_quality,quality_length,barcode_length,
 					 invert_second_p,/*copy_acc_p*/false,skipp);
 
 	  }
@@ -4351,7 +4703,7 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
 #ifdef USE_MPI
 			   Filestring_T filestring1, Filestring_T filestring2,
 #endif
-			   gzFile *input1, gzFile *input2,
+			   Bgzf_T *input1, Bgzf_T *input2,
 			   char ***files, int *nfiles, bool skipp) {
   T queryseq1;
   int nextchar2 = '\0';
@@ -4364,11 +4716,11 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
     queryseq1 = *queryseq2 = (T) NULL;
     if (*input1 == NULL || *nextchar == EOF) { /* was gzeof(*input1) */
       if (*input1 != NULL) {
-	gzclose(*input1);
+	Bgzf_free(&(*input1));
 	*input1 = NULL;
       }
       if (*input2 != NULL) {
-	gzclose(*input2);
+	Bgzf_free(&(*input2));
 	*input2 = NULL;
       }
 
@@ -4377,13 +4729,9 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
 	return (T) NULL;
 
       } else if (*nfiles == 1 || force_single_end_p == true) {
-	if ((*input1 = gzopen((*files)[0],"rb")) == NULL) {
+	if ((*input1 = Bgzf_open((*files)[0])) == NULL) {
 	  fprintf(stderr,"Cannot open gzipped file %s\n",(*files)[0]);
 	  exit(9);
-	} else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	  gzbuffer(*input1,GZBUFFER_SIZE);
-#endif
 	}
 	*input2 = NULL;
 	(*files) += 1;
@@ -4391,22 +4739,14 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
 	nextchar2 = '\0';
 	
       } else {
-	if ((*input1 = gzopen((*files)[0],"rb")) == NULL) {
+	if ((*input1 = Bgzf_open((*files)[0])) == NULL) {
 	  fprintf(stderr,"Cannot open gzipped file %s\n",(*files)[0]);
 	  exit(9);
-	} else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	  gzbuffer(*input1,GZBUFFER_SIZE);
-#endif
 	}
 
-	if ((*input2 = gzopen((*files)[1],"rb")) == NULL) {
+	if ((*input2 = Bgzf_open((*files)[1])) == NULL) {
 	  fprintf(stderr,"Cannot open gzipped file %s\n",(*files)[1]);
 	  exit(9);
-	} else {
-#ifdef HAVE_ZLIB_GZBUFFER
-	  gzbuffer(*input2,GZBUFFER_SIZE);
-#endif
 	}
 
 	(*files) += 2;
@@ -4425,7 +4765,7 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
       /* File ends after >.  Don't process. */
       *nextchar = EOF;
     } else {
-      *nextchar = gzgetc(*input1);
+      *nextchar = bgzfgetc(*input1);
 #ifdef USE_MPI
       Filestring_putc(*nextchar,filestring1);
 #endif
@@ -4447,7 +4787,7 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
 				  invert_first_p,/*copy_acc_p*/false,skipp);
       } else {
 	skip_header_gzip(*input1,*nextchar);
-	*nextchar = gzgetc(*input1);
+	*nextchar = bgzfgetc(*input1);
 #ifdef USE_MPI
 	Filestring_putc(*nextchar,filestring1);
 #endif
@@ -4499,7 +4839,7 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
 	    acc = (char *) NULL;
 	  }
 	}
-	nextchar2 = gzgetc(*input2);
+	nextchar2 = bgzfgetc(*input2);
 #ifdef USE_MPI
 	Filestring_putc(nextchar2,filestring2);
 #endif
@@ -4521,7 +4861,7 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
 				       invert_second_p,/*copy_acc_p*/false,skipp);
 	} else {
 	  skip_header_gzip(*input2,nextchar2);
-	  nextchar2 = gzgetc(*input2);
+	  nextchar2 = bgzfgetc(*input2);
 #ifdef USE_MPI
 	  Filestring_putc(nextchar2,filestring2);
 #endif
@@ -4759,7 +5099,7 @@ Shortread_read (int *nextchar, int *nchars1, int *nchars2, T *queryseq2,
 #endif
 		FILE **input1, FILE **input2,
 #ifdef HAVE_ZLIB
-		gzFile *gzipped1, gzFile *gzipped2,
+		Bgzf_T *gzipped1, Bgzf_T *gzipped2,
 #endif
 #ifdef HAVE_BZLIB
 		Bzip2_T *bzipped1, Bzip2_T *bzipped2,
@@ -5100,10 +5440,10 @@ Shortread_print_oneline (Filestring_T fp, T this) {
     FPRINTF(fp,"(null)");
   } else {
     for (i = 0; i < this->fulllength; i++) {
-      FPRINTF(fp,"%c",this->contents[i]);
+      PUTC(this->contents[i],fp);
     }
     for (i = 0; i < this->choplength; i++) {
-      FPRINTF(fp,"%c",this->chop[i]);
+      PUTC(this->chop[i],fp);
     }
   }
   return;
@@ -5114,10 +5454,10 @@ Shortread_print_oneline_revcomp (Filestring_T fp, T this) {
   int i = 0;
 
   for (i = this->fulllength-1; i >= 0; --i) {
-    FPRINTF(fp,"%c",complCode[(int) this->contents[i]]);
+    PUTC(complCode[(int) this->contents[i]],fp);
   }
   for (i = this->choplength-1; i >= 0; --i) {
-    FPRINTF(fp,"%c",complCode[(int) this->chop[i]]);
+    PUTC(complCode[(int) this->chop[i]],fp);
   }
 
   return;
@@ -5136,7 +5476,7 @@ Shortread_print_chopped_sam (Filestring_T fp, T this, int hardclip_low, int hard
 #ifdef PRINT_INDIVIDUAL_CHARS
     FPRINTF(fp,"\t");
     for (i = hardclip_low; i < this->fulllength - hardclip_high; i++) {
-      FPRINTF(fp,"%c",this->contents[i]);
+      PUTC(this->contents[i],fp);
     }
 #else
     FPRINTF(fp,"\t%.*s",this->fulllength - hardclip_high - hardclip_low,&(this->contents[hardclip_low]));
@@ -5151,7 +5491,7 @@ Shortread_print_chopped_revcomp_sam (Filestring_T fp, T this, int hardclip_low,
 
   FPRINTF(fp,"\t");
   for (i = this->fulllength - 1 - hardclip_low; i >= hardclip_high; --i) {
-    FPRINTF(fp,"%c",complCode[(int) this->contents[i]]);
+    PUTC(complCode[(int) this->contents[i]],fp);
   }
 
   return;
@@ -5167,7 +5507,7 @@ Shortread_print_chopped_end (Filestring_T fp, T this, int hardclip_low, int hard
   if (hardclip_low > 0) {
 #ifdef PRINT_INDIVIDUAL_CHARS
     for (i = 0; i < hardclip_low; i++) {
-      FPRINTF(fp,"%c",this->contents[i]);
+      PUTC(this->contents[i],fp);
     }
 #else
     FPRINTF(fp,"%.*s",hardclip_low,&(this->contents[0]));
@@ -5177,7 +5517,7 @@ Shortread_print_chopped_end (Filestring_T fp, T this, int hardclip_low, int hard
   } else {
 #ifdef PRINT_INDIVIDUAL_CHARS
     for (i = this->fulllength - hardclip_high; i < this->fulllength; i++) {
-      FPRINTF(fp,"%c",this->contents[i]);
+      PUTC(this->contents[i],fp);
     }
 #else
     FPRINTF(fp,"%.*s",hardclip_high,&(this->contents[this->fulllength - hardclip_high]));
@@ -5193,13 +5533,13 @@ Shortread_print_chopped_end_revcomp (Filestring_T fp, T this, int hardclip_low,
 
   if (hardclip_low > 0) {
     for (i = this->fulllength - 1; i >= this->fulllength - hardclip_low; --i) {
-      FPRINTF(fp,"%c",complCode[(int) this->contents[i]]);
+      PUTC(complCode[(int) this->contents[i]],fp);
     }
     return;
 
   } else {
     for (i = hardclip_high - 1; i >= 0; --i) {
-      FPRINTF(fp,"%c",complCode[(int) this->contents[i]]);
+      PUTC(complCode[(int) this->contents[i]],fp);
     }
     return;
   }
@@ -5216,7 +5556,7 @@ Shortread_print_chopped_end_quality (Filestring_T fp, T this, int hardclip_low,
   if (hardclip_low > 0) {
 #ifdef PRINT_INDIVIDUAL_CHARS
     for (i = 0; i < hardclip_low; i++) {
-      FPRINTF(fp,"%c",this->quality[i]);
+      PUTC(this->quality[i],fp);
     }
 #else
     FPRINTF(fp,"%.*s",hardclip_low,&(this->quality[0]));
@@ -5226,7 +5566,7 @@ Shortread_print_chopped_end_quality (Filestring_T fp, T this, int hardclip_low,
   } else {
 #ifdef PRINT_INDIVIDUAL_CHARS
     for (i = this->fulllength - hardclip_high; i < this->fulllength; i++) {
-      FPRINTF(fp,"%c",this->quality[i]);
+      PUTC(this->quality[i],fp);
     }
 #else
     FPRINTF(fp,"%.*s",hardclip_high,&(this->quality[this->fulllength - hardclip_high]));
@@ -5242,13 +5582,13 @@ Shortread_print_chopped_end_quality_reverse (Filestring_T fp, T this, int hardcl
 
   if (hardclip_low > 0) {
     for (i = this->fulllength - 1; i >= this->fulllength - hardclip_low; --i) {
-      FPRINTF(fp,"%c",this->quality[i]);
+      PUTC(this->quality[i],fp);
     }
     return;
 
   } else {
     for (i = hardclip_high - 1; i >= 0; --i) {
-      FPRINTF(fp,"%c",this->quality[i]);
+      PUTC(this->quality[i],fp);
     }
     return;
   }
@@ -5276,7 +5616,7 @@ Shortread_print_chop (Filestring_T fp, T this, bool invertp) {
       FPRINTF(fp,"%s",this->chop);
     } else {
       for (i = this->choplength - 1; i >= 0; i--) {
-	FPRINTF(fp,"%c",complCode[(int) this->chop[i]]);
+	PUTC(complCode[(int) this->chop[i]],fp);
       }
     }
   }
@@ -5310,7 +5650,7 @@ Shortread_print_quality (Filestring_T fp, T this, int hardclip_low, int hardclip
 		shift,this->quality[i]);
 	abort();
       } else {
-	FPRINTF(fp,"%c",c);
+	PUTC(c,fp);
       }
     }
 
@@ -5322,7 +5662,7 @@ Shortread_print_quality (Filestring_T fp, T this, int hardclip_low, int hardclip
 		  shift,this->chop_quality[i]);
 	  abort();
 	} else {
-	  FPRINTF(fp,"%c",c);
+	  PUTC(c,fp);
 	}
       }
     }
@@ -5347,7 +5687,7 @@ Shortread_print_quality_revcomp (Filestring_T fp, T this, int hardclip_low, int
 		shift,this->quality[i]);
 	abort();
       } else {
-	FPRINTF(fp,"%c",c);
+	PUTC(c,fp);
       }
     }
 
@@ -5359,7 +5699,7 @@ Shortread_print_quality_revcomp (Filestring_T fp, T this, int hardclip_low, int
 		  shift,this->chop_quality[i]);
 	  abort();
 	} else {
-	  FPRINTF(fp,"%c",c);
+	  PUTC(c,fp);
 	}
       }
     }
@@ -5373,7 +5713,7 @@ Shortread_print_oneline_uc (Filestring_T fp, T this) {
   int i = 0;
 
   for (i = 0; i < this->fulllength; i++) {
-    FPRINTF(fp,"%c",this->contents_uc[i]);
+    PUTC(this->contents_uc[i],fp);
   }
   return;
 }
@@ -5383,7 +5723,7 @@ Shortread_print_oneline_revcomp_uc (Filestring_T fp, T this) {
   int i = 0;
 
   for (i = this->fulllength-1; i >= 0; --i) {
-    FPRINTF(fp,"%c",complCode[(int) this->contents_uc[i]]);
+    PUTC(complCode[(int) this->contents_uc[i]],fp);
   }
   return;
 }
@@ -14,7 +14,7 @@
 #endif
 
 #ifdef HAVE_ZLIB
-#include <zlib.h>
+#include "bgzf.h"
 #endif
 
 #ifdef HAVE_BZLIB
@@ -50,7 +50,7 @@ Shortread_input_init (int *nchars, FILE *fp);
 
 #ifdef HAVE_ZLIB
 extern int
-Shortread_input_init_gzip (gzFile fp);
+Shortread_input_init_gzip (Bgzf_T fp);
 #endif
 
 #ifdef HAVE_BZLIB
@@ -82,6 +82,11 @@ Shortread_quality_string (T this);
 extern int
 Shortread_fulllength (T this);
 
+extern int
+Shortread_cache_keylength (T this);
+extern char *
+Shortread_fill_cache_key (char *dest, T this);
+
 extern void
 Shortread_free (T *old);
 extern T
@@ -116,7 +121,7 @@ Shortread_read_fastq_gzip (int *nextchar, T *queryseq2,
 #ifdef USE_MPI
 			   Filestring_T filestring1, Filestring_T filestring2,
 #endif
-			   gzFile *input1, gzFile *input2,
+			   Bgzf_T *input1, Bgzf_T *input2,
 			   char ***files, int *nfiles, bool skipp);
 #endif
 
@@ -140,7 +145,7 @@ Shortread_read_fasta_gzip (int *nextchar, T *queryseq2,
 #ifdef USE_MPI
 			   Filestring_T filestring1, Filestring_T filestring2,
 #endif
-			   gzFile *input1, gzFile *input2,
+			   Bgzf_T *input1, Bgzf_T *input2,
 			   char ***files, int *nfiles, bool skipp);
 #endif
 
@@ -162,7 +167,7 @@ Shortread_read (int *nextchar, int *nchars1, int *nchars2, T *queryseq2,
 #endif
 		FILE **input1, FILE **input2,
 #ifdef HAVE_ZLIB
-		gzFile *gzipped1, gzFile *gzipped2,
+		Bgzf_T *gzipped1, Bgzf_T *gzipped2,
 #endif
 #ifdef HAVE_BZLIB
 		Bzip2_T *bzipped1, Bzip2_T *bzipped2,
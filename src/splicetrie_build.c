@@ -2399,6 +2399,7 @@ build_via_splicesites_size (int *trie_obs_size, int *trie_max_size,
 void
 Splicetrie_build_via_splicesites (Triecontent_T **triecontents_obs, Trieoffset_T **trieoffsets_obs,
 				  Triecontent_T **triecontents_max, Trieoffset_T **trieoffsets_max,
+				  int *ntriecontents_obs, int *ntriecontents_max,
 				  int *nsplicepartners_skip, int *nsplicepartners_obs, int *nsplicepartners_max,
 				  Splicetype_T *splicetypes, List_T *splicestrings, int nsplicesites) {
 #ifdef USE_LIST
@@ -2836,6 +2837,9 @@ Splicetrie_build_via_splicesites (Triecontent_T **triecontents_obs, Trieoffset_T
   Uintlist_free(&triecontents_max_list);
 #endif
 
+  *ntriecontents_obs = (distances_observed_p == true) ? nprinted_obs : 0;
+  *ntriecontents_max = nprinted_max;
+
   return;
 }
 
@@ -3125,7 +3129,7 @@ build_via_introns_size (int *trie_obs_size, Univcoord_T *splicesites, Splicetype
 
 void
 Splicetrie_build_via_introns (Triecontent_T **triecontents_obs, Trieoffset_T **trieoffsets_obs,
-			      Univcoord_T *splicesites, Splicetype_T *splicetypes,
+			      int *ntriecontents_obs, Univcoord_T *splicesites, Splicetype_T *splicetypes,
 			      List_T *splicestrings, int nsplicesites,
 			      Univ_IIT_T chromosome_iit, IIT_T splicing_iit, int *splicing_divint_crosstable) {
 #ifdef USE_LIST
@@ -3399,6 +3403,8 @@ Splicetrie_build_via_introns (Triecontent_T **triecontents_obs, Trieoffset_T **t
   Uintlist_free(&triecontents_obs_list);
 #endif
 
+  *ntriecontents_obs = nprinted_obs;
+
   return;
 }
 
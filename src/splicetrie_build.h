@@ -63,12 +63,13 @@ Splicetrie_npartners (int **nsplicepartners_skip, int **nsplicepartners_obs, int
 extern void
 Splicetrie_build_via_splicesites (Triecontent_T **triecontents_obs, Trieoffset_T **trieoffsets_obs,
 				  Triecontent_T **triecontents_max, Trieoffset_T **trieoffsets_max,
+				  int *ntriecontents_obs, int *ntriecontents_max,
 				  int *nsplicepartners_skip, int *nsplicepartners_obs, int *nsplicepartners_max,
 				  Splicetype_T *splicetypes, List_T *splicestrings, int nsplicesites);
 
 extern void
 Splicetrie_build_via_introns (Triecontent_T **triecontents_obs, Trieoffset_T **trieoffsets_obs,
-			      Univcoord_T *splicesites, Splicetype_T *splicetypes,
+			      int *ntriecontents_obs, Univcoord_T *splicesites, Splicetype_T *splicetypes,
 			      List_T *splicestrings, int nsplicesites,
 			      Univ_IIT_T chromosome_iit, IIT_T splicing_iit, int *splicing_divint_crosstable);
 
@@ -0,0 +1,387 @@
+static char rcsid[] = "$Id: splicetrie_store.c $";
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "splicetrie_store.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>		/* For strlen, strrchr, and strerror */
+#include <errno.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>		/* For close, getpid, and unlink */
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>		/* For stat */
+#endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>		/* For munmap */
+#endif
+
+#include "mem.h"
+#include "fopen.h"
+#include "access.h"
+
+
+/* A splicetrie store holds everything gsnap derives from a splicing
+   IIT at startup, so that later runs can memory-map it instead of
+   rebuilding the tries.  The file starts with a header of UINT8
+   values, padded to HEADER_SIZE, followed by the arrays at offsets
+   that are a function of the header alone.  The header records what
+   the arrays were built from, and a store that does not match the
+   current IIT file, genome, or parameters is ignored.  With -v, the
+   alternate splice fragments come from the SNP database, so its name
+   goes into the filename, and its name and IIT file into the header. */
+
+#define STORE_MAGIC 0x474D41505354524FULL /* "GMAPSTRO" */
+#define STORE_VERSION 2
+#define HEADER_SIZE 4096	/* Keeps splicecomp page-aligned, so its empty pages can be holes */
+#define SECTION_ALIGNMENT 8
+
+#define H_MAGIC 0
+#define H_VERSION 1
+#define H_UNIVCOORD_SIZE 2
+#define H_GENOMELENGTH 3
+#define H_SHORTSPLICEDIST 4
+#define H_IIT_SIZE 5
+#define H_IIT_MTIME 6
+#define H_FLAGS 7
+#define H_NSPLICESITES 8
+#define H_NTRIECONTENTS_OBS 9
+#define H_NTRIECONTENTS_MAX 10
+#define H_SNPS_IIT_SIZE 11
+#define H_SNPS_IIT_MTIME 12
+#define H_NFIELDS 13
+#define SNPS_ROOT_OFFSET 1024	/* Byte offset of snps_root within the header */
+
+#define FLAG_ALT 1
+#define FLAG_OBS 2
+#define FLAG_MAX 4
+#define FLAG_DISTANCES_OBSERVED 8
+
+typedef enum {SPLICECOMP, SPLICESITES, SPLICETYPES, SPLICEDISTS, SPLICEFRAGS_REF, SPLICEFRAGS_ALT,
+	      TRIEOFFSETS_OBS, TRIECONTENTS_OBS, TRIEOFFSETS_MAX, TRIECONTENTS_MAX, NSECTIONS} Section_T;
+
+
+#define T Splicetrie_store_T
+struct T {
+  int fd;
+  size_t len;
+  char *memory;
+};
+
+
+char *
+Splicetrie_store_filename (char *mapdir, char *splicing_file, char *snps_root) {
+  char *filename, *basename;
+
+  if ((basename = strrchr(splicing_file,'/')) == NULL) {
+    basename = splicing_file;
+  } else {
+    basename++;
+  }
+  if (snps_root == NULL) {
+    filename = (char *) CALLOC(strlen(mapdir)+strlen("/")+strlen(basename)+strlen(".")+
+			       strlen(SPLICETRIE_STORE_FILESUFFIX)+1,sizeof(char));
+    sprintf(filename,"%s/%s.%s",mapdir,basename,SPLICETRIE_STORE_FILESUFFIX);
+  } else {
+    filename = (char *) CALLOC(strlen(mapdir)+strlen("/")+strlen(basename)+strlen(".")+strlen(snps_root)+strlen(".")+
+			       strlen(SPLICETRIE_STORE_FILESUFFIX)+1,sizeof(char));
+    sprintf(filename,"%s/%s.%s.%s",mapdir,basename,snps_root,SPLICETRIE_STORE_FILESUFFIX);
+  }
+  return filename;
+}
+
+
+void
+Splicetrie_store_free (T *old) {
+  if (*old) {
+#ifdef HAVE_MMAP
+    munmap((void *) (*old)->memory,(*old)->len);
+#endif
+    close((*old)->fd);
+    FREE(*old);
+  }
+  return;
+}
+
+
+/* Looks for the IIT file the same way IIT_read does */
+static bool
+iit_identity (UINT8 *size, UINT8 *mtime, char *iitfile) {
+  struct stat sb;
+  char *newfile;
+  bool foundp = false;
+
+  newfile = (char *) CALLOC(strlen(iitfile)+strlen(".iit")+1,sizeof(char));
+  sprintf(newfile,"%s.iit",iitfile);
+  if (stat(newfile,&sb) == 0 || stat(iitfile,&sb) == 0) {
+    *size = (UINT8) sb.st_size;
+    *mtime = (UINT8) sb.st_mtime;
+    foundp = true;
+  }
+  FREE(newfile);
+
+  return foundp;
+}
+
+
+static void
+compute_layout (off_t *offsets, size_t *lengths, UINT8 *header) {
+  size_t nsplicesites = (size_t) header[H_NSPLICESITES];
+  UINT8 flags = header[H_FLAGS];
+  off_t offset;
+  int section;
+
+  lengths[SPLICECOMP] = ((header[H_GENOMELENGTH]+31)/32U) * sizeof(Genomecomp_T);
+  lengths[SPLICESITES] = (nsplicesites + 1) * sizeof(Univcoord_T); /* Includes end marker */
+  lengths[SPLICETYPES] = nsplicesites * sizeof(Splicetype_T);
+  lengths[SPLICEDISTS] = nsplicesites * sizeof(Chrpos_T);
+  lengths[SPLICEFRAGS_REF] = nsplicesites * sizeof(Genomecomp_T);
+  lengths[SPLICEFRAGS_ALT] = (flags & FLAG_ALT) ? nsplicesites * sizeof(Genomecomp_T) : 0;
+  lengths[TRIEOFFSETS_OBS] = (flags & FLAG_OBS) ? nsplicesites * sizeof(Trieoffset_T) : 0;
+  lengths[TRIECONTENTS_OBS] = (flags & FLAG_OBS) ? header[H_NTRIECONTENTS_OBS] * sizeof(Triecontent_T) : 0;
+  lengths[TRIEOFFSETS_MAX] = (flags & FLAG_MAX) ? nsplicesites * sizeof(Trieoffset_T) : 0;
+  lengths[TRIECONTENTS_MAX] = (flags & FLAG_MAX) ? header[H_NTRIECONTENTS_MAX] * sizeof(Triecontent_T) : 0;
+
+  offset = HEADER_SIZE;
+  for (section = 0; section < NSECTIONS; section++) {
+    offsets[section] = offset;
+    offset += lengths[section];
+    offset = (offset + SECTION_ALIGNMENT - 1) & ~((off_t) SECTION_ALIGNMENT - 1);
+  }
+  return;
+}
+
+
+#ifdef HAVE_MMAP
+T
+Splicetrie_store_read (bool *distances_observed_p, Genomecomp_T **splicecomp, Univcoord_T **splicesites,
+		       Splicetype_T **splicetypes, Chrpos_T **splicedists,
+		       Genomecomp_T **splicefrags_ref, Genomecomp_T **splicefrags_alt,
+		       Trieoffset_T **trieoffsets_obs, Triecontent_T **triecontents_obs,
+		       Trieoffset_T **trieoffsets_max, Triecontent_T **triecontents_max,
+		       int *nsplicesites, char *filename, char *iitfile,
+		       Univcoord_T genomelength, Chrpos_T shortsplicedist,
+		       char *snps_root, char *snps_iitfile) {
+  T new;
+  UINT8 *header, iit_size, iit_mtime, snps_iit_size = 0, snps_iit_mtime = 0;
+  off_t offsets[NSECTIONS];
+  size_t lengths[NSECTIONS];
+  off_t end;
+  char *memory;
+  size_t len;
+  int fd, section;
+
+  if (Access_file_exists_p(filename) == false) {
+    return (T) NULL;
+  } else if (iit_identity(&iit_size,&iit_mtime,iitfile) == false) {
+    return (T) NULL;
+  } else if (snps_root != NULL && iit_identity(&snps_iit_size,&snps_iit_mtime,snps_iitfile) == false) {
+    return (T) NULL;
+  } else if (Access_filesize(filename) < HEADER_SIZE) {
+    return (T) NULL;
+  } else if ((memory = (char *) Access_mmap(&fd,&len,filename,sizeof(UINT8),/*randomp*/true)) == NULL) {
+    close(fd);
+    return (T) NULL;
+  }
+
+  header = (UINT8 *) memory;
+  if (header[H_MAGIC] != STORE_MAGIC || header[H_VERSION] != STORE_VERSION ||
+      header[H_UNIVCOORD_SIZE] != sizeof(Univcoord_T) ||
+      header[H_GENOMELENGTH] != (UINT8) genomelength ||
+      header[H_SHORTSPLICEDIST] != (UINT8) shortsplicedist ||
+      header[H_IIT_SIZE] != iit_size || header[H_IIT_MTIME] != iit_mtime ||
+      ((header[H_FLAGS] & FLAG_ALT) ? true : false) != (snps_root != NULL) ||
+      header[H_SNPS_IIT_SIZE] != snps_iit_size || header[H_SNPS_IIT_MTIME] != snps_iit_mtime ||
+      strncmp(&(memory[SNPS_ROOT_OFFSET]),snps_root == NULL ? "" : snps_root,HEADER_SIZE - SNPS_ROOT_OFFSET) != 0 ||
+      header[H_NSPLICESITES] == 0) {
+    fprintf(stderr,"splicetrie store %s is out of date...",filename);
+    munmap((void *) memory,len);
+    close(fd);
+    return (T) NULL;
+  }
+
+  compute_layout(offsets,lengths,header);
+  /* The writer stops at the last byte of the last non-empty section,
+     which need not be aligned */
+  end = HEADER_SIZE;
+  for (section = 0; section < NSECTIONS; section++) {
+    if (lengths[section] > 0) {
+      end = offsets[section] + lengths[section];
+    }
+  }
+  if ((size_t) end > len) {
+    fprintf(stderr,"splicetrie store %s is truncated...",filename);
+    munmap((void *) memory,len);
+    close(fd);
+    return (T) NULL;
+  }
+
+  fprintf(stderr,"memory mapping splicetrie store %s...",filename);
+  *nsplicesites = (int) header[H_NSPLICESITES];
+  if (distances_observed_p != NULL) {
+    *distances_observed_p = (header[H_FLAGS] & FLAG_DISTANCES_OBSERVED) ? true : false;
+  }
+  *splicecomp = (Genomecomp_T *) &(memory[offsets[SPLICECOMP]]);
+  *splicesites = (Univcoord_T *) &(memory[offsets[SPLICESITES]]);
+  *splicetypes = (Splicetype_T *) &(memory[offsets[SPLICETYPES]]);
+  *splicedists = (Chrpos_T *) &(memory[offsets[SPLICEDISTS]]);
+  *splicefrags_ref = (Genomecomp_T *) &(memory[offsets[SPLICEFRAGS_REF]]);
+  if (snps_root != NULL) {
+    *splicefrags_alt = (Genomecomp_T *) &(memory[offsets[SPLICEFRAGS_ALT]]);
+  } else {
+    *splicefrags_alt = *splicefrags_ref;
+  }
+  if (header[H_FLAGS] & FLAG_OBS) {
+    *trieoffsets_obs = (Trieoffset_T *) &(memory[offsets[TRIEOFFSETS_OBS]]);
+    *triecontents_obs = (Triecontent_T *) &(memory[offsets[TRIECONTENTS_OBS]]);
+  } else {
+    *trieoffsets_obs = (Trieoffset_T *) NULL;
+    *triecontents_obs = (Triecontent_T *) NULL;
+  }
+  if (header[H_FLAGS] & FLAG_MAX) {
+    *trieoffsets_max = (Trieoffset_T *) &(memory[offsets[TRIEOFFSETS_MAX]]);
+    *triecontents_max = (Triecontent_T *) &(memory[offsets[TRIECONTENTS_MAX]]);
+  } else {
+    *trieoffsets_max = (Trieoffset_T *) NULL;
+    *triecontents_max = (Triecontent_T *) NULL;
+  }
+
+  new = (T) MALLOC(sizeof(*new));
+  new->fd = fd;
+  new->len = len;
+  new->memory = memory;
+  return new;
+}
+#else
+T
+Splicetrie_store_read (bool *distances_observed_p, Genomecomp_T **splicecomp, Univcoord_T **splicesites,
+		       Splicetype_T **splicetypes, Chrpos_T **splicedists,
+		       Genomecomp_T **splicefrags_ref, Genomecomp_T **splicefrags_alt,
+		       Trieoffset_T **trieoffsets_obs, Triecontent_T **triecontents_obs,
+		       Trieoffset_T **trieoffsets_max, Triecontent_T **triecontents_max,
+		       int *nsplicesites, char *filename, char *iitfile,
+		       Univcoord_T genomelength, Chrpos_T shortsplicedist,
+		       char *snps_root, char *snps_iitfile) {
+  return (T) NULL;
+}
+#endif
+
+
+/* Pages of splicecomp with no splice sites are skipped over, leaving
+   holes in the file on filesystems that support them */
+static bool
+write_sparse (FILE *fp, char *data, size_t length) {
+  size_t pos, chunk, i;
+  int pagesize = HEADER_SIZE;
+
+  for (pos = 0; pos < length; pos += chunk) {
+    if ((chunk = length - pos) > (size_t) pagesize) {
+      chunk = pagesize;
+    }
+    for (i = pos; i < pos + chunk && data[i] == 0; i++) ;
+    if (i < pos + chunk) {
+      if (fwrite(&(data[pos]),sizeof(char),chunk,fp) != chunk) {
+	return false;
+      }
+    } else if (fseeko(fp,(off_t) chunk,SEEK_CUR) != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+void
+Splicetrie_store_write (char *filename, char *iitfile, Univcoord_T genomelength,
+			Chrpos_T shortsplicedist, char *snps_root, char *snps_iitfile, bool distances_observed_p,
+			Genomecomp_T *splicecomp, Univcoord_T *splicesites,
+			Splicetype_T *splicetypes, Chrpos_T *splicedists,
+			Genomecomp_T *splicefrags_ref, Genomecomp_T *splicefrags_alt,
+			Trieoffset_T *trieoffsets_obs, Triecontent_T *triecontents_obs, int ntriecontents_obs,
+			Trieoffset_T *trieoffsets_max, Triecontent_T *triecontents_max, int ntriecontents_max,
+			int nsplicesites) {
+  UINT8 header[HEADER_SIZE/sizeof(UINT8)];
+  off_t offsets[NSECTIONS];
+  size_t lengths[NSECTIONS];
+  void *data[NSECTIONS];
+  char *tmpfile;
+  FILE *fp;
+  bool okp = true;
+  int section;
+
+  memset(header,0,HEADER_SIZE);
+  header[H_MAGIC] = STORE_MAGIC;
+  header[H_VERSION] = STORE_VERSION;
+  header[H_UNIVCOORD_SIZE] = sizeof(Univcoord_T);
+  header[H_GENOMELENGTH] = (UINT8) genomelength;
+  header[H_SHORTSPLICEDIST] = (UINT8) shortsplicedist;
+  if (iit_identity(&(header[H_IIT_SIZE]),&(header[H_IIT_MTIME]),iitfile) == false) {
+    return;
+  }
+  if (snps_root != NULL) {
+    if (strlen(snps_root) >= HEADER_SIZE - SNPS_ROOT_OFFSET ||
+	iit_identity(&(header[H_SNPS_IIT_SIZE]),&(header[H_SNPS_IIT_MTIME]),snps_iitfile) == false) {
+      return;
+    }
+    strcpy(&(((char *) header)[SNPS_ROOT_OFFSET]),snps_root);
+  }
+  header[H_FLAGS] = (snps_root != NULL ? FLAG_ALT : 0) | (trieoffsets_obs != NULL ? FLAG_OBS : 0) |
+    (trieoffsets_max != NULL ? FLAG_MAX : 0) | (distances_observed_p ? FLAG_DISTANCES_OBSERVED : 0);
+  header[H_NSPLICESITES] = (UINT8) nsplicesites;
+  header[H_NTRIECONTENTS_OBS] = (UINT8) ntriecontents_obs;
+  header[H_NTRIECONTENTS_MAX] = (UINT8) ntriecontents_max;
+  compute_layout(offsets,lengths,header);
+
+  data[SPLICECOMP] = (void *) splicecomp;
+  data[SPLICESITES] = (void *) splicesites;
+  data[SPLICETYPES] = (void *) splicetypes;
+  data[SPLICEDISTS] = (void *) splicedists;
+  data[SPLICEFRAGS_REF] = (void *) splicefrags_ref;
+  data[SPLICEFRAGS_ALT] = (void *) splicefrags_alt;
+  data[TRIEOFFSETS_OBS] = (void *) trieoffsets_obs;
+  data[TRIECONTENTS_OBS] = (void *) triecontents_obs;
+  data[TRIEOFFSETS_MAX] = (void *) trieoffsets_max;
+  data[TRIECONTENTS_MAX] = (void *) triecontents_max;
+
+  /* Written under a temporary name and renamed, so that concurrent
+     processes never map a partial store */
+  tmpfile = (char *) CALLOC(strlen(filename)+strlen(".")+20+1,sizeof(char));
+  sprintf(tmpfile,"%s.%ld",filename,(long) getpid());
+  if ((fp = FOPEN_WRITE_BINARY(tmpfile)) == NULL) {
+    fprintf(stderr,"cannot write splicetrie store %s (%s)...",filename,strerror(errno));
+    FREE(tmpfile);
+    return;
+  }
+
+  if (fwrite(header,sizeof(char),HEADER_SIZE,fp) != HEADER_SIZE) {
+    okp = false;
+  }
+  for (section = 0; section < NSECTIONS && okp == true; section++) {
+    if (lengths[section] == 0) {
+      /* Skip */
+    } else if (fseeko(fp,offsets[section],SEEK_SET) != 0) {
+      okp = false;
+    } else if (section == SPLICECOMP) {
+      okp = write_sparse(fp,(char *) data[section],lengths[section]);
+    } else if (fwrite(data[section],sizeof(char),lengths[section],fp) != lengths[section]) {
+      okp = false;
+    }
+  }
+  if (fclose(fp) != 0) {
+    okp = false;
+  }
+
+  if (okp == false || rename(tmpfile,filename) != 0) {
+    fprintf(stderr,"cannot write splicetrie store %s (%s)...",filename,strerror(errno));
+    unlink(tmpfile);
+  } else {
+    fprintf(stderr,"saved splicetrie store %s...",filename);
+  }
+  FREE(tmpfile);
+
+  return;
+}
+
@@ -0,0 +1,43 @@
+/* $Id: splicetrie_store.h $ */
+#ifndef SPLICETRIE_STORE_INCLUDED
+#define SPLICETRIE_STORE_INCLUDED
+
+#include "bool.h"
+#include "types.h"
+#include "genomicpos.h"
+#include "splicetrie_build.h"	/* For Splicetype_T */
+
+#define SPLICETRIE_STORE_FILESUFFIX "splicetrie"
+
+#define T Splicetrie_store_T
+typedef struct T *T;
+
+extern char *
+Splicetrie_store_filename (char *mapdir, char *splicing_file, char *snps_root);
+
+extern void
+Splicetrie_store_free (T *old);
+
+extern T
+Splicetrie_store_read (bool *distances_observed_p, Genomecomp_T **splicecomp, Univcoord_T **splicesites,
+		       Splicetype_T **splicetypes, Chrpos_T **splicedists,
+		       Genomecomp_T **splicefrags_ref, Genomecomp_T **splicefrags_alt,
+		       Trieoffset_T **trieoffsets_obs, Triecontent_T **triecontents_obs,
+		       Trieoffset_T **trieoffsets_max, Triecontent_T **triecontents_max,
+		       int *nsplicesites, char *filename, char *iitfile,
+		       Univcoord_T genomelength, Chrpos_T shortsplicedist,
+		       char *snps_root, char *snps_iitfile);
+
+extern void
+Splicetrie_store_write (char *filename, char *iitfile, Univcoord_T genomelength,
+			Chrpos_T shortsplicedist, char *snps_root, char *snps_iitfile, bool distances_observed_p,
+			Genomecomp_T *splicecomp, Univcoord_T *splicesites,
+			Splicetype_T *splicetypes, Chrpos_T *splicedists,
+			Genomecomp_T *splicefrags_ref, Genomecomp_T *splicefrags_alt,
+			Trieoffset_T *trieoffsets_obs, Triecontent_T *triecontents_obs, int ntriecontents_obs,
+			Trieoffset_T *trieoffsets_max, Triecontent_T *triecontents_max, int ntriecontents_max,
+			int nsplicesites);
+
+#undef T
+#endif
+
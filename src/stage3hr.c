@@ -15500,6 +15500,84 @@ Stage3pair_remove_circular_alias (List_T hitpairlist) {
 }
 
 
+/* The pairing sweeps below walk one list of anchor hits, sorted by
+   the coordinate that defines insert_start, against a partner list
+   sorted by genomicstart (or genomicend if endp).  Both searches
+   gallop from the previous position, so a repetitive mate with
+   thousands of hits costs O(log) per unpaired run instead of a scan
+   over every hit. */
+
+static inline Univcoord_T
+hit_coord (T hit, bool endp) {
+  return (endp == true) ? hit->genomicend : hit->genomicstart;
+}
+
+/* Returns the first k >= lowk with coord + extent > insert_start, or
+   nhits if there is none */
+static int
+window_lower_bound (T *hits, int lowk, int nhits, bool endp, int extent, Univcoord_T insert_start) {
+  int highk, step = 1;
+
+  if (lowk >= nhits || hit_coord(hits[lowk],endp) + extent > insert_start) {
+    return lowk;
+  }
+
+  /* Invariant: hits[lowk] fails, hits[highk] (if < nhits) succeeds */
+  highk = lowk + 1;
+  while (highk < nhits && hit_coord(hits[highk],endp) + extent <= insert_start) {
+    lowk = highk;
+    step += step;
+    highk = lowk + step;
+  }
+  if (highk > nhits) {
+    highk = nhits;
+  }
+
+  while (lowk + 1 < highk) {
+    step = lowk + (highk - lowk)/2;
+    if (hit_coord(hits[step],endp) + extent <= insert_start) {
+      lowk = step;
+    } else {
+      highk = step;
+    }
+  }
+  return highk;
+}
+
+/* Returns the first anchor k >= lowk whose window, ending at pairmax +
+   insert_start, reaches partner_end, or nanchors if there is none.
+   Anchors before lowk are known not to wrap below querylength. */
+static int
+window_next_anchor (T *anchors, int lowk, int nanchors, bool endp, int querylength,
+		    Univcoord_T partner_end) {
+  int highk, step = 1;
+
+  if (lowk >= nanchors || partner_end <= pairmax + (hit_coord(anchors[lowk],endp) - querylength)) {
+    return lowk;
+  }
+
+  highk = lowk + 1;
+  while (highk < nanchors && partner_end > pairmax + (hit_coord(anchors[highk],endp) - querylength)) {
+    lowk = highk;
+    step += step;
+    highk = lowk + step;
+  }
+  if (highk > nanchors) {
+    highk = nanchors;
+  }
+
+  while (lowk + 1 < highk) {
+    step = lowk + (highk - lowk)/2;
+    if (partner_end > pairmax + (hit_coord(anchors[step],endp) - querylength)) {
+      lowk = step;
+    } else {
+      highk = step;
+    }
+  }
+  return highk;
+}
+
+
 static List_T
 pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordant, int *nsamechr,
 			List_T *samechr, List_T *conc_transloc, List_T hitpairs,
@@ -15514,7 +15592,7 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 			int querylength5, int querylength3, int maxpairedpaths,
 			int splicing_penalty, int genestrand) {
   int new_found_score = *found_score;
-  int frontier_score, score5_start, score5_end, score5, score3, i, j;
+  int frontier_score, score5_start, score5_end, score5, score3, i, j, lowj;
   List_T q, prev_start;
   Stage3pair_T stage3pair;
   T *hits5, *hits3, hit5, hit3;
@@ -15566,31 +15644,29 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 	  debug5(printf("at score %d, nhits5_plus = %d; at score %d, nhits3_plus = %d\n",
 			score5,nhits5,score3,nhits3));
 
-	  i = j = 0;
+	  i = lowj = 0;
 	  while (*abort_pairing_p == false && i < nhits5) {
 	    hit5 = hits5[i];
+	    if (hit5->genomicend < (Univcoord_T) querylength5) {
+	      /* insert_start would wrap, so nothing pairs with this hit */
+	      i++;
+	      continue;
+	    }
 	    insert_start = hit5->genomicend - querylength5;
 	    debug5(printf("plus/plus: i=%d/%d %u..%u %s %s %p\n",
 			  i,nhits5,hit5->genomicstart - hit5->chroffset,hit5->genomicend - hit5->chroffset,
 			  print_sense(hit5->sensedir),hittype_string(hit5->hittype),hit5));
 
-	    while (j >= 0 && 
-		   hits3[j]->genomicstart + querylength3 /* for scramble: */ + pairmax > insert_start) {
-	      debug5(printf("  backup: j=%d/%d %u..%u %s %s %p\n",
-			    j,nhits3,hits3[j]->genomicstart - hits3[j]->chroffset,hits3[j]->genomicend - hits3[j]->chroffset,
-			    print_sense(hits3[j]->sensedir),hittype_string(hits3[j]->hittype),hits3[j]));
-	      j--;
-	    }
-	    j++;		/* Finish backup */
-
-	    while (j < nhits3 && 
-		   hits3[j]->genomicstart + querylength3 /* for scramble: */ + pairmax <= insert_start) {
-	      debug5(printf("  advance: j=%d/%d %u..%u %s %s %p\n",
-			    j,nhits3,hits3[j]->genomicstart - hits3[j]->chroffset,hits3[j]->genomicend - hits3[j]->chroffset,
-			    print_sense(hits3[j]->sensedir),hittype_string(hits3[j]->hittype),hits3[j]));
-	      j++;
+	    /* for scramble: window extends pairmax below insert_start */
+	    if ((lowj = window_lower_bound(hits3,lowj,nhits3,/*endp*/false,querylength3 + pairmax,insert_start)) >= nhits3) {
+	      break;
+	    } else if (hits3[lowj]->genomicstart + querylength3 > pairmax + insert_start) {
+	      i = window_next_anchor(hits5,i + 1,nhits5,/*endp*/true,querylength5,
+				     hits3[lowj]->genomicstart + querylength3);
+	      continue;
 	    }
 
+	    j = lowj;
 	    while (j < nhits3 && hits3[j]->genomicstart + querylength3 <= pairmax + insert_start) {
 	      debug5(printf("  overlap: j=%d/%d %u..%u %s %s %p",
 			    j,nhits3,hits3[j]->genomicstart - hits3[j]->chroffset,hits3[j]->genomicend - hits3[j]->chroffset,
@@ -15672,7 +15748,6 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 
 	      j++;
 	    }
-	    j--;		/* Finish advance */
 
 	    i++;
 	  }
@@ -15687,31 +15762,29 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 	  debug5(printf("at score %d, nhits5_minus = %d; at score %d, nhits3_minus = %d\n",
 			score5,nhits5,score3,nhits3));
 
-	  i = j = 0;
+	  i = lowj = 0;
 	  while (*abort_pairing_p == false && i < nhits3) {
 	    hit3 = hits3[i];
+	    if (hit3->genomicstart < (Univcoord_T) querylength3) {
+	      /* insert_start would wrap, so nothing pairs with this hit */
+	      i++;
+	      continue;
+	    }
 	    insert_start = hit3->genomicstart - querylength3;
 	    debug5(printf("minus/minus: i=%d/%d %u..%u %s %s %p\n",
 			  i,nhits3,hit3->genomicstart - hit3->chroffset,hit3->genomicend - hit3->chroffset,
 			  print_sense(hit3->sensedir),hittype_string(hit3->hittype),hit3));
 
-	    while (j >= 0 && 
-		   hits5[j]->genomicend + querylength5 /* for scramble: */ + pairmax > insert_start) {
-	      debug5(printf("  backup: j=%d/%d %u..%u %s %s %p\n",
-			    j,nhits5,hits5[j]->genomicstart - hits5[j]->chroffset,hits5[j]->genomicend - hits5[j]->chroffset,
-			    print_sense(hits5[j]->sensedir),hittype_string(hits5[j]->hittype),hits5[j]));
-	      j--;
-	    }
-	    j++;			/* Finish backup */
-
-	    while (j < nhits5 && 
-		   hits5[j]->genomicend + querylength5 /* for scramble: */ + pairmax <= insert_start) {
-	      debug5(printf("  advance: j=%d/%d %u..%u %s %s %p\n",
-			    j,nhits5,hits5[j]->genomicstart - hits5[j]->chroffset,hits5[j]->genomicend - hits5[j]->chroffset,
-			    print_sense(hits5[j]->sensedir),hittype_string(hits5[j]->hittype),hits5[j]));
-	      j++;
+	    /* for scramble: window extends pairmax below insert_start */
+	    if ((lowj = window_lower_bound(hits5,lowj,nhits5,/*endp*/true,querylength5 + pairmax,insert_start)) >= nhits5) {
+	      break;
+	    } else if (hits5[lowj]->genomicend + querylength5 > pairmax + insert_start) {
+	      i = window_next_anchor(hits3,i + 1,nhits3,/*endp*/false,querylength3,
+				     hits5[lowj]->genomicend + querylength5);
+	      continue;
 	    }
 
+	    j = lowj;
 	    while (j < nhits5 && hits5[j]->genomicend + querylength5 <= pairmax + insert_start) {
 	      debug5(printf("  overlap: j=%d/%d %u..%u %s %s %p",
 			    j,nhits5,hits5[j]->genomicstart - hits5[j]->chroffset,hits5[j]->genomicend - hits5[j]->chroffset,
@@ -15794,7 +15867,6 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 
 	      j++;
 	    }
-	    j--;		/* Finish advance */
 
 	    i++;
 	  }
@@ -15809,31 +15881,29 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 	  debug5(printf("at score %d, nhits5_plus = %d; at score %d, nhits3_minus = %d\n",
 			score5,nhits5,score3,nhits3));
 
-	  i = j = 0;
+	  i = lowj = 0;
 	  while (*abort_pairing_p == false && i < nhits5) {
 	    hit5 = hits5[i];
+	    if (hit5->genomicend < (Univcoord_T) querylength5) {
+	      /* insert_start would wrap, so nothing pairs with this hit */
+	      i++;
+	      continue;
+	    }
 	    insert_start = hit5->genomicend - querylength5;
 	    debug5(printf("plus/minus: i=%d/%d %u..%u %s %s %p\n",
 			  i,nhits5,hit5->genomicstart - hit5->chroffset,hit5->genomicend - hit5->chroffset,
 			  print_sense(hit5->sensedir),hittype_string(hit5->hittype),hit5));
 
-	    while (j >= 0 && 
-		   hits3[j]->genomicstart + querylength3 /* for scramble: */ + pairmax > insert_start) {
-	      debug5(printf("  backup: j=%d/%d %u..%u %s %s %p\n",
-			    j,nhits3,hits3[j]->genomicstart - hits3[j]->chroffset,hits3[j]->genomicend - hits3[j]->chroffset,
-			    print_sense(hits3[j]->sensedir),hittype_string(hits3[j]->hittype),hits3[j]));
-	      j--;
-	    }
-	    j++;		/* Finish backup */
-
-	    while (j < nhits3 && 
-		   hits3[j]->genomicstart + querylength3 /* for scramble: */ + pairmax <= insert_start) {
-	      debug5(printf("  advance: j=%d/%d %u..%u %s %s %p\n",
-			    j,nhits3,hits3[j]->genomicstart - hits3[j]->chroffset,hits3[j]->genomicend - hits3[j]->chroffset,
-			    print_sense(hits3[j]->sensedir),hittype_string(hits3[j]->hittype),hits3[j]));
-	      j++;
+	    /* for scramble: window extends pairmax below insert_start */
+	    if ((lowj = window_lower_bound(hits3,lowj,nhits3,/*endp*/false,querylength3 + pairmax,insert_start)) >= nhits3) {
+	      break;
+	    } else if (hits3[lowj]->genomicstart + querylength3 > pairmax + insert_start) {
+	      i = window_next_anchor(hits5,i + 1,nhits5,/*endp*/true,querylength5,
+				     hits3[lowj]->genomicstart + querylength3);
+	      continue;
 	    }
 
+	    j = lowj;
 	    while (j < nhits3 && hits3[j]->genomicstart + querylength3 <= pairmax + insert_start) {
 	      debug5(printf("  overlap: j=%d/%d %u..%u %s %s %p",
 			    j,nhits3,hits3[j]->genomicstart - hits3[j]->chroffset,hits3[j]->genomicend - hits3[j]->chroffset,
@@ -15879,7 +15949,6 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 
 	      j++;
 	    }
-	    j--;		/* Finish advance */
 
 	    i++;
 	  }
@@ -15894,31 +15963,29 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 	  debug5(printf("at score %d, nhits5_minus = %d; at score %d, nhits3_plus = %d\n",
 			score5,nhits5,score3,nhits3));
 
-	  i = j = 0;
+	  i = lowj = 0;
 	  while (*abort_pairing_p == false && i < nhits3) {
 	    hit3 = hits3[i];
+	    if (hit3->genomicstart < (Univcoord_T) querylength3) {
+	      /* insert_start would wrap, so nothing pairs with this hit */
+	      i++;
+	      continue;
+	    }
 	    insert_start = hit3->genomicstart - querylength3;
 	    debug5(printf("minus/plus: i=%d/%d %u..%u %s %s %p\n",
 			  i,nhits3,hit3->genomicstart - hit3->chroffset,hit3->genomicend - hit3->chroffset,
 			  print_sense(hit3->sensedir),hittype_string(hit3->hittype),hit3));
 
-	    while (j >= 0 && 
-		   hits5[j]->genomicend + querylength5 /* for scramble: */ + pairmax > insert_start) {
-	      debug5(printf("  backup: j=%d/%d %u..%u %s %s %p\n",
-			    j,nhits5,hits5[j]->genomicstart - hits5[j]->chroffset,hits5[j]->genomicend - hits5[j]->chroffset,
-			    print_sense(hits5[j]->sensedir),hittype_string(hits5[j]->hittype),hits5[j]));
-	      j--;
-	    }
-	    j++;			/* Finish backup */
-
-	    while (j < nhits5 && 
-		   hits5[j]->genomicend + querylength5 /* for scramble: */ + pairmax <= insert_start) {
-	      debug5(printf("  advance: j=%d/%d %u..%u %s %s %p\n",
-			    j,nhits5,hits5[j]->genomicstart - hits5[j]->chroffset,hits5[j]->genomicend - hits5[j]->chroffset,
-			    print_sense(hits5[j]->sensedir),hittype_string(hits5[j]->hittype),hits5[j]));
-	      j++;
+	    /* for scramble: window extends pairmax below insert_start */
+	    if ((lowj = window_lower_bound(hits5,lowj,nhits5,/*endp*/true,querylength5 + pairmax,insert_start)) >= nhits5) {
+	      break;
+	    } else if (hits5[lowj]->genomicend + querylength5 > pairmax + insert_start) {
+	      i = window_next_anchor(hits3,i + 1,nhits3,/*endp*/false,querylength3,
+				     hits5[lowj]->genomicend + querylength5);
+	      continue;
 	    }
 
+	    j = lowj;
 	    while (j < nhits5 && hits5[j]->genomicend + querylength5 <= pairmax + insert_start) {
 	      debug5(printf("  overlap: j=%d/%d %u..%u %s %s %p",
 			    j,nhits5,hits5[j]->genomicstart - hits5[j]->chroffset,hits5[j]->genomicend - hits5[j]->chroffset,
@@ -15964,7 +16031,6 @@ pair_up_concordant_aux (bool *abort_pairing_p, int *found_score, int *nconcordan
 
 	      j++;
 	    }
-	    j--;		/* Finish advance */
 
 	    i++;
 	  }
@@ -7,12 +7,21 @@ static char rcsid[] = "$Id: uniqscan.c 173896 2015-09-12 00:11:40Z twu $";
 #include <sys/types.h>		/* Needed to define pthread_t on Solaris */
 #endif
 
+#ifdef WORDS_BIGENDIAN
+#include "bigendian.h"
+#else
+#include "littleendian.h"
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>		/* For strcpy */
 #include <strings.h>		/* For rindex */
 #include <ctype.h>
 #include <math.h>		/* For rint */
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#endif
 
 #include "assert.h"
 #include "except.h"
@@ -138,6 +147,11 @@ static char *dbversion = NULL;
 /* Compute options */
 static bool from_right_p = false;
 
+/* Mappability track */
+static int mappability_length = 0;
+static char *mappability_file = NULL;
+static int nworkers = 1;
+
 static bool query_unk_mismatch_p = false;
 static bool genome_unk_mismatch_p = true;
 static bool novelsplicingp = false;
@@ -268,6 +282,9 @@ static struct option long_options[] = {
   /* Compute options */
   {"from-5-end", no_argument, 0, '5'}, /* from_right_p */
   {"from-3-end", no_argument, 0, '3'}, /* from_right_p */
+  {"mappability", required_argument, 0, 0}, /* mappability_length */
+  {"mappability-file", required_argument, 0, 0}, /* mappability_file */
+  {"nthreads", required_argument, 0, 't'}, /* nworkers */
 
   {"pairmax-dna", required_argument, 0, 0}, /* pairmax_dna */
   {"pairmax-rna", required_argument, 0, 0}, /* pairmax_rna */
@@ -561,6 +578,275 @@ uniqueness_scan (bool from_right_p) {
   return;
 }
 
+
+/************************************************************************
+ *   Mappability track.  Every window of mappability_length on the
+ *   forward strand is aligned, and the track records one bit per
+ *   window start, set if the window aligns to exactly one place.
+ *
+ *   File layout (native byte order):
+ *     UINT4 readlength, UINT4 nchromosomes, then per chromosome
+ *     UINT4 labellength, char label[labellength], UINT4 chrlength,
+ *     UINT4 nwindows, UINT4 bits[(nwindows+31)/32]
+ *   where bit (i % 32) of bits[i/32] is window i (0-based chrpos).
+ ************************************************************************/
+
+#define MAPPABILITY_CHUNK 4096	/* Windows per work unit.  Must be a multiple of 32 */
+
+static Univcoord_T *mappability_chroffsets;
+static Chrpos_T *mappability_nwindows;
+static UINT4 **mappability_bits;
+
+#ifdef HAVE_PTHREAD
+static pthread_mutex_t mappability_lock;
+#endif
+static int mappability_chrnum;	/* 0-based */
+static Chrpos_T mappability_chrpos;
+
+
+/* Hands out the next chunk of windows.  Chunks never span chromosomes
+   and start on a word boundary, so workers write disjoint words. */
+static bool
+mappability_next_chunk (int *chrnum, Chrpos_T *start, Chrpos_T *end) {
+  bool foundp = false;
+  char *label;
+  bool allocp;
+
+#ifdef HAVE_PTHREAD
+  pthread_mutex_lock(&mappability_lock);
+#endif
+  while (mappability_chrnum < nchromosomes &&
+	 mappability_chrpos >= mappability_nwindows[mappability_chrnum]) {
+    mappability_chrnum++;
+    mappability_chrpos = 0;
+  }
+
+  if (mappability_chrnum < nchromosomes) {
+    if (mappability_chrpos == 0) {
+      label = Univ_IIT_label(chromosome_iit,mappability_chrnum+1,&allocp);
+      fprintf(stderr,"Scanning %s (%u windows)\n",label,mappability_nwindows[mappability_chrnum]);
+      if (allocp == true) {
+	FREE(label);
+      }
+    }
+    *chrnum = mappability_chrnum;
+    *start = mappability_chrpos;
+    if ((*end = *start + MAPPABILITY_CHUNK) > mappability_nwindows[mappability_chrnum]) {
+      *end = mappability_nwindows[mappability_chrnum];
+    }
+    mappability_chrpos = *end;
+    foundp = true;
+  }
+#ifdef HAVE_PTHREAD
+  pthread_mutex_unlock(&mappability_lock);
+#endif
+
+  return foundp;
+}
+
+
+static void *
+mappability_worker (void *data) {
+  char *gbuffer, *window;
+  Chrpos_T start, end, chrpos, lastn;
+  int chrnum, i;
+  int npaths, first_absmq, second_absmq;
+  Stage3end_T *stage3array;
+  Shortread_T queryseq1;
+  Floors_T *floors_array;
+
+  Oligoindex_array_T oligoindices_major, oligoindices_minor;
+  Dynprog_T dynprogL, dynprogM, dynprogR;
+  Pairpool_T pairpool;
+  Diagpool_T diagpool;
+  Cellpool_T cellpool;
+
+  oligoindices_major = Oligoindex_array_new_major(MAX_QUERYLENGTH_FOR_ALLOC,MAX_GENOMICLENGTH_FOR_ALLOC);
+  oligoindices_minor = Oligoindex_array_new_minor(MAX_QUERYLENGTH_FOR_ALLOC,MAX_GENOMICLENGTH_FOR_ALLOC);
+  dynprogL = Dynprog_new(nullgap,EXTRAQUERYGAP,maxpeelback,extramaterial_end,extramaterial_paired,
+			 /*doublep*/true);
+  dynprogM = Dynprog_new(nullgap,EXTRAQUERYGAP,maxpeelback,extramaterial_end,extramaterial_paired,
+			 /*doublep*/false);
+  dynprogR = Dynprog_new(nullgap,EXTRAQUERYGAP,maxpeelback,extramaterial_end,extramaterial_paired,
+			 /*doublep*/true);
+  pairpool = Pairpool_new();
+  diagpool = Diagpool_new();
+  cellpool = Cellpool_new();
+  floors_array = (Floors_T *) CALLOC(MAX_READLENGTH+1,sizeof(Floors_T));
+
+#ifdef HAVE_PTHREAD
+  Except_stack_create();
+#endif
+
+  gbuffer = (char *) CALLOC(MAPPABILITY_CHUNK+mappability_length,sizeof(char));
+  window = (char *) CALLOC(mappability_length+1,sizeof(char));
+
+  while (mappability_next_chunk(&chrnum,&start,&end) == true) {
+    /* Fetch all windows of the chunk at once */
+    Genome_fill_buffer_simple(genome,mappability_chroffsets[chrnum] + start,
+			      (end - start) + mappability_length - 1,gbuffer);
+
+    /* Windows starting at or before lastn contain an N */
+    lastn = 0;
+    for (i = 0; i < mappability_length - 1; i++) {
+      if (gbuffer[i] == 'N') {
+	lastn = start + i + 1;
+      }
+    }
+
+    for (chrpos = start; chrpos < end; chrpos++) {
+      if (gbuffer[chrpos - start + mappability_length - 1] == 'N') {
+	lastn = chrpos + mappability_length;
+      }
+      if (lastn > chrpos) {
+	/* Window contains an unknown base, so leave it unmappable */
+      } else {
+	strncpy(window,&(gbuffer[chrpos - start]),mappability_length);
+	queryseq1 = Shortread_new(/*acc*/NULL,/*restofheader*/NULL,/*filterp*/false,window,/*long_sequence*/NULL,
+				  /*sequence_length*/mappability_length,/*quality*/NULL,/*long_quality*/NULL,
+				  /*quality_length*/0,/*barcode_length*/0,/*invertp*/0,/*copy_acc_p*/false,
+				  /*skipp*/false);
+	stage3array = Stage1_single_read(&npaths,&first_absmq,&second_absmq,
+					 queryseq1,indexdb,indexdb2,indexdb_size_threshold,
+					 floors_array,user_maxlevel_float,user_mincoverage_float,
+					 indel_penalty_middle,indel_penalty_end,
+					 allow_end_indels_p,max_end_insertions,max_end_deletions,min_indel_end_matches,
+					 localsplicing_penalty,/*distantsplicing_penalty*/100,min_shortend,
+					 oligoindices_major,oligoindices_minor,pairpool,diagpool,cellpool,
+					 dynprogL,dynprogM,dynprogR,/*keep_floors_p*/true);
+	if (npaths == 1) {
+	  mappability_bits[chrnum][chrpos/32] |= (1U << (chrpos % 32));
+	}
+
+	for (i = 0; i < npaths; i++) {
+	  Stage3end_free(&(stage3array[i]));
+	}
+	FREE_OUT(stage3array);
+	Shortread_free(&queryseq1);
+      }
+    }
+
+    Pairpool_free_memory(pairpool);
+    Diagpool_free_memory(diagpool);
+    Cellpool_free_memory(cellpool);
+  }
+
+  FREE(window);
+  FREE(gbuffer);
+
+#ifdef HAVE_PTHREAD
+  Except_stack_destroy();
+#endif
+
+  for (i = 0; i <= MAX_READLENGTH; i++) {
+    if (floors_array[i] != NULL) {
+      Floors_free_keep(&(floors_array[i]));
+    }
+  }
+  FREE(floors_array);
+
+  Cellpool_free(&cellpool);
+  Diagpool_free(&diagpool);
+  Pairpool_free(&pairpool);
+  Dynprog_free(&dynprogR);
+  Dynprog_free(&dynprogM);
+  Dynprog_free(&dynprogL);
+  Oligoindex_array_free(&oligoindices_minor);
+  Oligoindex_array_free(&oligoindices_major);
+
+  return (void *) NULL;
+}
+
+
+static void
+mappability_scan (char *filename, int nworkers) {
+  FILE *fp;
+  Univcoord_T *chrhighs;
+  Chrpos_T *chrlengths;
+  UINT4 nwords, value;
+  char *label;
+  bool allocp;
+  int chrnum;
+#ifdef HAVE_PTHREAD
+  pthread_t *worker_thread_ids;
+  pthread_attr_t thread_attr_join;
+  int worker_id;
+#endif
+
+  if ((fp = FOPEN_WRITE_BINARY(filename)) == NULL) {
+    fprintf(stderr,"Can't open file %s for writing\n",filename);
+    exit(9);
+  }
+
+  Univ_IIT_intervals_setup(&mappability_chroffsets,&chrhighs,&chrlengths,chromosome_iit,
+			   nchromosomes,circular_typeint);
+  mappability_nwindows = (Chrpos_T *) CALLOC(nchromosomes,sizeof(Chrpos_T));
+  mappability_bits = (UINT4 **) CALLOC(nchromosomes,sizeof(UINT4 *));
+  for (chrnum = 0; chrnum < nchromosomes; chrnum++) {
+    if (chrlengths[chrnum] >= (Chrpos_T) mappability_length) {
+      mappability_nwindows[chrnum] = chrlengths[chrnum] - mappability_length + 1;
+    }
+    mappability_bits[chrnum] = (UINT4 *) CALLOC((mappability_nwindows[chrnum] + 31)/32 + 1,sizeof(UINT4));
+  }
+  mappability_chrnum = 0;
+  mappability_chrpos = 0;
+
+#ifdef HAVE_PTHREAD
+  if (nworkers > 1) {
+    pthread_mutex_init(&mappability_lock,NULL);
+    pthread_attr_init(&thread_attr_join);
+    pthread_attr_setdetachstate(&thread_attr_join,PTHREAD_CREATE_JOINABLE);
+    Except_init_pthread();
+
+    worker_thread_ids = (pthread_t *) CALLOC(nworkers,sizeof(pthread_t));
+    for (worker_id = 0; worker_id < nworkers; worker_id++) {
+      pthread_create(&(worker_thread_ids[worker_id]),&thread_attr_join,mappability_worker,(void *) NULL);
+    }
+    for (worker_id = 0; worker_id < nworkers; worker_id++) {
+      pthread_join(worker_thread_ids[worker_id],NULL);
+    }
+    FREE(worker_thread_ids);
+    pthread_mutex_destroy(&mappability_lock);
+  } else {
+    pthread_mutex_init(&mappability_lock,NULL);
+    Except_init_pthread();
+    mappability_worker((void *) NULL);
+    pthread_mutex_destroy(&mappability_lock);
+  }
+#else
+  mappability_worker((void *) NULL);
+#endif
+
+  value = mappability_length;
+  FWRITE_UINT(value,fp);
+  value = nchromosomes;
+  FWRITE_UINT(value,fp);
+  for (chrnum = 0; chrnum < nchromosomes; chrnum++) {
+    label = Univ_IIT_label(chromosome_iit,chrnum+1,&allocp);
+    value = strlen(label);
+    FWRITE_UINT(value,fp);
+    FWRITE_CHARS(label,value,fp);
+    if (allocp == true) {
+      FREE(label);
+    }
+    FWRITE_UINT(chrlengths[chrnum],fp);
+    FWRITE_UINT(mappability_nwindows[chrnum],fp);
+    nwords = (mappability_nwindows[chrnum] + 31)/32;
+    FWRITE_UINTS(mappability_bits[chrnum],nwords,fp);
+    FREE(mappability_bits[chrnum]);
+  }
+  fclose(fp);
+
+  FREE(mappability_bits);
+  FREE(mappability_nwindows);
+  FREE(chrlengths);
+  FREE(chrhighs);
+  FREE(mappability_chroffsets);
+
+  return;
+}
+
+
 static int
 add_gmap_mode (char *string) {
   if (!strcmp(string,"none")) {
@@ -753,7 +1039,7 @@ main (int argc, char *argv[]) {
   char *string;
 
   while ((opt = getopt_long(argc,argv,
-			    "D:d:k:q:GN:M:m:i:y:Y:z:Z:w:e:l:g:S:s:V:v:53",
+			    "D:d:k:q:GN:M:m:i:y:Y:z:Z:w:e:l:g:S:s:V:v:53t:",
 			    long_options, &long_option_index)) != -1) {
     switch (opt) {
     case 0:
@@ -785,6 +1071,15 @@ main (int argc, char *argv[]) {
 	  exit(9);
 	}
 
+      } else if (!strcmp(long_name,"mappability")) {
+	mappability_length = atoi(optarg);
+	if (mappability_length <= 0 || mappability_length > MAX_READLENGTH) {
+	  fprintf(stderr,"--mappability must be between 1 and %d\n",MAX_READLENGTH);
+	  exit(9);
+	}
+      } else if (!strcmp(long_name,"mappability-file")) {
+	mappability_file = optarg;
+
       } else if (!strcmp(long_name,"cmetdir")) {
 	user_cmetdir = optarg;
       } else if (!strcmp(long_name,"atoidir")) {
@@ -948,6 +1243,7 @@ main (int argc, char *argv[]) {
 
     case '5': from_right_p = false; break;
     case '3': from_right_p = true; break;
+    case 't': nworkers = atoi(optarg); break;
 
     case '?': fprintf(stderr,"For usage, run 'gsnap --help'\n"); exit(9);
     default: exit(9);
@@ -959,6 +1255,11 @@ main (int argc, char *argv[]) {
 
   Except_inactivate();
 
+  if (mappability_length > 0 && mappability_file == NULL) {
+    fprintf(stderr,"--mappability requires --mappability-file\n");
+    exit(9);
+  }
+
   if (dbroot == NULL) {
     fprintf(stderr,"Need to specify the -d flag.  For usage, run 'gsnap --help'\n");
     /* print_program_usage(); */
@@ -1015,8 +1316,10 @@ main (int argc, char *argv[]) {
   FREE(iitfile);
 
 
+  /* Compiled with GSNAP, so the block readers expect the genomebits128
+     layout, as does Genome_hr_setup */
   if (snps_root == NULL) {
-    genome = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
+    genome = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_BITS,
 			uncompressedp,genome_access,/*sharedp*/false);
     if (mode == CMET_STRANDED || mode == CMET_NONSTRANDED) {
       if (user_cmetdir == NULL) {
@@ -1116,9 +1419,9 @@ main (int argc, char *argv[]) {
     }
 
     /* SNPs */
-    genome = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_OLIGOS,
+    genome = Genome_new(genomesubdir,fileroot,/*snps_root*/NULL,/*genometype*/GENOME_BITS,
 			uncompressedp,genome_access,/*sharedp*/false);
-    genomealt = Genome_new(snpsdir,fileroot,snps_root,/*genometype*/GENOME_OLIGOS,
+    genomealt = Genome_new(snpsdir,fileroot,snps_root,/*genometype*/GENOME_BITS,
 			   uncompressedp,genome_access,/*sharedp*/false);
 
     if (mode == CMET_STRANDED || mode == CMET_NONSTRANDED) {
@@ -1309,7 +1612,11 @@ main (int argc, char *argv[]) {
 		 novelsplicingp,/*merge_samechr_p*/false,circularp,/*failedinput_root*/NULL,
 		 /*print_m8_p*/false,/*want_random_p*/true);
 
-  uniqueness_scan(from_right_p);
+  if (mappability_length > 0) {
+    mappability_scan(mappability_file,nworkers);
+  } else {
+    uniqueness_scan(from_right_p);
+  }
 
   Dynprog_term();
 
@@ -1424,6 +1731,23 @@ Usage: gsnap [OPTIONS...] <FASTA file>, or\n\
   fprintf(stdout,"\
   -5, --from-5-end               Compute successive substrings from 5' end (default)\n\
   -3, --from-3-end               Compute successive substrings from 3' end\n\
+  --mappability=INT              Instead of reading sequences from stdin, align every window\n\
+                                   of this length in the genome and write a binary track\n\
+                                   with one bit per window start, set if the window\n\
+                                   aligns uniquely\n\
+  --mappability-file=STRING      File for the mappability track (required with --mappability)\n\
+");
+#ifdef HAVE_PTHREAD
+  fprintf(stdout,"\
+  -t, --nthreads=INT             Number of worker threads for --mappability (default 1)\n\
+");
+#else
+  fprintf(stdout,"\
+  -t, --nthreads=INT             Number of worker threads.  Flag is ignored in this version,\n\
+                                   which has pthreads disabled\n\
+");
+#endif
+  fprintf(stdout,"\
   -m, --max-mismatches=FLOAT     Maximum number of mismatches allowed (if not specified, then\n\
                                    defaults to the ultrafast level of ((readlength+2)/12 - 2))\n\
                                    If specified between 0.0 and 1.0, then treated as a fraction\n\